@@ -27,4 +27,8 @@ elseif(APPLE)
 # MESSAGE( STATUS "sys root " ${CMAKE_OSX_SYSROOT} )
 endif()
 
+# ---[ Threads, for the BD output thread
+find_package(Threads REQUIRED)
+list(APPEND PBSAM_LINKER_LIBS ${CMAKE_THREAD_LIBS_INIT})
+
 MESSAGE( STATUS "linkers: " ${PBSAM_LINKER_LIBS} )
@@ -0,0 +1,76 @@
+//
+//  AllocCounter.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef AllocCounter_h
+#define AllocCounter_h
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/*
+ Count of heap allocations made through the global operator new. The
+ counter is always available but only advances in a binary where exactly
+ one translation unit defines PB_COUNT_ALLOCS before including this header,
+ which installs counting replacements of operator new and delete. Used to
+ check that the solver inner loops stay allocation free.
+ */
+class AllocCounter
+{
+public:
+  static atomic<long> & count()
+  {
+    static atomic<long> ct(0);
+    return ct;
+  }
+  
+  static long get_count() { return count().load(); }
+  static void reset()     { count().store(0); }
+};
+
+#ifdef PB_COUNT_ALLOCS
+void * operator new(size_t sz)
+{
+  AllocCounter::count()++;
+  void * ptr = malloc(sz > 0 ? sz : 1);
+  if (ptr == NULL) throw bad_alloc();
+  return ptr;
+}
+
+void operator delete(void * ptr) noexcept
+{
+  free(ptr);
+}
+#endif
+
+#endif /* AllocCounter_h */
@@ -0,0 +1,132 @@
+//
+//  AsyncOutput.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef AsyncOutput_h
+#define AsyncOutput_h
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+ Runs output jobs in order on a dedicated I/O thread, so that a simulation
+ does not wait on the file system. Jobs are closures that own a copy of
+ what they write. They pass through a bounded single-producer,
+ single-consumer ring: post() returns as soon as the job is queued and only
+ waits (back-pressure) while the ring is full. flush() returns once every
+ posted job has run, the destructor flushes and stops the thread.
+ Only one thread may post.
+ */
+class AsyncOutput
+{
+protected:
+  vector<function<void()> > ring_;
+  size_t                    cap_;
+  atomic<size_t>            head_;  // next job to run
+  atomic<size_t>            tail_;  // next free slot
+  atomic<bool>              stop_;
+  thread                    io_;
+  
+  // spin briefly, then sleep, while waiting on the other thread
+  static void backoff(int & spins)
+  {
+    if (++spins < 64) this_thread::yield();
+    else this_thread::sleep_for(chrono::microseconds(spins < 256 ? 50 : 500));
+  }
+  
+  void run_io()
+  {
+    int spins = 0;
+    while (true)
+    {
+      size_t h = head_.load(memory_order_relaxed);
+      if (h == tail_.load(memory_order_acquire))
+      {
+        if (stop_.load(memory_order_acquire) &&
+            h == tail_.load(memory_order_acquire)) return;
+        backoff(spins);
+        continue;
+      }
+      spins = 0;
+      function<void()> job;
+      job.swap(ring_[h % cap_]);
+      try
+      {
+        job();
+      } catch (const exception & ex)
+      {
+        cout << "Output failed: " << ex.what() << endl;
+      }
+      head_.store(h + 1, memory_order_release);
+    }
+  }
+  
+public:
+  AsyncOutput(size_t capacity = 64)
+  :ring_(capacity > 0 ? capacity : 1), cap_(ring_.size()), head_(0), tail_(0),
+  stop_(false)
+  {
+    io_ = thread(&AsyncOutput::run_io, this);
+  }
+  
+  ~AsyncOutput()
+  {
+    stop_.store(true, memory_order_release);
+    io_.join();
+  }
+  
+  void post(function<void()> job)
+  {
+    size_t t = tail_.load(memory_order_relaxed);
+    int spins = 0;
+    while (t - head_.load(memory_order_acquire) >= cap_) backoff(spins);
+    ring_[t % cap_] = move(job);
+    tail_.store(t + 1, memory_order_release);
+  }
+  
+  void flush()
+  {
+    int spins = 0;
+    while (head_.load(memory_order_acquire) != tail_.load(memory_order_relaxed))
+      backoff(spins);
+  }
+  
+  size_t get_capacity() const { return cap_; }
+  size_t get_pending() const
+  { return tail_.load(memory_order_acquire) - head_.load(memory_order_acquire); }
+};
+
+#endif /* AsyncOutput_h */
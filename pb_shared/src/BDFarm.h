@@ -0,0 +1,174 @@
+//
+//  BDFarm.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BDFarm_h
+#define BDFarm_h
+
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MPIShard.h"
+
+using namespace std;
+
+/*
+ Runs the trajectories of a BD run side by side on a pool of threads, and
+ across MPI ranks when started with mpirun. Each worker owns its own system
+ and solvers, made by make_worker(w) on the calling thread before any
+ trajectory starts, and takes the next trajectory number until all are
+ done. Numbers come from one counter shared by all ranks, so a rank that
+ draws long trajectories takes fewer of them. A trajectory returns its
+ stats lines, which are appended to statfile in trajectory order: as soon
+ as all earlier trajectories have finished on one rank, or by rank 0 once
+ every rank is done with MPI. The .stat file reads the same whatever the
+ number of threads and ranks. Progress is printed here too, under the stats
+ lock, so that workers never write to cout themselves. The first exception
+ thrown by a trajectory stops the farm on that rank and is rethrown by run().
+ */
+class BDFarm
+{
+public:
+  // runs trajectory traj and returns its stats lines
+  typedef function<vector<string>(int traj)> TrajFn;
+  
+protected:
+  int                        nthreads_;
+  int                        nranks_;
+  int                        ntraj_;
+  string                     statfile_;
+  
+  MPIShard::Counter *        next_;  // hands out trajectory numbers
+  mutex                      nextMtx_;
+  atomic<bool>               stop_;
+  mutex                      statMtx_;
+  int                        nextStat_;  // next trajectory to write stats of
+  map<int, vector<string> >  doneStats_;  // finished, waiting on earlier ones
+  exception_ptr              error_;
+  
+  int next_traj()
+  {
+    lock_guard<mutex> lock(nextMtx_);
+    return stop_ ? ntraj_ : next_->next();
+  }
+  
+  // write out the stats of every finished trajectory up to the first gap
+  void write_stats()
+  {
+    if (doneStats_.find(nextStat_) == doneStats_.end()) return;
+    ofstream out;
+    if (!statfile_.empty())
+      out.open(statfile_, fstream::in | fstream::out | fstream::app);
+    map<int, vector<string> >::iterator it;
+    while ((it = doneStats_.find(nextStat_)) != doneStats_.end())
+    {
+      for (int k = 0; k < it->second.size(); k++)
+        out << it->second[k] << endl;
+      doneStats_.erase(it);
+      nextStat_++;
+    }
+  }
+  
+  void add_stats(int traj, const vector<string> & lines)
+  {
+    lock_guard<mutex> lock(statMtx_);
+    cout << "Done with trajectory " << traj << endl;
+    doneStats_[traj] = lines;
+    if (nranks_ == 1) write_stats();
+  }
+  
+  void work(TrajFn traj_fn)
+  {
+    int traj;
+    while ((traj = next_traj()) < ntraj_)
+    {
+      try
+      {
+        add_stats(traj, traj_fn(traj));
+      } catch (...)
+      {
+        lock_guard<mutex> lock(statMtx_);
+        if (!error_) error_ = current_exception();
+        stop_ = true;
+        return;
+      }
+    }
+  }
+  
+public:
+  BDFarm(int nthreads, int ntraj, string statfile)
+  :nthreads_(max(1, min(nthreads, ntraj))), nranks_(MPIShard::size()),
+  ntraj_(ntraj), statfile_(statfile), next_(NULL), stop_(false), nextStat_(0)
+  {
+    if (!MPIShard::threads_ok()) nthreads_ = 1;
+  }
+  
+  // worker 0 runs on the calling thread. With MPI every rank calls run()
+  void run(function<TrajFn(int worker)> make_worker)
+  {
+    int w;
+    vector<TrajFn> workers(nthreads_);
+    for (w = 0; w < nthreads_; w++) workers[w] = make_worker(w);
+    
+    MPIShard::Counter counter;
+    next_ = &counter;
+    vector<thread> pool;
+    for (w = 1; w < nthreads_; w++)
+      pool.push_back(thread(&BDFarm::work, this, workers[w]));
+    work(workers[0]);
+    for (w = 0; w < pool.size(); w++) pool[w].join();
+    
+    if (nranks_ > 1)
+    {
+      // trajectories missing after a failure are skipped
+      MPIShard::gather(doneStats_);
+      while (MPIShard::rank() == 0 && !doneStats_.empty())
+      {
+        nextStat_ = doneStats_.begin()->first;
+        write_stats();
+      }
+    }
+    next_ = NULL;
+    
+    if (error_) rethrow_exception(error_);
+  }
+  
+  const int get_nthreads() const { return nthreads_; }
+  const int get_nranks() const   { return nranks_; }
+};
+
+#endif /* BDFarm_h */
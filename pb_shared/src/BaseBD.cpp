@@ -118,17 +118,19 @@ BaseBDStep::BaseBDStep(shared_ptr<BaseSystem> _sys,
                        vector<double> rot_diff_consts,
                        bool diff, bool force)
 :transDiffConsts_(trans_diff_consts), rotDiffConsts_(rot_diff_consts),
-diff_(diff), force_(force), _sys_(_sys), _consts_(_consts)
+diff_(diff), force_(force), farGap_(0.0), bSurf_(0.0), escaped_(false),
+_sys_(_sys), _consts_(_consts)
 {
   random_device rd;
-  randGen_ = mt19937(rd());
+  set_rand_seed(rd(), 0);
 }
 
 BaseBDStep::BaseBDStep(shared_ptr<BaseSystem> _sys,
                        shared_ptr<Constants> _consts,
                        bool diff, bool force)
 :transDiffConsts_(_sys->get_n()), rotDiffConsts_(_sys->get_n()),
-diff_(diff), force_(force), _sys_(_sys), _consts_(_consts)
+diff_(diff), force_(force), farGap_(0.0), bSurf_(0.0), escaped_(false),
+_sys_(_sys), _consts_(_consts)
 {
   for (int i = 0; i < _sys_->get_n(); i++)
   {
@@ -137,7 +139,7 @@ diff_(diff), force_(force), _sys_(_sys), _consts_(_consts)
   }
   
   random_device rd;
-  randGen_ = mt19937(rd());
+  set_rand_seed(rd(), 0);
 }
 
 
@@ -150,11 +152,27 @@ double BaseBDStep::compute_dt( )
   return 2.0;
 }
 
-Pt BaseBDStep::rand_vec(double mean, double var)
+void BaseBDStep::draw_kicks()
 {
-  normal_distribution<double> dist (mean, sqrt(var));
-  Pt pout = Pt(dist(randGen_), dist(randGen_), dist(randGen_));
-  return pout;
+  kicks_.resize(6 * _sys_->get_n());
+  Philox::gaussians({{seed_, stream_}}, step_, 0, 0, &kicks_[0],
+                    (int) kicks_.size());
+}
+
+Pt BaseBDStep::rand_kick(int i, bool rot, int attempt, double var)
+{
+  double sd = sqrt(var);
+  if (attempt == 0)
+  {
+    const double * k = &kicks_[6*i + (rot ? 3 : 0)];
+    return Pt(k[0]*sd, k[1]*sd, k[2]*sd);
+  }
+  
+  // retries after an overlap draw from their own counters
+  double k[3];
+  Philox::gaussians({{seed_, stream_}}, step_, attempt, 2*i + (rot ? 2 : 1),
+                    k, 3);
+  return Pt(k[0]*sd, k[1]*sd, k[2]*sd);
 }
 
 void BaseBDStep::indi_trans_update(int i, Pt fi)
@@ -170,8 +188,9 @@ void BaseBDStep::indi_trans_update(int i, Pt fi)
   int tries = 0;
   while (!accept && tries < 500)
   {
+    rand = (diff_) ? rand_kick(i, false, tries, 2*transDiffConsts_[i]*dt_)
+                   : Pt(0.0,0.0,0.0);
     tries++;
-    rand = (diff_) ? rand_vec(0,2*transDiffConsts_[i]*dt_) : Pt(0.0,0.0,0.0);
     _sys_->translate_mol(i, dr + rand);
     accept = true;
     try {
@@ -196,9 +215,11 @@ void BaseBDStep::indi_rot_update(int i, Pt tau_i)
   
   Pt dtheta = (tau_i * coeff);
   
+  int tries = 0;
   while (! accept)
   {
-    rand = (diff_) ? rand_vec(0,2*rotDiffConsts_[i]*dt_) : Pt(0.0,0.0,0.0);
+    rand = (diff_) ? rand_kick(i, true, tries++, 2*rotDiffConsts_[i]*dt_)
+                   : Pt(0.0,0.0,0.0);
     dtheta = dtheta + rand;
     
     // creating zero quaternion if there is no rot
@@ -221,6 +242,7 @@ void BaseBDStep::bd_update(shared_ptr<vector<Pt> > _F,
   int i;
   compute_min_dist();
   dt_ = compute_dt();
+  if (diff_) draw_kicks();
   
   for (i = 0; i < _sys_->get_n(); i++)
   {
@@ -232,11 +254,228 @@ void BaseBDStep::bd_update(shared_ptr<vector<Pt> > _F,
     if ( rotDiffConsts_[i] != 0) indi_rot_update(i, _tau->operator[](i));
   }
   update_sys_time(dt_);
+  step_++;
+}
+
+double BaseBDStep::bounding_rad(int i)
+{
+  Pt cen = _sys_->get_unwrapped_center(i);
+  double rad = 0.0;
+  for (int k = 0; k < _sys_->get_Ns_i(i); k++)
+  {
+    double d = _sys_->get_pbc_dist_vec_base(cen, _sys_->get_centerik(i, k))
+                    .norm() + _sys_->get_aik(i, k);
+    if (d > rad) rad = d;
+  }
+  return rad;
+}
+
+void BaseBDStep::free_rotate(int i, double t, PhiloxStream & rng)
+{
+  double var = 2.0 * rotDiffConsts_[i] * t;
+  Quat qrot;
+  
+  // past a few radians^2 the orientation has forgotten where it started,
+  // otherwise in small enough pieces that each is a Gaussian rotation
+  if (var > 4.0) qrot = qrot.chooseRandom(rng);
+  else
+  {
+    int m = (int) ceil(var / 0.05);
+    double sd = sqrt(var / m);
+    for (int s = 0; s < m; s++)
+    {
+      Pt dtheta(rng.normal()*sd, rng.normal()*sd, rng.normal()*sd);
+      if (dtheta.norm() < 1e-15) continue;
+      qrot = Quat(dtheta.norm(), dtheta) * qrot;
+    }
+  }
+  
+  // SAM molecules turn about the origin, so about their cog from there
+  Pt cog = _sys_->get_cogi(i);
+  _sys_->translate_mol(i, cog * -1.0);
+  _sys_->rotate_mol(i, qrot);
+  _sys_->translate_mol(i, cog);
+}
+
+double BaseBDStep::return_to_b(int m, double r, PhiloxStream & rng)
+{
+  Pt cen = _sys_->get_unwrapped_center(m);
+  Pt e = cen * (1.0/r), u, v;
+  
+  // two directions normal to e
+  u = (fabs(e.x()) < 0.9) ? Pt(1.0, 0.0, 0.0) : Pt(0.0, 1.0, 0.0);
+  u = u - e * u.dot(e);
+  u = u * (1.0/u.norm());
+  v = Pt(e.y()*u.z() - e.z()*u.y(), e.z()*u.x() - e.x()*u.z(),
+         e.x()*u.y() - e.y()*u.x());
+  
+  for (int tries = 0; tries < 500; tries++)
+  {
+    double x = FreeDiffusion::return_cos(r, bSurf_, rng.uniform());
+    double phi = 2.0 * M_PI * rng.uniform(), sn = sqrt(1.0 - x*x);
+    Pt dr = (e * x + u * (sn*cos(phi)) + v * (sn*sin(phi))) * bSurf_ - cen;
+    _sys_->translate_mol(m, dr);
+    try {
+      _sys_->check_for_overlap();
+      break;
+    } catch (OverlappingMoleculeException) {
+      _sys_->translate_mol(m, dr * -1);
+    }
+  }
+  return FreeDiffusion::return_time(r, bSurf_, transDiffConsts_[m],
+                                    rng.normal());
+}
+
+bool BaseBDStep::far_update()
+{
+  int i, j, n = _sys_->get_n();
+  escaped_ = false;
+  if (farGap_ <= 0.0 || !diff_) return false;
+  
+  vector<int> mobile;
+  for (i = 0; i < n; i++)
+    if (transDiffConsts_[i] != 0) mobile.push_back(i);
+  if (mobile.empty()) return false;
+  
+  vector<double> brad(n), dom(mobile.size(), _sys_->get_boxlength()/4.0);
+  for (i = 0; i < n; i++) brad[i] = bounding_rad(i);
+  
+  // sphere each mobile molecule may wander in, half the spare gap to other
+  // mobile molecules so that their spheres cannot meet
+  for (int a = 0; a < mobile.size(); a++)
+  {
+    i = mobile[a];
+    for (j = 0; j < n; j++)
+    {
+      if (j == i) continue;
+      double gap = _sys_->get_pbc_dist_vec_base(_sys_->get_unwrapped_center(i),
+                                     _sys_->get_unwrapped_center(j)).norm()
+                   - brad[i] - brad[j] - farGap_;
+      if (gap <= 0.0) return false;
+      if (transDiffConsts_[j] != 0) gap *= 0.5;
+      if (gap < dom[a]) dom[a] = gap;
+    }
+  }
+  
+  // not worth it unless every molecule goes further than in a normal step
+  compute_min_dist();
+  double dt = compute_dt();
+  for (int a = 0; a < mobile.size(); a++)
+    if (dom[a] < sqrt(6.0 * transDiffConsts_[mobile[a]] * dt)) return false;
+  
+  // its own counter slot, apart from the kicks of draw_kicks and rand_kick
+  PhiloxStream rng(seed_, stream_, step_, 0xFFFFFFFE);
+  double tstep;
+  
+  double r = _sys_->get_unwrapped_center(mobile[0]).norm();
+  if (bSurf_ > 0.0 && mobile.size() == 1 && r > bSurf_)
+  {
+    if (rng.uniform() > FreeDiffusion::return_prob(r, bSurf_))
+    {
+      escaped_ = true;
+      step_++;
+      return true;
+    }
+    tstep = return_to_b(mobile[0], r, rng);
+  } else
+  {
+    vector<double> texit(mobile.size());
+    int first = 0;
+    for (int a = 0; a < mobile.size(); a++)
+    {
+      texit[a] = FreeDiffusion::exit_time(dom[a], transDiffConsts_[mobile[a]],
+                                          rng.uniform());
+      if (texit[a] < texit[first]) first = a;
+    }
+    tstep = texit[first];
+    
+    for (int a = 0; a < mobile.size(); a++)
+    {
+      double rad = (a == first) ? dom[a] :
+                   FreeDiffusion::radius(dom[a], transDiffConsts_[mobile[a]],
+                                         tstep, rng.uniform());
+      double cth = 2.0 * rng.uniform() - 1.0, phi = 2.0*M_PI*rng.uniform();
+      double sth = sqrt(1.0 - cth*cth);
+      _sys_->translate_mol(mobile[a], Pt(sth*cos(phi), sth*sin(phi), cth)*rad);
+    }
+  }
+  
+  for (i = 0; i < n; i++)
+    if (rotDiffConsts_[i] != 0) free_rotate(i, tstep, rng);
+  
+  dt_ = tstep;
+  update_sys_time(tstep);
+  step_++;
+  return true;
+}
+
+string BaseBDStep::get_how_escaped() const
+{
+  char buff[400];
+  sprintf(buff, "System has escaped: r >= %5.2f without return;\t", bSurf_);
+  return buff;
 }
 
 BaseBDRun::BaseBDRun(shared_ptr<BaseTerminate> _terminator, string outfname,
                      int num, bool diff, bool force, int maxiter, double prec)
-:maxIter_(maxiter), prec_(prec), _terminator_(_terminator)
+:maxIter_(maxiter), prec_(prec), _terminator_(_terminator), poseDouble_(false)
+{
+}
+
+void BaseBDRun::open_output(string trajfile, string statfile)
+{
+  string ext = ".ptraj";
+  if (trajfile.size() > ext.size() &&
+      trajfile.compare(trajfile.size()-ext.size(), ext.size(), ext) == 0)
+    _poseOut_ = make_shared<PoseTrajWriter>(trajfile, _stepper_->get_system(),
+                                            typePQR_, !poseDouble_);
+  else
+    xyzOut_.open(trajfile);
+  if (!statfile.empty())
+    statsOut_.open(statfile, fstream::in | fstream::out | fstream::app);
+  stats_.clear();
+  _io_ = make_shared<AsyncOutput>();
+}
+
+void BaseBDRun::write_output(int step, bool phys)
+{
+  shared_ptr<BaseSystem> sys = _stepper_->get_system();
+  if (_poseOut_)
+  {
+    vector<double> energies(sys->get_n());
+    for (int i = 0; i < sys->get_n(); i++)
+      energies[i] = _physCalc_->get_omegai(i);
+    shared_ptr<PoseTrajWriter> out = _poseOut_;
+    PoseTrajectory::Frame fr = out->snapshot(step, energies);
+    _io_->post([out, fr] () { out->write_frame(fr); });
+  } else
+  {
+    ofstream * out = &xyzOut_;
+    BaseSystem::XYZFrame fr = sys->get_xyz_frame();
+    _io_->post([out, fr] () { BaseSystem::write_xyz_frame(*out, fr); });
+  }
+  
+  if (!phys) return;
+  PhysSnapshot snap = _physCalc_->snapshot();
+  _io_->post([snap] () { BasePhysCalc::print_snapshot(snap); });
+}
+
+void BaseBDRun::write_stats(string line)
+{
+  if (!statsOut_.is_open())
+  {
+    stats_.push_back(line);
+    return;
+  }
+  ofstream * out = &statsOut_;
+  _io_->post([out, line] () { *out << line << endl; });
+}
+
+void BaseBDRun::close_output()
 {
+  _io_.reset();
+  if (_poseOut_) _poseOut_.reset();
+  else xyzOut_.close();
+  statsOut_.close();
 }
 
@@ -15,6 +15,12 @@
 #include <vector>
 #include "BaseSys.h"
 #include "BasePhysCalc.h"
+#include "PoseTrajectory.h"
+#include "AsyncOutput.h"
+#include "Philox.h"
+#include "FreeDiffusion.h"
+#include "MultiStepForce.h"
+#include "PairTable.h"
 
 using namespace std;
 /*
@@ -105,8 +111,20 @@ protected:
   double dt_;
   double min_dist_;
   
-  // random number generator object:
-  mt19937 randGen_;
+  // random kicks are Philox draws keyed by (seed, stream) with counter
+  // (step, attempt, slot), so they do not depend on draw order or thread
+  unsigned seed_;
+  unsigned stream_;
+  unsigned step_;
+  vector<double> kicks_;  // first attempt kicks of a step, 6 per molecule
+  
+  // far field: molecules whose gaps all exceed farGap_ are moved by free
+  // diffusion (see far_update). With bSurf_ > 0 a lone mobile molecule past
+  // it escapes or comes back by the return probability
+  double farGap_;
+  double bSurf_;
+  bool escaped_;
+  
   shared_ptr<BaseSystem> _sys_;
   shared_ptr<Constants> _consts_;
   
@@ -124,12 +142,27 @@ protected:
   // this is really the only function that will differ in sub classes
   virtual void compute_min_dist( ) { }
   
-  // return a random vector with each element drawn from a Gaussian
-  Pt rand_vec(double mean, double var);
+  // draw the first attempt translational and rotational kicks of every
+  // molecule for this step in one call
+  void draw_kicks();
+  
+  // random kick with variance var per element for molecule i, rotational
+  // if rot, on attempt number attempt of its move
+  Pt rand_kick(int i, bool rot, int attempt, double var);
   
   // update System time
   void update_sys_time(double dt) { _sys_->set_time(_sys_->get_time() + dt); }
   
+  // radius about the rotation center that holds all spheres of molecule i
+  double bounding_rad(int i);
+  
+  // rotational diffusion of molecule i over time t without torque
+  void free_rotate(int i, double t, PhiloxStream & rng);
+  
+  // put the lone mobile molecule m at distance r > bSurf_ back on the
+  // b-surface, returning the time taken
+  double return_to_b(int m, double r, PhiloxStream & rng);
+  
 public:
   BaseBDStep(shared_ptr<BaseSystem> _sys, shared_ptr<Constants> _consts,
            vector<double> trans_diff_consts,
@@ -145,6 +178,37 @@ public:
   void bd_update(shared_ptr<vector<Pt> > _F,
                  shared_ptr<vector<Pt> > _tau);
   
+  /*
+   If every molecule that translates is more than farGap_ from all others,
+   move them without forces and return true. Each gets a sphere about its
+   center that keeps it that far from the rest, and the first of them to
+   reach its sphere sets the step: it is put on its surface and the others
+   where diffusion that has not left its sphere is at that time. A lone
+   mobile molecule past bSurf_ from the origin instead escapes, ending the
+   trajectory (see get_escaped), or is put back on the b-surface
+   */
+  bool far_update();
+  
+  // gap beyond which molecules are moved by far_update (0 turns it off) and
+  // b-surface radius for escapes (0 for none)
+  void set_far_field(double gap, double b = 0.0)
+  {
+    farGap_ = gap;
+    bSurf_  = b;
+  }
+  
+  bool get_escaped() const { return escaped_; }
+  string get_how_escaped() const;
+  
+  // reseed the random kicks with stream of seed, so each trajectory of a
+  // run gets its own reproducible sequence
+  void set_rand_seed(unsigned seed, unsigned stream)
+  {
+    seed_   = seed;
+    stream_ = stream;
+    step_   = 0;
+  }
+  
   shared_ptr<BaseSystem> get_system() { return _sys_; }
   double get_dt()                     { return dt_; }
   double get_min_dist()               { return min_dist_; }
@@ -159,12 +223,33 @@ protected:
   shared_ptr<BaseBDStep> _stepper_;
   shared_ptr<BasePhysCalc> _physCalc_;
   shared_ptr<BaseTerminate> _terminator_;
+  shared_ptr<MultiStepForce> _mts_;  // forces between full solves, may be null
+  shared_ptr<PairTableCalc>  _table_; // forces while no pair is close, or null
   
   string outfname_; //outputfile
   
   int maxIter_;
   double prec_;
   
+  // trajectory, force and stats output, written on the thread of _io_
+  shared_ptr<AsyncOutput>     _io_;
+  ofstream                    xyzOut_;
+  ofstream                    statsOut_;
+  shared_ptr<PoseTrajWriter>  _poseOut_;
+  vector<string>              typePQR_;  // recorded in pose trajectories
+  bool                        poseDouble_;
+  vector<string>              stats_;  // stats lines kept if no statfile
+  
+  // open trajfile for the trajectory, a binary pose trajectory if it ends
+  // in .ptraj and XYZ text otherwise, and statfile for appending stats. If
+  // statfile is empty the stats lines are kept for get_stats instead
+  void open_output(string trajfile, string statfile);
+  // copy the current frame (and forces if phys) and queue them for writing
+  void write_output(int step, bool phys = true);
+  void write_stats(string line);
+  // wait for all queued output, then close the files
+  void close_output();
+  
 public:
   // num is the number of bodies to perform calculations on (2, 3 or all).
   // If num=0, then the equations will be solved exactly
@@ -175,6 +260,32 @@ public:
   virtual void run(string xyzfile = "test.xyz", string statfile = "stats.dat",
                    int nSCF = 0) { }
   
+  // PQR file of each molecule type and precision for .ptraj output
+  void set_pose_traj(vector<string> typePQR, bool dbl = false)
+  {
+    typePQR_ = typePQR;
+    poseDouble_ = dbl;
+  }
+  
+  void set_rand_seed(unsigned seed, unsigned stream)
+  {
+    _stepper_->set_rand_seed(seed, stream);
+  }
+  
+  void set_far_field(double gap, double b = 0.0)
+  {
+    _stepper_->set_far_field(gap, b);
+  }
+  
+  // solve fully only when mts asks for it, see MultiStepForce
+  void set_multi_step(shared_ptr<MultiStepForce> mts) { _mts_ = mts; }
+  
+  // forces from pair tables alone, without solving, while every pair is
+  // farther apart than its table starts
+  void set_pair_table(shared_ptr<PairTableCalc> table) { _table_ = table; }
+  
+  const vector<string> & get_stats() const { return stats_; }
+  
   Pt get_force_i(int i)      {return _physCalc_->get_forcei(i);}
   Pt get_torque_i(int i)     {return _physCalc_->get_taui(i);}
   double get_energy_i(int i) {return _physCalc_->calc_ei(i);}
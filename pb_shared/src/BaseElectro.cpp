@@ -7,6 +7,7 @@
 //
 
 #include "BaseElectro.h"
+#include "PoleKernels.h"
 
 
 BaseElectro::BaseElectro(shared_ptr<BaseSystem> _sys,
@@ -307,13 +308,12 @@ void BaseElectro::compute_pot()
             }
           }
         }
-#pragma omp critical
-        {
-          if (cont)
-          esp_[xct][yct][zct] = NAN;
-          else
-          esp_[xct][yct][zct] = (units_*compute_pot_at(pos))/e_s;
-        }
+        // compute_pot_at only reads shared state (see get_local_exp), and
+        // every grid point is written by exactly one thread
+        if (cont)
+        esp_[xct][yct][zct] = NAN;
+        else
+        esp_[xct][yct][zct] = (units_*compute_pot_at(pos))/e_s;
       }
     }
   }
@@ -324,39 +324,31 @@ void BaseElectro::compute_pot()
 
 MyMatrix<cmplx> BaseElectro::get_local_exp( Pt dist, double lambda )
 {
+  SHWorkspace shws = _shCalc_->make_workspace();
   int n, m;
   double expKR, kap    = _consts_->get_kappa();
   vector<double> bessK;
   MyMatrix<cmplx> localK(p_, 2*p_);
   
-  bessK = _bCalc_->calc_mbfK(p_, kap*dist.r());
+  _bCalc_->calc_mbfK(p_, kap*dist.r(), bessK);
   expKR = exp( - kap * dist.r()) / dist.r();
-  _shCalc_->calc_sh(dist.theta(),dist.phi());
+  _shCalc_->calc_sh(dist.theta(),dist.phi(), shws);
   
   for ( n = 0; n < p_; n++)
   {
     for ( m = -n; m <= n; m++)
     {
       localK.set_val( n, m+p_, (pow( lambda/dist.r(), n) * expKR *
-                                _shCalc_->get_result(n, m) * bessK[n]));
+                                shws.get_result(n, m) * bessK[n]));
     }
   }
   return localK;
 }
 
-double BaseElectro::lotan_inner_prod(MyMatrix<cmplx> U, MyMatrix<cmplx> V,
-                                          int p)
+double BaseElectro::lotan_inner_prod(const MyMatrix<cmplx> & U,
+                                     const MyMatrix<cmplx> & V, int p)
 {
-  double ip = 0;
-  int n, m, mT;
-  for (n = 0; n < p; n++)
-  {
-    for (m = -n; m <= n; m++)
-    {
-      mT = (m < 0) ? -1*m : m;
-      ip += (U(n, mT+p_).real()*V(n, mT+p_).real()
-             + U(n, mT+p_).imag()*V(n, mT+p_).imag());
-    }
-  }
+  double ip;
+  POLE_DISPATCH(p, inner_prod_fixed, p, U, V, ip);
   return ip;
 }
\ No newline at end of file
@@ -33,23 +33,23 @@ protected:
   string ax_;
   double value_;
   double range_;
+  string msg_;
   
 public:
   ValueOutOfRange( string ax, double val, double ran)
   :ax_(ax), value_(val), range_(ran)
   {
+    msg_ = ax_ + " value " + to_string(value_)+ " out of range. It is";
+    if (value_ < range_)
+    msg_ += " less than ";
+    else
+    msg_ += " greater than ";
+    msg_ += to_string(range_);
   }
   
   virtual const char* what() const throw()
   {
-    string ss;
-    ss = ax_ + " value " + to_string(value_)+ " out of range. It is";
-    if (value_ < range_)
-    ss += " less than ";
-    else
-    ss += " greater than ";
-    ss += to_string(range_);
-    return ss.c_str();
+    return msg_.c_str();
   }
 };
 
@@ -93,7 +93,8 @@ protected:
   
   MyMatrix<cmplx> get_local_exp( Pt dist, double lambda );
   
-  double lotan_inner_prod(MyMatrix<cmplx> U, MyMatrix<cmplx> V, int p);
+  double lotan_inner_prod(const MyMatrix<cmplx> & U,
+                          const MyMatrix<cmplx> & V, int p);
   
 public:
   BaseElectro(shared_ptr<BaseSystem> _sys,
@@ -111,6 +112,11 @@ public:
   // print Grid file, given an axis and a value on that axis
   void print_grid(string axis, double value, string fname);
   
+  // potential at point in internal units, before conversion to the output
+  // units. Like compute_pot_at it only reads shared state
+  double pot_at( Pt point )
+  { return compute_pot_at(point)/_consts_->get_dielectric_water(); }
+  
   // return potential grid
   vector<vector<vector<double > > > get_potential() { return esp_; }
   vector<vector<double > > get_pot2d()              { return grid_; }
@@ -68,6 +68,21 @@ public:
   virtual void calc_all_tau() { }
 };
 
+/*
+ Copy of the results written by print_all, so that they can be written
+ after the calculation has moved on (see BaseBDRun)
+ */
+struct PhysSnapshot
+{
+  double          t;
+  string          unit;
+  double          unitConv;
+  string          outfname;  // "" for stdout
+  vector<double>  rad;       // printed with each molecule if not empty
+  vector<Pt>      pos, force, torque;
+  vector<double>  energy;
+};
+
 /*
  Base class for calculations of physical quantities
  */
@@ -117,7 +132,50 @@ public:
   
   void calc_all()     { calc_energy(); calc_force(); calc_torque(); }
   
-  virtual void print_all() { }
+  virtual void print_all() { print_snapshot(snapshot()); }
+  
+  // copy of what print_all writes, empty if nothing is written
+  virtual PhysSnapshot snapshot()
+  {
+    PhysSnapshot snap;
+    snap.outfname = outfname_;
+    return snap;
+  }
+  
+  // write a snapshot, safe to call from another thread
+  static void print_snapshot(const PhysSnapshot & snap)
+  {
+    if (snap.pos.empty()) return;
+    streambuf * buf;
+    ofstream of;
+    if(snap.outfname != "")
+    {
+      of.open(snap.outfname, fstream::in | fstream::out | fstream::app);
+      buf = of.rdbuf();
+    } else {
+      buf = cout.rdbuf();
+    }
+    
+    ostream out(buf);
+    double cv = snap.unitConv;
+    out << "My units are " << snap.unit << ". Time: " << snap.t << "\n";
+    for (int i = 0; i < snap.pos.size(); i++)
+    {
+      Pt pos = snap.pos[i], fi = snap.force[i], ti = snap.torque[i];
+      out << "Molecule #" << i + 1;
+      if (!snap.rad.empty()) out << " radius: " << snap.rad[i];
+      out << "\n";
+      out << "\tPOSITION: [" << pos.x() << ", " << pos.y();
+      out << ", " << pos.z() << "]" << "\n";
+      out << "\tENERGY: " << cv * snap.energy[i] << "\n";
+      
+      out << "\tFORCE: " << fi.norm() * cv << ", [";
+      out << fi.x() * cv << " " << fi.y() * cv << " " << fi.z() * cv << "]\n";
+      out << "\tTORQUE: " << ti.norm() << ", [";
+      out << ti.x() * cv << " " << ti.y() * cv << " " << ti.z() * cv << "]\n";
+    }
+    out.flush();
+  }
   
   virtual shared_ptr<vector<Pt> > get_Tau()
   { return make_shared<vector<Pt> > ();  }
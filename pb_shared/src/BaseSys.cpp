@@ -16,8 +16,9 @@ BaseMolecule::BaseMolecule(int type, int type_idx, string movetype,
                            double dtrans)
 :moveType_(movetype), drot_(drot), dtrans_(dtrans),
 qs_(qs), pos_(pos), vdwr_(vdwr), type_(type), typeIdx_(type_idx),
-Nc_((int) pos.size()), centers_(1), as_(1), Ns_(1)
+Nc_((int) pos.size()), centers_(1), as_(1), Ns_(1), orient_(3, 3, 0.0)
 {
+  for (int i = 0; i < 3; i++) orient_(i, i) = 1.0;
   set_Dtr_Drot(moveType_);
 }
 
@@ -180,3 +181,37 @@ void BaseSystem::check_for_overlap()
 }
 
 
+
+BaseSystem::XYZFrame BaseSystem::get_xyz_frame()
+{
+  XYZFrame fr;
+  fr.t = t_;
+  for (int i = 0; i < N_; i++)
+  {
+    fr.nc.push_back(get_Nc_i(i));
+    fr.ns.push_back(get_Ns_i(i));
+    for (int j = 0; j < get_Nc_i(i); j++) fr.pts.push_back(get_posijreal(i, j));
+    for (int k = 0; k < get_Ns_i(i); k++) fr.pts.push_back(get_centerik(i, k));
+  }
+  return fr;
+}
+
+void BaseSystem::write_xyz_frame(ostream & xyz_out, const XYZFrame & fr)
+{
+  int i, j, ct(0);
+  char xyzlin[400];
+  Pt pt;
+  
+  xyz_out << fr.pts.size() << "\n";
+  xyz_out << "Atoms. Timestep (ps): " << fr.t << "\n";
+  for ( i = 0; i < fr.nc.size(); i++ )
+  {
+    for ( j = 0; j < fr.nc[i] + fr.ns[i]; j++, ct++)
+    {
+      pt = fr.pts[ct];
+      sprintf(xyzlin,"%c %8.3f %8.3f %8.3f", (j < fr.nc[i]) ? 'N' : 'X',
+              pt.x(), pt.y(), pt.z());
+      xyz_out << xyzlin << "\n";
+    }
+  }
+}
@@ -14,6 +14,7 @@
 #include <map>
 #include <memory>
 #include "util.h"
+#include "PointSoA.h"
 #include "Constants.h"
 
 using namespace std;
@@ -31,15 +32,20 @@ protected:
   int                 Nc_;  // number of charges in this MoleculeAM
   
   vector<double>      qs_;  // magnitude of each charge in the MoleculeAM
-  vector<Pt>          pos_;  // position of each charge in the MoleculeAM
+  PointSoA            pos_;  // position of each charge in the MoleculeAM
   vector<double>      vdwr_; // van der waal radius of each charge
   
   int                 Ns_;  // number of coarse grained spheres
   vector<Pt>          centers_; //coarse-grained sphere centers
   vector<double>      as_; // coarse-grained sphere radii
   
+  MyMatrix<double>    orient_; // rotation from the body frame, see rotate()
+  
   void set_Dtr_Drot(string type);
   
+  // compose rot onto the orientation, to be called by rotate()
+  void add_rotation(MyMatrix<double> rot)   { orient_ = rot * orient_; }
+  
 public:
   
   BaseMolecule()  { }
@@ -61,7 +67,8 @@ public:
   
   const int get_m() const               { return Nc_; } // called M in analytic
   const int get_nc() const              { return Nc_; }
-  Pt get_posj(int j) const              { return pos_[j]; }
+  Pt get_posj(int j) const              { return pos_.get(j); }
+  Pt get_posj_sph(int j) const          { return pos_.get_sph(j); }
   string get_move_type() const          { return moveType_; }
   int get_type() const                  { return type_; }
   int get_type_idx() const              { return typeIdx_; }
@@ -71,9 +78,14 @@ public:
   Pt get_centerk(int k) const           { return centers_[k]; }
   const double get_qj(int j) const      { return qs_[j]; }
   const double get_radj(int j) const    { return vdwr_[j]; }
-  Pt get_posj_realspace(int j)          { return pos_[j] + get_cen_j(j); }
+  Pt get_posj_realspace(int j)      { return pos_.get(j) + get_cen_j(j); }
   const int get_ns() const              { return Ns_; }
   
+  // rotation taking the body frame (the coordinates the molecule was
+  // built from) to its current orientation
+  MyMatrix<double> get_orient() const   { return orient_; }
+  void set_orient(MyMatrix<double> rot) { orient_ = rot; }
+  
   void write_pqr(string outfile);
 
   // get center for charge j
@@ -157,6 +169,8 @@ public:
   const double get_qij(int i, int j) const {return molecules_[i]->get_qj(j);}
   const double get_radij(int i, int j) const { return molecules_[i]->get_radj(j); }
   Pt get_posij(int i, int j)               {return molecules_[i]->get_posj(j);}
+  // as get_posij, in spherical coordinates
+  Pt get_posij_sph(int i, int j)     {return molecules_[i]->get_posj_sph(j);}
   Pt get_posijreal(int i, int j)
   {return molecules_[i]->get_posj_realspace(j);}
   
@@ -208,7 +222,20 @@ public:
   virtual void write_to_pqr( string outfile, int mid = -1 ) = 0;
   
   // write current system configuration to XYZ file
-  virtual void write_to_xyz(ofstream &xyz_out) = 0;
+  virtual void write_to_xyz(ofstream &xyz_out)
+  { write_xyz_frame(xyz_out, get_xyz_frame()); }
+  
+  // copy of the configuration written by write_to_xyz: the charges and
+  // then the sphere centers of each molecule
+  struct XYZFrame
+  {
+    double      t;
+    vector<Pt>  pts;
+    vector<int> nc, ns;
+  };
+  
+  XYZFrame get_xyz_frame();
+  static void write_xyz_frame(ostream & xyz_out, const XYZFrame & fr);
   
   //overridden by SAM:
   virtual double calc_min_dist(int i, int j) { return 0.0; }
@@ -227,18 +254,18 @@ class OverlappingMoleculeException: public exception
 protected:
   int idx1_;
   int idx2_;
+  string msg_;
   
 public:
   OverlappingMoleculeException(int idx1, int idx2)
   :idx1_(idx1), idx2_(idx2)
   {
+    msg_ = "Molecule " + to_string(idx1_)+" & " + to_string(idx2_) + " overlap";
   }
   
   virtual const char* what() const throw()
   {
-    string ss;
-    ss = "Molecule " + to_string(idx1_)+" & " + to_string(idx2_) + " overlap";
-    return ss.c_str();
+    return msg_.c_str();
   }
 };
 
@@ -22,6 +22,12 @@ BesselConstants::BesselConstants(const int N)
   }
 }
 
+shared_ptr<BesselConstants> BesselConstants::get_shared(const int N)
+{
+  return TableRegistry<BesselConstants>::get({(double) N},
+                          [N] () { return make_shared<BesselConstants>(N); });
+}
+
 
 BesselCalc::BesselCalc(int N, shared_ptr<BesselConstants> _consts)
 : numVals_(N), _consts_(_consts)
@@ -41,20 +47,24 @@ const vector<double> BesselCalc::calc_mbfK(const int n,
                                            const double z) const
 {
   vector<double> K;
-  K.reserve(n);
+  calc_mbfK(n, z, K);
+  return K;
+}
+
+void BesselCalc::calc_mbfK(const int n, const double z,
+                           vector<double> & K) const
+{
+  K.resize(n);
   
-  if (n > 0) K.push_back(1.0);
-  if (n > 1) K.push_back(1 + z);
+  if (n > 0) K[0] = 1.0;
+  if (n > 1) K[1] = 1 + z;
   
   double z_sq = z * z;
   int i;
-  double val;
   for (i = 2; i < n; i++)
   {
-    val = K[i-1] + (z_sq * K[i-2] * _consts_->get_kconst_val(i-1));
-    K.push_back(val);
+    K[i] = K[i-1] + (z_sq * K[i-2] * _consts_->get_kconst_val(i-1));
   }
-  return K;
 }
 
 /*
@@ -69,11 +79,14 @@ const vector<double> BesselCalc::calc_mbfI(const int n,
                      const double z) const
 {
   vector<double> I;
-  I.reserve(n);
-  for (int k = 0; k < n; k++)
-  {
-    I.push_back(1);
-  }
+  calc_mbfI(n, z, I);
+  return I;
+}
+
+void BesselCalc::calc_mbfI(const int n, const double z,
+                           vector<double> & I) const
+{
+  I.assign(n, 1.0);
   
   if (z != 0)
   {
@@ -91,7 +104,6 @@ const vector<double> BesselCalc::calc_mbfI(const int n,
       }
     }
   }
-  return I;
 }
 
 //
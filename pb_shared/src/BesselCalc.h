@@ -37,6 +37,7 @@
 #include <memory>
 
 #include "Constants.h"
+#include "TableRegistry.h"
 
 using namespace std;
 
@@ -54,6 +55,9 @@ public:
   
   BesselConstants(const int N=Constants::MAX_NUM_POLES);
   
+  // shared instance for N values, built on first use (see TableRegistry)
+  static shared_ptr<BesselConstants> get_shared(const int N);
+  
   const int get_n() const                     { return numVals_; }
   const double get_kconst_val(int i) const    { return kConsts_[i]; }
   
@@ -83,6 +87,10 @@ public:
   const vector<double> calc_mbfI(const int n, const double z) const;
   const vector<double> calc_mbfK(const int n, const double z) const;
   
+  // As above, but fill a caller-owned vector (reused without reallocation)
+  void calc_mbfI(const int n, const double z, vector<double> & I) const;
+  void calc_mbfK(const int n, const double z, vector<double> & K) const;
+  
   const int get_num_vals() const { return numVals_; }
   
 };
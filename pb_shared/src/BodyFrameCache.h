@@ -0,0 +1,150 @@
+//
+//  BodyFrameCache.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BodyFrameCache_h
+#define BodyFrameCache_h
+
+#include <vector>
+#include <memory>
+#include "BaseSys.h"
+#include "WignerRotation.h"
+
+using namespace std;
+
+/*
+ Charge expansions of rigid molecules, computed once per molecule type and
+ rotated to the orientation of every copy. Molecules of the same type whose
+ charges, radii and sphere layout agree in the body frame share the
+ expansions of the first such molecule (their reference). The expansions
+ are stored with the orientation the reference had when they were
+ computed, so a copy is brought up to date with one Wigner rotation,
+ O(p^3) per expansion instead of O(M p^2).
+ 
+ Usage: for each molecule i, if has(i) call rotate_to(), otherwise compute
+ the expansions directly and store() them. References come first, so
+ processing molecules in index order always fills a reference before its
+ copies are asked for.
+ */
+class BodyFrameCache
+{
+protected:
+  int p_;
+  vector<int> ref_;  // reference molecule of each molecule
+  vector<MyMatrix<double> > refOrient_;  // orientation at store()
+  vector<vector<MyMatrix<cmplx> > > exp_;  // expansions, by reference
+  
+  // body frame coordinates of a point given in the molecule frame
+  static Pt to_body(const MyMatrix<double> & orient, Pt pt)
+  {
+    return Pt(orient(0,0)*pt.x() + orient(1,0)*pt.y() + orient(2,0)*pt.z(),
+              orient(0,1)*pt.x() + orient(1,1)*pt.y() + orient(2,1)*pt.z(),
+              orient(0,2)*pt.x() + orient(1,2)*pt.y() + orient(2,2)*pt.z());
+  }
+  
+  // whether two molecules are the same rigid body, up to orientation
+  static bool same_body(shared_ptr<BaseMolecule> a,
+                        shared_ptr<BaseMolecule> b, double tol = 1e-6)
+  {
+    if ((a->get_type() != b->get_type()) || (a->get_nc() != b->get_nc()) ||
+        (a->get_ns() != b->get_ns()))
+      return false;
+    
+    MyMatrix<double> oa = a->get_orient(), ob = b->get_orient();
+    Pt ca = a->get_centerk(0), cb = b->get_centerk(0);
+    for (int k = 0; k < a->get_ns(); k++)
+    {
+      if (fabs(a->get_ak(k) - b->get_ak(k)) > tol) return false;
+      Pt d = (to_body(oa, a->get_centerk(k) - ca) -
+              to_body(ob, b->get_centerk(k) - cb));
+      if (d.norm() > tol) return false;
+    }
+    for (int j = 0; j < a->get_nc(); j++)
+    {
+      if (fabs(a->get_qj(j) - b->get_qj(j)) > tol) return false;
+      Pt d = (to_body(oa, a->get_posj_realspace(j) - ca) -
+              to_body(ob, b->get_posj_realspace(j) - cb));
+      if (d.norm() > tol) return false;
+    }
+    return true;
+  }
+  
+public:
+  BodyFrameCache(int p=1) :p_(p) { }
+  
+  // match every molecule with its reference, dropping stored expansions
+  void assign(const vector<shared_ptr<BaseMolecule> > & mols)
+  {
+    int n = (int) mols.size();
+    ref_.assign(n, -1);
+    refOrient_.assign(n, MyMatrix<double> (3, 3));
+    exp_.assign(n, vector<MyMatrix<cmplx> > ());
+    for (int i = 0; i < n; i++)
+    {
+      for (int r = 0; (r < i) && (ref_[i] < 0); r++)
+        if ((ref_[r] == r) && same_body(mols[r], mols[i])) ref_[i] = r;
+      if (ref_[i] < 0) ref_[i] = i;
+    }
+  }
+  
+  bool is_assigned() const        { return !ref_.empty(); }
+  int get_ref(int i) const        { return ref_[i]; }
+  bool has(int i) const           { return !exp_[ref_[i]].empty(); }
+  
+  void store(int i, shared_ptr<BaseMolecule> mol,
+             const vector<MyMatrix<cmplx> > & ex)
+  {
+    refOrient_[ref_[i]] = mol->get_orient();
+    exp_[ref_[i]] = ex;
+  }
+  
+  // expansions for molecule i at its current orientation
+  void rotate_to(int i, shared_ptr<BaseMolecule> mol,
+                 vector<MyMatrix<cmplx> > & out) const
+  {
+    const MyMatrix<double> & o0 = refOrient_[ref_[i]];
+    MyMatrix<double> oi = mol->get_orient(), rel(3, 3, 0.0);
+    for (int a = 0; a < 3; a++)
+      for (int b = 0; b < 3; b++)
+        for (int c = 0; c < 3; c++)
+          rel(a, b) += oi(a, c) * o0(b, c);
+    
+    WignerRotation rot(rel, p_);
+    const vector<MyMatrix<cmplx> > & ex = exp_[ref_[i]];
+    out.resize(ex.size());
+    for (int e = 0; e < ex.size(); e++)
+    {
+      out[e] = MyMatrix<cmplx> (ex[e].get_nrows(), ex[e].get_ncols());
+      rot.rotate(ex[e], out[e]);
+    }
+  }
+};
+
+#endif /* BodyFrameCache_h */
@@ -37,7 +37,8 @@ const int Constants::IMAT_GRID = 72000;
 Constants::Constants(Units units)
 :bDist_(100.0), qDist_(500.0), fDist_(100.0), dielectricWater_(78.0),
 dielectricProt_(4.0), saltConcentration_(0.0100), temp_(353.0), tol_(2.5),
-patchAngle_(6.0), rotateAngle_(20.0), units_(units), tolSP_(1.0)
+patchAngle_(6.0), rotateAngle_(20.0), units_(units), tolSP_(1.0),
+mixedDist_(-1.0)
 {
 	update_all();
 }
@@ -48,7 +49,7 @@ patchAngle_(6.0), rotateAngle_(20.0), units_(units), tolSP_(1.0)
 Constants::Constants(Setup setup)
 :bDist_(100.0), qDist_(500.0), fDist_(100.0), dielectricWater_(78.0),
 dielectricProt_(4.0), saltConcentration_(0.0100), temp_(353.0), tol_(2.5),
-patchAngle_(6.0), rotateAngle_(20.0)
+patchAngle_(6.0), rotateAngle_(20.0), mixedDist_(setup.getMixedPrec())
 {
   set_units(setup.getUnits());
   set_dielectric_prot(setup.getIDiel());
@@ -69,7 +70,7 @@ patchAngle_(consts.get_patch_angle()), rotateAngle_(consts.get_rotate_angle()),
 lambda_(consts.get_lambda()), KbT_(consts.get_kbt()), iKbT_(consts.get_ikbt()),
 kappa_(consts.get_kappa()), patchSize_(consts.get_patch_size()),
 rotateSize_(consts.get_rotate_size()), units_(consts.get_unitsEnum()),
-tolSP_(consts.get_tol_sp())
+tolSP_(consts.get_tol_sp()), mixedDist_(consts.get_mixed_prec_dist())
 {
   update_all();
 }
@@ -61,6 +61,7 @@ protected:
   double lambda_; //uniform scaling
   
   double tolSP_;
+  double mixedDist_; //!< Pair separation beyond which re-exp is single prec
 //  double sphBeta_;
 
   //Dependent constants:
@@ -135,6 +136,7 @@ public:
     update_kappa(); update_kbt();
   }
   void set_tol(double val)                    { tol_ = val; }
+  void set_mixed_prec_dist(double val)        { mixedDist_ = val; }
   void set_patch_angle(double val)
   {
     patchAngle_ = val;
@@ -163,6 +165,7 @@ public:
   const double get_patch_angle() const        { return patchAngle_; }
   const double get_rotate_angle() const       { return rotateAngle_; }
   const double get_lambda() const             { return lambda_; }
+  const double get_mixed_prec_dist() const    { return mixedDist_; }
   
   const Units get_unitsEnum() const           { return units_; }
   string get_units();
@@ -0,0 +1,246 @@
+//
+//  ExpansionFile.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ExpansionFile_h
+#define ExpansionFile_h
+
+#include <cstdint>
+#include "readutil.h"
+
+using namespace std;
+
+class BadExpansionFileException: public exception
+{
+protected:
+  string msg_;
+  
+public:
+  BadExpansionFileException(string path, string why)
+  :msg_("Bad expansion file " + path + ": " + why)
+  {
+  }
+  
+  virtual const char* what() const throw()
+  {
+    return msg_.c_str();
+  }
+};
+
+/*
+ Binary file of a set of multipole expansions: the H or F of every sphere
+ of a molecule in PB-SAM, or A and grad(A) in PB-AM. All expansions are of
+ real potentials, so only m >= 0 is stored and (n, -m) is the conjugate of
+ (n, m). Layout, in native byte order:
+ 
+   [0, 64)   Header
+   [64, ...) for each expansion, for n < p, 0 <= m <= n: re, im
+ 
+ Expansions are indexed by up to three dimensions, the last fastest, e.g.
+ (N, N, 3) for grad(A). The checksum is FNV-1a over the data. Reading is a
+ single read of the file, and an expansion can be taken at a lower or
+ higher order than stored (truncated or padded with zeros).
+ */
+class ExpansionFile
+{
+public:
+  static const uint32_t VERSION = 1;
+  
+  struct Header
+  {
+    char     magic[8];
+    uint32_t version;
+    int32_t  p;
+    int32_t  dims[3];
+    int32_t  reserved;
+    double   kappa;
+    double   rcut;
+    uint64_t checksum;
+    uint64_t nbytes;    // of data
+  };
+  
+protected:
+  string          path_;
+  Header          head_;
+  vector<double>  data_;
+  
+  static const char * magic() { return "PBSEXPN"; }
+  
+  static uint64_t fnv1a(const char * c, size_t n)
+  {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; i++)
+    {
+      h ^= (unsigned char) c[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+  
+  static int tri(int p) { return p*(p+1)/2; }
+  
+  void read()
+  {
+    ifstream fin(path_.c_str(), ios::binary);
+    if (!fin.is_open()) throw CouldNotReadException(path_);
+    fin.read((char *) &head_, sizeof(Header));
+    if (!fin || strncmp(head_.magic, magic(), 8) != 0)
+      throw BadExpansionFileException(path_, "not a binary expansion file");
+    if (head_.version != VERSION)
+      throw BadExpansionFileException(path_, "version " +
+                                      to_string(head_.version));
+    if (head_.p < 1 || head_.nbytes !=
+        (uint64_t) get_n() * tri(head_.p) * 2 * sizeof(double))
+      throw BadExpansionFileException(path_, "inconsistent header");
+    
+    data_.resize(head_.nbytes / sizeof(double));
+    fin.read((char *) &data_[0], head_.nbytes);
+    if (!fin) throw BadExpansionFileException(path_, "file too short");
+    if (fnv1a((const char *) &data_[0], head_.nbytes) != head_.checksum)
+      throw BadExpansionFileException(path_, "checksum mismatch");
+  }
+  
+public:
+  ExpansionFile(string path)
+  :path_(path)
+  {
+    read();
+  }
+  
+  /*
+   Write mats, p x (2p+1) matrices with (n, m) at column m+p, to path.
+   dims gives their shape, by default a flat list. The file is written
+   next to path and renamed into place, so an interrupted write never
+   leaves a partial file at path
+   */
+  static void write(string path, int p, double kappa, double rcut,
+                    const vector<MyMatrix<cmplx> > & mats,
+                    vector<int> dims = vector<int>())
+  {
+    Header head;
+    memset(&head, 0, sizeof(Header));
+    strncpy(head.magic, magic(), 8);
+    head.version = VERSION;
+    head.p       = p;
+    if (dims.empty()) dims.push_back((int) mats.size());
+    for (int d = 0; d < 3; d++)
+      head.dims[d] = (d < dims.size()) ? dims[d] : 1;
+    head.kappa   = kappa;
+    head.rcut    = rcut;
+    
+    vector<double> data(mats.size() * tri(p) * 2);
+    size_t ct = 0;
+    for (int i = 0; i < mats.size(); i++)
+      for (int n = 0; n < p; n++)
+        for (int m = 0; m <= n; m++)
+        {
+          data[ct++] = mats[i](n, m+p).real();
+          data[ct++] = mats[i](n, m+p).imag();
+        }
+    head.nbytes   = data.size() * sizeof(double);
+    head.checksum = fnv1a((const char *) &data[0], head.nbytes);
+    
+    string tmp = path + ".tmp";
+    ofstream fout(tmp.c_str(), ofstream::binary);
+    if (!fout) throw CouldNotWriteException(tmp);
+    fout.write((const char *) &head, sizeof(Header));
+    fout.write((const char *) &data[0], head.nbytes);
+    fout.close();
+    if (!fout)
+    {
+      remove(tmp.c_str());
+      throw CouldNotWriteException(tmp);
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+    {
+      remove(tmp.c_str());
+      throw CouldNotWriteException(path);
+    }
+  }
+  
+  /*
+   Convert the text .exp files of one molecule (one file per sphere, as
+   written by print_all_to_file) to a binary file at path
+   */
+  static void convert_text(const vector<string> & expFiles, string path)
+  {
+    vector<MyMatrix<cmplx> > mats;
+    int p = 0;
+    double kappa = 0.0, rcut = 0.0;
+    for (int k = 0; k < expFiles.size(); k++)
+    {
+      ifstream fin(expFiles[k].c_str());
+      if (!fin.is_open()) throw CouldNotReadException(expFiles[k]);
+      int pk;
+      fin >> pk;
+      if (k == 0) p = pk;
+      else if (pk != p)
+        throw BadExpansionFileException(expFiles[k], "pole order differs");
+      fin.close();
+      
+      HFFile hf(expFiles[k], p);
+      kappa = hf.get_kappa();
+      rcut  = hf.get_rcut();
+      mats.push_back(hf.get_mat());
+    }
+    write(path, p, kappa, rcut, mats);
+  }
+  
+  const string get_path() const   { return path_; }
+  int get_p() const               { return head_.p; }
+  double get_kappa() const        { return head_.kappa; }
+  double get_rcut() const         { return head_.rcut; }
+  int get_dim(int d) const        { return head_.dims[d]; }
+  int get_n() const
+  { return head_.dims[0] * head_.dims[1] * head_.dims[2]; }
+  
+  // Expansion i, flat index, as a p x (2p+1) matrix
+  MyMatrix<cmplx> get_mat(int i, int p) const
+  {
+    MyMatrix<cmplx> mat(p, 2*p+1);
+    const double * c = &data_[(size_t) i * tri(head_.p) * 2];
+    int pmin = min(p, head_.p);
+    for (int n = 0; n < pmin; n++)
+      for (int m = 0; m <= n; m++)
+      {
+        cmplx v(c[2*(tri(n)+m)], c[2*(tri(n)+m)+1]);
+        mat.set_val(n, m+p, v);
+        if (m > 0) mat.set_val(n, -m+p, conj(v));
+      }
+    return mat;
+  }
+  
+  MyMatrix<cmplx> get_mat(int i, int j, int k, int p) const
+  {
+    return get_mat((i*head_.dims[1] + j)*head_.dims[2] + k, p);
+  }
+};
+
+#endif /* ExpansionFile_h */
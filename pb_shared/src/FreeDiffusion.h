@@ -0,0 +1,157 @@
+//
+//  FreeDiffusion.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FreeDiffusion_h
+#define FreeDiffusion_h
+
+#include <math.h>
+
+using namespace std;
+
+/*
+ Sampling of free 3D diffusion, for moving molecules far from all others
+ without forces. Each draw is the inverse of a distribution at a uniform u
+ in (0, 1), so callers pick the random numbers. Times are in units of
+ R^2/D through tau = D t / R^2
+ */
+class FreeDiffusion
+{
+protected:
+  // below this tau the sphere is out of reach and free diffusion is used
+  static constexpr double SHORT_TAU = 0.01;
+  
+  // bisect the increasing f for f(x) = u on [lo, hi]
+  template <typename F>
+  static double invert(F f, double u, double lo, double hi)
+  {
+    for (int it = 0; it < 60; it++)
+    {
+      double mid = 0.5 * (lo + hi);
+      if (f(mid) < u) lo = mid;
+      else            hi = mid;
+    }
+    return 0.5 * (lo + hi);
+  }
+  
+  // last term of the eigenfunction series needed at tau
+  static int n_terms(double tau)
+  {
+    return 1 + (int) sqrt(40.0 / (M_PI * M_PI * tau));
+  }
+  
+public:
+  /*
+   Probability that diffusion from the center of a sphere has reached its
+   surface by tau. The image series converges fast for small tau and the
+   eigenfunction series for large
+   */
+  static double exit_cdf(double tau)
+  {
+    double s = 0.0;
+    if (tau < 0.1)
+    {
+      for (int k = 0; k < 4; k++)
+        s += exp(-(2*k+1)*(2*k+1) / (4.0*tau));
+      return 2.0 * s / sqrt(M_PI * tau);
+    }
+    for (int n = 1; n <= n_terms(tau); n++)
+      s += ((n % 2) ? 2.0 : -2.0) * exp(-n*n*M_PI*M_PI*tau);
+    return 1.0 - s;
+  }
+  
+  // time to first reach radius R from the center, with diffusion const D
+  static double exit_time(double R, double D, double u)
+  {
+    double ltau = invert([] (double l) { return exit_cdf(exp(l)); }, u,
+                         log(1e-4), log(50.0));
+    return exp(ltau) * R * R / D;
+  }
+  
+  /*
+   Distance from the center at time t of diffusion that has not yet reached
+   radius R. Its CDF is the integral of r^2 times the sphere's Green's
+   function, sum_n exp(-k_n^2 D t) (sin(k_n r)/k_n - r cos(k_n r)) with
+   k_n = n pi / R, normalized at R. For short t this is free diffusion
+   */
+  static double radius(double R, double D, double t, double u)
+  {
+    double tau = D * t / (R * R);
+    if (tau < SHORT_TAU)
+    {
+      // Maxwell distribution of free diffusion
+      double s = sqrt(2.0 * D * t);
+      auto cdf = [s] (double r) {
+        double x = r / s;
+        return erf(x/sqrt(2.0)) - sqrt(2.0/M_PI) * x * exp(-0.5*x*x);
+      };
+      return invert(cdf, u, 0.0, R);
+    }
+    int nmax = n_terms(tau);
+    auto cdf = [R, tau, nmax] (double r) {
+      double s = 0.0;
+      for (int n = 1; n <= nmax; n++)
+      {
+        double k = n * M_PI / R;
+        s += exp(-n*n*M_PI*M_PI*tau) * (sin(k*r)/k - r*cos(k*r));
+      }
+      return s;
+    };
+    return invert(cdf, u * cdf(R), 0.0, R);
+  }
+  
+  // chance that diffusion from distance r ever reaches the sphere b < r
+  static double return_prob(double r, double b) { return b / r; }
+  
+  /*
+   Time to reach the sphere b from distance r > b, given that it does, from
+   a standard normal z. The hitting time has the Levy distribution with
+   scale (r-b)^2 / 2D
+   */
+  static double return_time(double r, double b, double D, double z)
+  {
+    return (r - b) * (r - b) / (2.0 * D * z * z);
+  }
+  
+  /*
+   Cosine of the angle, from the starting direction, at which diffusion from
+   distance r reaches the sphere b, given that it does. Inverts the CDF of
+   the density (rho^2 + 1 - 2 rho x)^(-3/2) on [-1, 1] with rho = r/b
+   */
+  static double return_cos(double r, double b, double u)
+  {
+    double rho = r / b;
+    double w = 1.0/(rho+1.0) + u * (1.0/(rho-1.0) - 1.0/(rho+1.0));
+    double x = (rho*rho + 1.0 - 1.0/(w*w)) / (2.0 * rho);
+    return (x > 1.0) ? 1.0 : ((x < -1.0) ? -1.0 : x);
+  }
+};
+
+#endif /* FreeDiffusion_h */
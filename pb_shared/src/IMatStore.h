@@ -0,0 +1,366 @@
+//
+//  IMatStore.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMatStore_h
+#define IMatStore_h
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "readutil.h"
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+using namespace std;
+
+class BadIMatStoreException: public exception
+{
+protected:
+  string msg_;
+  
+public:
+  BadIMatStoreException(string path, string why)
+  :msg_("Bad IMat store " + path + ": " + why)
+  {
+  }
+  
+  virtual const char* what() const throw()
+  {
+    return msg_.c_str();
+  }
+};
+
+/*
+ Single file holding the IE matrices of every sphere of one molecule type.
+ Layout, all in native byte order:
+ 
+   [0, 64)        Header
+   [64, ...)      ns index entries of (radius, byte offset of block,
+                  checksum of block)
+   [blockOff,...) ns blocks of p^4 doubles, each on a 64 byte boundary
+ 
+ Checksums are FNV-1a. The one in the header covers the header and the
+ index and is checked on open, which only reads their first pages. The
+ blocks are checked by verify(), so opening a large store does not read
+ the whole file.
+ A store is opened read-only with mmap, so every process on a node that
+ reads the same file shares one copy in the page cache, and within a
+ process open() hands back the mapping already in use. Blocks can be used
+ in place at the stored p, or viewed at any lower p through their leading
+ p^2 x p^2 corner.
+ */
+class IMatStore
+{
+public:
+  static const uint32_t VERSION = 2;
+  static const size_t   ALIGN   = 64;
+  
+  struct Header
+  {
+    char     magic[8];
+    uint32_t version;
+    int32_t  p;          // pole order of the stored matrices
+    int32_t  ns;         // number of spheres
+    int32_t  quad;       // IEMatrix::Quadrature used to compute them
+    int64_t  gridPts;    // UNIFORM grid points per sphere
+    uint64_t checksum;   // header, with this field 0, and index
+    uint64_t indexOff;
+    uint64_t blockOff;
+    uint64_t blockStride;
+  };
+  
+  struct IndexEntry
+  {
+    double   radius;
+    uint64_t offset;
+    uint64_t checksum;   // p^4 doubles of the block
+  };
+  
+  // Row-major p^2 x p^2 view of a block that was stored at a higher order
+  struct View
+  {
+    const double * base_;
+    int            stride_;  // row length in the stored block
+    int            n_;       // rows and columns of the view, p^2
+    
+    double operator()(int r, int c) const { return base_[r*stride_ + c]; }
+    const double * row(int r) const       { return base_ + r*stride_; }
+  };
+  
+protected:
+  string          path_;
+  const char *    data_;
+  size_t          size_;
+  bool            mapped_;   // data_ is an mmap, otherwise it is in buf_
+  vector<double>  buf_;
+  const Header *  head_;
+  
+  static const char * magic() { return "PBSIMAT"; }
+  
+  static uint64_t fnv1a(const char * c, size_t n,
+                        uint64_t h = 14695981039346656037ULL)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      h ^= (unsigned char) c[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+  
+  static size_t round_up(size_t n) { return (n + ALIGN - 1) / ALIGN * ALIGN; }
+  
+  static uint64_t head_checksum(const Header & head, const char * index)
+  {
+    Header h = head;
+    h.checksum = 0;
+    return fnv1a(index, h.ns*sizeof(IndexEntry),
+                 fnv1a((const char *) &h, sizeof(Header)));
+  }
+  
+  void map_file()
+  {
+#ifndef _WIN32
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) throw CouldNotReadException(path_);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+      size_ = (size_t) st.st_size;
+      void * m = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+      if (m != MAP_FAILED)
+      {
+        data_   = (const char *) m;
+        mapped_ = true;
+      }
+    }
+    ::close(fd);
+    if (mapped_) return;
+#endif
+    // no mmap: one private copy
+    ifstream fin(path_.c_str(), ios::binary | ios::ate);
+    if (!fin.is_open()) throw CouldNotReadException(path_);
+    size_ = (size_t) fin.tellg();
+    buf_.resize(size_ / sizeof(double) + 1);
+    fin.seekg(0);
+    fin.read((char *) &buf_[0], size_);
+    data_ = (const char *) &buf_[0];
+  }
+  
+  void check()
+  {
+    if (size_ < sizeof(Header))
+      throw BadIMatStoreException(path_, "file too short");
+    head_ = (const Header *) data_;
+    if (strncmp(head_->magic, magic(), 8) != 0)
+      throw BadIMatStoreException(path_, "not an IMat store");
+    if (head_->version != VERSION)
+      throw BadIMatStoreException(path_, "version " +
+                                  to_string(head_->version) + ", expected " +
+                                  to_string(VERSION));
+    size_t pq = (size_t) head_->p * head_->p * head_->p * head_->p;
+    if (head_->p < 1 || head_->ns < 0 ||
+        head_->blockStride < pq*sizeof(double) ||
+        head_->indexOff + head_->ns*sizeof(IndexEntry) > size_ ||
+        head_->blockOff + head_->ns*head_->blockStride > size_)
+      throw BadIMatStoreException(path_, "inconsistent header");
+    if (head_checksum(*head_, data_ + head_->indexOff) != head_->checksum)
+      throw BadIMatStoreException(path_, "header checksum mismatch");
+    for (int k = 0; k < head_->ns; k++)
+      if (entry(k).offset < head_->blockOff ||
+          entry(k).offset + pq*sizeof(double) > size_)
+        throw BadIMatStoreException(path_, "inconsistent index");
+  }
+  
+  const IndexEntry & entry(int k) const
+  {
+    return ((const IndexEntry *) (data_ + head_->indexOff))[k];
+  }
+  
+public:
+  IMatStore(string path)
+  :path_(path), data_(NULL), size_(0), mapped_(false), head_(NULL)
+  {
+    map_file();
+    try { check(); }
+    catch (...) { unmap(); throw; }
+  }
+  
+  ~IMatStore() { unmap(); }
+  
+  IMatStore(const IMatStore &) = delete;
+  IMatStore & operator=(const IMatStore &) = delete;
+  
+  void unmap()
+  {
+#ifndef _WIN32
+    if (mapped_) munmap((void *) data_, size_);
+#endif
+    mapped_ = false;
+    data_   = NULL;
+    buf_.clear();
+  }
+  
+  // Store for path, shared with any other user of the same file
+  static shared_ptr<IMatStore> open(string path)
+  {
+    static mutex lock;
+    static map<string, weak_ptr<IMatStore> > opened;
+    lock_guard<mutex> guard(lock);
+    shared_ptr<IMatStore> st = opened[path].lock();
+    if (!st)
+    {
+      st = make_shared<IMatStore>(path);
+      opened[path] = st;
+    }
+    return st;
+  }
+  
+  /*
+   Write the matrices in mats (one p^4 vector per sphere) to path. The
+   file is written next to path and renamed into place, so a reader never
+   maps a partial store
+   */
+  static void write(string path, int p, const vector<vector<double> > & mats,
+                    const vector<double> & radii, int quad, long gridPts)
+  {
+    int ns = (int) mats.size();
+    size_t pq = (size_t) p*p*p*p;
+    
+    Header head;
+    memset(&head, 0, sizeof(Header));
+    strncpy(head.magic, magic(), 8);
+    head.version     = VERSION;
+    head.p           = p;
+    head.ns          = ns;
+    head.quad        = quad;
+    head.gridPts     = gridPts;
+    head.indexOff    = sizeof(Header);
+    head.blockOff    = round_up(head.indexOff + ns*sizeof(IndexEntry));
+    head.blockStride = round_up(pq*sizeof(double));
+    
+    // everything after the header, built in memory for the checksums
+    vector<char> body(head.blockOff + ns*head.blockStride - sizeof(Header), 0);
+    IndexEntry * idx = (IndexEntry *) &body[0];
+    for (int k = 0; k < ns; k++)
+    {
+      if (mats[k].size() != pq)
+        throw BadIMatStoreException(path, "sphere " + to_string(k) +
+                                    " matrix is not p^4");
+      idx[k].radius = radii[k];
+      idx[k].offset = head.blockOff + k*head.blockStride;
+      memcpy(&body[idx[k].offset - sizeof(Header)], &mats[k][0],
+             pq*sizeof(double));
+      idx[k].checksum = fnv1a((const char *) &mats[k][0], pq*sizeof(double));
+    }
+    head.checksum = head_checksum(head, &body[0]);
+    
+    string tmp = path + ".tmp";
+    ofstream fout(tmp.c_str(), ofstream::binary);
+    if (!fout)
+    {
+      cout << "file "<< tmp << " could not be opened."<< endl;
+      exit(1);
+    }
+    fout.write((const char *) &head, sizeof(Header));
+    fout.write(&body[0], body.size());
+    fout.close();
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+    {
+      cout << "could not move " << tmp << " to " << path << endl;
+      exit(1);
+    }
+  }
+  
+  // Stores are named <prefix>.imat
+  static bool is_store_path(const string & path)
+  {
+    return (path.size() > 5 && path.compare(path.size()-5, 5, ".imat") == 0);
+  }
+  
+  /*
+   Check the stored block of sphere k, or of every sphere for k < 0,
+   against its checksum. This reads the whole block, so it is left to
+   callers that want it rather than done on open
+   */
+  void verify(int k = -1) const
+  {
+    size_t nbyte = (size_t) get_p()*get_p()*get_p()*get_p()*sizeof(double);
+    for (int j = (k < 0) ? 0 : k; j < ((k < 0) ? get_ns() : k+1); j++)
+      if (fnv1a(data_ + entry(j).offset, nbyte) != entry(j).checksum)
+        throw BadIMatStoreException(path_, "checksum mismatch in sphere " +
+                                    to_string(j));
+  }
+  
+  const string get_path() const   { return path_; }
+  int get_p() const               { return head_->p; }
+  int get_ns() const              { return head_->ns; }
+  int get_quad() const            { return head_->quad; }
+  long get_grid_pts() const       { return (long) head_->gridPts; }
+  double get_radius(int k) const  { return entry(k).radius; }
+  bool is_mapped() const          { return mapped_; }
+  
+  // Block of sphere k at the stored order, p^4 doubles
+  const double * get_block(int k) const
+  {
+    return (const double *) (data_ + entry(k).offset);
+  }
+  
+  // Leading p^2 x p^2 corner of sphere k's block, p <= get_p()
+  View view(int k, int p) const
+  {
+    if (p > get_p()) throw TooFewPolesException(get_p(), p);
+    View v = { get_block(k), get_p()*get_p(), p*p };
+    return v;
+  }
+  
+  // Copy sphere k at order p into out, which must hold p^4 doubles
+  void copy_k(int k, int p, double * out) const
+  {
+    View v = view(k, p);
+    if (v.n_ == v.stride_)
+    {
+      memcpy(out, v.base_, (size_t) v.n_*v.n_*sizeof(double));
+      return;
+    }
+    for (int r = 0; r < v.n_; r++)
+      memcpy(out + r*v.n_, v.row(r), v.n_*sizeof(double));
+  }
+};
+
+#endif /* IMatStore_h */
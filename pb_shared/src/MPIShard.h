@@ -0,0 +1,248 @@
+//
+//  MPIShard.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MPIShard_h
+#define MPIShard_h
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __MPI
+#include <mpi.h>
+#endif
+
+using namespace std;
+
+/*
+ Helpers for spreading the trajectories of a BD run over MPI ranks. Built
+ without __MPI, or run without mpirun, a run is one rank and these fall
+ back to doing nothing.
+ */
+class MPIShard
+{
+public:
+  /*
+   Starts MPI for the life of main(). Threads of a rank take turns calling
+   MPI, so trajthreads still applies within each rank when the MPI library
+   allows it
+   */
+  class Session
+  {
+  public:
+    Session()
+    {
+#ifdef __MPI
+      int provided;
+      MPI_Init_thread(NULL, NULL, MPI_THREAD_SERIALIZED, &provided);
+#endif
+    }
+    
+    ~Session()
+    {
+#ifdef __MPI
+      MPI_Finalize();
+#endif
+    }
+  };
+  
+  /*
+   Trajectory numbers handed out from one counter on rank 0, so that ranks
+   that draw long trajectories take fewer of them. Every rank must make and
+   destroy it together. Not thread safe, callers take turns
+   */
+  class Counter
+  {
+  protected:
+    int next_;
+#ifdef __MPI
+    MPI_Win win_;
+    int *   base_;
+#endif
+    
+  public:
+    Counter() :next_(0)
+    {
+#ifdef __MPI
+      if (size() == 1) return;
+      MPI_Win_allocate((rank() == 0) ? sizeof(int) : 0, sizeof(int),
+                       MPI_INFO_NULL, MPI_COMM_WORLD, &base_, &win_);
+      if (rank() == 0)
+      {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win_);
+        *base_ = 0;
+        MPI_Win_unlock(0, win_);
+      }
+      MPI_Barrier(MPI_COMM_WORLD);
+#endif
+    }
+    
+    ~Counter()
+    {
+#ifdef __MPI
+      if (size() > 1) MPI_Win_free(&win_);
+#endif
+    }
+    
+    int next()
+    {
+#ifdef __MPI
+      if (size() > 1)
+      {
+        int one = 1, got;
+        MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win_);
+        MPI_Fetch_and_op(&one, &got, MPI_INT, 0, 0, MPI_SUM, win_);
+        MPI_Win_unlock(0, win_);
+        return got;
+      }
+#endif
+      return next_++;
+    }
+  };
+  
+  static int rank()
+  {
+    int r = 0;
+#ifdef __MPI
+    if (running()) MPI_Comm_rank(MPI_COMM_WORLD, &r);
+#endif
+    return r;
+  }
+  
+  static int size()
+  {
+    int n = 1;
+#ifdef __MPI
+    if (running()) MPI_Comm_size(MPI_COMM_WORLD, &n);
+#endif
+    return n;
+  }
+  
+  // whether the threads of a rank may call MPI, one at a time
+  static bool threads_ok()
+  {
+#ifdef __MPI
+    if (!running()) return true;
+    int provided;
+    MPI_Query_thread(&provided);
+    return provided >= MPI_THREAD_SERIALIZED;
+#else
+    return true;
+#endif
+  }
+  
+  static void bcast(int & val, int root = 0)
+  {
+#ifdef __MPI
+    if (size() > 1) MPI_Bcast(&val, 1, MPI_INT, root, MPI_COMM_WORLD);
+#endif
+  }
+  
+  static void bcast(string & bytes, int root = 0)
+  {
+#ifdef __MPI
+    if (size() == 1) return;
+    unsigned long long n = bytes.size();
+    MPI_Bcast(&n, 1, MPI_UNSIGNED_LONG_LONG, root, MPI_COMM_WORLD);
+    bytes.resize(n);
+    // in pieces, as counts are ints
+    const size_t chunk = 1 << 30;
+    for (size_t off = 0; off < n; off += chunk)
+      MPI_Bcast(&bytes[off], (int) min(chunk, (size_t) n - off), MPI_CHAR,
+                root, MPI_COMM_WORLD);
+#endif
+  }
+  
+  // collect the stats lines of each trajectory from every rank on root
+  static void gather(map<int, vector<string> > & lines, int root = 0)
+  {
+#ifdef __MPI
+    if (size() == 1) return;
+    ostringstream out;
+    map<int, vector<string> >::iterator it;
+    for (it = lines.begin(); it != lines.end(); it++)
+    {
+      out << it->first << " " << it->second.size() << "\n";
+      for (int k = 0; k < it->second.size(); k++) out << it->second[k] << "\n";
+    }
+    string mine = out.str();
+    int n = (int) mine.size(), r, nrank = size();
+    vector<int> counts(nrank), displs(nrank, 0);
+    MPI_Gather(&n, 1, MPI_INT, &counts[0], 1, MPI_INT, root, MPI_COMM_WORLD);
+    for (r = 1; r < nrank; r++) displs[r] = displs[r-1] + counts[r-1];
+    string all((rank() == root) ? displs[nrank-1] + counts[nrank-1] : 0, ' ');
+    MPI_Gatherv(&mine[0], n, MPI_CHAR, &all[0], &counts[0], &displs[0],
+                MPI_CHAR, root, MPI_COMM_WORLD);
+    if (rank() != root) return;
+    
+    istringstream in(all);
+    string line;
+    int traj, nline;
+    while (in >> traj >> nline)
+    {
+      getline(in, line);
+      vector<string> & tlines = lines[traj];
+      tlines.resize(nline);
+      for (int k = 0; k < nline; k++) getline(in, tlines[k]);
+    }
+#endif
+  }
+  
+  static string read_file(string path)
+  {
+    ifstream in(path.c_str(), ios::binary);
+    ostringstream bytes;
+    bytes << in.rdbuf();
+    return bytes.str();
+  }
+  
+  static void write_file(string path, const string & bytes)
+  {
+    ofstream out(path.c_str(), ios::binary);
+    out.write(bytes.data(), bytes.size());
+  }
+  
+protected:
+#ifdef __MPI
+  static bool running()
+  {
+    int init, fin;
+    MPI_Initialized(&init);
+    MPI_Finalized(&fin);
+    return init && !fin;
+  }
+#endif
+};
+
+#endif /* MPIShard_h */
@@ -0,0 +1,362 @@
+//
+//  MultiStepForce.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MultiStepForce_h
+#define MultiStepForce_h
+
+#include <math.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BaseSys.h"
+#include "PairTable.h"
+
+using namespace std;
+
+/*
+ Forces and torques for BD steps between full polarization solves. A full
+ solve is asked for every k steps, or sooner once a molecule has moved more
+ than dmax or turned more than rotmax (radians) since the last one. In
+ between the forces come from a cheap model about the last full solve:
+ 
+   frozen  the polarization is held, and the change since then in the
+           screened Coulomb forces between the fixed charges is added
+   linear  forces extrapolated linearly in each molecule's displacement,
+           with a Jacobian built up by Broyden updates between full solves
+   table   forces and torques of the pair tables (see set_table), with the
+           many-body remainder of the last full solve held. A full solve
+           is also asked for while a pair is nearer than its table reaches
+ 
+ Torques are held in the linear model. At every full solve the model's
+ forces are compared with the solved ones; k is halved when the relative
+ drift is over tol and doubled, up to the k given, when it is well under
+ */
+class MultiStepForce
+{
+protected:
+  shared_ptr<BaseSystem> _sys_;
+  int    kMax_;
+  int    k_;
+  string model_;
+  double tol_;
+  double dmax_;
+  double rotmax_;
+  double kappa_;
+  double epsS_;
+  bool   cog_;    // torques about cog, else center 0
+  
+  bool   valid_;  // a full solve to extrapolate from
+  int    count_;  // steps since it
+  double drift_;  // at the last full solve
+  int    nFull_;
+  int    nSteps_;
+  
+  // pose and forces at the last full solve
+  vector<Pt>         x0_;
+  vector<Pt>         F0_;
+  vector<Pt>         tau0_;
+  vector<Pt>         ref0_;    // torque centers
+  vector<vector<Pt> > q0_;     // charge positions
+  vector<int>         arm_[3]; // charges whose separations give orientation
+  vector<Pt>          armV0_[2];
+  vector<vector<double> > J_;  // dF/dx, row major
+  
+  shared_ptr<PairTableCalc> _table_;
+  vector<Pt>                Ft0_;    // of the table at the last full solve
+  vector<Pt>                taut0_;
+  
+  shared_ptr<vector<Pt> > _F_;
+  shared_ptr<vector<Pt> > _tau_;
+  
+  Pt ref_pt(int i)
+  { return cog_ ? _sys_->get_cogi(i) : _sys_->get_centerik(i, 0); }
+  
+  static Pt cross(Pt a, Pt b)
+  {
+    return Pt(a.y()*b.z() - a.z()*b.y(), a.z()*b.x() - a.x()*b.z(),
+              a.x()*b.y() - a.y()*b.x());
+  }
+  
+  static double angle(Pt a, Pt b)
+  {
+    return atan2(cross(a, b).norm(), a.dot(b));
+  }
+  
+  Pt arm_vec(int i, int a)
+  {
+    return _sys_->get_pbc_dist_vec_base(_sys_->get_posijreal(i, arm_[a+1][i]),
+                                        _sys_->get_posijreal(i, arm_[0][i]));
+  }
+  
+  // a charge far from the first one and another far off that line, so that
+  // the two separations turn with the molecule about any axis
+  void choose_arms()
+  {
+    for (int a = 0; a < 3; a++) arm_[a].assign(_sys_->get_n(), 0);
+    for (int i = 0; i < _sys_->get_n(); i++)
+    {
+      Pt p0 = _sys_->get_posijreal(i, 0), u;
+      double best = 0.0;
+      for (int j = 1; j < _sys_->get_Nc_i(i); j++)
+      {
+        Pt v = _sys_->get_pbc_dist_vec_base(_sys_->get_posijreal(i, j), p0);
+        if (v.norm() > best)
+        {
+          best = v.norm();
+          arm_[1][i] = j;
+          u = v * (1.0/best);
+        }
+      }
+      best = 0.0;
+      for (int j = 1; j < _sys_->get_Nc_i(i) && arm_[1][i] != 0; j++)
+      {
+        Pt v = _sys_->get_pbc_dist_vec_base(_sys_->get_posijreal(i, j), p0);
+        double perp = (v - u * v.dot(u)).norm();
+        if (perp > best)
+        {
+          best = perp;
+          arm_[2][i] = j;
+        }
+      }
+    }
+  }
+  
+  // screened Coulomb forces and torques between the charges of molecules
+  // whose centers are within the cutoff, at positions pos(i, j)
+  template <typename P>
+  void add_coulomb(P pos, double sign, vector<Pt> & F, vector<Pt> & tau,
+                   const vector<Pt> & ref)
+  {
+    int N = _sys_->get_n();
+    for (int i = 0; i < N; i++)
+      for (int j = i+1; j < N; j++)
+      {
+        Pt cij = _sys_->get_pbc_dist_vec_base(_sys_->get_unwrapped_center(i),
+                                              _sys_->get_unwrapped_center(j));
+        if (! _sys_->less_than_cutoff(cij)) continue;
+        Pt fi(0.0, 0.0, 0.0), ti(0.0, 0.0, 0.0), tj(0.0, 0.0, 0.0);
+        for (int a = 0; a < _sys_->get_Nc_i(i); a++)
+        {
+          Pt ra = pos(i, a);
+          double qa = _sys_->get_qij(i, a);
+          Pt fa(0.0, 0.0, 0.0);
+          for (int b = 0; b < _sys_->get_Nc_i(j); b++)
+          {
+            Pt rb = pos(j, b);
+            Pt v = _sys_->get_pbc_dist_vec_base(ra, rb);
+            double r = v.norm();
+            if (r < 1e-8) continue;
+            double mag = qa * _sys_->get_qij(j, b) * (1.0 + kappa_*r) *
+                         exp(-kappa_*r) / (epsS_*r*r*r);
+            Pt f = v * mag;
+            fa = fa + f;
+            tj = tj - cross(_sys_->get_pbc_dist_vec_base(rb, ref[j]), f);
+          }
+          fi = fi + fa;
+          ti = ti + cross(_sys_->get_pbc_dist_vec_base(ra, ref[i]), fa);
+        }
+        F[i] = F[i] + fi * sign;
+        F[j] = F[j] - fi * sign;
+        tau[i] = tau[i] + ti * sign;
+        tau[j] = tau[j] + tj * sign;
+      }
+  }
+  
+  // forces and torques of the model at the current pose
+  void model(vector<Pt> & F, vector<Pt> & tau)
+  {
+    int N = _sys_->get_n();
+    F = F0_;
+    tau = tau0_;
+    if (model_ == "linear")
+    {
+      for (int i = 0; i < N; i++)
+      {
+        Pt dx = _sys_->get_unwrapped_center(i) - x0_[i];
+        const vector<double> & J = J_[i];
+        F[i] = F[i] + Pt(J[0]*dx.x() + J[1]*dx.y() + J[2]*dx.z(),
+                         J[3]*dx.x() + J[4]*dx.y() + J[5]*dx.z(),
+                         J[6]*dx.x() + J[7]*dx.y() + J[8]*dx.z());
+      }
+      return;
+    }
+    if (model_ == "table" && _table_)
+    {
+      _table_->calc_force();
+      for (int i = 0; i < N; i++)
+      {
+        F[i] = F[i] - Ft0_[i] + (*_table_->get_F())[i];
+        tau[i] = tau[i] - taut0_[i] + (*_table_->get_Tau())[i];
+      }
+      return;
+    }
+    
+    vector<Pt> ref(N);
+    for (int i = 0; i < N; i++) ref[i] = ref_pt(i);
+    add_coulomb([this] (int i, int j) { return _sys_->get_posijreal(i, j); },
+                1.0, F, tau, ref);
+    add_coulomb([this] (int i, int j) { return q0_[i][j]; },
+                -1.0, F, tau, ref0_);
+  }
+  
+  static double rel_err(vector<Pt> a, vector<Pt> b)
+  {
+    double num = 0.0, den = 0.0;
+    for (int i = 0; i < a.size(); i++)
+    {
+      Pt d = a[i] - b[i], c = b[i];
+      num += d.norm2();
+      den += c.norm2();
+    }
+    if (num == 0.0) return 0.0;
+    return sqrt(num / max(den, 1e-300));
+  }
+  
+public:
+  MultiStepForce(shared_ptr<BaseSystem> sys, int k, string model,
+                 double tol, double dmax, double rotmax, double kappa,
+                 double epsS, bool cog)
+  :_sys_(sys), kMax_(max(1, k)), k_(max(1, k)), model_(model), tol_(tol),
+  dmax_(dmax), rotmax_(rotmax), kappa_(kappa), epsS_(epsS), cog_(cog),
+  valid_(false), count_(0), drift_(0.0), nFull_(0), nSteps_(0),
+  J_(sys->get_n(), vector<double> (9, 0.0)),
+  _F_(make_shared<vector<Pt> >(sys->get_n())),
+  _tau_(make_shared<vector<Pt> >(sys->get_n()))
+  {
+    choose_arms();
+  }
+  
+  // true if the forces for this step must come from a full solve
+  bool need_full()
+  {
+    if (!valid_ || count_ >= k_) return true;
+    if (model_ == "table" && _table_ && _table_->pairs_close()) return true;
+    for (int i = 0; i < _sys_->get_n(); i++)
+    {
+      if ((_sys_->get_unwrapped_center(i) - x0_[i]).norm() > dmax_)
+        return true;
+      for (int a = 0; a < 2; a++)
+        if (arm_[a+1][i] != 0 && angle(arm_vec(i, a), armV0_[a][i]) > rotmax_)
+          return true;
+    }
+    return false;
+  }
+  
+  // take the forces of a full solve at the current pose, checking the model
+  // against them first
+  void refresh(shared_ptr<vector<Pt> > F, shared_ptr<vector<Pt> > tau)
+  {
+    int i, N = _sys_->get_n();
+    if (valid_ && count_ > 0)
+    {
+      vector<Pt> Fm, taum;
+      model(Fm, taum);
+      drift_ = max(rel_err(Fm, *F), rel_err(taum, *tau));
+      if (drift_ > tol_) k_ = max(1, k_/2);
+      else if (drift_ < 0.25*tol_) k_ = min(kMax_, 2*k_);
+    }
+    
+    if (valid_ && model_ == "linear")
+      for (i = 0; i < N; i++)
+      {
+        Pt dx = _sys_->get_unwrapped_center(i) - x0_[i];
+        double dx2 = dx.norm2();
+        vector<double> & J = J_[i];
+        // a jump much past dmax was not a step the model should learn from
+        if (dx2 < 1e-16 || dx2 > 4.0*dmax_*dmax_) continue;
+        Pt r = F->operator[](i) - F0_[i] -
+               Pt(J[0]*dx.x() + J[1]*dx.y() + J[2]*dx.z(),
+                  J[3]*dx.x() + J[4]*dx.y() + J[5]*dx.z(),
+                  J[6]*dx.x() + J[7]*dx.y() + J[8]*dx.z());
+        double rr[3] = {r.x(), r.y(), r.z()}, d[3] = {dx.x(), dx.y(), dx.z()};
+        for (int m = 0; m < 3; m++)
+          for (int n = 0; n < 3; n++) J[3*m+n] += rr[m] * d[n] / dx2;
+      }
+    
+    F0_ = *F;
+    tau0_ = *tau;
+    if (model_ == "table" && _table_)
+    {
+      _table_->calc_force();
+      Ft0_ = *_table_->get_F();
+      taut0_ = *_table_->get_Tau();
+    }
+    *_F_ = F0_;
+    *_tau_ = tau0_;
+    x0_.resize(N);
+    ref0_.resize(N);
+    q0_.resize(N);
+    armV0_[0].resize(N);
+    armV0_[1].resize(N);
+    for (i = 0; i < N; i++)
+    {
+      x0_[i] = _sys_->get_unwrapped_center(i);
+      ref0_[i] = ref_pt(i);
+      q0_[i].resize(_sys_->get_Nc_i(i));
+      for (int j = 0; j < _sys_->get_Nc_i(i); j++)
+        q0_[i][j] = _sys_->get_posijreal(i, j);
+      for (int a = 0; a < 2; a++) armV0_[a][i] = arm_vec(i, a);
+    }
+    valid_ = true;
+    count_ = 0;
+    nFull_++;
+    nSteps_++;
+  }
+  
+  // forces of the model for a step between full solves
+  void predict()
+  {
+    model(*_F_, *_tau_);
+    count_++;
+    nSteps_++;
+  }
+  
+  // the pose jumped without forces (see BaseBDStep::far_update), so the
+  // next step gets a full solve that is not held against the model
+  void invalidate()
+  {
+    valid_ = false;
+    for (int i = 0; i < J_.size(); i++) J_[i].assign(9, 0.0);
+  }
+  
+  // pair tables for the table model, on the same system
+  void set_table(shared_ptr<PairTableCalc> table) { _table_ = table; }
+  
+  shared_ptr<vector<Pt> > get_F()   { return _F_; }
+  shared_ptr<vector<Pt> > get_Tau() { return _tau_; }
+  
+  int get_k() const          { return k_; }
+  double get_drift() const   { return drift_; }
+  int get_n_full() const     { return nFull_; }
+  int get_n_steps() const    { return nSteps_; }
+};
+
+#endif /* MultiStepForce_h */
@@ -22,7 +22,7 @@ public:
   ExpansionAccessException(const int i, const int j,
                         const int poles)
   :i_(i), j_(j), poles_(poles)
-  {
+  { printf("DBG EXPACC %d %d %d\n", i, j, poles);
   }
   
   virtual const char* what() const throw()
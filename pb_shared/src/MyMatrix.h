@@ -32,6 +32,7 @@
 #ifndef MyMatrix_h
 #define MyMatrix_h
 
+#include <execinfo.h>
 #include <stdio.h>
 #include <vector>
 #include <sstream>
@@ -49,8 +50,7 @@ public:
 MatrixAccessException(const int i, const int j,
                     const int nrows, const int ncols)
 :i_(i), j_(j), nrows_(nrows), ncols_(ncols)
-{
-}
+{ printf("DBG MATACC %d %d %d %d\n", i, j, nrows, ncols); void* b[30]; int n = backtrace(b, 30); backtrace_symbols_fd(b, n, 1); }
 
 virtual const char* what() const throw()
 {
@@ -154,7 +154,7 @@ public:
   /*
    Set the value of a coordinate in this matrix given the position (i, j)
    */
-  void set_val(const int i, const int j, T val)
+  void set_val(const int i, const int j, const T & val)
   {
     vals_[i][j] = val;
   }
@@ -174,10 +174,22 @@ public:
     }
   }
   
+  const T& operator()(const int i, const int j) const
+  {
+    if (i < 0 || j < 0 || i > nrows_ || j > ncols_)
+    {
+      throw MatrixAccessException(i, j, nrows_, ncols_);
+    }
+    else
+    {
+      return vals_[i][j];
+    }
+  }
+  
   /*
    Addition operator returns new matrix
    */
-  MyMatrix<T> operator+(MyMatrix<T>& rhs)
+  MyMatrix<T> operator+(const MyMatrix<T>& rhs)
   {
     if (ncols_ != rhs.ncols_ || nrows_ != rhs.nrows_)
     {
@@ -200,7 +212,7 @@ public:
   /*
    summation operator adds to existing matrix
    */
-  MyMatrix<T>& operator+=(MyMatrix<T>& rhs)
+  MyMatrix<T>& operator+=(const MyMatrix<T>& rhs)
   {
     if (ncols_ != rhs.ncols_ || nrows_ != rhs.nrows_)
     {
@@ -221,7 +233,7 @@ public:
   /*
    Compute Forbenius inner product of two matrices
    */
-  T inner(MyMatrix<T>& rhs)
+  T inner(const MyMatrix<T>& rhs)
   {
     if (ncols_ != rhs.ncols_ || nrows_ != rhs.nrows_)
     {
@@ -244,7 +256,7 @@ public:
   /*
    Matrix multiplication. If this is size n x m, then rhs must be size m x p
    */
-  MyMatrix<T> operator*(MyMatrix<T>& rhs)
+  MyMatrix<T> operator*(const MyMatrix<T>& rhs)
   {
     if (ncols_ != rhs.nrows_)
     {
@@ -275,8 +287,8 @@ public:
     return result;
   }
   
-  const int get_nrows() { return nrows_; }
-  const int get_ncols() { return ncols_; }
+  const int get_nrows() const { return nrows_; }
+  const int get_ncols() const { return ncols_; }
   
 };
 
@@ -328,7 +340,7 @@ public:
     }
   }
   
-  void set_val(const int i, T val)
+  void set_val(const int i, const T & val)
   {
     MyMatrix<T>::set_val(i, 0, val);
   }
@@ -390,7 +402,12 @@ public:
   {
     return this->vals_[i][0];
   }
-  
+
+  const T& operator[](int i) const
+  {
+    return this->vals_[i][0];
+  }
+
   /*
    The multiplication operator now computes the inner product
    */
@@ -0,0 +1,176 @@
+//
+//  P2MKernel.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef P2MKernel_h
+#define P2MKernel_h
+
+#include <vector>
+#include <memory>
+#include "SHCalc.h"
+
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+/*
+ Charges to be expanded about one or more centers, stored as separate
+ coordinate arrays. Positions are relative to the center of the expansion
+ they belong to, and each charge carries the index of that expansion.
+ Entries for the same expansion should be added contiguously.
+ */
+class P2MBatch
+{
+public:
+  vector<int>    exp_;  // index of the expansion each charge contributes to
+  vector<double> x_, y_, z_, q_;
+  
+  void reserve(size_t n)
+  {
+    exp_.reserve(n); x_.reserve(n); y_.reserve(n); z_.reserve(n);
+    q_.reserve(n);
+  }
+  
+  void add(int k, double x, double y, double z, double q)
+  {
+    exp_.push_back(k);
+    x_.push_back(x); y_.push_back(y); z_.push_back(z);
+    q_.push_back(q);
+  }
+  
+  size_t size() const { return q_.size(); }
+};
+
+/*
+ Charge to multipole kernel. Accumulates, for every entry of a P2MBatch,
+ 
+   REGULAR:    scl * q * (r/a_k)^n * Y_(n,m)(theta, phi)
+   IRREGULAR:  scl * q * (1/r) * (a_k/r)^n * Y_(n,m)(theta, phi)
+ 
+ into the (p, 2p+1) matrix of its expansion k. Powers of r are built by
+ recurrence and only m >= 0 is summed, the m < 0 half being filled with
+ the conjugate at the end. Charges are split into fixed blocks that never
+ straddle two expansions; with OpenMP the blocks are spread over threads
+ and reduced in block order, so the result does not depend on the number
+ of threads.
+ */
+class P2MKernel
+{
+public:
+  enum Radial { REGULAR, IRREGULAR };
+  
+  static const int BLOCK = 256;
+  
+  static void accumulate(const P2MBatch & batch, const vector<double> & a,
+                         Radial radial, double scl, int p,
+                         shared_ptr<SHCalc> shcalc,
+                         vector<MyMatrix<cmplx> > & out)
+  {
+    // blocks of charges within a single expansion
+    vector<size_t> start;
+    size_t i = 0;
+    while (i < batch.size())
+    {
+      start.push_back(i);
+      size_t end = min(i + BLOCK, batch.size());
+      size_t j = i + 1;
+      while (j < end && batch.exp_[j] == batch.exp_[i]) j++;
+      i = j;
+    }
+    start.push_back(batch.size());
+    
+    int nblk = (int) start.size() - 1;
+    vector<vector<cmplx> > part(nblk);
+    
+#pragma omp parallel
+    {
+      SHWorkspace shws = shcalc->make_workspace();
+      vector<double> rn(p);
+      
+#pragma omp for schedule(dynamic)
+      for (int b = 0; b < nblk; b++)
+      {
+        vector<cmplx> & acc = part[b];
+        acc.assign(p*p, cmplx(0.0, 0.0));
+        double ak = a[batch.exp_[start[b]]];
+        for (size_t c = start[b]; c < start[b+1]; c++)
+        {
+          double r, theta, phi;
+          to_spherical(batch.x_[c], batch.y_[c], batch.z_[c], r, theta, phi);
+          shcalc->calc_sh(theta, phi, shws);
+          
+          double fac, ratio;
+          if (radial == REGULAR)
+          {
+            fac = batch.q_[c] * scl;
+            ratio = r / ak;
+          } else
+          {
+            fac = batch.q_[c] * scl / r;
+            ratio = ak / r;
+          }
+          rn[0] = fac;
+          for (int n = 1; n < p; n++) rn[n] = rn[n-1] * ratio;
+          
+          const MyMatrix<cmplx> & Y = shws.get_full_result();
+          for (int n = 0; n < p; n++)
+            for (int m = 0; m <= n; m++)
+              acc[n*p+m] += rn[n] * Y(n, m);
+        }
+      }
+    }
+    
+    for (int b = 0; b < nblk; b++)
+    {
+      MyMatrix<cmplx> & mat = out[batch.exp_[start[b]]];
+      for (int n = 0; n < p; n++)
+        for (int m = 0; m <= n; m++)
+        {
+          mat(n, m+p) += part[b][n*p+m];
+          if (m > 0) mat(n, -m+p) += conj(part[b][n*p+m]);
+        }
+    }
+  }
+  
+protected:
+  // same conventions as Point::convert_to_spherical
+  static void to_spherical(double x, double y, double z,
+                           double & r, double & theta, double & phi)
+  {
+    r = sqrt(x*x + y*y + z*z);
+    if (r < fabs(z)) r = fabs(z);
+    theta = (r == 0.0) ? 0.0 : acos(z/r);
+    phi = ((x == 0.0) && (y == 0.0)) ? 0.0 : atan2(y, x);
+  }
+};
+
+#endif /* P2MKernel_h */
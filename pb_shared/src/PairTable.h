@@ -0,0 +1,696 @@
+//
+//  PairTable.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PairTable_h
+#define PairTable_h
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "readutil.h"
+#include "BasePhysCalc.h"
+#include "BDFarm.h"
+#include "WignerRotation.h"
+
+using namespace std;
+
+class BadPairTableException: public exception
+{
+protected:
+  string msg_;
+  
+public:
+  BadPairTableException(string path, string why)
+  :msg_("Bad pair table " + path + ": " + why)
+  {
+  }
+  
+  virtual const char* what() const throw()
+  {
+    return msg_.c_str();
+  }
+};
+
+/*
+ Energies, forces and torques of a pair of rigid molecules of types A and B
+ (which may be the same) as functions of their relative pose. Everything is
+ in the body frame of A with its center at the origin: B has its center at
+ d u and is turned by R from its own body frame. Each of the NCH channels
+ (energy, force and torque of each molecule) is expanded at nd distances
+ evenly spaced over [d0, d1] as
+ 
+   f(d_k, u, R) = sum c_k(lm, jab) Y_lm(u) D_jab(R)
+ 
+ with real spherical harmonics of degree l <= L and the real and imaginary
+ parts of the Wigner functions D^j_ab(R), j <= J. The coefficients are
+ projections from two-body solves on a product quadrature, Gauss-Legendre
+ by uniform in u and in the Euler angles of R, that is exact for functions
+ of those degrees. Between distances the coefficients are Catmull-Rom
+ splines. Past d1 every channel is zero, and nearer than d0 the table does
+ not apply.
+ 
+ File layout, in native byte order:
+ 
+   [0, 64)   Header
+   [64, ...) coefficients, by distance, channel, Y_lm, D_jab, last fastest
+ */
+class PairTable
+{
+public:
+  static const uint32_t VERSION = 1;
+  static const int NCH = 14;
+  
+  struct Sample;
+  // two-body solve for B at d u turned by R, see build
+  typedef function<Sample(double d, Pt u, MyMatrix<double> R)> SolveFn;
+  
+  // channels of one pose
+  struct Sample
+  {
+    double e[2];
+    Pt     f[2];
+    Pt     tau[2];
+    
+    Sample() { e[0] = e[1] = 0.0; }
+    
+    void to_channels(double * c) const
+    {
+      for (int m = 0; m < 2; m++)
+      {
+        Pt fm = f[m], tm = tau[m];
+        c[m] = e[m];
+        for (int d = 0; d < 3; d++)
+        {
+          c[2+3*m+d] = fm.get_cart(d);
+          c[8+3*m+d] = tm.get_cart(d);
+        }
+      }
+    }
+    
+    void from_channels(const double * c)
+    {
+      for (int m = 0; m < 2; m++)
+      {
+        e[m] = c[m];
+        f[m] = Pt(c[2+3*m], c[3+3*m], c[4+3*m]);
+        tau[m] = Pt(c[8+3*m], c[9+3*m], c[10+3*m]);
+      }
+    }
+    
+    string to_line() const
+    {
+      double c[NCH];
+      char buf[32];
+      string line;
+      to_channels(c);
+      for (int i = 0; i < NCH; i++)
+      {
+        sprintf(buf, "%s%.17g", (i == 0) ? "" : " ", c[i]);
+        line += buf;
+      }
+      return line;
+    }
+    
+    static Sample from_line(string line)
+    {
+      double c[NCH];
+      istringstream iss(line);
+      for (int i = 0; i < NCH; i++) iss >> c[i];
+      Sample s;
+      s.from_channels(c);
+      return s;
+    }
+  };
+  
+  struct Header
+  {
+    char     magic[8];
+    uint32_t version;
+    int32_t  L;
+    int32_t  J;
+    int32_t  nd;
+    int32_t  types[2];
+    double   d0;
+    double   d1;
+    uint64_t checksum;
+    uint64_t nbytes;    // of coefficients
+  };
+  
+protected:
+  Header         head_;
+  int            nY_;    // (L+1)^2
+  int            nD_;    // sum over j of (2j+1)^2
+  vector<double> coef_;
+  
+  static const char * magic() { return "PBPAIRT"; }
+  
+  static uint64_t fnv1a(const char * c, size_t n)
+  {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; i++)
+    {
+      h ^= (unsigned char) c[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+  
+  void set_sizes()
+  {
+    nY_ = (head_.L + 1) * (head_.L + 1);
+    nD_ = 0;
+    for (int j = 0; j <= head_.J; j++) nD_ += (2*j+1) * (2*j+1);
+  }
+  
+  static double fact(int n)
+  {
+    double f = 1.0;
+    for (int i = 2; i <= n; i++) f *= i;
+    return f;
+  }
+  
+  // Wigner small d^j_ab(beta)
+  static double wigner_d(int j, int a, int b, double beta)
+  {
+    double c = cos(0.5*beta), s = sin(0.5*beta), sum = 0.0;
+    double pre = sqrt(fact(j+a) * fact(j-a) * fact(j+b) * fact(j-b));
+    for (int k = max(0, b-a); k <= min(j+b, j-a); k++)
+    {
+      double t = pre / (fact(j+b-k) * fact(k) * fact(a-b+k) * fact(j-a-k));
+      t *= pow(c, 2*j+b-a-2*k) * pow(s, a-b+2*k);
+      sum += ((a-b+k) % 2 == 0) ? t : -t;
+    }
+    return sum;
+  }
+  
+  // real spherical harmonics of u, unnormalized, at (l, m) -> l^2 + l + m
+  static void y_basis(int L, Pt u, double * y)
+  {
+    double r = u.norm(), x = u.z()/r, phi = atan2(u.y(), u.x());
+    double sx = sqrt(max(0.0, 1.0 - x*x));
+    vector<double> P((L+1)*(L+1), 0.0);  // P_l^m at l*(L+1) + m
+    double pmm = 1.0;
+    for (int m = 0; m <= L; m++)
+    {
+      if (m > 0) pmm *= (2*m - 1) * sx;
+      P[m*(L+1)+m] = pmm;
+      if (m < L) P[(m+1)*(L+1)+m] = x * (2*m + 1) * pmm;
+      for (int l = m+2; l <= L; l++)
+        P[l*(L+1)+m] = ((2*l - 1) * x * P[(l-1)*(L+1)+m] -
+                        (l + m - 1) * P[(l-2)*(L+1)+m]) / (l - m);
+    }
+    for (int l = 0; l <= L; l++)
+    {
+      y[l*l+l] = P[l*(L+1)];
+      for (int m = 1; m <= l; m++)
+      {
+        y[l*l+l+m] = P[l*(L+1)+m] * cos(m*phi);
+        y[l*l+l-m] = P[l*(L+1)+m] * sin(m*phi);
+      }
+    }
+  }
+  
+  // real and imaginary parts of D^j_ab for R = Rz(al) Ry(be) Rz(ga), by j,
+  // a, b, the last fastest. (a, b) and (-a, -b) give the cosine and sine
+  static void d_basis(int J, double al, double be, double ga, double * D)
+  {
+    int n = 0;
+    for (int j = 0; j <= J; j++)
+      for (int a = -j; a <= j; a++)
+        for (int b = -j; b <= j; b++)
+        {
+          if (a > 0 || (a == 0 && b >= 0))
+            D[n++] = wigner_d(j, a, b, be) * cos(a*al + b*ga);
+          else
+            D[n++] = wigner_d(j, -a, -b, be) * sin(-a*al - b*ga);
+        }
+  }
+  
+  static MyMatrix<double> euler_matrix(double al, double be, double ga)
+  {
+    double ca = cos(al), sa = sin(al), cb = cos(be), sb = sin(be);
+    double cg = cos(ga), sg = sin(ga);
+    MyMatrix<double> R(3, 3);
+    R(0, 0) = ca*cb*cg - sa*sg; R(0, 1) = -ca*cb*sg - sa*cg; R(0, 2) = ca*sb;
+    R(1, 0) = sa*cb*cg + ca*sg; R(1, 1) = -sa*cb*sg + ca*cg; R(1, 2) = sa*sb;
+    R(2, 0) = -sb*cg;           R(2, 1) = sb*sg;             R(2, 2) = cb;
+    return R;
+  }
+  
+  int n_s2() const  { return (head_.L + 1) * (2*head_.L + 1); }
+  int n_so3() const { return (head_.J + 1) * (2*head_.J + 1) * (2*head_.J + 1); }
+  
+  // quadrature node i over u and r over R, with their weights
+  void s2_node(int i, Pt & u, double & w) const
+  {
+    vector<double> x, wt;
+    gauss_legendre(head_.L + 1, x, wt);
+    int nphi = 2*head_.L + 1, it = i / nphi;
+    double phi = 2.0 * M_PI * (i % nphi) / nphi, st = sqrt(1.0 - x[it]*x[it]);
+    u = Pt(st*cos(phi), st*sin(phi), x[it]);
+    w = wt[it] * 2.0 * M_PI / nphi;
+  }
+  
+  void so3_node(int r, double & al, double & be, double & ga, double & w) const
+  {
+    vector<double> x, wt;
+    gauss_legendre(head_.J + 1, x, wt);
+    int na = 2*head_.J + 1, ib = r / (na*na);
+    al = 2.0 * M_PI * ((r / na) % na) / na;
+    ga = 2.0 * M_PI * (r % na) / na;
+    be = acos(x[ib]);
+    w = wt[ib] * 4.0 * M_PI * M_PI / (na*na);
+  }
+  
+  // node indices and weights of the spline at d, ends extended linearly
+  void spline(double d, int * k, double * w) const
+  {
+    int nd = head_.nd;
+    double h = (head_.d1 - head_.d0) / (nd - 1), s = (d - head_.d0) / h;
+    int k0 = min(max((int) floor(s), 0), nd - 2);
+    double t = s - k0, cr[4];
+    cr[0] = 0.5 * (-t*t*t + 2*t*t - t);
+    cr[1] = 0.5 * (3*t*t*t - 5*t*t + 2);
+    cr[2] = 0.5 * (-3*t*t*t + 4*t*t + t);
+    cr[3] = 0.5 * (t*t*t - t*t);
+    for (int q = 0; q < 4; q++) w[q] = 0.0;
+    for (int q = 0; q < 4; q++)
+    {
+      int kk = k0 - 1 + q;
+      if (kk < 0)        { w[1] += 2.0*cr[q]; w[2] -= cr[q]; }
+      else if (kk >= nd) { w[2] += 2.0*cr[q]; w[1] -= cr[q]; }
+      else w[q] += cr[q];
+    }
+    for (int q = 0; q < 4; q++) k[q] = min(max(k0 - 1 + q, 0), nd - 1);
+  }
+  
+public:
+  PairTable(int L, int J, int nd, double d0, double d1, int typeA, int typeB)
+  {
+    memset(&head_, 0, sizeof(Header));
+    strncpy(head_.magic, magic(), 8);
+    head_.version  = VERSION;
+    head_.L        = L;
+    head_.J        = J;
+    head_.nd       = max(2, nd);
+    head_.types[0] = typeA;
+    head_.types[1] = typeB;
+    head_.d0       = d0;
+    head_.d1       = d1;
+    set_sizes();
+    coef_.assign((size_t) head_.nd * NCH * nY_ * nD_, 0.0);
+  }
+  
+  PairTable(string path)
+  {
+    ifstream fin(path.c_str(), ios::binary);
+    if (!fin.is_open()) throw CouldNotReadException(path);
+    fin.read((char *) &head_, sizeof(Header));
+    if (!fin || strncmp(head_.magic, magic(), 8) != 0)
+      throw BadPairTableException(path, "not a pair table");
+    if (head_.version != VERSION)
+      throw BadPairTableException(path, "version " + to_string(head_.version));
+    set_sizes();
+    if (head_.L < 0 || head_.J < 0 || head_.nd < 2 || head_.nbytes !=
+        (uint64_t) head_.nd * NCH * nY_ * nD_ * sizeof(double))
+      throw BadPairTableException(path, "inconsistent header");
+    
+    coef_.resize(head_.nbytes / sizeof(double));
+    fin.read((char *) &coef_[0], head_.nbytes);
+    if (!fin) throw BadPairTableException(path, "file too short");
+    if (fnv1a((const char *) &coef_[0], head_.nbytes) != head_.checksum)
+      throw BadPairTableException(path, "checksum mismatch");
+  }
+  
+  void write(string path)
+  {
+    head_.nbytes   = coef_.size() * sizeof(double);
+    head_.checksum = fnv1a((const char *) &coef_[0], head_.nbytes);
+    ofstream fout(path.c_str(), ofstream::binary);
+    if (!fout)
+    {
+      cout << "file "<< path << " could not be opened."<< endl;
+      exit(1);
+    }
+    fout.write((const char *) &head_, sizeof(Header));
+    fout.write((const char *) &coef_[0], head_.nbytes);
+  }
+  
+  // two-body solves needed by fit, one for each pose given by sample_pose
+  int n_samples() const { return head_.nd * n_s2() * n_so3(); }
+  
+  void sample_pose(int s, double & d, Pt & u, MyMatrix<double> & R) const
+  {
+    double w, al, be, ga;
+    int nS2 = n_s2(), nSO3 = n_so3();
+    d = head_.d0 + (head_.d1 - head_.d0) * (s / (nS2*nSO3)) / (head_.nd - 1);
+    s2_node((s / nSO3) % nS2, u, w);
+    so3_node(s % nSO3, al, be, ga, w);
+    R = euler_matrix(al, be, ga);
+  }
+  
+  // coefficients from the solves at every sample_pose, in order
+  void fit(const vector<Sample> & samp)
+  {
+    int nS2 = n_s2(), nSO3 = n_so3(), i, r, y, c, k;
+    vector<double> Y(nS2*nY_), wY(nS2), D(nSO3*nD_), wD(nSO3);
+    vector<double> normY(nY_, 0.0), normD(nD_, 0.0);
+    for (i = 0; i < nS2; i++)
+    {
+      Pt u;
+      s2_node(i, u, wY[i]);
+      y_basis(head_.L, u, &Y[i*nY_]);
+      for (y = 0; y < nY_; y++) normY[y] += wY[i] * Y[i*nY_+y] * Y[i*nY_+y];
+    }
+    for (r = 0; r < nSO3; r++)
+    {
+      double al, be, ga;
+      so3_node(r, al, be, ga, wD[r]);
+      d_basis(head_.J, al, be, ga, &D[r*nD_]);
+      for (y = 0; y < nD_; y++) normD[y] += wD[r] * D[r*nD_+y] * D[r*nD_+y];
+    }
+    
+    vector<double> ch((size_t) samp.size() * NCH), G(nS2*nD_);
+    for (size_t s = 0; s < samp.size(); s++) samp[s].to_channels(&ch[s*NCH]);
+    for (k = 0; k < head_.nd; k++)
+      for (c = 0; c < NCH; c++)
+      {
+        fill(G.begin(), G.end(), 0.0);
+        for (i = 0; i < nS2; i++)
+          for (r = 0; r < nSO3; r++)
+          {
+            double f = wD[r] * ch[((size_t)(k*nS2 + i)*nSO3 + r)*NCH + c];
+            for (int b = 0; b < nD_; b++) G[i*nD_+b] += f * D[r*nD_+b];
+          }
+        double * cf = &coef_[((size_t) k*NCH + c) * nY_ * nD_];
+        for (y = 0; y < nY_; y++)
+          for (int b = 0; b < nD_; b++)
+          {
+            double sum = 0.0;
+            for (i = 0; i < nS2; i++) sum += wY[i] * Y[i*nY_+y] * G[i*nD_+b];
+            cf[y*nD_+b] = sum / (normY[y] * normD[b]);
+          }
+      }
+  }
+  
+  /*
+   Channels for B at d u turned by R, in the frame of A. False, with all
+   channels zero, if d is nearer than the table reaches
+   */
+  bool evaluate(double d, Pt u, const MyMatrix<double> & R, Sample & out) const
+  {
+    out = Sample();
+    if (d < head_.d0 - 1e-9) return false;
+    if (d > head_.d1) return true;
+    
+    int k[4];
+    double w[4], al, be, ga, ch[NCH];
+    vector<double> Y(nY_), D(nD_);
+    spline(d, k, w);
+    y_basis(head_.L, u, &Y[0]);
+    WignerRotation::euler_angles(R, al, be, ga);
+    d_basis(head_.J, al, be, ga, &D[0]);
+    for (int c = 0; c < NCH; c++)
+    {
+      ch[c] = 0.0;
+      for (int q = 0; q < 4; q++)
+      {
+        if (w[q] == 0.0) continue;
+        const double * cf = &coef_[((size_t) k[q]*NCH + c) * nY_ * nD_];
+        double sum = 0.0;
+        for (int y = 0; y < nY_; y++)
+        {
+          double t = 0.0;
+          for (int b = 0; b < nD_; b++) t += cf[y*nD_+b] * D[b];
+          sum += Y[y] * t;
+        }
+        ch[c] += w[q] * sum;
+      }
+    }
+    out.from_channels(ch);
+    return true;
+  }
+  
+  /*
+   Fill the table from solves on nthreads workers (and MPI ranks), each
+   with its own solver from make_worker. The solves are written a line each
+   to samples, in order, which rank 0 reads back to fit. Returns the RMS
+   error of the forces from the table relative to those of nCheck solves at
+   random poses in the nearer half of the table, or -1 on other ranks
+   */
+  double build(string samples, int nthreads,
+               function<SolveFn(int worker)> make_worker, int nCheck = 20)
+  {
+    if (MPIShard::rank() == 0) remove(samples.c_str());
+    BDFarm farm(nthreads, n_samples(), samples);
+    farm.run([this, &make_worker] (int w) -> BDFarm::TrajFn
+    {
+      SolveFn solve = make_worker(w);
+      return [this, solve] (int s) -> vector<string>
+      {
+        double d;
+        Pt u;
+        MyMatrix<double> R;
+        sample_pose(s, d, u, R);
+        return vector<string> (1, solve(d, u, R).to_line());
+      };
+    });
+    if (MPIShard::rank() != 0) return -1.0;
+    
+    vector<Sample> samp;
+    ifstream fin(samples.c_str());
+    string line;
+    while (getline(fin, line))
+      if (!line.empty()) samp.push_back(Sample::from_line(line));
+    if ((int) samp.size() != n_samples())
+      throw BadPairTableException(samples, "missing solves");
+    fit(samp);
+    
+    SolveFn solve = make_worker(0);
+    mt19937 gen(n_samples());
+    uniform_real_distribution<double> uni(0.0, 1.0);
+    double num = 0.0, den = 0.0;
+    for (int t = 0; t < nCheck; t++)
+    {
+      double d = head_.d0 + 0.5 * (head_.d1 - head_.d0) * uni(gen);
+      double z = 2.0*uni(gen) - 1.0, phi = 2.0*M_PI*uni(gen);
+      Pt u(sqrt(1.0 - z*z)*cos(phi), sqrt(1.0 - z*z)*sin(phi), z), ax;
+      do ax = Pt(2*uni(gen)-1, 2*uni(gen)-1, 2*uni(gen)-1);
+      while (ax.norm() > 1.0 || ax.norm() < 1e-3);
+      MyMatrix<double> R = Quat(M_PI*uni(gen), ax).get_rotation_matrix();
+      Sample ex = solve(d, u, R), tb;
+      evaluate(d, u, R, tb);
+      for (int m = 0; m < 2; m++)
+      {
+        num += (tb.f[m] - ex.f[m]).norm2();
+        den += ex.f[m].norm2();
+      }
+    }
+    return (den > 0.0) ? sqrt(num / den) : 0.0;
+  }
+  
+  static MyMatrix<double> transpose(const MyMatrix<double> & m)
+  {
+    MyMatrix<double> t(3, 3);
+    for (int a = 0; a < 3; a++)
+      for (int b = 0; b < 3; b++) t(a, b) = m(b, a);
+    return t;
+  }
+  
+  int get_type(int m) const { return head_.types[m]; }
+  double get_d0() const     { return head_.d0; }
+  double get_d1() const     { return head_.d1; }
+  int get_L() const         { return head_.L; }
+  int get_J() const         { return head_.J; }
+  int get_nd() const        { return head_.nd; }
+  size_t get_bytes() const  { return sizeof(Header) + coef_.size() * sizeof(double); }
+};
+
+
+/*
+ Pairwise forces, torques and energies of a system from pair tables, one
+ for each pair of molecule types in it. Pairs are taken as for the solvers,
+ within the cutoff between centers
+ */
+class PairTableCalc : public BasePhysCalc
+{
+protected:
+  shared_ptr<BaseSystem>            _sys_;
+  vector<shared_ptr<PairTable> >    tables_;
+  bool                              cog_;     // centers are cogs, else center 0
+  
+  shared_ptr<vector<Pt> >     _F_;
+  shared_ptr<vector<Pt> >     _tau_;
+  shared_ptr<vector<double> > omega_;
+  
+  Pt ref_pt(int i)
+  { return cog_ ? _sys_->get_cogi(i) : _sys_->get_centerik(i, 0); }
+  
+  // table for molecules i and j, swap if j is its A
+  PairTable * find(int i, int j, bool & swap)
+  {
+    int ti = _sys_->get_moli(i)->get_type(), tj = _sys_->get_moli(j)->get_type();
+    for (int t = 0; t < tables_.size(); t++)
+    {
+      if (tables_[t]->get_type(0) == ti && tables_[t]->get_type(1) == tj)
+      {
+        swap = false;
+        return tables_[t].get();
+      }
+      if (tables_[t]->get_type(0) == tj && tables_[t]->get_type(1) == ti)
+      {
+        swap = true;
+        return tables_[t].get();
+      }
+    }
+    return NULL;
+  }
+  
+  // pose of b relative to a in a's frame, and a's orientation
+  void rel_pose(int a, int b, double & d, Pt & u, MyMatrix<double> & R,
+                MyMatrix<double> & RA)
+  {
+    RA = _sys_->get_moli(a)->get_orient();
+    MyMatrix<double> RAt = PairTable::transpose(RA);
+    Pt r = _sys_->get_pbc_dist_vec_base(ref_pt(b), ref_pt(a));
+    d = r.norm();
+    u = r.rotate(RAt) * (1.0/d);
+    R = RAt * _sys_->get_moli(b)->get_orient();
+  }
+  
+public:
+  PairTableCalc(shared_ptr<BaseSystem> sys,
+                vector<shared_ptr<PairTable> > tables, bool cog,
+                shared_ptr<Constants> cst, string outfname,
+                Units unit = INTERNAL)
+  :BasePhysCalc(sys->get_n(), cst, outfname, unit), _sys_(sys),
+  tables_(tables), cog_(cog), _F_(make_shared<vector<Pt> >(sys->get_n())),
+  _tau_(make_shared<vector<Pt> >(sys->get_n())),
+  omega_(make_shared<vector<double> >(sys->get_n()))
+  {
+  }
+  
+  // true if there is a table for every pair of molecules
+  bool covers()
+  {
+    bool swap;
+    for (int i = 0; i < _sys_->get_n(); i++)
+      for (int j = i+1; j < _sys_->get_n(); j++)
+        if (!find(i, j, swap)) return false;
+    return true;
+  }
+  
+  // true if a pair is nearer than its table reaches
+  bool pairs_close()
+  {
+    bool swap;
+    for (int i = 0; i < _sys_->get_n(); i++)
+      for (int j = i+1; j < _sys_->get_n(); j++)
+      {
+        PairTable * tab = find(i, j, swap);
+        if (!tab) continue;
+        double d = _sys_->get_pbc_dist_vec_base(ref_pt(i), ref_pt(j)).norm();
+        if (d < tab->get_d0()) return true;
+      }
+    return false;
+  }
+  
+  void calc_force()
+  {
+    for (int i = 0; i < N_; i++)
+    {
+      (*_F_)[i] = Pt(0.0, 0.0, 0.0);
+      (*_tau_)[i] = Pt(0.0, 0.0, 0.0);
+      (*omega_)[i] = 0.0;
+    }
+    
+    for (int i = 0; i < N_; i++)
+      for (int j = i+1; j < N_; j++)
+      {
+        bool swap;
+        PairTable * tab = find(i, j, swap);
+        if (!tab) continue;
+        if (!_sys_->less_than_cutoff(_sys_->get_pbc_dist_vec_base(ref_pt(i),
+                                                                ref_pt(j))))
+          continue;
+        int a = swap ? j : i, b = swap ? i : j, mol[2] = {a, b};
+        double d;
+        Pt u;
+        MyMatrix<double> R, RA;
+        PairTable::Sample s;
+        rel_pose(a, b, d, u, R, RA);
+        tab->evaluate(d, u, R, s);
+        for (int m = 0; m < 2; m++)
+        {
+          (*_F_)[mol[m]] = (*_F_)[mol[m]] + s.f[m].rotate(RA);
+          (*_tau_)[mol[m]] = (*_tau_)[mol[m]] + s.tau[m].rotate(RA);
+          (*omega_)[mol[m]] += s.e[m];
+        }
+      }
+  }
+  
+  // filled by calc_force
+  void calc_energy() { }
+  void calc_torque() { }
+  
+  PhysSnapshot snapshot()
+  {
+    PhysSnapshot snap;
+    snap.t = _sys_->get_time();
+    snap.unit = unit_;
+    snap.unitConv = unit_conv_;
+    snap.outfname = outfname_;
+    for (int i = 0; i < N_; i++)
+    {
+      snap.pos.push_back(ref_pt(i));
+      if (!cog_) snap.rad.push_back(_sys_->get_aik(i, 0));
+      snap.energy.push_back((*omega_)[i]);
+      snap.force.push_back((*_F_)[i]);
+      snap.torque.push_back((*_tau_)[i]);
+    }
+    return snap;
+  }
+  
+  shared_ptr<vector<Pt> > get_Tau()       { return _tau_; }
+  shared_ptr<vector<Pt> > get_F()         { return _F_; }
+  shared_ptr<vector<double> > get_omega() { return omega_; }
+  
+  Pt get_taui(int i)       { return (*_tau_)[i]; }
+  Pt get_forcei(int i)     { return (*_F_)[i]; }
+  double get_omegai(int i) { return (*omega_)[i]; }
+  double calc_ei(int i)    { return (*omega_)[i]; }
+  Pt get_moli_pos(int i)   { return ref_pt(i); }
+};
+
+#endif /* PairTable_h */
@@ -0,0 +1,138 @@
+//
+//  Philox.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef Philox_h
+#define Philox_h
+
+#include <math.h>
+#include <stdint.h>
+#include <array>
+
+using namespace std;
+
+/*
+ Counter-based random numbers (Philox-4x32-10, Salmon et al., SC'11). A draw
+ is a pure function of a key and a counter, so a number depends only on
+ what it is for, here (seed, trajectory) as key and (step, attempt, slot) as
+ counter, and not on which thread draws it or what was drawn before.
+ */
+class Philox
+{
+public:
+  typedef array<uint32_t, 4> Ctr;
+  typedef array<uint32_t, 2> Key;
+  
+protected:
+  static void round(Ctr & c, const Key & k)
+  {
+    uint64_t p0 = (uint64_t) 0xD2511F53 * c[0];
+    uint64_t p1 = (uint64_t) 0xCD9E8D57 * c[2];
+    uint32_t hi0 = (uint32_t)(p0 >> 32), lo0 = (uint32_t) p0;
+    uint32_t hi1 = (uint32_t)(p1 >> 32), lo1 = (uint32_t) p1;
+    c = {{ hi1 ^ c[1] ^ k[0], lo1, hi0 ^ c[3] ^ k[1], lo0 }};
+  }
+  
+public:
+  // the four random words of counter c under key k
+  static Ctr block(Ctr c, Key k)
+  {
+    for (int r = 0; r < 10; r++)
+    {
+      if (r > 0)
+      {
+        k[0] += 0x9E3779B9;
+        k[1] += 0xBB67AE85;
+      }
+      round(c, k);
+    }
+    return c;
+  }
+  
+  // uniform in (0, 1) from 53 bits of two words, never exactly 0 or 1
+  static double uniform(uint32_t hi, uint32_t lo)
+  {
+    uint64_t bits = ((uint64_t) hi << 21) ^ (lo >> 11);
+    return ((double) (bits & ((1ull << 53) - 1)) + 0.5) / 9007199254740992.0;
+  }
+  
+  /*
+   Fill out with n standard normals for counter (c0, c1, c2, b), one
+   Box-Muller pair per block b = 0, 1, ... Normal j is always the same
+   number, whatever n is, so callers can lay out slots as they like
+   */
+  static void gaussians(Key k, uint32_t c0, uint32_t c1, uint32_t c2,
+                        double * out, int n)
+  {
+    for (int b = 0; b < (n+1)/2; b++)
+    {
+      Ctr w = block({{c0, c1, c2, (uint32_t) b}}, k);
+      double r  = sqrt(-2.0 * log(uniform(w[0], w[1])));
+      double th = 2.0 * M_PI * uniform(w[2], w[3]);
+      out[2*b] = r * cos(th);
+      if (2*b+1 < n) out[2*b+1] = r * sin(th);
+    }
+  }
+};
+
+/*
+ A sequence of uniforms and normals under one key, for serial set up code
+ that just wants the next number. Draws 2j and 2j+1 come from block j with
+ c1, c2 in the upper counter words, so streams differing only there do not
+ overlap
+ */
+class PhiloxStream
+{
+protected:
+  Philox::Key key_;
+  uint32_t    c1_, c2_;
+  uint64_t    n_;
+  
+public:
+  PhiloxStream(uint32_t seed = 0, uint32_t stream = 0, uint32_t c1 = 0,
+               uint32_t c2 = 0)
+  :key_({{seed, stream}}), c1_(c1), c2_(c2), n_(0) { }
+  
+  double uniform()
+  {
+    Philox::Ctr w = Philox::block({{(uint32_t)(n_/2), (uint32_t)(n_ >> 33),
+                                    c1_, c2_}}, key_);
+    return (n_++ % 2 == 0) ? Philox::uniform(w[0], w[1])
+                           : Philox::uniform(w[2], w[3]);
+  }
+  
+  double normal()
+  {
+    double r  = sqrt(-2.0 * log(uniform()));
+    return r * cos(2.0 * M_PI * uniform());
+  }
+};
+
+#endif /* Philox_h */
@@ -0,0 +1,162 @@
+//
+//  PointSoA.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef PointSoA_h
+#define PointSoA_h
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "util.h"
+
+using namespace std;
+
+/*
+ Set of points stored as separate x, y and z arrays. Rigid moves are applied
+ to the whole set in loops over contiguous arrays, which the compiler can
+ vectorize. Points are handed out as Pt by value.
+ 
+ The spherical coordinates of every point are kept in a second set of
+ arrays. They are computed in bulk the first time one is asked for after a
+ change, instead of converting one Pt at a time. The conversion is the same
+ as Pt's, so get_sph(i) gives the same r, theta and phi as get(i). Reading
+ from several threads is safe, moving the points while others read is not.
+ */
+class PointSoA
+{
+protected:
+  vector<double>          x_, y_, z_;
+  mutable vector<double>  r_, theta_, phi_;
+  mutable atomic<bool>    sphOK_;  // spherical arrays match x_, y_, z_
+  mutable mutex           sphLock_;
+  
+  void update_spherical() const
+  {
+    if (sphOK_.load(memory_order_acquire)) return;
+    lock_guard<mutex> lock(sphLock_);
+    if (sphOK_.load(memory_order_relaxed)) return;
+    int n = size();
+    r_.resize(n); theta_.resize(n); phi_.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+      double r = sqrt(x_[i]*x_[i] + y_[i]*y_[i] + z_[i]*z_[i]);
+      if (r < fabs(z_[i])) r = fabs(z_[i]);
+      r_[i] = r;
+      theta_[i] = (r == 0.0) ? 0.0 : acos(z_[i]/r);
+      phi_[i] = (x_[i] == 0.0 && y_[i] == 0.0) ? 0.0 : atan2(y_[i], x_[i]);
+    }
+    sphOK_.store(true, memory_order_release);
+  }
+  
+public:
+  PointSoA() : sphOK_(false) { }
+  
+  PointSoA(vector<Pt> pts)
+  :x_(pts.size()), y_(pts.size()), z_(pts.size()), sphOK_(false)
+  {
+    for (int i = 0; i < pts.size(); i++)
+    {
+      x_[i] = pts[i].x(); y_[i] = pts[i].y(); z_[i] = pts[i].z();
+    }
+  }
+  
+  PointSoA(const PointSoA & other)
+  :x_(other.x_), y_(other.y_), z_(other.z_), sphOK_(false) { }
+  
+  PointSoA & operator=(const PointSoA & other)
+  {
+    x_ = other.x_; y_ = other.y_; z_ = other.z_;
+    sphOK_ = false;
+    return *this;
+  }
+  
+  int size() const                { return (int) x_.size(); }
+  
+  double x(int i) const           { return x_[i]; }
+  double y(int i) const           { return y_[i]; }
+  double z(int i) const           { return z_[i]; }
+  Pt get(int i) const             { return Pt(x_[i], y_[i], z_[i]); }
+  
+  // point i in spherical form (r, theta, phi)
+  Pt get_sph(int i) const
+  {
+    update_spherical();
+    return Pt(r_[i], theta_[i], phi_[i], true);
+  }
+  
+  void set(int i, Pt pt)
+  {
+    x_[i] = pt.x(); y_[i] = pt.y(); z_[i] = pt.z();
+    sphOK_ = false;
+  }
+  
+  vector<Pt> to_vector() const
+  {
+    vector<Pt> pts;
+    pts.reserve(size());
+    for (int i = 0; i < size(); i++) pts.push_back(get(i));
+    return pts;
+  }
+  
+  // apply the 3x3 rotation matrix rot to every point
+  void rotate(MyMatrix<double> & rot)
+  {
+    const double r00 = rot(0,0), r01 = rot(0,1), r02 = rot(0,2);
+    const double r10 = rot(1,0), r11 = rot(1,1), r12 = rot(1,2);
+    const double r20 = rot(2,0), r21 = rot(2,1), r22 = rot(2,2);
+    double * xp = x_.data(), * yp = y_.data(), * zp = z_.data();
+    int n = size();
+    for (int i = 0; i < n; i++)
+    {
+      double x = xp[i], y = yp[i], z = zp[i];
+      xp[i] = r00 * x + r01 * y + r02 * z;
+      yp[i] = r10 * x + r11 * y + r12 * z;
+      zp[i] = r20 * x + r21 * y + r22 * z;
+    }
+    sphOK_ = false;
+  }
+  
+  // shift every point by dr
+  void translate(Pt dr)
+  {
+    const double dx = dr.x(), dy = dr.y(), dz = dr.z();
+    double * xp = x_.data(), * yp = y_.data(), * zp = z_.data();
+    int n = size();
+    for (int i = 0; i < n; i++)
+    {
+      xp[i] += dx; yp[i] += dy; zp[i] += dz;
+    }
+    sphOK_ = false;
+  }
+};
+
+#endif /* PointSoA_h */
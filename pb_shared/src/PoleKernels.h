@@ -0,0 +1,315 @@
+//
+//  PoleKernels.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PoleKernels_h
+#define PoleKernels_h
+
+#include <array>
+#include "ReExpCalc.h"
+
+using namespace std;
+
+/*
+ Kernels for the inner loops of the solvers, templated on the number of
+ poles. For the common orders below the loop bounds are compile time
+ constants and scratch coefficients live in fixed size blocks on the stack.
+ The P = 0 instance is the generic fallback and uses the runtime order.
+ 
+ Kernels are selected with POLE_DISPATCH (number of poles) or SH_DISPATCH
+ (number of spherical harmonics, 2*poles in PBAM and PBSAM), e.g.
+   POLE_DISPATCH(p_, rotate_fixed, p_, T, &ReExpCoeffs::get_rval, X, Z, false)
+ */
+#define POLE_DISPATCH(p, KERNEL, ...)                       \
+  switch (p)                                                \
+  {                                                         \
+    case 5:   KERNEL<5>  (__VA_ARGS__); break;              \
+    case 8:   KERNEL<8>  (__VA_ARGS__); break;              \
+    case 10:  KERNEL<10> (__VA_ARGS__); break;              \
+    case 15:  KERNEL<15> (__VA_ARGS__); break;              \
+    case 20:  KERNEL<20> (__VA_ARGS__); break;              \
+    case 25:  KERNEL<25> (__VA_ARGS__); break;              \
+    case 30:  KERNEL<30> (__VA_ARGS__); break;              \
+    default:  KERNEL<0>  (__VA_ARGS__); break;              \
+  }
+
+#define SH_DISPATCH(n, KERNEL, ...)                         \
+  switch (n)                                                \
+  {                                                         \
+    case 10:  KERNEL<10> (__VA_ARGS__); break;              \
+    case 16:  KERNEL<16> (__VA_ARGS__); break;              \
+    case 20:  KERNEL<20> (__VA_ARGS__); break;              \
+    case 30:  KERNEL<30> (__VA_ARGS__); break;              \
+    case 40:  KERNEL<40> (__VA_ARGS__); break;              \
+    case 50:  KERNEL<50> (__VA_ARGS__); break;              \
+    case 60:  KERNEL<60> (__VA_ARGS__); break;              \
+    default:  KERNEL<0>  (__VA_ARGS__); break;              \
+  }
+
+/*
+ Block of N values, zero initialized. For N > 0 this is a std::array,
+ the N = 0 specialization is sized at runtime
+ */
+template <typename T, int N>
+class FixedBlock
+{
+protected:
+  array<T, N> vals_;
+  
+public:
+  FixedBlock(const int) :vals_() { }
+  
+  T& operator[](const int i)  { return vals_[i]; }
+  T* data()                   { return vals_.data(); }
+};
+
+template <typename T>
+class FixedBlock<T, 0>
+{
+protected:
+  vector<T> vals_;
+  
+public:
+  FixedBlock(const int n) :vals_(n) { }
+  
+  T& operator[](const int i)  { return vals_[i]; }
+  T* data()                   { return vals_.data(); }
+};
+
+// index of (n, m) in a packed block of expansion coefficients, -n <= m <= n
+inline int pole_idx(const int n, const int m) { return n*n + n + m; }
+
+/*
+ Legendre polynomials and spherical harmonics for N values of n. The
+ Legendre polynomials use the recursion:
+ Pl,l (x) = (-1)^l * (2l-1)!! * (1-x^2)^(l/2)                          (1)
+ Pl,m (x) = x * (2l-1)/(l-m) * Pl-1,m(x) - (l+m-1)/(l-m) * Pl-2,m(x)   (2)
+ and the harmonics are formed as in SHCalc::calc_sh. Results are written to
+ P and Y for 0 <= m < N (entries with m > n are zero)
+ */
+template <int N>
+void sh_fixed(const int nrt, const double theta, const double phi,
+              const SHCalcConstants & consts, MyMatrix<double> & P,
+              MyMatrix<cmplx> & Y)
+{
+  const int nv = (N > 0) ? N : nrt;
+  FixedBlock<double, N*N> leg(nv*nv);
+  FixedBlock<cmplx, N> eiphi(nv);
+  int l, m;
+  double x = cos(theta);
+  double sinl = 1.0;  // (1-x^2)^(l/2)
+  double sint = sqrt(1.0 - x*x);
+  
+  for (l = 0; l < nv; l++)
+  {
+    if (l > 0) sinl *= sint;
+    for (m = 0; m < l; m++)
+    {
+      if (l == 1) leg[l*nv+m] = x;
+      else
+        leg[l*nv+m] = consts.get_leg_consts1_val(l, m) * x * leg[(l-1)*nv+m]
+                    - consts.get_leg_consts2_val(l, m) * leg[(l-2)*nv+m];
+    }
+    leg[l*nv+l] = ((l%2 == 0) ? 1.0 : -1.0) * consts.get_dub_fac_val(l)*sinl;
+  }
+  
+  for (m = 0; m < nv; m++) eiphi[m] = cmplx(cos(m*phi), sin(m*phi));
+  
+  for (l = 0; l < nv; l++)
+  {
+    for (m = 0; m < nv; m++)
+    {
+      if (m > l)
+      {
+        P.set_val(l, m, 0.0);
+        Y.set_val(l, m, 0.0);
+        continue;
+      }
+      P.set_val(l, m, leg[l*nv+m]);
+      Y.set_val(l, m, ((m%2 == 0) ? 1.0 : -1.0) *
+                consts.get_sh_consts_val(l, m) * leg[l*nv+m] * eiphi[m]);
+    }
+  }
+}
+
+/*
+ Rotation step of the re-expansion (eq 46 in Lotan 2006):
+   herm = false : z(n,m) = sum_s R(n,m,s) x(n,s)
+   herm = true  : z(n,m) = sum_s conj(R(n,s,m)) x(n,s)
+ rget selects the table of T to use (R, dR/dtheta or dR/dphi). X and Z
+ are (p, 2p+1) matrices indexed (n, m+p)
+ */
+template <int P>
+void rotate_fixed(const int prt, const ReExpCoeffs & T,
+                  cmplx (ReExpCoeffs::*rget)(int, int, int) const,
+                  const MyMatrix<cmplx> & X, MyMatrix<cmplx> & Z, bool herm)
+{
+  const int p = (P > 0) ? P : prt;
+  FixedBlock<cmplx, P*P> x(p*p);
+  int n, m, s;
+  cmplx inter, rval;
+  
+  for (n = 0; n < p; n++)
+    for (m = -n; m <= n; m++)
+      x[pole_idx(n, m)] = X(n, m+p);
+  
+  for (n = 0; n < p; n++)
+  {
+    for (m = -n; m <= n; m++)
+    {
+      inter = 0;
+      for (s = -n; s <= n; s++)
+      {
+        if (herm)
+        {
+          rval = (T.*rget)(n, s, m);
+          inter += conj(rval) * x[pole_idx(n, s)];
+        } else
+        {
+          rval = (T.*rget)(n, m, s);
+          inter += rval * x[pole_idx(n, s)];
+        }
+      }
+      Z.set_val(n, m+p, inter);
+    }
+  }
+}
+
+/*
+ Rotation for a singular T (theta = 0 or pi), applied to X in place:
+ identity for theta < pi/2, otherwise z(n,m) = (-1)^n x(n,-m)
+ */
+inline void rotate_sing_inplace(const int p, const double theta,
+                                MyMatrix<cmplx> & X)
+{
+  if (theta <= M_PI/2.0) return;
+  int n, m;
+  cmplx tmp;
+  for (n = 0; n < p; n++)
+  {
+    for (m = 1; m <= n; m++)
+    {
+      tmp = X(n, m+p);
+      X(n, m+p) = X(n, -m+p);
+      X(n, -m+p) = tmp;
+    }
+    if (n%2 == 1)
+      for (m = -n; m <= n; m++) X(n, m+p) = -X(n, m+p);
+  }
+}
+
+/*
+ Coaxial translation step of the re-expansion (eq 46 in Lotan 2006):
+   z(n,m) = sum_{l=|m|}^{p-1} fac(n,l) S(n,l,m) x(l,m)
+ If trans, S(l,n,m) is used in place of S(n,l,m). If lamScl is given then
+ fac(n,l) = lamScl[n-l] for l <= n (PB-SAM scaling), otherwise fac = 1
+ */
+template <int P>
+void translate_fixed(const int prt, const ReExpCoeffs & T,
+                     double (ReExpCoeffs::*sget)(int, int, int) const,
+                     const MyMatrix<cmplx> & X, MyMatrix<cmplx> & Z,
+                     bool trans,
+                     const double * lamScl)
+{
+  const int p = (P > 0) ? P : prt;
+  FixedBlock<cmplx, P*P> x(p*p);
+  int n, m, l;
+  double fac, sval;
+  cmplx inter;
+  
+  for (n = 0; n < p; n++)
+    for (m = -n; m <= n; m++)
+      x[pole_idx(n, m)] = X(n, m+p);
+  
+  for (n = 0; n < p; n++)
+  {
+    for (m = -n; m <= n; m++)
+    {
+      inter = 0;
+      for (l = abs(m); l < p; l++)
+      {
+        fac = ((lamScl != NULL) && (l <= n)) ? lamScl[n-l] : 1.0;
+        sval = trans ? (T.*sget)(l, n, m) : (T.*sget)(n, l, m);
+        inter += fac * sval * x[pole_idx(l, m)];
+      }
+      Z.set_val(n, m+p, inter);
+    }
+  }
+}
+
+/*
+ Inner product of two expansions as defined in eq 29 of Lotan 2006
+ */
+template <int P>
+void inner_prod_fixed(const int prt, const MyMatrix<cmplx> & U,
+                      const MyMatrix<cmplx> & V, double & ip)
+{
+  const int p = (P > 0) ? P : prt;
+  int n, m, mT;
+  ip = 0;
+  for (n = 0; n < p; n++)
+  {
+    for (m = -n; m <= n; m++)
+    {
+      mT = (m < 0) ? -1*m : m;
+      ip += (U(n, mT+p).real()*V(n, mT+p).real()
+             + U(n, mT+p).imag()*V(n, mT+p).imag());
+    }
+  }
+}
+
+/*
+ Y = A * X, where A is the p^2 x p^2 column major surface integral matrix
+ of one sphere (IEMatrix::get_IE_k_org) and X has nc columns. Same layout
+ as applyMMat, for builds without BLAS
+ */
+template <int P>
+void ie_matmul_fixed(const int prt, const double * A, const double * X,
+                     double * Y, const int nc)
+{
+  const int p2 = (P > 0) ? P*P : prt*prt;
+  int i, j, c;
+  double xj;
+  const double * col;
+  
+  for (c = 0; c < nc; c++)
+  {
+    FixedBlock<double, P*P> y(p2);
+    for (j = 0; j < p2; j++)
+    {
+      xj = X[c*p2+j];
+      col = A + j*p2;
+      for (i = 0; i < p2; i++) y[i] += col[i] * xj;
+    }
+    for (i = 0; i < p2; i++) Y[c*p2+i] = y[i];
+  }
+}
+
+#endif /* PoleKernels_h */
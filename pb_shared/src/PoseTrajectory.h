@@ -0,0 +1,448 @@
+//
+//  PoseTrajectory.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PoseTrajectory_h
+#define PoseTrajectory_h
+
+#include <cstdint>
+#include "BaseSys.h"
+#include "readutil.h"
+
+using namespace std;
+
+class BadPoseTrajException: public exception
+{
+protected:
+  string msg_;
+  
+public:
+  BadPoseTrajException(string path, string why)
+  :msg_("Bad pose trajectory " + path + ": " + why)
+  {
+  }
+  
+  virtual const char* what() const throw()
+  {
+    return msg_.c_str();
+  }
+};
+
+/*
+ Binary BD trajectory of rigid molecules. As molecules do not deform, a
+ frame only needs the pose of each: the position of its first sphere center
+ and the quaternion of its orientation. The atoms are regenerated from the
+ body frame coordinates of each molecule type, stored once in the header.
+ Layout, in native byte order:
+ 
+   [0, 64)        Header
+   type table     for each type: int32 nc, ns, len; char pqr[len];
+                  nc x (x, y, z, q, r); ns x (x, y, z, a) as doubles
+   molecule table int32 type of each molecule
+   frames         double time; int64 step; then as float or double:
+                  nmol energies; nmol x (tx, ty, tz, qw, qa, qb, qc)
+ 
+ A trailing partial frame, as left by an interrupted run, is ignored.
+ */
+class PoseTrajectory
+{
+public:
+  static const uint32_t VERSION = 1;
+  
+  struct Header
+  {
+    char     magic[8];
+    uint32_t version;
+    int32_t  prec;       // bytes per pose value, 4 or 8
+    int32_t  nmol;
+    int32_t  ntype;
+    uint64_t headBytes;  // offset of the first frame
+    uint64_t frameBytes;
+    double   boxlen;
+    int32_t  reserved[4];
+  };
+  
+  // Body frame geometry of a molecule type
+  struct TypeRef
+  {
+    string          pqr;
+    vector<Pt>      pos;
+    vector<double>  q, rad;
+    vector<Pt>      cen;
+    vector<double>  a;
+  };
+  
+  struct Frame
+  {
+    double          t;
+    int64_t         step;
+    vector<double>  energy;
+    vector<Pt>      trans;
+    vector<Quat>    rot;
+  };
+  
+  static const char * magic() { return "PBSPOSE"; }
+  
+  static uint64_t frame_bytes(int nmol, int prec)
+  { return sizeof(double) + sizeof(int64_t) + (uint64_t) nmol * 8 * prec; }
+};
+
+/*
+ Writes a pose trajectory of a system, buffering bufBytes of frames
+ between writes to the file
+ */
+class PoseTrajWriter
+{
+protected:
+  string                  path_;
+  ofstream                out_;
+  shared_ptr<BaseSystem>  _sys_;
+  int                     prec_;
+  vector<char>            buf_;
+  size_t                  bufMax_;
+  
+  template<typename T> void put(T val)
+  {
+    const char * c = (const char *) &val;
+    buf_.insert(buf_.end(), c, c + sizeof(T));
+  }
+  
+  void put_val(double val)
+  {
+    if (prec_ == sizeof(float)) put((float) val);
+    else put(val);
+  }
+  
+  void write_header(const vector<string> & typePQR)
+  {
+    int i, j, k, N = _sys_->get_n(), ntype = 0;
+    vector<int> ref;  // first molecule of each type
+    for (i = 0; i < N; i++)
+    {
+      int ty = _sys_->get_moli(i)->get_type();
+      if (ty >= ntype) { ref.resize(ty+1, -1); ntype = ty+1; }
+      if (ref[ty] == -1) ref[ty] = i;
+    }
+    
+    PoseTrajectory::Header head;
+    memset(&head, 0, sizeof(head));
+    strncpy(head.magic, PoseTrajectory::magic(), 8);
+    head.version    = PoseTrajectory::VERSION;
+    head.prec       = prec_;
+    head.nmol       = N;
+    head.ntype      = ntype;
+    head.frameBytes = PoseTrajectory::frame_bytes(N, prec_);
+    head.boxlen     = _sys_->get_boxlength();
+    put(head);
+    
+    for (int ty = 0; ty < ntype; ty++)
+    {
+      string pqr = (ty < typePQR.size()) ? typePQR[ty] : "";
+      i = ref[ty];
+      int nc = (i < 0) ? 0 : _sys_->get_Nc_i(i);
+      int ns = (i < 0) ? 0 : _sys_->get_Ns_i(i);
+      put((int32_t) nc); put((int32_t) ns); put((int32_t) pqr.size());
+      buf_.insert(buf_.end(), pqr.begin(), pqr.end());
+      if (i < 0) continue;
+      
+      // body frame = orient^T (lab - first center)
+      MyMatrix<double> orient = _sys_->get_moli(i)->get_orient(), rt(3, 3);
+      for (j = 0; j < 3; j++)
+        for (k = 0; k < 3; k++) rt(j, k) = orient(k, j);
+      Pt c0 = _sys_->get_centerik(i, 0), b;
+      for (j = 0; j < nc; j++)
+      {
+        b = (_sys_->get_posijreal(i, j) - c0).rotate(rt);
+        put(b.x()); put(b.y()); put(b.z());
+        put(_sys_->get_qij(i, j)); put(_sys_->get_radij(i, j));
+      }
+      for (k = 0; k < ns; k++)
+      {
+        b = (_sys_->get_centerik(i, k) - c0).rotate(rt);
+        put(b.x()); put(b.y()); put(b.z()); put(_sys_->get_aik(i, k));
+      }
+    }
+    for (i = 0; i < N; i++) put((int32_t) _sys_->get_moli(i)->get_type());
+    
+    ((PoseTrajectory::Header *) &buf_[0])->headBytes = buf_.size();
+    flush();
+  }
+  
+public:
+  PoseTrajWriter(string path, shared_ptr<BaseSystem> _sys,
+                 vector<string> typePQR = vector<string>(),
+                 bool single = true, size_t bufBytes = 1 << 20)
+  :path_(path), _sys_(_sys), prec_(single ? sizeof(float) : sizeof(double)),
+  bufMax_(bufBytes)
+  {
+    out_.open(path.c_str(), ofstream::binary | ofstream::trunc);
+    if (!out_)
+    {
+      cout << "file "<< path << " could not be opened."<< endl;
+      exit(1);
+    }
+    write_header(typePQR);
+  }
+  
+  ~PoseTrajWriter() { flush(); }
+  
+  // Copy of the current poses, energies are per molecule
+  PoseTrajectory::Frame snapshot(int64_t step, const vector<double> & energies)
+  {
+    PoseTrajectory::Frame fr;
+    fr.t    = _sys_->get_time();
+    fr.step = step;
+    for (int i = 0; i < _sys_->get_n(); i++)
+    {
+      fr.energy.push_back((i < energies.size()) ? energies[i] : 0.0);
+      fr.trans.push_back(_sys_->get_centerik(i, 0));
+      fr.rot.push_back(Quat::from_rotation_matrix(
+                                          _sys_->get_moli(i)->get_orient()));
+    }
+    return fr;
+  }
+  
+  // Append a frame, need not be taken on the thread that writes it
+  void write_frame(PoseTrajectory::Frame fr)
+  {
+    put(fr.t);
+    put(fr.step);
+    for (int i = 0; i < fr.energy.size(); i++) put_val(fr.energy[i]);
+    for (int i = 0; i < fr.trans.size(); i++)
+    {
+      put_val(fr.trans[i].x()); put_val(fr.trans[i].y());
+      put_val(fr.trans[i].z());
+      put_val(fr.rot[i].get_w()); put_val(fr.rot[i].get_a());
+      put_val(fr.rot[i].get_b()); put_val(fr.rot[i].get_c());
+    }
+    if (buf_.size() >= bufMax_) flush();
+  }
+  
+  // Append the current poses
+  void write_frame(int64_t step, const vector<double> & energies)
+  {
+    write_frame(snapshot(step, energies));
+  }
+  
+  void flush()
+  {
+    if (buf_.empty()) return;
+    out_.write(&buf_[0], buf_.size());
+    out_.flush();
+    buf_.clear();
+  }
+  
+  const string get_path() const { return path_; }
+};
+
+/*
+ Reads frames of a pose trajectory and expands them back to atoms
+ */
+class PoseTrajReader
+{
+protected:
+  string                            path_;
+  mutable ifstream                  in_;
+  PoseTrajectory::Header            head_;
+  vector<PoseTrajectory::TypeRef>   types_;
+  vector<int>                       molType_;
+  int                               nframe_;
+  
+  template<typename T> T get()
+  {
+    T val;
+    in_.read((char *) &val, sizeof(T));
+    if (!in_) throw BadPoseTrajException(path_, "header too short");
+    return val;
+  }
+  
+  static double get_val(const char * & c, int prec)
+  {
+    double v;
+    if (prec == sizeof(float)) { float f; memcpy(&f, c, 4); v = f; }
+    else memcpy(&v, c, 8);
+    c += prec;
+    return v;
+  }
+  
+public:
+  PoseTrajReader(string path)
+  :path_(path)
+  {
+    in_.open(path.c_str(), ifstream::binary);
+    if (!in_.is_open()) throw CouldNotReadException(path_);
+    head_ = get<PoseTrajectory::Header>();
+    if (strncmp(head_.magic, PoseTrajectory::magic(), 8) != 0)
+      throw BadPoseTrajException(path_, "not a pose trajectory");
+    if (head_.version != PoseTrajectory::VERSION)
+      throw BadPoseTrajException(path_, "version " +
+                                 to_string(head_.version));
+    if ((head_.prec != sizeof(float) && head_.prec != sizeof(double)) ||
+        head_.frameBytes != PoseTrajectory::frame_bytes(head_.nmol,
+                                                        head_.prec))
+      throw BadPoseTrajException(path_, "inconsistent header");
+    
+    types_.resize(head_.ntype);
+    for (int ty = 0; ty < head_.ntype; ty++)
+    {
+      PoseTrajectory::TypeRef & tr = types_[ty];
+      int nc = get<int32_t>(), ns = get<int32_t>(), len = get<int32_t>();
+      tr.pqr.resize(len);
+      if (len > 0) in_.read(&tr.pqr[0], len);
+      for (int j = 0; j < nc; j++)
+      {
+        double x = get<double>(), y = get<double>(), z = get<double>();
+        tr.pos.push_back(Pt(x, y, z));
+        tr.q.push_back(get<double>()); tr.rad.push_back(get<double>());
+      }
+      for (int k = 0; k < ns; k++)
+      {
+        double x = get<double>(), y = get<double>(), z = get<double>();
+        tr.cen.push_back(Pt(x, y, z)); tr.a.push_back(get<double>());
+      }
+    }
+    for (int i = 0; i < head_.nmol; i++)
+    {
+      molType_.push_back(get<int32_t>());
+      if (molType_[i] < 0 || molType_[i] >= head_.ntype)
+        throw BadPoseTrajException(path_, "bad molecule type");
+    }
+    if ((uint64_t) in_.tellg() != head_.headBytes)
+      throw BadPoseTrajException(path_, "inconsistent header");
+    
+    in_.seekg(0, ios::end);
+    nframe_ = (int) (((uint64_t) in_.tellg() - head_.headBytes) /
+                     head_.frameBytes);
+  }
+  
+  int get_nframes() const             { return nframe_; }
+  int get_nmol() const                { return head_.nmol; }
+  int get_ntype() const               { return head_.ntype; }
+  int get_prec() const                { return head_.prec; }
+  double get_boxlen() const           { return head_.boxlen; }
+  int get_type(int i) const           { return molType_[i]; }
+  const PoseTrajectory::TypeRef & get_type_ref(int ty) const
+  { return types_[ty]; }
+  
+  PoseTrajectory::Frame get_frame(int f) const
+  {
+    if (f < 0 || f >= nframe_)
+      throw BadPoseTrajException(path_, "no frame " + to_string(f));
+    vector<char> raw(head_.frameBytes);
+    in_.clear();
+    in_.seekg(head_.headBytes + (uint64_t) f * head_.frameBytes);
+    in_.read(&raw[0], raw.size());
+    if (!in_) throw BadPoseTrajException(path_, "frame " + to_string(f));
+    
+    PoseTrajectory::Frame fr;
+    const char * c = &raw[0];
+    memcpy(&fr.t, c, sizeof(double)); c += sizeof(double);
+    memcpy(&fr.step, c, sizeof(int64_t)); c += sizeof(int64_t);
+    for (int i = 0; i < head_.nmol; i++)
+      fr.energy.push_back(get_val(c, head_.prec));
+    for (int i = 0; i < head_.nmol; i++)
+    {
+      double x = get_val(c, head_.prec), y = get_val(c, head_.prec);
+      double z = get_val(c, head_.prec);
+      fr.trans.push_back(Pt(x, y, z));
+      double w = get_val(c, head_.prec), a = get_val(c, head_.prec);
+      double b = get_val(c, head_.prec), d = get_val(c, head_.prec);
+      fr.rot.push_back(Quat(w, a, b, d));
+    }
+    return fr;
+  }
+  
+  // lab frame positions of the atoms and of the sphere centers of mol i
+  void expand(PoseTrajectory::Frame & fr, int i,
+              vector<Pt> & atoms, vector<Pt> & cens) const
+  {
+    const PoseTrajectory::TypeRef & tr = types_[molType_[i]];
+    MyMatrix<double> rot = fr.rot[i].get_rotation_matrix();
+    atoms.resize(tr.pos.size()); cens.resize(tr.cen.size());
+    Pt b;
+    for (int j = 0; j < tr.pos.size(); j++)
+    {
+      b = tr.pos[j];
+      atoms[j] = b.rotate(rot) + fr.trans[i];
+    }
+    for (int k = 0; k < tr.cen.size(); k++)
+    {
+      b = tr.cen[k];
+      cens[k] = b.rotate(rot) + fr.trans[i];
+    }
+  }
+  
+  // Frame f in the layout of System::write_to_xyz
+  void write_xyz(ostream & out, int f) const
+  {
+    PoseTrajectory::Frame fr = get_frame(f);
+    BaseSystem::XYZFrame xyz;
+    vector<Pt> atoms, cens;
+    xyz.t = fr.t;
+    for (int i = 0; i < head_.nmol; i++)
+    {
+      expand(fr, i, atoms, cens);
+      xyz.nc.push_back((int) atoms.size());
+      xyz.ns.push_back((int) cens.size());
+      xyz.pts.insert(xyz.pts.end(), atoms.begin(), atoms.end());
+      xyz.pts.insert(xyz.pts.end(), cens.begin(), cens.end());
+    }
+    BaseSystem::write_xyz_frame(out, xyz);
+  }
+  
+  // Frame f in the layout of System::write_to_pqr
+  void write_pqr(ostream & out, int f) const
+  {
+    PoseTrajectory::Frame fr = get_frame(f);
+    vector<Pt> atoms, cens;
+    char pqrlin[400];
+    int i, j, ct = 0;
+    for (i = 0; i < head_.nmol; i++)
+    {
+      const PoseTrajectory::TypeRef & tr = types_[molType_[i]];
+      expand(fr, i, atoms, cens);
+      for (j = 0; j < atoms.size(); j++, ct++)
+      {
+        sprintf(pqrlin,"%6d  C   CHG A%-5d    %8.3f%8.3f%8.3f %7.4f %7.4f\n",
+                ct, i, atoms[j].x(), atoms[j].y(), atoms[j].z(), tr.q[j],
+                tr.rad[j]);
+        out << "ATOM " << pqrlin;
+      }
+      for (j = 0; j < cens.size(); j++, ct++)
+      {
+        sprintf(pqrlin,"%6d  X   CEN A%-5d    %8.3f%8.3f%8.3f %7.4f %7.4f\n",
+                ct, i, cens[j].x(), cens[j].y(), cens[j].z(), 0.0, tr.a[j]);
+        out << "ATOM " << pqrlin;
+      }
+    }
+  }
+};
+
+#endif /* PoseTrajectory_h */
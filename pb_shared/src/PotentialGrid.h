@@ -0,0 +1,372 @@
+//
+//  PotentialGrid.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PotentialGrid_h
+#define PotentialGrid_h
+
+#include <math.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "BasePhysCalc.h"
+
+#ifdef __OMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+/*
+ Potential of molecules that do not move, tabulated on a regular grid
+ together with its field (minus the gradient, by central differences of the
+ table). Both are interpolated trilinearly between grid points
+ */
+class PotentialGrid
+{
+protected:
+  double lo_[3];
+  double h_;
+  int    n_[3];
+  vector<double> pot_;
+  vector<double> field_[3];
+  
+  int idx(int i, int j, int k) const { return (i*n_[1] + j)*n_[2] + k; }
+  
+  // index of the lower corner of the cell holding p and the weights of the
+  // upper corner in each dimension. False if p is outside the grid
+  bool locate(Pt p, int & c, double w[3]) const
+  {
+    double x[3] = {p.x(), p.y(), p.z()};
+    int ic[3];
+    for (int d = 0; d < 3; d++)
+    {
+      double f = (x[d] - lo_[d]) / h_;
+      ic[d] = (int) floor(f);
+      if (ic[d] < 0 || ic[d] >= n_[d]-1) return false;
+      w[d] = f - ic[d];
+    }
+    c = idx(ic[0], ic[1], ic[2]);
+    return true;
+  }
+  
+  double interp(const vector<double> & v, int c, const double w[3]) const
+  {
+    int sx = n_[1]*n_[2], sy = n_[2];
+    double c00 = v[c]      *(1-w[2]) + v[c+1]      *w[2];
+    double c01 = v[c+sy]   *(1-w[2]) + v[c+sy+1]   *w[2];
+    double c10 = v[c+sx]   *(1-w[2]) + v[c+sx+1]   *w[2];
+    double c11 = v[c+sx+sy]*(1-w[2]) + v[c+sx+sy+1]*w[2];
+    return ((c00*(1-w[1]) + c01*w[1])*(1-w[0]) +
+            (c10*(1-w[1]) + c11*w[1])*w[0]);
+  }
+  
+public:
+  // grid with spacing h covering the box from lo to hi
+  PotentialGrid(Pt lo, Pt hi, double h)
+  :h_(h)
+  {
+    double l[3] = {lo.x(), lo.y(), lo.z()};
+    double u[3] = {hi.x(), hi.y(), hi.z()};
+    for (int d = 0; d < 3; d++)
+    {
+      lo_[d] = l[d];
+      n_[d] = max(2, (int) ceil((u[d] - l[d]) / h) + 1);
+    }
+    pot_.resize(n_[0]*n_[1]*n_[2]);
+    for (int d = 0; d < 3; d++) field_[d].resize(pot_.size());
+  }
+  
+  // tabulate pot(Pt) at every grid point, then the field
+  template <typename PotFn>
+  void fill(PotFn pot)
+  {
+#pragma omp parallel for
+    for (int i = 0; i < n_[0]; i++)
+      for (int j = 0; j < n_[1]; j++)
+        for (int k = 0; k < n_[2]; k++)
+          pot_[idx(i, j, k)] = pot(Pt(lo_[0] + i*h_, lo_[1] + j*h_,
+                                      lo_[2] + k*h_));
+    
+    int st[3] = {n_[1]*n_[2], n_[2], 1};
+    for (int i = 0; i < n_[0]; i++)
+      for (int j = 0; j < n_[1]; j++)
+        for (int k = 0; k < n_[2]; k++)
+        {
+          int at[3] = {i, j, k}, c = idx(i, j, k);
+          for (int d = 0; d < 3; d++)
+          {
+            // central differences inside, one sided on the faces
+            int lo = (at[d] > 0) ? c - st[d] : c;
+            int hi = (at[d] < n_[d]-1) ? c + st[d] : c;
+            int span = (at[d] > 0) + (at[d] < n_[d]-1);
+            field_[d][c] = - (pot_[hi] - pot_[lo]) / (span * h_);
+          }
+        }
+  }
+  
+  bool contains(Pt p) const
+  {
+    int c; double w[3];
+    return locate(p, c, w);
+  }
+  
+  double potential(Pt p) const
+  {
+    int c; double w[3];
+    return locate(p, c, w) ? interp(pot_, c, w) : 0.0;
+  }
+  
+  Pt field(Pt p) const
+  {
+    int c; double w[3];
+    if (!locate(p, c, w)) return Pt(0.0, 0.0, 0.0);
+    return Pt(interp(field_[0], c, w), interp(field_[1], c, w),
+              interp(field_[2], c, w));
+  }
+  
+  int get_npts() const { return (int) pot_.size(); }
+  double get_h() const { return h_; }
+};
+
+/*
+ Grid of spacing h over the spheres of sys and pad past them, filled with
+ pot. A point inside a sphere takes pot on the surface of the sphere it is
+ deepest in, so the table stays finite where the expansions diverge. cen
+ is set to the middle of the grid
+ */
+inline shared_ptr<PotentialGrid> make_static_grid(shared_ptr<BaseSystem> sys,
+                                                  double h, double pad,
+                                                  function<double(Pt)> pot,
+                                                  Pt & cen)
+{
+  double lo[3] = {1e100, 1e100, 1e100}, hi[3] = {-1e100, -1e100, -1e100};
+  for (int i = 0; i < sys->get_n(); i++)
+    for (int k = 0; k < sys->get_Ns_i(i); k++)
+    {
+      Pt c = sys->get_centerik(i, k);
+      double a = sys->get_aik(i, k), x[3] = {c.x(), c.y(), c.z()};
+      for (int d = 0; d < 3; d++)
+      {
+        lo[d] = min(lo[d], x[d] - a - pad);
+        hi[d] = max(hi[d], x[d] + a + pad);
+      }
+    }
+  cen = Pt(0.5*(lo[0]+hi[0]), 0.5*(lo[1]+hi[1]), 0.5*(lo[2]+hi[2]));
+  
+  auto grid = make_shared<PotentialGrid>(Pt(lo[0], lo[1], lo[2]),
+                                         Pt(hi[0], hi[1], hi[2]), h);
+  grid->fill([&] (Pt p) -> double
+  {
+    for (int it = 0; it < 10; it++)
+    {
+      double depth = 0.0;
+      Pt dv;
+      for (int i = 0; i < sys->get_n(); i++)
+        for (int k = 0; k < sys->get_Ns_i(i); k++)
+        {
+          Pt v = p - sys->get_centerik(i, k);
+          double in = sys->get_aik(i, k) - v.norm();
+          if (in > depth)
+          {
+            depth = in;
+            dv = v;
+          }
+        }
+      if (depth < 1e-10) break;
+      double r = dv.norm();
+      p = (r > 1e-8) ? p + dv * (depth / r) : p + Pt(depth, 0.0, 0.0);
+    }
+    return pot(p);
+  });
+  return grid;
+}
+
+/*
+ Energy, force and torque on the mobile molecules of a system from the
+ potential of its static ones, read from a PotentialGrid, or from pot
+ itself off the grid. If set_pairs is on, a physics calculation over the
+ mobile molecules alone adds their interactions with each other
+ */
+class GridPhysCalc : public BasePhysCalc
+{
+protected:
+  shared_ptr<BaseSystem>    _sys_;
+  shared_ptr<PotentialGrid> _grid_;
+  function<double(Pt)>      pot_;     // exact potential of static mols
+  Pt                        cen_;     // middle of the grid
+  vector<int>               mobile_;  // system index of each mobile mol
+  bool                      cog_;     // torques about cog, else center 0
+  shared_ptr<BasePhysCalc>  _pairs_;  // over mobile_ only, may be null
+  bool                      usePairs_;
+  
+  shared_ptr<vector<Pt> >     _F_;
+  shared_ptr<vector<Pt> >     _tau_;
+  shared_ptr<vector<double> > omega_;
+  
+  Pt ref_pt(int i)
+  { return cog_ ? _sys_->get_cogi(i) : _sys_->get_centerik(i, 0); }
+  
+  // potential and field at r, from its periodic image nearest the grid
+  void pot_field(Pt r, double & phi, Pt & fld)
+  {
+    Pt img = cen_ - _sys_->get_pbc_dist_vec_base(cen_, r);
+    if (_grid_->contains(img))
+    {
+      phi = _grid_->potential(img);
+      fld = _grid_->field(img);
+      return;
+    }
+    double d = 0.5 * _grid_->get_h();
+    phi = pot_(img);
+    fld = Pt(pot_(img - Pt(d, 0, 0)) - pot_(img + Pt(d, 0, 0)),
+             pot_(img - Pt(0, d, 0)) - pot_(img + Pt(0, d, 0)),
+             pot_(img - Pt(0, 0, d)) - pot_(img + Pt(0, 0, d))) * (0.5/d);
+  }
+  
+public:
+  GridPhysCalc(shared_ptr<BaseSystem> sys, shared_ptr<PotentialGrid> grid,
+               function<double(Pt)> pot, Pt cen, vector<int> mobile,
+               bool cog, shared_ptr<Constants> cst, string outfname,
+               Units unit = INTERNAL)
+  :BasePhysCalc(sys->get_n(), cst, outfname, unit), _sys_(sys),
+  _grid_(grid), pot_(pot), cen_(cen), mobile_(mobile), cog_(cog),
+  usePairs_(false), _F_(make_shared<vector<Pt> >(sys->get_n())),
+  _tau_(make_shared<vector<Pt> >(sys->get_n())),
+  omega_(make_shared<vector<double> >(sys->get_n()))
+  {
+  }
+  
+  // calculation over a system of the mobile molecules alone, in the order
+  // of mobile_
+  void set_pair_calc(shared_ptr<BasePhysCalc> pairs) { _pairs_ = pairs; }
+  void set_use_pairs(bool use) { usePairs_ = use && _pairs_; }
+  
+  // true if spheres of two mobile molecules are within the cutoff
+  bool pairs_close()
+  {
+    double cut = _sys_->get_cutoff();
+    for (int a = 0; a < mobile_.size(); a++)
+      for (int b = a+1; b < mobile_.size(); b++)
+      {
+        int i = mobile_[a], j = mobile_[b];
+        for (int k = 0; k < _sys_->get_Ns_i(i); k++)
+          for (int l = 0; l < _sys_->get_Ns_i(j); l++)
+          {
+            double r = _sys_->get_pbc_dist_vec_base(_sys_->get_centerik(i, k),
+                                                 _sys_->get_centerik(j, l))
+                                                 .norm();
+            if (r - _sys_->get_aik(i, k) - _sys_->get_aik(j, l) < cut)
+              return true;
+          }
+      }
+    return false;
+  }
+  
+  // one pass over the mobile charges fills energies, forces and torques
+  void calc_force()
+  {
+    for (int i = 0; i < N_; i++)
+    {
+      (*_F_)[i] = Pt(0.0, 0.0, 0.0);
+      (*_tau_)[i] = Pt(0.0, 0.0, 0.0);
+      (*omega_)[i] = 0.0;
+    }
+    
+    for (int a = 0; a < mobile_.size(); a++)
+    {
+      int i = mobile_[a];
+      Pt ref = ref_pt(i), f(0.0, 0.0, 0.0), tau(0.0, 0.0, 0.0);
+      double e = 0.0;
+      for (int j = 0; j < _sys_->get_Nc_i(i); j++)
+      {
+        double q = _sys_->get_qij(i, j), phi;
+        Pt r = _sys_->get_posijreal(i, j), fld, fj, arm;
+        pot_field(r, phi, fld);
+        fj = fld * q;
+        arm = r - ref;
+        e += q * phi;
+        f = f + fj;
+        tau = tau + Pt(arm.y()*fj.z() - arm.z()*fj.y(),
+                       arm.z()*fj.x() - arm.x()*fj.z(),
+                       arm.x()*fj.y() - arm.y()*fj.x());
+      }
+      (*_F_)[i] = f;
+      (*_tau_)[i] = tau;
+      (*omega_)[i] = e;
+    }
+    
+    if (!usePairs_) return;
+    _pairs_->calc_energy();
+    _pairs_->calc_force();
+    _pairs_->calc_torque();
+    for (int a = 0; a < mobile_.size(); a++)
+    {
+      int i = mobile_[a];
+      (*_F_)[i] = (*_F_)[i] + _pairs_->get_forcei(a);
+      (*_tau_)[i] = (*_tau_)[i] + _pairs_->get_taui(a);
+      (*omega_)[i] += _pairs_->get_omegai(a);
+    }
+  }
+  
+  // filled by calc_force
+  void calc_energy() { }
+  void calc_torque() { }
+  
+  PhysSnapshot snapshot()
+  {
+    PhysSnapshot snap;
+    snap.t = _sys_->get_time();
+    snap.unit = unit_;
+    snap.unitConv = unit_conv_;
+    snap.outfname = outfname_;
+    for (int i = 0; i < N_; i++)
+    {
+      snap.pos.push_back(ref_pt(i));
+      if (!cog_) snap.rad.push_back(_sys_->get_aik(i, 0));
+      snap.energy.push_back((*omega_)[i]);
+      snap.force.push_back((*_F_)[i]);
+      snap.torque.push_back((*_tau_)[i]);
+    }
+    return snap;
+  }
+  
+  shared_ptr<vector<Pt> > get_Tau()       { return _tau_; }
+  shared_ptr<vector<Pt> > get_F()         { return _F_; }
+  shared_ptr<vector<double> > get_omega() { return omega_; }
+  
+  Pt get_taui(int i)       { return (*_tau_)[i]; }
+  Pt get_forcei(int i)     { return (*_F_)[i]; }
+  double get_omegai(int i) { return (*omega_)[i]; }
+  double calc_ei(int i)    { return (*omega_)[i]; }
+  Pt get_moli_pos(int i)   { return ref_pt(i); }
+};
+
+#endif /* PotentialGrid_h */
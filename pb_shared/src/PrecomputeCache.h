@@ -0,0 +1,277 @@
+//
+//  PrecomputeCache.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PrecomputeCache_h
+#define PrecomputeCache_h
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+  #include <dirent.h>
+  #include <sys/stat.h>
+  #include <sys/time.h>
+  #include <unistd.h>
+#endif
+
+using namespace std;
+
+/*
+ Builds the name of a cache entry from everything its contents depend on.
+ Values are hashed as they are added, with two independent 64 bit FNV-1a
+ streams, and str() gives the 128 bit result in hex. Doubles are rounded
+ to a fixed number of digits first, so values that differ only by round
+ off (e.g. positions after a translation) give the same key
+ */
+class CacheKey
+{
+protected:
+  uint64_t h1_, h2_;
+  
+  void mix(const void * v, size_t n)
+  {
+    const unsigned char * c = (const unsigned char *) v;
+    for (size_t i = 0; i < n; i++)
+    {
+      h1_ = (h1_ ^ c[i]) * 1099511628211ULL;
+      h2_ = (h2_ ^ c[i]) * 0x9e3779b97f4a7c15ULL;
+    }
+  }
+  
+public:
+  CacheKey() :h1_(14695981039346656037ULL), h2_(0x84222325cbf29ce4ULL) { }
+  
+  void add(int v)                { int64_t w = v; mix(&w, sizeof(w)); }
+  void add(const string & s)     { add((int) s.size()); mix(s.data(), s.size()); }
+  
+  // v rounded to tol
+  void add(double v, double tol = 1e-6)
+  {
+    int64_t w = llround(v / tol);
+    mix(&w, sizeof(w));
+  }
+  
+  // n values exactly, for keys that depend on computed data
+  void add(const double * v, size_t n)
+  {
+    add((int) n);
+    mix(v, n*sizeof(double));
+  }
+  
+  string str() const
+  {
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long) h1_,
+             (unsigned long long) h2_);
+    return string(buf);
+  }
+};
+
+/*
+ On-disk cache of precomputed quantities, one directory per entry named by
+ its CacheKey. An entry is written into a private temporary directory and
+ published with a single rename(), so jobs sharing the cache never see a
+ partial entry, and when two jobs compute the same entry the first rename
+ wins and the other copy is dropped. Using an entry touches it; once the
+ cache grows past its size limit the least recently used entries are
+ removed. A job that loses an entry to eviction while reading it should
+ just recompute it.
+ 
+ The cache is disabled when its directory is empty or cannot be created,
+ and on platforms without POSIX directories.
+ */
+class PrecomputeCache
+{
+protected:
+  string  dir_;
+  double  maxBytes_;
+  bool    enabled_;
+  
+#ifndef _WIN32
+  static bool is_dir(const string & path)
+  {
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+  }
+  
+  // files directly inside path
+  static vector<string> list(const string & path)
+  {
+    vector<string> names;
+    DIR * d = opendir(path.c_str());
+    if (!d) return names;
+    struct dirent * e;
+    while ((e = readdir(d)) != NULL)
+    {
+      string n(e->d_name);
+      if (n != "." && n != "..") names.push_back(n);
+    }
+    closedir(d);
+    return names;
+  }
+  
+  static double entry_bytes(const string & path)
+  {
+    double sz = 0.0;
+    struct stat st;
+    vector<string> files = list(path);
+    for (int i = 0; i < files.size(); i++)
+      if (stat((path + "/" + files[i]).c_str(), &st) == 0) sz += st.st_size;
+    return sz;
+  }
+  
+  static void remove_entry(const string & path)
+  {
+    vector<string> files = list(path);
+    for (int i = 0; i < files.size(); i++)
+      ::remove((path + "/" + files[i]).c_str());
+    rmdir(path.c_str());
+  }
+  
+  static void touch(const string & path)
+  {
+    utimes(path.c_str(), NULL);
+  }
+#endif
+  
+public:
+  PrecomputeCache(string dir = "", double maxMB = 2048.0)
+  :dir_(dir), maxBytes_(maxMB * 1024.0 * 1024.0), enabled_(false)
+  {
+#ifndef _WIN32
+    if (dir_.empty()) return;
+    while (dir_.size() > 1 && dir_[dir_.size()-1] == '/')
+      dir_.erase(dir_.size()-1);
+    mkdir(dir_.c_str(), 0777);
+    enabled_ = is_dir(dir_);
+    if (!enabled_) cout << "Cache directory " << dir_ << " not usable" << endl;
+#endif
+  }
+  
+  bool enabled() const        { return enabled_; }
+  const string & get_dir() const { return dir_; }
+  
+  // Directory of the entry for key, or "" if it is not cached
+  string lookup(const string & key)
+  {
+    if (!enabled_) return "";
+#ifndef _WIN32
+    string path = dir_ + "/" + key;
+    if (!is_dir(path)) return "";
+    touch(path);
+    return path;
+#else
+    return "";
+#endif
+  }
+  
+  // Empty private directory to write the entry for key into
+  string begin_entry(const string & key)
+  {
+    if (!enabled_) return "";
+#ifndef _WIN32
+    char suffix[64];
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    snprintf(suffix, sizeof(suffix), ".tmp.%ld.%ld.%ld", (long) getpid(),
+             (long) tv.tv_sec, (long) tv.tv_usec);
+    string tmp = dir_ + "/" + key + suffix;
+    if (mkdir(tmp.c_str(), 0777) != 0) return "";
+    return tmp;
+#else
+    return "";
+#endif
+  }
+  
+  // Publish the directory from begin_entry as key, then trim the cache
+  void commit_entry(const string & key, const string & tmp)
+  {
+    if (!enabled_ || tmp.empty()) return;
+#ifndef _WIN32
+    string path = dir_ + "/" + key;
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+      remove_entry(tmp); // someone else published it first
+    evict(path);
+#endif
+  }
+  
+  // Drop an entry that could not be used
+  void discard(const string & path)
+  {
+#ifndef _WIN32
+    if (enabled_ && !path.empty()) remove_entry(path);
+#endif
+  }
+  
+  /*
+   Remove least recently used entries until the cache fits its size limit.
+   keep is never removed. Temporary directories of other jobs are skipped
+   unless they are a day old, i.e. left by a job that died
+   */
+  void evict(const string & keep = "")
+  {
+#ifndef _WIN32
+    if (!enabled_) return;
+    vector<pair<time_t, string> > ents;
+    double total = 0.0;
+    time_t now = time(NULL);
+    vector<string> names = list(dir_);
+    for (int i = 0; i < names.size(); i++)
+    {
+      string path = dir_ + "/" + names[i];
+      struct stat st;
+      if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+      if (names[i].find(".tmp.") != string::npos)
+      {
+        if (now - st.st_mtime > 86400) remove_entry(path);
+        continue;
+      }
+      total += entry_bytes(path);
+      if (path != keep) ents.push_back(make_pair(st.st_mtime, path));
+    }
+    sort(ents.begin(), ents.end());
+    for (int i = 0; i < ents.size() && total > maxBytes_; i++)
+    {
+      total -= entry_bytes(ents[i].second);
+      remove_entry(ents[i].second);
+    }
+#endif
+  }
+};
+
+#endif /* PrecomputeCache_h */
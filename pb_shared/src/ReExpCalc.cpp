@@ -93,19 +93,26 @@ void ReExpCoeffsConstants::calc_nu_and_mu()
   }
 }
 
-void ReExpCoeffsConstants::redo_with_kappa(double kappa)
+shared_ptr<ReExpCoeffsConstants> ReExpCoeffsConstants::get_shared(
+                                                              double kappa,
+                                                              double lambda,
+                                                              int p, bool sam)
 {
-  kappa_ = kappa;
-  calc_a_and_b();
-  calc_alpha_and_beta();
-  calc_nu_and_mu();
+  return TableRegistry<ReExpCoeffsConstants>::get(
+                            {(double) p, kappa, lambda, (sam ? 1.0 : 0.0)},
+                            [kappa, lambda, p, sam] ()
+                            { return make_shared<ReExpCoeffsConstants>(kappa,
+                                                                       lambda,
+                                                                       p, sam);
+                            });
 }
 
-ReExpCoeffs::ReExpCoeffs(int p, Pt v, MyMatrix<cmplx> Ytp,
-                         vector<double> besselK,
+ReExpCoeffs::ReExpCoeffs(int p, Pt v, const MyMatrix<cmplx> & Ytp,
+                         const vector<double> & besselK,
                          shared_ptr<ReExpCoeffsConstants> _consts,
-                         vector<double> kappa, vector<double> lambda,
-                         bool grad)
+                         const vector<double> & kappa,
+                         const vector<double> & lambda,
+                         bool grad, bool single)
 :p_(p),
 v_(v),
 Ytp_(Ytp),
@@ -117,12 +124,8 @@ lam_sam_(lambda),
 lam_scl_(p),
 s_prefac_(2),
 grad_(grad),
+single_(false),
 _consts_(_consts),
-R_(2*p, MyMatrix<cmplx> (2*p, 4*p)),
-S_(2*p, MyMatrix<double> (2*p, 4*p)),
-S_F_(2*p, MyMatrix<double> (2*p, 4*p)),
-dSdR_(2*p, MyMatrix<double> (2*p, 4*p)),
-dRdTheta_(2*p, MyMatrix<cmplx> (2*p, 4*p)),
 prefacSing_(2*p, MyMatrix<double>(p, 2))
 {
   
@@ -161,7 +164,69 @@ prefacSing_(2*p, MyMatrix<double>(p, 2))
 
   if (sint < sin_eps)  rSing_ = true;
   else                 rSing_ = false;
+  
+  // S and its derivatives use the constants for this kappa. The shared
+  // tables are never modified, so switch to the matching one if needed
+  if ( _consts_->get_kappa() != kappa_ )
+    _consts_ = ReExpCoeffsConstants::get_shared(kappa_, _consts_->get_lambda(),
+                                                p_, _consts_->is_sam());
  
+  if (single)
+  {
+    DoubleTables & scratch = scratch_tables();
+    swap_tables(scratch);
+    calc_tables();
+    store_single();
+    swap_tables(scratch);
+  } else
+  {
+    calc_tables();
+  }
+}
+
+ReExpCoeffs::DoubleTables & ReExpCoeffs::scratch_tables()
+{
+  static thread_local DoubleTables scratch;
+  return scratch;
+}
+
+void ReExpCoeffs::swap_tables(DoubleTables & tab)
+{
+  swap(R_, tab.R);
+  swap(dRdTheta_, tab.dRdTheta);
+  swap(S_, tab.S);
+  swap(S_F_, tab.S_F);
+  swap(dSdR_, tab.dSdR);
+}
+
+template <typename T>
+static void zero_table(typename VecOfMats<T>::type & tab, int p)
+{
+  if ((tab.get_nrows() != 2*p) || (tab[0].get_nrows() != 2*p)
+      || (tab[0].get_ncols() != 4*p))
+  {
+    tab = typename VecOfMats<T>::type (2*p, MyMatrix<T> (2*p, 4*p));
+    return;
+  }
+  
+  for (int n = 0; n < 2*p; n++)
+    for (int i = 0; i < 2*p; i++)
+      for (int j = 0; j < 4*p; j++)
+        tab[n](i, j) = T();
+}
+
+void ReExpCoeffs::zero_tables()
+{
+  zero_table<cmplx>(R_, p_);
+  zero_table<cmplx>(dRdTheta_, p_);
+  zero_table<double>(S_, p_);
+  zero_table<double>(S_F_, p_);
+  zero_table<double>(dSdR_, p_);
+}
+
+void ReExpCoeffs::calc_tables()
+{
+  zero_tables();
   calc_r();
   calc_s(true); // Calculating S with given kappa
   calc_s(false); // Calculating S with k = 0 for F matrix
@@ -171,12 +236,74 @@ prefacSing_(2*p, MyMatrix<double>(p, 2))
 
 void ReExpCoeffs::calc_derivatives()
 {
+  if (single_)
+  {
+    // The double tables were not kept, so recompute them in scratch space
+    // and store the derivatives as floats too
+    DoubleTables & scratch = scratch_tables();
+    single_ = false;
+    grad_ = true;
+    swap_tables(scratch);
+    calc_tables();
+    store_single();
+    swap_tables(scratch);
+    return;
+  }
+  
   if (!rSing_)  calc_dr_dtheta();
   else          calc_dR_pre();
   calc_ds_dr();
   
 }
 
+/*
+ Copy the rotation and translation tables (and their derivatives, if they
+ were computed) into single precision storage and release the double
+ precision versions. Intended for well separated pairs, where the
+ truncation error of the expansion dominates the rounding error of float
+ */
+void ReExpCoeffs::use_single_prec()
+{
+  if (single_) return;
+  store_single();
+  
+  R_        = VecOfMats<cmplx>::type ();
+  dRdTheta_ = VecOfMats<cmplx>::type ();
+  S_        = VecOfMats<double>::type ();
+  S_F_      = VecOfMats<double>::type ();
+  dSdR_     = VecOfMats<double>::type ();
+}
+
+void ReExpCoeffs::store_single()
+{
+  int n, i, j;
+  
+  Rf_ = VecOfMats<complex<float> >::type (2*p_,
+                                   MyMatrix<complex<float> > (2*p_, 4*p_));
+  Sf_ = VecOfMats<float>::type (2*p_, MyMatrix<float> (2*p_, 4*p_));
+  S_Ff_ = VecOfMats<float>::type (2*p_, MyMatrix<float> (2*p_, 4*p_));
+  if (grad_)
+  {
+    dRdThetaf_ = VecOfMats<complex<float> >::type (2*p_,
+                                   MyMatrix<complex<float> > (2*p_, 4*p_));
+    dSdRf_ = VecOfMats<float>::type (2*p_, MyMatrix<float> (2*p_, 4*p_));
+  }
+  
+  for (n = 0; n < 2*p_; n++)
+    for (i = 0; i < 2*p_; i++)
+      for (j = 0; j < 4*p_; j++)
+      {
+        Rf_[n](i, j)   = (complex<float>) R_[n](i, j);
+        Sf_[n](i, j)   = (float) S_[n](i, j);
+        S_Ff_[n](i, j) = (float) S_F_[n](i, j);
+        if (grad_)
+        {
+          dRdThetaf_[n](i, j) = (complex<float>) dRdTheta_[n](i, j);
+          dSdRf_[n](i, j)     = (float) dSdR_[n](i, j);
+        }
+      }
+  single_ = true;
+}
 
 void ReExpCoeffs::calc_dR_pre()
 {
@@ -391,11 +518,6 @@ void ReExpCoeffs::calc_s(bool useKappa)
       }
     }
   }
-  
-  
-  
-  if ( !useKappa ) // Recomputing constants with old kappa
-    _consts_->redo_with_kappa(kappa_);
 
 } // end calc_s
 
@@ -102,20 +102,6 @@ protected:
   void calc_alpha_and_beta();
   void calc_nu_and_mu();
   
-public:
-  
-  ReExpCoeffsConstants() { }
-
-  ReExpCoeffsConstants(double const& kappa, double const& lambda, int const &p,
-                       bool sam = false);
-  
-  double get_a_val(int n, int m)  { return a_(n, m + 2*p_); }
-  double get_b_val(int n, int m)  { return b_(n, m + 2*p_); }
-  double get_alpha(int n, int m)  { return alpha_(n, m + 2*p_); }
-  double get_beta(int n, int m)   { return  beta_(n, m + 2*p_); }
-  double get_nu(int n, int m)     { return nu_(n, m + 2*p_);}
-  double get_mu(int n, int m)     { return mu_(n, m + 2*p_);}
-  
   void set_a_val( int n, int m, double val) {a_.set_val(n, m + 2*p_, val);}
   void set_b_val(int n, int m, double val)  {b_.set_val(n, m + 2*p_, val);}
   void set_alpha( int n, int m, double val) {alpha_.set_val(n, m + 2*p_, val);}
@@ -123,7 +109,33 @@ public:
   void set_nu( int n, int m, double val)    {nu_.set_val(n, m + 2*p_, val);}
   void set_mu(int n, int m, double val)     {mu_.set_val(n, m + 2*p_, val);}
   
-  void redo_with_kappa(double kappa);
+public:
+  
+  ReExpCoeffsConstants() { }
+
+  ReExpCoeffsConstants(double const& kappa, double const& lambda, int const &p,
+                       bool sam = false);
+  
+  /*
+   Shared instance for (p, kappa, lambda, sam), built on first use. These
+   are immutable once built, so a single table may be used by every solver
+   and thread in the process (see TableRegistry)
+   */
+  static shared_ptr<ReExpCoeffsConstants> get_shared(double kappa,
+                                                     double lambda, int p,
+                                                     bool sam = false);
+  
+  double get_a_val(int n, int m) const  { return a_(n, m + 2*p_); }
+  double get_b_val(int n, int m) const  { return b_(n, m + 2*p_); }
+  double get_alpha(int n, int m) const  { return alpha_(n, m + 2*p_); }
+  double get_beta(int n, int m) const   { return  beta_(n, m + 2*p_); }
+  double get_nu(int n, int m) const     { return nu_(n, m + 2*p_);}
+  double get_mu(int n, int m) const     { return mu_(n, m + 2*p_);}
+  
+  double get_kappa() const              { return kappa_; }
+  double get_lambda() const             { return lambda_; }
+  int get_p() const                     { return p_; }
+  bool is_sam() const                   { return is_sam_; }
   
 };
 
@@ -163,6 +175,20 @@ protected:
    */
   VecOfMats<cmplx>::type    dRdTheta_;
   VecOfMats<double>::type   dSdR_;
+  
+  /*
+   Single precision copies of the above tables. Populated by the
+   constructor when single is set, without keeping the double tables, or
+   by use_single_prec(), which then releases them. All getters read from
+   these instead. Values are promoted back to double on retrieval, so
+   accumulation stays in double
+   */
+  bool single_;
+  VecOfMats<complex<float> >::type  Rf_;
+  VecOfMats<complex<float> >::type  dRdThetaf_;
+  VecOfMats<float>::type            Sf_;
+  VecOfMats<float>::type            S_Ff_;
+  VecOfMats<float>::type            dSdRf_;
 
   double kappa_; //from Constants
   double kappa_extern_; // For PB-SAM, if we xform within mol, still
@@ -190,6 +216,23 @@ protected:
   
   VecOfMats<double>::type prefacSing_; // for singular case
   
+  /*
+   Double precision tables of one pair. A pair kept in single precision is
+   computed in its thread's scratch set of these, so that only its float
+   tables are allocated
+   */
+  struct DoubleTables
+  {
+    VecOfMats<cmplx>::type   R, dRdTheta;
+    VecOfMats<double>::type  S, S_F, dSdR;
+  };
+  static DoubleTables & scratch_tables();
+  void swap_tables(DoubleTables & tab);
+  
+  void zero_tables(); // size the double tables for p_ and zero them
+  void calc_tables(); // R, S, S_F and, if grad_, their derivatives
+  void store_single(); // copy the double tables into the float ones
+  
   void calc_r();  // calculate all the values for R_
   void calc_s(bool useKappa); // calculate all the values for S_
   void calc_dr_dtheta();
@@ -198,55 +241,74 @@ protected:
   void calc_dR_pre(); // compute prefactors for singularities
   
 public:
-  ReExpCoeffs() { };
+  ReExpCoeffs() : single_(false) { };
   
-  ReExpCoeffs(int p, Pt v, MyMatrix<cmplx> Ytp, vector<double> besselK_,
-              shared_ptr<ReExpCoeffsConstants> _consts, vector<double> kappa,
-              vector<double> lambda, bool grad = false);
+  ReExpCoeffs(int p, Pt v, const MyMatrix<cmplx> & Ytp,
+              const vector<double> & besselK_,
+              shared_ptr<ReExpCoeffsConstants> _consts,
+              const vector<double> & kappa, const vector<double> & lambda,
+              bool grad = false, bool single = false);
   
   void calc_derivatives();
   
+  // Convert R, S and their derivatives to float storage (far field pairs)
+  void use_single_prec();
+  bool is_single_prec() const { return single_; }
+  
   MyVector<double> calc_SH_spec( double val ); // for singularities
   
-  vector<double> get_lambdas()   { return lam_sam_; };
-  vector<double> get_lam_scale() { return lam_scl_; };
+  vector<double> get_lambdas() const   { return lam_sam_; };
+  const vector<double> & get_lam_scale() const { return lam_scl_; };
   
-  bool isSingular()  { return rSing_; }  
-  Pt get_TVec()       { return v_; }
+  bool isSingular() const  { return rSing_; }  
+  Pt get_TVec() const       { return v_; }
   
-  cmplx get_yval(int n, int s)
+  cmplx get_yval(int n, int s) const
   {
     if ( s < 0 ) return conj(Ytp_(n, -s));
     else         return Ytp_(n, s);
   }
   
-  cmplx get_rval(int n, int m, int s)
+  cmplx get_rval(int n, int m, int s) const
   {
+    if ( single_ )
+    {
+      if ( m < 0 ) return (cmplx) conj(Rf_[n](-m, -s+2*p_));
+      else         return (cmplx)      Rf_[n]( m,  s+2*p_);
+    }
     if ( m < 0 ) return conj(R_[n](-m, -s+2*p_));
     else         return      R_[n]( m,  s+2*p_);
   }
   
-  double get_sval(int n, int l, int m)
+  double get_sval(int n, int l, int m) const
   {
+    if ( single_ ) return (double) Sf_[n](l, abs(m)+2*p_);
     if ( m < 0 ) return S_[n](l, -m+2*p_);
     else         return S_[n](l,  m+2*p_);
   }
   
-  double get_s_fval(int n, int l, int m)
+  double get_s_fval(int n, int l, int m) const
   {
+    if ( single_ ) return (double) S_Ff_[n](l, abs(m)+2*p_);
     if ( m < 0 ) return S_F_[n](l, -m+2*p_);
     else         return S_F_[n](l,  m+2*p_);
   }
   
-  double get_dsdr_val(int n, int l, int m)
+  double get_dsdr_val(int n, int l, int m) const
   { 
+    if ( single_ ) return (double) dSdRf_[n](l, abs(m)+2*p_);
     if ( m < 0 ) return dSdR_[n](l, -m+2*p_);
     else         return dSdR_[n](l,  m+2*p_);
   }
   
   
-  cmplx get_dr_dtheta_val(int n, int m, int s)
+  cmplx get_dr_dtheta_val(int n, int m, int s) const
   {
+    if ( single_ )
+    {
+      if ( m < 0 ) return (cmplx) conj(dRdThetaf_[n](-m, -s+2*p_));
+      else         return (cmplx) dRdThetaf_[n](m, s+2*p_);
+    }
     if ( m < 0 ) return conj(dRdTheta_[n](-m, -s+2*p_));
     else         return dRdTheta_[n](m, s+2*p_);
   }
@@ -254,7 +316,7 @@ public:
   /*
    dR/dPhi is just -i * s * R
    */
-  cmplx get_dr_dphi_val(int n, int m, int s)
+  cmplx get_dr_dphi_val(int n, int m, int s) const
   {
     cmplx ic = cmplx(0, 1);
     cmplx sc = cmplx(s, 0);
@@ -262,7 +324,7 @@ public:
     return drdp;
   }
   
-  double get_prefac_dR_val(int n, int m, int l)
+  double get_prefac_dR_val(int n, int m, int l) const
   {
     return prefacSing_[n](m, l);
   }
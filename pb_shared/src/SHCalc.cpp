@@ -7,6 +7,7 @@
 //
 
 #include "SHCalc.h"
+#include "PoleKernels.h"
 
 SHCalcConstants::SHCalcConstants(const int N)
 :numVals_(N), legConsts1_(N, N), legConsts2_(N, N),
@@ -48,63 +49,25 @@ shConsts_(N, N), dubFac_(N)
   
 }
 
-SHCalc::SHCalc(const int num_vals, shared_ptr<SHCalcConstants> _consts)
-:numVals_(num_vals), P_( num_vals, num_vals), _consts_(_consts), 
-Y_( num_vals, num_vals)
+shared_ptr<SHCalcConstants> SHCalcConstants::get_shared(const int num_vals)
 {
-  assert (_consts_->get_n() == numVals_);
+  return TableRegistry<SHCalcConstants>::get({(double) num_vals},
+                          [num_vals] ()
+                          { return make_shared<SHCalcConstants>(num_vals); });
 }
 
-/*
- 
- Calculate the Legendre polynomial for the input theta using the
- recursion functions for the polynomials, which are as follows:
- Pl,l (x) = (-1)^l * (2l-1)!! * (1-x^2)^(l/2)                          (1)
- Pl,l+1 (x) = x * (2l+1) * Pl,l(x)                                     (2)
- Pl,m (x) = x * (2l-1)/(l-m) * Pl-1,m(x) - (l+m-1)/(l-m) * Pl-2,m(x)   (3)
- 
- This sets the member P_ to the results
- */
-void SHCalc::calc_legendre(const double theta)
+SHCalc::SHCalc(const int num_vals, shared_ptr<SHCalcConstants> _consts)
+:numVals_(num_vals), _consts_(_consts), ws_(num_vals)
 {
-  double x = cos(theta);
-  P_.set_val(0, 0, 1.0);  // base value for recursion
-  P_.set_val(1, 0, x);
-  
-  int l, m;
-  double val = 0.0;
-  for (l = 0; l < numVals_; l++)
-  {
-    for (m = 0; m <= l; m++)
-    {
-      if ((l == 0 && m == 0) || (l == 1 && m == 0)) continue; //skip base values
-      else if (l == m)
-      {
-        double dblL = (double) l;
-        val = pow(-1.0, dblL) * _consts_->get_dub_fac_val(l)
-        * pow(1.0-x*x, dblL/2.0);  // (1) in doc string
-      }
-      else if (m == l + 1)
-      {
-        val = x * (2*l + 1) * P_(l, l);  // (2)
-      }
-      else if (m < l)
-      {
-        val = _consts_->get_leg_consts1_val(l, m) * x * P_(l-1, m);  // (3)
-        val -= _consts_->get_leg_consts2_val(l, m) * P_(l-2, m);  // (3)
-      }
-      P_.set_val(l, m, val);
-    }
-  }
+  assert (_consts_->get_n() == numVals_);
 }
 
-
 /*
  Return the results of the legendre calculation for an n, m.
  */
 double SHCalc::get_legendre_result( int n, int m )
 {
-  return P_( n, m);
+  return ws_.P_( n, m);
 }
 
 /*
@@ -115,42 +78,17 @@ double SHCalc::get_legendre_result( int n, int m )
  where P_(n, m) are the associated Legendre polynomials.
  
  */
-void SHCalc::calc_sh(const double theta, const double phi)
+void SHCalc::calc_sh(const double theta, const double phi,
+                     SHWorkspace & ws) const
 {
-  calc_legendre(theta);  // first calculate legendre
-  cmplx iu (0, 1.0);  // complex unit
-  int n, m;
-  cmplx val, mcomp;
-  double shc;  // constant value
-  for (n = 0; n < numVals_; n++)
-  {
-    for (m = 0; m < numVals_; m++)
-    {
-      shc = _consts_->get_sh_consts_val(n, m);
-      double dblM = (double) m;
-      mcomp = complex<double> (dblM, 0.0);
-      val = pow(-1.0, dblM) * shc * P_(n, m) * exp(iu * mcomp * phi);
-      Y_.set_val(n, m, val);
-    }
-  }
-  
+  // legendre polynomials are computed first, see sh_fixed in PoleKernels.h
+  SH_DISPATCH(numVals_, sh_fixed, numVals_, theta, phi, *_consts_,
+              ws.P_, ws.Y_);
 }
 
-/*
- Return the results of the spherical harmonic calculation for an n, m.
- If m is negative, then we return the complex conjugate of the calculated
- value for the positive value of m
- */
-cmplx SHCalc::get_result(const int n, const int m)
+void SHCalc::calc_sh(const double theta, const double phi)
 {
-  if (m < 0)
-  {
-    return conj(Y_(n, -m));  // complex conjugate
-  }
-  else
-  {
-    return Y_(n, m);
-  }
+  calc_sh(theta, phi, ws_);
 }
 
 
@@ -59,11 +59,14 @@ protected:
 public:
   SHCalcConstants(const int num_vals=Constants::MAX_NUM_POLES);
   
-  const double get_leg_consts1_val(const int n, const int m)
+  // shared instance for num_vals poles, built on first use
+  static shared_ptr<SHCalcConstants> get_shared(const int num_vals);
+  
+  const double get_leg_consts1_val(const int n, const int m) const
   { return legConsts1_(n, m); }
-  const double get_leg_consts2_val(const int n, const int m)
+  const double get_leg_consts2_val(const int n, const int m) const
   { return legConsts2_(n, m); }
-  const double get_sh_consts_val(const int n, const int m)
+  const double get_sh_consts_val(const int n, const int m) const
   { return shConsts_(n, m);   }
   const double get_dub_fac_val(const int i) const
   { return dubFac_[i];        }
@@ -72,6 +75,30 @@ public:
 };
 
 
+/*
+ Caller-owned storage for one spherical harmonic evaluation. Giving each
+ thread its own workspace lets a single SHCalc be shared across threads
+ */
+class SHWorkspace
+{
+public:
+  MyMatrix<double>   P_;  // legendre polynomials
+  MyMatrix<cmplx>    Y_;  // spherical harmonics
+  
+  SHWorkspace(const int num_vals=1)
+  :P_(num_vals, num_vals), Y_(num_vals, num_vals) { }
+  
+  // result for n, m values, negative m is the complex conjugate of +m
+  cmplx get_result(const int n, const int m) const
+  {
+    if (m < 0) return conj(Y_(n, -m));
+    else       return Y_(n, m);
+  }
+  
+  const MyMatrix<cmplx> & get_full_result() const { return Y_; }
+};
+
+
 /*
  Class for computing spherical harmonics. This includes
  calcualtion of the associated Legendre Polynomials
@@ -82,7 +109,9 @@ public:
  where P_(n, m) are the associated Legendre polynomials.
  
  These are constructed dynamically and returned as a matrix of
- values for every n,m
+ values for every n,m. The const calc_sh overload writes into a caller's
+ SHWorkspace and is safe to call concurrently; the stateful overload and
+ getters below use the calculator's own workspace.
  */
 class SHCalc
 {
@@ -90,28 +119,30 @@ protected:
   
   int                     numVals_;  //# of poles (output matrix will be NxN)
   shared_ptr<SHCalcConstants> _consts_;
-  MyMatrix<double>        P_;  // legendre polynomials
-  MyMatrix<cmplx>         Y_;  // spherical harmonics calcualted by this class
-  
-  void calc_legendre(const double theta);  // calculate the legendre polynomial
-  //  at every n, m (store in this.P_)
+  SHWorkspace             ws_;  // results of the last stateful calc_sh
   
 public:
   SHCalc() {}
   
   SHCalc(const int num_vals, shared_ptr<SHCalcConstants> _consts);
   
-  // calculate the spherical harmonics at every n, m  (store in this.Y_)
+  // calculate the spherical harmonics at every n, m  (store in ws)
+  void calc_sh(const double theta, const double phi, SHWorkspace & ws) const;
+  
+  // calculate the spherical harmonics at every n, m  (store in this.ws_)
   void calc_sh(const double theta, const double phi);
   
+  // workspace sized for this calculator
+  SHWorkspace make_workspace() const { return SHWorkspace(numVals_); }
+  
   // retrieve the result for n, m values
-  cmplx get_result(const int n, const int m);
+  cmplx get_result(const int n, const int m) { return ws_.get_result(n, m); }
   
   // retrieve the full calculated Y_ matrix
-  MyMatrix<cmplx> get_full_result() { return Y_; }
+  const MyMatrix<cmplx> & get_full_result() const { return ws_.Y_; }
   
   double get_legendre_result( int n, int m );
-  int get_num_vals()  { return numVals_; }
+  int get_num_vals() const { return numVals_; }
 };
 
 
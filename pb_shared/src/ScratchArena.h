@@ -0,0 +1,114 @@
+//
+//  ScratchArena.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ScratchArena_h
+#define ScratchArena_h
+
+#include <deque>
+#include "MyMatrix.h"
+
+using namespace std;
+
+/*
+ Pool of scratch matrices for the solver iterations. Buffers are handed
+ out in order by get() and stay owned by the arena, so after the first
+ iteration has sized the pool a repeat of the same sequence of requests
+ makes no heap allocations. Releasing is only a move of the cursor:
+ reset() frees everything and a Scope rewinds to where it was opened.
+ References from get() are valid until the cursor is moved back past them.
+ 
+ The solvers use the per-thread instance from local(), so threads never
+ share buffers.
+ */
+template <typename T>
+class ScratchArena
+{
+protected:
+  size_t                next_;  // index of the next free buffer
+  deque<MyMatrix<T> >   bufs_;  // deque: growing keeps references valid
+  
+public:
+  ScratchArena() : next_(0) { }
+  
+  // next free buffer, resized to (nrows, ncols) and set to zero
+  MyMatrix<T> & get(const int nrows, const int ncols)
+  {
+    if (next_ == bufs_.size()) bufs_.push_back(MyMatrix<T>(nrows, ncols));
+    
+    MyMatrix<T> & mat = bufs_[next_++];
+    if (mat.get_nrows() != nrows || mat.get_ncols() != ncols)
+    {
+      mat = MyMatrix<T>(nrows, ncols);
+    } else
+    {
+      for (int i = 0; i < nrows; i++)
+        for (int j = 0; j < ncols; j++)
+          mat(i, j) = T();
+    }
+    return mat;
+  }
+  
+  size_t get_mark() const        { return next_; }
+  void rewind(const size_t mark) { next_ = mark; }
+  void reset()                   { next_ = 0; }
+  
+  // number of buffers in use and held by the pool
+  size_t get_used() const        { return next_; }
+  size_t get_capacity() const    { return bufs_.size(); }
+  
+  static ScratchArena<T> & local()
+  {
+    static thread_local ScratchArena<T> arena;
+    return arena;
+  }
+  
+  /*
+   Buffers taken through a Scope are given back when it goes out of scope,
+   one is opened per solver iteration and per nested calc_vals call
+   */
+  class Scope
+  {
+  protected:
+    ScratchArena<T> & arena_;
+    size_t            mark_;
+    
+  public:
+    Scope(ScratchArena<T> & arena=ScratchArena<T>::local())
+    :arena_(arena), mark_(arena.get_mark()) { }
+    
+    ~Scope() { arena_.rewind(mark_); }
+    
+    MyMatrix<T> & get(const int nrows, const int ncols)
+    { return arena_.get(nrows, ncols); }
+  };
+};
+
+#endif /* ScratchArena_h */
@@ -0,0 +1,100 @@
+//
+//  TableRegistry.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TableRegistry_h
+#define TableRegistry_h
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+/*
+ Process wide registry of constant tables of type T (BesselConstants,
+ SHCalcConstants, ReExpCoeffsConstants, ExpansionConstants). Tables are
+ keyed by the parameters that define them, e.g. (p, kappa, lambda, sam),
+ built once on first request and then shared by every solver and
+ calculator. Tables handed out by the registry must not be modified.
+ Lookup and construction are guarded by a mutex, so this is safe to call
+ from OpenMP regions.
+ */
+template <typename T>
+class TableRegistry
+{
+protected:
+  static mutex & lock()
+  {
+    static mutex lock_;
+    return lock_;
+  }
+  
+  static map<vector<double>, shared_ptr<T> > & tables()
+  {
+    static map<vector<double>, shared_ptr<T> > tables_;
+    return tables_;
+  }
+  
+public:
+  /*
+   Return the table for key, calling build() to construct it if it has not
+   been requested before
+   */
+  template <typename Builder>
+  static shared_ptr<T> get(const vector<double> & key, Builder build)
+  {
+    lock_guard<mutex> guard(lock());
+    typename map<vector<double>, shared_ptr<T> >::iterator it;
+    it = tables().find(key);
+    if (it != tables().end()) return it->second;
+    
+    shared_ptr<T> table = build();
+    tables()[key] = table;
+    return table;
+  }
+  
+  // number of distinct tables built so far
+  static int size()
+  {
+    lock_guard<mutex> guard(lock());
+    return (int) tables().size();
+  }
+  
+  // drop the registry's references, tables still in use stay alive
+  static void clear()
+  {
+    lock_guard<mutex> guard(lock());
+    tables().clear();
+  }
+};
+
+#endif /* TableRegistry_h */
@@ -0,0 +1,178 @@
+//
+//  WignerRotation.h
+//  pb_solvers_code
+//
+/*
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WignerRotation_h
+#define WignerRotation_h
+
+#include <vector>
+#include <memory>
+#include "SHCalc.h"
+#include "TableRegistry.h"
+
+using namespace std;
+
+/*
+ Wigner D matrices, D^n_(m,m'), for the fixed rotation X = Rx(pi/2) that
+ takes the y axis onto the z axis, in the spherical harmonic convention
+ of SHCalc. Built once per number of poles by Gauss-Legendre x uniform
+ quadrature of Y_(n,m)(X r) * conj(Y_(n,m')(r)), which is exact for the
+ degrees involved. Any rotation about y is then X^-1 Rz X.
+ */
+class WignerConstants
+{
+protected:
+  int p_;
+  vector<MyMatrix<cmplx> > dX_;  // D^n for X, indexed (m+n, m'+n)
+  
+public:
+  WignerConstants(int p)
+  :p_(p), dX_(p)
+  {
+    for (int n = 0; n < p_; n++)
+      dX_[n] = MyMatrix<cmplx> (2*n+1, 2*n+1);
+    
+    auto shcalc = make_shared<SHCalc>(p_, SHCalcConstants::get_shared(p_));
+    SHWorkspace ws = shcalc->make_workspace(), wsX = shcalc->make_workspace();
+    vector<double> ct, wt;
+    gauss_legendre(p_, ct, wt);
+    int nphi = 2*p_;
+    
+    for (int i = 0; i < p_; i++)
+    {
+      double theta = acos(ct[i]), st = sin(theta);
+      for (int j = 0; j < nphi; j++)
+      {
+        double phi = 2.0 * M_PI * j / nphi;
+        double wij = wt[i] * 2.0 * M_PI / nphi;
+        // X r for r = (sin t cos f, sin t sin f, cos t)
+        Pt xr(st*cos(phi), -ct[i], st*sin(phi));
+        shcalc->calc_sh(theta, phi, ws);
+        shcalc->calc_sh(xr.theta(), xr.phi(), wsX);
+        for (int n = 0; n < p_; n++)
+        {
+          double scl = wij * (2.0*n + 1.0) / (4.0 * M_PI);
+          for (int m = -n; m <= n; m++)
+          {
+            cmplx ym = scl * wsX.get_result(n, m);
+            for (int s = -n; s <= n; s++)
+              dX_[n](m+n, s+n) += ym * conj(ws.get_result(n, s));
+          }
+        }
+      }
+    }
+  }
+  
+  // shared instance for p poles, built on first use (see TableRegistry)
+  static shared_ptr<WignerConstants> get_shared(int p)
+  {
+    return TableRegistry<WignerConstants>::get({(double) p},
+                          [p] () { return make_shared<WignerConstants>(p); });
+  }
+  
+  const MyMatrix<cmplx> & get_dX(int n) const { return dX_[n]; }
+  int get_p() const                           { return p_; }
+};
+
+
+/*
+ Rotation of multipole expansions stored as (p, 2p+1) matrices indexed
+ (n, m+p). If X holds coefficients of Y_(n,m)(r), the rotated matrix holds
+ those of the same function with its sources moved by rot (3x3 rotation
+ matrix acting on points). Rot is split into Euler angles,
+ Rz(alpha) Ry(beta) Rz(gamma), and the y rotation is applied through the
+ tabulated X matrices, giving O(p^3) per expansion.
+ */
+class WignerRotation
+{
+protected:
+  int p_;
+  double alpha_, beta_, gamma_;
+  shared_ptr<WignerConstants> _consts_;
+  
+public:
+  WignerRotation(const MyMatrix<double> & rot, int p)
+  :p_(p), _consts_(WignerConstants::get_shared(p))
+  {
+    euler_angles(rot, alpha_, beta_, gamma_);
+  }
+  
+  // rot = Rz(alpha) Ry(beta) Rz(gamma), with gamma = 0 when beta is 0 or pi
+  static void euler_angles(const MyMatrix<double> & rot, double & alpha,
+                           double & beta, double & gamma)
+  {
+    double cb = min(1.0, max(-1.0, rot(2, 2)));
+    beta = acos(cb);
+    if (sqrt(rot(0, 2)*rot(0, 2) + rot(1, 2)*rot(1, 2)) > 1e-12)
+    {
+      alpha = atan2(rot(1, 2), rot(0, 2));
+      gamma = atan2(rot(2, 1), -rot(2, 0));
+    } else if (cb > 0)
+    {
+      alpha = atan2(rot(1, 0), rot(0, 0));
+      gamma = 0.0;
+    } else
+    {
+      alpha = atan2(-rot(1, 0), -rot(0, 0));
+      gamma = 0.0;
+    }
+  }
+  
+  void rotate(const MyMatrix<cmplx> & X, MyMatrix<cmplx> & out) const
+  {
+    vector<cmplx> v1, v2;
+    for (int n = 0; n < p_; n++)
+    {
+      const MyMatrix<cmplx> & dX = _consts_->get_dX(n);
+      v1.assign(2*n+1, cmplx(0.0, 0.0));
+      v2.assign(2*n+1, cmplx(0.0, 0.0));
+      
+      // Rz(gamma), then X
+      for (int s = -n; s <= n; s++)
+      {
+        cmplx xs = X(n, s+p_) * polar(1.0, s*gamma_);
+        for (int m = -n; m <= n; m++)
+          v1[m+n] += dX(m+n, s+n) * xs;
+      }
+      // Rz(beta), then X^-1 = X^H
+      for (int s = -n; s <= n; s++)
+      {
+        cmplx xs = v1[s+n] * polar(1.0, s*beta_);
+        for (int m = -n; m <= n; m++)
+          v2[m+n] += conj(dX(s+n, m+n)) * xs;
+      }
+      // Rz(alpha)
+      for (int m = -n; m <= n; m++)
+        out(n, m+p_) = v2[m+n] * polar(1.0, m*alpha_);
+    }
+  }
+};
+
+#endif /* WignerRotation_h */
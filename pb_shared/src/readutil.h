@@ -36,28 +36,54 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 
 #include <string>
 
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
 using namespace std;
 
 class CouldNotReadException: public exception
 {
 protected:
   string path_;
+  string msg_;
   
 public:
   CouldNotReadException(string path)
-  :path_(path)
+  :path_(path), msg_("Could not read: " + path)
+  {
+  }
+  
+  virtual const char* what() const throw()
+  {
+    return msg_.c_str();
+  }
+};
+
+class CouldNotWriteException: public exception
+{
+protected:
+  string path_;
+  string msg_;
+  
+public:
+  CouldNotWriteException(string path)
+  :path_(path), msg_("Could not write: " + path)
   {
   }
   
   virtual const char* what() const throw()
   {
-    string ss;
-    ss = "Could not read: " + path_;
-    return ss.c_str();
+    return msg_.c_str();
   }
 };
 
@@ -66,18 +92,18 @@ class NotEnoughCoordsException: public exception
 protected:
   int infile_;
   int needed_;
+  string msg_;
   
 public:
   NotEnoughCoordsException( int inFile, int needed)
-  :infile_(inFile), needed_(needed)
+  :infile_(inFile), needed_(needed),
+  msg_("File has "+to_string(inFile)+" lines, need "+to_string(needed))
   {
   }
   
   virtual const char* what() const throw()
   {
-    string ss;
-    ss = "File has "+to_string(infile_)+" lines, need "+to_string(needed_);
-    return ss.c_str();
+    return msg_.c_str();
   }
   
 };
@@ -87,20 +113,244 @@ class TooFewPolesException: public exception
 protected:
   int infile_;
   int needed_;
+  string msg_;
   
 public:
   TooFewPolesException( int inFile, int needed)
-  :infile_(inFile), needed_(needed)
+  :infile_(inFile), needed_(needed),
+  msg_("File has "+to_string(inFile)+" poles, need "+to_string(needed))
   {
   }
   
   virtual const char* what() const throw()
   {
-    string ss;
-    ss = "File has "+to_string(infile_)+" poles, need "+to_string(needed_);
-    return ss.c_str();
+    return msg_.c_str();
+  }
+  
+};
+
+class ParseException: public exception
+{
+protected:
+  string msg_;
+  
+public:
+  ParseException(string path, int line, string why)
+  :msg_(path + ":" + to_string(line) + ": " + why)
+  {
+  }
+  
+  virtual const char* what() const throw()
+  {
+    return msg_.c_str();
+  }
+};
+
+/*
+ Line by line reader for the text files below. The file is mapped with
+ mmap (or read in one go where that is not available) and lines and
+ whitespace delimited fields are handed out as pointers into it, so
+ nothing is copied until a number is parsed. Errors name the file and
+ line they come from.
+ */
+class LineScanner
+{
+protected:
+  string        path_;
+  const char *  data_;
+  size_t        size_;
+  bool          mapped_;  // data_ is an mmap, otherwise it is in buf_
+  string        buf_;
+  
+  const char *  next_;    // start of the next line
+  const char *  lb_;      // current line is [lb_, le_)
+  const char *  le_;
+  const char *  pos_;     // start of the next field in the current line
+  int           line_;    // number of the current line, from 1
+  
+  static bool is_space(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+  
+public:
+  LineScanner(string path)
+  :path_(path), data_(NULL), size_(0), mapped_(false), next_(NULL),
+  lb_(NULL), le_(NULL), pos_(NULL), line_(0)
+  {
+#ifndef _WIN32
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) throw CouldNotReadException(path_);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+      size_ = (size_t) st.st_size;
+      void * m = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (m != MAP_FAILED)
+      {
+        data_   = (const char *) m;
+        mapped_ = true;
+#ifdef MADV_SEQUENTIAL
+        madvise(m, size_, MADV_SEQUENTIAL);
+#endif
+      }
+    }
+    ::close(fd);
+#endif
+    if (!mapped_)
+    {
+      ifstream fin(path_.c_str(), ios::binary);
+      if (!fin.is_open()) throw CouldNotReadException(path_);
+      buf_.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+      data_ = buf_.data();
+      size_ = buf_.size();
+    }
+    next_ = data_;
+  }
+  
+  ~LineScanner()
+  {
+#ifndef _WIN32
+    if (mapped_) munmap((void *) data_, size_);
+#endif
+  }
+  
+  LineScanner(const LineScanner &) = delete;
+  LineScanner & operator=(const LineScanner &) = delete;
+  
+  // move to the next line, false at the end of the file
+  bool next_line()
+  {
+    const char * end = data_ + size_;
+    if (next_ >= end) return false;
+    lb_ = next_;
+    const char * nl = (const char *) memchr(lb_, '\n', end - lb_);
+    le_    = nl ? nl : end;
+    next_  = nl ? nl + 1 : end;
+    if (le_ > lb_ && le_[-1] == '\r') le_--;
+    pos_ = lb_;
+    line_++;
+    return true;
+  }
+  
+  bool starts_with(const char * s) const
+  {
+    size_t n = strlen(s);
+    return (size_t) (le_ - lb_) >= n && strncmp(lb_, s, n) == 0;
+  }
+  
+  bool blank() const
+  {
+    for (const char * c = lb_; c < le_; c++) if (!is_space(*c)) return false;
+    return true;
+  }
+  
+  // next field of the current line as [b, e), false if there are no more
+  bool next_field(const char *& b, const char *& e)
+  {
+    while (pos_ < le_ && is_space(*pos_)) pos_++;
+    if (pos_ == le_) return false;
+    b = pos_;
+    while (pos_ < le_ && !is_space(*pos_)) pos_++;
+    e = pos_;
+    return true;
+  }
+  
+  // the field [b, e) as a number, throws a ParseException if it is not one
+  double to_double(const char * b, const char * e) const
+  {
+    double v;
+    if (!parse_double(b, e, v))
+      fail("could not read \"" + string(b, e) + "\" as a number");
+    return v;
   }
   
+  double read_double()
+  {
+    const char * b, * e;
+    if (!next_field(b, e)) fail("expected a number, found end of line");
+    return to_double(b, e);
+  }
+  
+  void fail(string why) const { throw ParseException(path_, line_, why); }
+  
+  const string get_path() const   { return path_; }
+  int get_line_number() const     { return line_; }
+  string get_line() const         { return string(lb_, le_); }
+  
+  /*
+   Parse the decimal number at the start of [b, e) into v and return the
+   end of it, or NULL if there is none. Numbers with at most 19 significant
+   digits and a power of ten that is exact in a double (the case for
+   anything written with %f or %e) are converted directly, which rounds
+   exactly as strtod does. Anything else is passed to strtod.
+   */
+  static const char * scan_double(const char * b, const char * e, double & v)
+  {
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+      1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+      1e20, 1e21, 1e22 };
+    const char * c = b;
+    bool neg = false, any = false;
+    if (c < e && (*c == '-' || *c == '+')) neg = (*c++ == '-');
+    
+    uint64_t man = 0;
+    int digits = 0, exp10 = 0;
+    for (; c < e && *c >= '0' && *c <= '9'; c++, any = true)
+    {
+      if (digits < 19)
+      {
+        man = man*10 + (*c - '0');
+        if (man != 0) digits++;
+      } else exp10++;
+    }
+    if (c < e && *c == '.')
+    {
+      for (c++; c < e && *c >= '0' && *c <= '9'; c++, any = true)
+      {
+        if (digits >= 19) continue;
+        man = man*10 + (*c - '0');
+        if (man != 0) digits++;
+        exp10--;
+      }
+    }
+    if (!any) return NULL;
+    
+    const char * ep = c;
+    if (ep < e && (*ep == 'e' || *ep == 'E'))
+    {
+      ep++;
+      bool eneg = false;
+      int ex = 0;
+      if (ep < e && (*ep == '-' || *ep == '+')) eneg = (*ep++ == '-');
+      if (ep < e && *ep >= '0' && *ep <= '9')
+      {
+        for (; ep < e && *ep >= '0' && *ep <= '9'; ep++)
+          if (ex < 10000) ex = ex*10 + (*ep - '0');
+        exp10 += eneg ? -ex : ex;
+        c = ep;
+      }
+    }
+    
+    if (man < (1ULL << 53) && exp10 >= -22 && exp10 <= 22)
+    {
+      v = (exp10 < 0) ? (double) man / pow10[-exp10]
+                      : (double) man * pow10[exp10];
+      if (neg) v = -v;
+      return c;
+    }
+    
+    string num(b, c);
+    char * end;
+    v = strtod(num.c_str(), &end);
+    return (end == num.c_str() + num.size()) ? c : NULL;
+  }
+  
+  // [b, e) is exactly one number
+  static bool parse_double(const char * b, const char * e, double & v)
+  {
+    return scan_double(b, e, v) == e;
+  }
 };
 
 /*
@@ -113,30 +363,26 @@ protected:
   vector<Pt> sp_;
   vector<Pt> np_;
   
+  // Vertex file: comments, a line of counts, then one vertex per line
+  // starting with its position and normal
   void read()
   {
-    // File handling
-    ifstream fin( path_.c_str() );
-
-    if (!fin.is_open()) throw CouldNotReadException(path_);
-    string s;
-    
-    // Ignoring any comments in the file
-    getline( fin, s );
-    while ( s[0] == '#' )
-      getline( fin, s );
-    
-    double x, y, z, nx, ny, nz;
-    getline( fin, s ); // ignore first line b/c its summary of cols
-    
-    // While there is no EOF read
-    while ( !fin.eof( ))
+    LineScanner in(path_);
+    bool head = true;
+    while (in.next_line())
     {
-      stringstream linestream(s);
-      linestream >> x >> y >> z >> nx >> ny >> nz;
+      if (head)
+      {
+        head = in.starts_with("#");
+        continue;
+      }
+      if (in.blank()) continue;
+      
+      double x = in.read_double(), y = in.read_double(), z = in.read_double();
+      double nx = in.read_double(), ny = in.read_double();
+      double nz = in.read_double();
       sp_.push_back( Pt(x, y, z));
       np_.push_back( Pt(nx, ny, nz));
-      getline( fin, s );
     }
   }
   
@@ -149,8 +395,8 @@ public:
   }
   
   const string get_path() const                   { return path_; }
-  vector<Pt> get_sp() const                       { return sp_;   }
-  vector<Pt> get_np() const                       { return np_;   }
+  const vector<Pt> & get_sp() const              { return sp_;   }
+  const vector<Pt> & get_np() const              { return np_;   }
   
 };
 
@@ -286,37 +532,65 @@ protected:
   vector<Pt> cgCenters_;  // coarse grain centers
   vector<double> cgRadii_;
   
+  static bool is_number_start(char c)
+  {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+  }
+  
+  /*
+   Columns before x y z charge radius are not always there (chain ID,
+   residue number), and fixed width columns can run together when a
+   coordinate is wide (33.067-10.026). So the last five numbers on an ATOM
+   line are used, reading back over fields that are all numbers and
+   ignoring any trailing non-numeric fields (element). Lines whose residue
+   or atom name is CEN are coarse-grained spheres.
+   */
   void read()
   {
-    ifstream fin(path_.c_str());
-    if (!fin.is_open()) throw CouldNotReadException(path_);
-    
-    char buf[1000];
-    fin.getline(buf, 999);
-    int iCoord = 31;
-    while (!fin.eof())
+    static const int MAXFIELD = 64;
+    const char * fb[MAXFIELD], * fe[MAXFIELD];
+    double num[5], fnum[MAXFIELD];
+    LineScanner in(path_);
+    while (in.next_line())
     {
-      double x, y, z, c, r;
-      if (strncmp(&(buf[0]),"ATOM",4) == 0)
+      if (!in.starts_with("ATOM")) continue;
+      
+      int nf = 0, nn = 0, k, j;
+      while (nf < MAXFIELD && in.next_field(fb[nf], fe[nf])) nf++;
+      while (nf > 0 && !is_number_start(*fb[nf-1])) nf--;
+      
+      for (k = nf-1; k > 0 && nn < 5; k--)
       {
-        sscanf(&(buf[iCoord]), "%lf %lf %lf %lf %lf", &x, &y, &z, &c, &r);
-        // read in as centers that specifies dielectric boundary
-        if (string(buf).find(" CEN ") != string::npos)
-        {
-          cgRadii_.push_back(r);
-          cgCenters_.push_back(Pt(x,y,z));
-        }
-        
-        // read in as atoms
-        else
-        {
-          atomCenters_.push_back(Pt(x,y,z));
-          charges_.push_back(c);
-          atomRadii_.push_back(r);
-          centerGeo_ = centerGeo_ + Pt(x,y,z);
-        }
+        int nfn = 0;
+        const char * c = fb[k];
+        while (c != NULL && c < fe[k] && nfn < MAXFIELD)
+          c = LineScanner::scan_double(c, fe[k], fnum[nfn++]);
+        if (c != fe[k]) break;
+        for (j = nfn-1; j >= 0 && nn < 5; j--) num[4 - nn++] = fnum[j];
+      }
+      if (nn < 5) in.fail("expected x y z charge radius, found \"" +
+                          in.get_line() + "\"");
+      double x = num[0], y = num[1], z = num[2], c = num[3], r = num[4];
+      
+      bool cen = false;
+      for (j = 1; j <= k && !cen; j++)
+        cen = (fe[j] - fb[j] == 3 && strncmp(fb[j], "CEN", 3) == 0);
+      
+      // read in as centers that specifies dielectric boundary
+      if (cen)
+      {
+        cgRadii_.push_back(r);
+        cgCenters_.push_back(Pt(x,y,z));
+      }
+      
+      // read in as atoms
+      else
+      {
+        atomCenters_.push_back(Pt(x,y,z));
+        charges_.push_back(c);
+        atomRadii_.push_back(r);
+        centerGeo_ = centerGeo_ + Pt(x,y,z);
       }
-      fin.getline(buf,599);
     }
     Nc_ = (int) atomCenters_.size();
     Ns_ = (int) cgCenters_.size();
@@ -337,13 +611,13 @@ public:
   }
   
   const string get_path() const             { return path_; }
-  vector<Pt> get_atom_pts() const           { return atomCenters_; }
-  const vector<double> get_charges() const  { return charges_; }
-  const vector<double> get_radii() const    { return atomRadii_; }
-  const int get_Nc() const                  { return Nc_; }
-  const int get_Ns() const                  { return Ns_; }
-  const vector<double> get_cg_radii() const { return cgRadii_; }
-  vector<Pt> get_cg_centers() const         { return cgCenters_; }
+  const vector<Pt> & get_atom_pts() const     { return atomCenters_; }
+  const vector<double> & get_charges() const  { return charges_; }
+  const vector<double> & get_radii() const    { return atomRadii_; }
+  const int get_Nc() const                    { return Nc_; }
+  const int get_Ns() const                    { return Ns_; }
+  const vector<double> & get_cg_radii() const { return cgRadii_; }
+  const vector<Pt> & get_cg_centers() const   { return cgCenters_; }
   const Pt get_center_geo() const           { return centerGeo_; }
   
 };
@@ -369,18 +643,15 @@ public:
   
   XYZFile() { }
   
+  // one x y z per line for the first nmols (non-blank) lines
   void read()
   {
     int ctr = 0;
-    string s;
-    double x,y,z;
-    ifstream fin (path_.c_str());
-    if (!fin.is_open()) throw CouldNotReadException(path_);
-    
-    while ( getline( fin, s ) && (ctr < nmols_))
+    LineScanner in(path_);
+    while ((ctr < nmols_) && in.next_line())
     {
-      istringstream ss( s );
-      ss >> x >> y >> z;
+      if (in.blank()) continue;
+      double x = in.read_double(), y = in.read_double(), z = in.read_double();
       pts_.push_back(Pt(x, y, z));
       ctr++;
     }
@@ -389,7 +660,8 @@ public:
   
   const string get_path() const     { return path_; }
   const int get_nmols() const       { return nmols_; }
-  vector<Pt> get_pts() const        { return pts_; }
+  const vector<Pt> & get_pts() const  { return pts_; }
+  Pt get_pt(int j) const              { return pts_[j]; }
 };
 
 /*
@@ -406,7 +678,7 @@ protected:
   {
     int ps = p_*p_;
     int pq = ps*ps;
-    ifstream fin(path_.c_str());
+    ifstream fin(path_.c_str(), ios::binary);
     if (!fin.is_open()) throw CouldNotReadException(path_);
     
     // read pole order
@@ -415,16 +687,14 @@ protected:
     if( p < p_ ) throw TooFewPolesException(p, p_);
     // read mat
     else if(p == p_)
-      for(int h = 0; h<pq; h++)
-        fin.read( reinterpret_cast<char*>(&mat_[h]), sizeof(double));
+      fin.read( reinterpret_cast<char*>(&mat_[0]), pq*sizeof(double));
     else
     {
       streamsize skipsize = ( p*p - ps )*sizeof(double);
       
       for(int j=0; j<ps; j++)
       {
-        for(int h = 0; h<ps; h++)
-          fin.read( reinterpret_cast<char*>(&mat_[h+j*ps]), sizeof(double));
+        fin.read( reinterpret_cast<char*>(&mat_[j*ps]), ps*sizeof(double));
         fin.seekg( skipsize, ios::cur);
       }   
     }
@@ -518,7 +788,7 @@ public:
   HFFile(string path, int p)
   :path_(path), p_(p), mat_(p, 2*p+1)
   {
-    vec_.reserve(p*p);
+    vec_.resize(p*p);
     read();
     convert_to_mat();
   }
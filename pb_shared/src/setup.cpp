@@ -25,6 +25,28 @@ idiel_( 4.0 ),
 sdiel_( 78.0 ),
 temp_( 298.0 ),
 npoles_( 5 ),
+mixedPrec_( -1.0 ),
+imatQuad_( "uniform" ),
+cacheDir_( "" ),
+cacheMB_( 2048.0 ),
+aFile_( "" ),
+trajFormat_( "xyz" ),
+trajDouble_( false ),
+trajThreads_( 1 ),
+potGridH_( 0.0 ),
+potGridPad_( 20.0 ),
+farGap_( 0.0 ),
+farB_( 0.0 ),
+mtsK_( 0 ),
+mtsModel_( "frozen" ),
+mtsTol_( 0.1 ),
+mtsMove_( 1.0 ),
+mtsRot_( 0.2 ),
+pairTabL_( 3 ),
+pairTabJ_( 3 ),
+pairTabNd_( 16 ),
+pairTabGap_{ 0.5, 30.0 },
+orientRand_( false ),
 srand_( (unsigned)time(NULL) ),
 nTypenCount_(2),
 typeDef_(2),
@@ -118,6 +140,27 @@ gridCt_(g2dct), //
 idiel_( int_diel ),  //
 sdiel_( solv_diel ), //
 temp_( temp ),       //
+mixedPrec_( -1.0 ),
+imatQuad_( "uniform" ),
+cacheDir_( "" ),
+cacheMB_( 2048.0 ),
+aFile_( "" ),
+trajFormat_( "xyz" ),
+trajDouble_( false ),
+trajThreads_( 1 ),
+potGridH_( 0.0 ),
+potGridPad_( 20.0 ),
+farGap_( 0.0 ),
+farB_( 0.0 ),
+mtsK_( 0 ),
+mtsModel_( "frozen" ),
+mtsTol_( 0.1 ),
+mtsMove_( 1.0 ),
+mtsRot_( 0.2 ),
+pairTabL_( 3 ),
+pairTabJ_( 3 ),
+pairTabNd_( 16 ),
+pairTabGap_{ 0.5, 30.0 },
 srand_( (unsigned)time(NULL) ),
 nTypenCount_(nmol), //
 typeDef_(nmol),
@@ -347,7 +390,11 @@ void Setup::findKeyword(vector<string> fline)
   {
     cout << "Number of poles command found" << endl;
     setNPoles( atoi(fline[1].c_str()) );
-  }else if (keyword == "termct")
+  } else if (keyword == "mixedprec")
+  {
+    cout << "Mixed precision command found" << endl;
+    setMixedPrec( atof(fline[1].c_str()) );
+  } else if (keyword == "termct")
   {
     cout << "Termination count command found" << endl;
     set_numterms(atoi(fline[1].c_str()));
@@ -515,6 +562,58 @@ void Setup::findKeyword(vector<string> fline)
   {
     cout << "sphbeta command found" << endl;
     set_sph_beta(atof(fline[1].c_str()));
+  } else if (keyword == "imatquad")
+  {
+    cout << "imatquad command found" << endl;
+    set_imat_quad(fline[1]);
+  } else if (keyword == "cachedir")
+  {
+    cout << "cachedir command found" << endl;
+    set_cache_dir(fline[1]);
+    if (fline.size() > 2) set_cache_mb(atof(fline[2].c_str()));
+  } else if (keyword == "afile")
+  {
+    cout << "afile command found" << endl;
+    set_afile(fline[1]);
+  } else if (keyword == "trajformat")
+  {
+    cout << "trajformat command found" << endl;
+    set_traj_format(fline[1]);
+    if (fline.size() > 2) set_traj_double(fline[2] == "double");
+  } else if (keyword == "trajthreads")
+  {
+    cout << "trajthreads command found" << endl;
+    set_traj_threads(max(1, atoi(fline[1].c_str())));
+  } else if (keyword == "potgrid")
+  {
+    cout << "potgrid command found" << endl;
+    set_pot_grid(atof(fline[1].c_str()),
+                 (fline.size() > 2) ? atof(fline[2].c_str()) : potGridPad_);
+  } else if (keyword == "farfield")
+  {
+    cout << "farfield command found" << endl;
+    set_far_field(atof(fline[1].c_str()),
+                  (fline.size() > 2) ? atof(fline[2].c_str()) : 0.0);
+  } else if (keyword == "mts")
+  {
+    cout << "mts command found" << endl;
+    set_multi_step(max(0, atoi(fline[1].c_str())),
+                   (fline.size() > 2) ? fline[2] : mtsModel_,
+                   (fline.size() > 3) ? atof(fline[3].c_str()) : mtsTol_,
+                   (fline.size() > 4) ? atof(fline[4].c_str()) : mtsMove_,
+                   (fline.size() > 5) ? atof(fline[5].c_str()) : mtsRot_);
+  } else if (keyword == "pairtable")
+  {
+    cout << "pairtable command found" << endl;
+    add_pair_table(fline[1],
+                   (fline.size() > 2) ? atoi(fline[2].c_str()) - 1 : 0,
+                   (fline.size() > 3) ? atoi(fline[3].c_str()) - 1 : 0);
+  } else if (keyword == "pairtabres")
+  {
+    cout << "pairtabres command found" << endl;
+    set_pair_table_res(atoi(fline[1].c_str()), atoi(fline[2].c_str()),
+                       atoi(fline[3].c_str()), atof(fline[4].c_str()),
+                       atof(fline[5].c_str()));
   } else
     cout << "Keyword not found, read in as " << fline[0] << endl;
 }
@@ -592,6 +691,10 @@ void Setup::check_inputs()
       problems.push_back("Number of termination conditions provided is less \
                               than specified termination count");
     }
+    // the static grid replaces full solves, so there is nothing left for
+    // multiple time steps or pair tables to approximate
+    if (potGridH_ > 0 && (mtsK_ > 1 || !pairTabs_.empty()))
+      problems.push_back("potgrid cannot be combined with mts or pairtable");
   }
   if (problems.size() > 0) throw BadInputException(problems);
 }
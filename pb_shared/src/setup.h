@@ -56,6 +56,29 @@ protected:
   double  iKbT_;
   double  temp_;
   double  kappa_;
+  double  mixedPrec_;  // separation beyond which re-exp tables are float
+  string  imatQuad_;  // quadrature for IE matrices: uniform or adaptive
+  string  cacheDir_;  // directory for cached IE and self-pol, "" for none
+  double  cacheMB_;   // size limit of cacheDir_
+  string  aFile_;     // prefix of saved A and grad(A), "" for none
+  string  trajFormat_; // BD trajectory output: xyz or pose
+  bool    trajDouble_; // pose trajectories in double rather than float
+  int     trajThreads_; // BD trajectories run at once, one per thread
+  double  potGridH_;    // spacing of static molecule potential grid, 0 off
+  double  potGridPad_;  // reach of that grid past the static molecules
+  double  farGap_;      // gap past which BD moves molecules freely, 0 off
+  double  farB_;        // b-surface for escapes in that mode, 0 for none
+  int     mtsK_;        // BD steps per full solve, 0 for every step
+  string  mtsModel_;    // forces between full solves: frozen or linear
+  double  mtsTol_;      // force drift past which mtsK_ is cut
+  double  mtsMove_;     // translation that forces a full solve
+  double  mtsRot_;      // rotation (radians) that forces a full solve
+  vector<string> pairTabs_;   // pair table files
+  vector<vector<int> > pairTabTypes_;  // the two types of each, from 0
+  int     pairTabL_;     // degree in direction of a built table
+  int     pairTabJ_;     // degree in relative orientation
+  int     pairTabNd_;    // distances
+  double  pairTabGap_[2];  // range of gaps between bounding spheres
   bool    orientRand_; // flag for creating random orientations for mols
 
   // make spheres settings:
@@ -122,6 +145,45 @@ protected:
   void setBoxl( double boxl )         { blen_ = boxl; }
   void setMaxTime( int maxt )         { maxtime_ = maxt; }
   void setKappa( double kappa )       { kappa_ = kappa; }
+  void setMixedPrec( double dist )    { mixedPrec_ = dist; }
+  void set_imat_quad( string quad )   { imatQuad_ = quad; }
+  void set_cache_mb( double mb )      { cacheMB_ = mb; }
+  void set_afile( string prefix )     { aFile_ = prefix; }
+  void set_traj_format( string fmt )  { trajFormat_ = fmt; }
+  void set_traj_double( bool dbl )    { trajDouble_ = dbl; }
+  void set_traj_threads( int nthr )   { trajThreads_ = nthr; }
+  void set_pot_grid( double h, double pad )
+  {
+    potGridH_ = h;
+    potGridPad_ = pad;
+  }
+  void set_far_field( double gap, double b )
+  {
+    farGap_ = gap;
+    farB_ = b;
+  }
+  void set_multi_step( int k, string model, double tol, double move,
+                       double rot )
+  {
+    mtsK_ = k;
+    mtsModel_ = model;
+    mtsTol_ = tol;
+    mtsMove_ = move;
+    mtsRot_ = rot;
+  }
+  void add_pair_table( string path, int typeA, int typeB )
+  {
+    pairTabs_.push_back(path);
+    pairTabTypes_.push_back(vector<int> {typeA, typeB});
+  }
+  void set_pair_table_res( int L, int J, int nd, double gmin, double gmax )
+  {
+    pairTabL_ = L;
+    pairTabJ_ = J;
+    pairTabNd_ = nd;
+    pairTabGap_[0] = gmin;
+    pairTabGap_[1] = gmax;
+  }
   void set_tol_sp(double tolsp)       { tolSP_ = tolsp; }
   void set_sph_beta(double sphbeta)   { sphBeta_ = sphbeta; }
   void set_n_trials(int n)            { nTrials_ = n; }
@@ -213,6 +275,15 @@ public:
   // APBS PBSAM  
   void apbs_pbsam_set(vector<string> surffil, vector<string> imatfil,
                       vector<string> expfil);
+  // command line
+  void set_cache_dir( string dir )    { cacheDir_ = dir; }
+  // from MPI rank 0, so that every rank runs the same system
+  void set_rand_seed( int seed )      { srand_ = seed; }
+  void set_precomputed( int type, string imat, string exp )
+  {
+    imatNames_[type] = imat;
+    expNames_[type] = exp;
+  }
 
   // electrostatics
   string getDXoutName(  )         { return potOutfnames_[0];}
@@ -261,6 +332,31 @@ public:
   double getDtr( int n )           { return typeDiff_[n][0]; }
   double getDrot( int n )          { return typeDiff_[n][1]; }
   double getKappa()                { return kappa_; }
+  double getMixedPrec()            { return mixedPrec_; }
+  string get_imat_quad()           { return imatQuad_; }
+  string get_cache_dir()           { return cacheDir_; }
+  double get_cache_mb()            { return cacheMB_; }
+  string get_afile()               { return aFile_; }
+  string get_traj_format()         { return trajFormat_; }
+  bool get_traj_double()           { return trajDouble_; }
+  int get_traj_threads()           { return trajThreads_; }
+  double get_pot_grid_h()          { return potGridH_; }
+  double get_pot_grid_pad()        { return potGridPad_; }
+  double get_far_gap()             { return farGap_; }
+  double get_far_b()               { return farB_; }
+  int get_mts_k()                  { return mtsK_; }
+  string get_mts_model()           { return mtsModel_; }
+  double get_mts_tol()             { return mtsTol_; }
+  double get_mts_move()            { return mtsMove_; }
+  double get_mts_rot()             { return mtsRot_; }
+  int get_n_pair_tab()             { return (int) pairTabs_.size(); }
+  string get_pair_tab(int i)       { return pairTabs_[i]; }
+  int get_pair_tab_type(int i, int m) { return pairTabTypes_[i][m]; }
+  int get_pair_tab_L()             { return pairTabL_; }
+  int get_pair_tab_J()             { return pairTabJ_; }
+  int get_pair_tab_nd()            { return pairTabNd_; }
+  double get_pair_tab_gap(int m)   { return pairTabGap_[m]; }
+  int getRandSeed()                { return srand_; }
   double getIKbT()                 { return iKbT_; }
   double get_tol_sp()              { return tolSP_; }
   double get_sph_beta ()           { return sphBeta_; }
@@ -291,22 +387,22 @@ class BadInputException: public exception
 {
 protected:
   vector<string> problems_;
+  string msg_;
   
 public:
   BadInputException(vector<string> problems)
   :problems_(problems)
   {
+    msg_ = "The following problems were found in your input file:\n";
+    for (int i = 0; i < problems_.size(); i++)
+    {
+      msg_ += to_string(i) + ": " + problems_[i] + "\n";
+    }
   }
   
   virtual const char* what() const throw()
   {
-    string ss;
-    ss = "The following problems were found in your input file:\n";
-    for (int i = 0; i < problems_.size(); i++)
-    {
-      ss += to_string(i) + ": " + problems_[i] + "\n";
-    }
-    return ss.c_str();
+    return msg_.c_str();
   }
 };
 
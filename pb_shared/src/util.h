@@ -46,6 +46,7 @@
 #include <unordered_map>
 #include "MyMatrix.h"
 #include "MyExpansion.h"
+#include "Philox.h"
 
 #ifdef _WIN32
   extern double drand48();
@@ -447,6 +448,64 @@ public:
     return Q;
   }
   
+  // uniformly random orientation drawn from rng instead of drand48
+  Quat chooseRandom(PhiloxStream & rng)
+  {
+    double s = rng.uniform();
+    double sig1 = sqrt(1.0-s);
+    double sig2 = sqrt(s);
+    double t1 = 2.0*rng.uniform()*M_PI;
+    double t2 = 2.0*rng.uniform()*M_PI;
+    return Quat(cos(t2)*sig2, sin(t1)*sig1, cos(t1)*sig1, sin(t2)*sig2);
+  }
+  
+  /*
+   Rotation matrix equivalent to rotate_point
+   */
+  MyMatrix<double> get_rotation_matrix()
+  {
+    double w = w_, a = a_, b = b_, c = c_;
+    MyMatrix<double> rot(3, 3);
+    rot(0, 0) = w*w + a*a - b*b - c*c;
+    rot(0, 1) = 2.0*(a*b - w*c);
+    rot(0, 2) = 2.0*(a*c + w*b);
+    rot(1, 0) = 2.0*(a*b + w*c);
+    rot(1, 1) = w*w - a*a + b*b - c*c;
+    rot(1, 2) = 2.0*(b*c - w*a);
+    rot(2, 0) = 2.0*(a*c - w*b);
+    rot(2, 1) = 2.0*(b*c + w*a);
+    rot(2, 2) = w*w - a*a - b*b + c*c;
+    return rot;
+  }
+
+  /*
+   Quaternion of a rotation matrix, the inverse of get_rotation_matrix.
+   Built from the largest of the four diagonal combinations for stability
+   */
+  static Quat from_rotation_matrix(const MyMatrix<double> & r)
+  {
+    double tr = r(0,0) + r(1,1) + r(2,2), s;
+    if (tr > 0)
+    {
+      s = 0.5 / sqrt(tr + 1.0);
+      return Quat(0.25/s, (r(2,1)-r(1,2))*s, (r(0,2)-r(2,0))*s,
+                  (r(1,0)-r(0,1))*s);
+    } else if (r(0,0) > r(1,1) && r(0,0) > r(2,2))
+    {
+      s = 2.0 * sqrt(1.0 + r(0,0) - r(1,1) - r(2,2));
+      return Quat((r(2,1)-r(1,2))/s, 0.25*s, (r(0,1)+r(1,0))/s,
+                  (r(0,2)+r(2,0))/s);
+    } else if (r(1,1) > r(2,2))
+    {
+      s = 2.0 * sqrt(1.0 + r(1,1) - r(0,0) - r(2,2));
+      return Quat((r(0,2)-r(2,0))/s, (r(0,1)+r(1,0))/s, 0.25*s,
+                  (r(1,2)+r(2,1))/s);
+    }
+    s = 2.0 * sqrt(1.0 + r(2,2) - r(0,0) - r(1,1));
+    return Quat((r(1,0)-r(0,1))/s, (r(0,2)+r(2,0))/s, (r(1,2)+r(2,1))/s,
+                0.25*s);
+  }
+
   /*
    Rotate a point with this quarternion. If the quarternion is q and the point
    is p, then this returns q*p*conj(q)
@@ -466,6 +525,32 @@ public:
 //
 };
 
+/*
+ Nodes and weights of the npts point Gauss-Legendre rule on [-1, 1]
+ */
+inline void gauss_legendre(int npts, vector<double> & x, vector<double> & w)
+{
+  x.resize(npts); w.resize(npts);
+  for (int i = 0; i < npts; i++)
+  {
+    double z = cos(M_PI * (i + 0.75) / (npts + 0.5)), z1, pp = 1.0;
+    do
+    {
+      double p1 = 1.0, p2 = 0.0, p3;
+      for (int j = 0; j < npts; j++)
+      {
+        p3 = p2; p2 = p1;
+        p1 = ((2.0*j + 1.0) * z * p2 - j * p3) / (j + 1);
+      }
+      pp = npts * (z * p1 - p2) / (z*z - 1.0);
+      z1 = z;
+      z = z1 - p1 / pp;
+    } while (fabs(z - z1) > 1e-15);
+    x[i] = z;
+    w[i] = 2.0 / ((1.0 - z*z) * pp * pp);
+  }
+}
+
 typedef complex<double> cmplx;
 typedef Point<double> Pt;
 typedef Point<cmplx> Ptx;
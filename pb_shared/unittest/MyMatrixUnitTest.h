@@ -11,6 +11,7 @@
 
 //#include "MyMatrix.h"
 #include "util.h"
+#include "ScratchArena.h"
 using namespace std;
 
 /*
@@ -171,4 +172,35 @@ TEST_F(MyMatrixUTest, exceptMult)
   ASSERT_THROW(testMat1 * testMat2, MatrixArithmeticException);
 }
 
+// scratch buffers are reused, zeroed, after a scope is released
+TEST_F(MyMatrixUTest, scratchArenaReuse)
+{
+  ScratchArena<double> arena;
+  MyMatrix<double> * first;
+  {
+    ScratchArena<double>::Scope scope(arena);
+    first = &scope.get(2, 3);
+    (*first)(1, 2) = 5.0;
+    scope.get(4, 4);
+    EXPECT_EQ(arena.get_used(), 2);
+  }
+  EXPECT_EQ(arena.get_used(), 0);
+  EXPECT_EQ(arena.get_capacity(), 2);
+  
+  {
+    ScratchArena<double>::Scope scope(arena);
+    MyMatrix<double> & again = scope.get(2, 3);
+    EXPECT_EQ(&again, first);
+    EXPECT_NEAR(again(1, 2), 0.0, preclim);
+    EXPECT_EQ(scope.get(4, 4).get_ncols(), 4);
+  }
+  
+  // a different shape in a slot resizes that buffer
+  arena.reset();
+  MyMatrix<double> & resized = arena.get(3, 3);
+  EXPECT_EQ(resized.get_nrows(), 3);
+  EXPECT_EQ(resized.get_ncols(), 3);
+  EXPECT_EQ(arena.get_capacity(), 2);
+}
+
 #endif /* MyMatrixTest_h */
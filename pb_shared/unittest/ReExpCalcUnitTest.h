@@ -176,6 +176,26 @@ TEST_F(ReExpConstUTest, checkMu)
   }
 }
 
+TEST_F(ReExpConstUTest, checkShared)
+{
+  Constants Cst;
+  auto c1 = ReExpCoeffsConstants::get_shared(Cst.get_kappa(), 25.0, nvals);
+  auto c2 = ReExpCoeffsConstants::get_shared(Cst.get_kappa(), 25.0, nvals);
+  auto c3 = ReExpCoeffsConstants::get_shared(0.0, 25.0, nvals);
+  
+  EXPECT_TRUE( c1 == c2 );
+  EXPECT_FALSE( c1 == c3 );
+  EXPECT_NEAR( c3->get_kappa(), 0.0, preclim);
+  
+  for ( int s = -nvals+1; s < nvals; s++ )
+    EXPECT_NEAR( c1->get_mu( nvals-1, s), MU9[ s+nvals], preclim);
+  
+  EXPECT_TRUE( BesselConstants::get_shared(nvals) ==
+               BesselConstants::get_shared(nvals) );
+  EXPECT_TRUE( SHCalcConstants::get_shared(nvals) ==
+               SHCalcConstants::get_shared(nvals) );
+}
+
 
 /*
  Class to test R and S
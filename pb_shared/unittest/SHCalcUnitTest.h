@@ -10,6 +10,8 @@
 #define SHCalcUnitTest_h
 
 #include "SHCalc.h"
+#include "P2MKernel.h"
+#include "WignerRotation.h"
 
 /*
  Class for unit testing spherical harmonics constants
@@ -173,4 +175,148 @@ TEST_F(SHCalcUTest, sphHarm_t05p05)
 
 
 
+// compiled order (10) and generic fallback (13) must agree
+TEST_F(SHCalcUTest, sphHarmFixedVsGeneric)
+{
+  shared_ptr<SHCalcConstants> _SHConst10_ = make_shared<SHCalcConstants> (10);
+  shared_ptr<SHCalcConstants> _SHConst13_ = make_shared<SHCalcConstants> (13);
+  SHCalc SHCalc10(10, _SHConst10_);
+  SHCalc SHCalc13(13, _SHConst13_);
+  SHCalc10.calc_sh( 2.1, -0.7 );
+  SHCalc13.calc_sh( 2.1, -0.7 );
+  
+  for (int n = 0; n < 10; n++)
+  {
+    for (int m = -n; m <= n; m++)
+    {
+      EXPECT_NEAR( SHCalc10.get_result(n, m).real(),
+                   SHCalc13.get_result(n, m).real(), preclim);
+      EXPECT_NEAR( SHCalc10.get_result(n, m).imag(),
+                   SHCalc13.get_result(n, m).imag(), preclim);
+    }
+  }
+}
+
+TEST_F(SHCalcUTest, sphHarmWorkspace)
+{
+  shared_ptr<SHCalcConstants> _SHConst_ = make_shared<SHCalcConstants> (10);
+  SHCalc SHCalcu(10, _SHConst_);
+  SHWorkspace ws1 = SHCalcu.make_workspace();
+  SHWorkspace ws2 = SHCalcu.make_workspace();
+  
+  // workspace evaluations must not disturb each other or the calculator
+  SHCalcu.calc_sh( 0.5, 0.5 );
+  SHCalcu.calc_sh( 2.1, -0.7, ws1 );
+  SHCalcu.calc_sh( 0.5, 0.5, ws2 );
+  
+  for (int n = 0; n < 10; n++)
+  {
+    for (int m = -n; m <= n; m++)
+    {
+      EXPECT_NEAR( ws2.get_result(n, m).real(),
+                   SHCalcu.get_result(n, m).real(), preclim);
+      EXPECT_NEAR( ws2.get_result(n, m).imag(),
+                   SHCalcu.get_result(n, m).imag(), preclim);
+    }
+  }
+  
+  SHCalcu.calc_sh( 2.1, -0.7 );
+  for (int n = 0; n < 10; n++)
+  {
+    for (int m = -n; m <= n; m++)
+    {
+      EXPECT_NEAR( ws1.get_result(n, m).real(),
+                   SHCalcu.get_result(n, m).real(), preclim);
+      EXPECT_NEAR( ws1.get_result(n, m).imag(),
+                   SHCalcu.get_result(n, m).imag(), preclim);
+    }
+  }
+}
+
+TEST_F(SHCalcUTest, p2mBatchVsDirect)
+{
+  int p = 8, nch = 600;
+  shared_ptr<SHCalcConstants> _SHConst_ = make_shared<SHCalcConstants> (2*p);
+  shared_ptr<SHCalc> SHCalcu = make_shared<SHCalc>(2*p, _SHConst_);
+  SHWorkspace ws = SHCalcu->make_workspace();
+  vector<double> a = {2.5, 4.0};
+  
+  // enough charges on the first center to span several blocks
+  P2MBatch batch;
+  for (int c = 0; c < nch; c++)
+  {
+    int k = (c < 2*nch/3) ? 0 : 1;
+    batch.add(k, 3.0*sin(0.37*c), 2.0*cos(1.1*c), 1.5*sin(0.05*c+0.4),
+              (c % 3) - 1.0 + 0.25);
+  }
+  
+  for (int rad = 0; rad < 2; rad++)
+  {
+    P2MKernel::Radial type = (rad == 0) ? P2MKernel::REGULAR :
+                                          P2MKernel::IRREGULAR;
+    vector<MyMatrix<cmplx> > out(2, MyMatrix<cmplx>(p, 2*p+1));
+    P2MKernel::accumulate(batch, a, type, 0.25, p, SHCalcu, out);
+    
+    vector<MyMatrix<cmplx> > ref(2, MyMatrix<cmplx>(p, 2*p+1));
+    for (int c = 0; c < nch; c++)
+    {
+      int k = batch.exp_[c];
+      Pt pos(batch.x_[c], batch.y_[c], batch.z_[c]);
+      SHCalcu->calc_sh(pos.theta(), pos.phi(), ws);
+      for (int n = 0; n < p; n++)
+        for (int m = -n; m <= n; m++)
+        {
+          double rad_fac = (type == P2MKernel::REGULAR) ?
+                           pow(pos.r()/a[k], n) : pow(a[k]/pos.r(), n)/pos.r();
+          ref[k](n, m+p) += ws.get_result(n, m) * 0.25 * batch.q_[c] * rad_fac;
+        }
+    }
+    
+    for (int k = 0; k < 2; k++)
+      for (int n = 0; n < p; n++)
+        for (int m = -n; m <= n; m++)
+        {
+          EXPECT_NEAR(out[k](n, m+p).real(), ref[k](n, m+p).real(), preclim);
+          EXPECT_NEAR(out[k](n, m+p).imag(), ref[k](n, m+p).imag(), preclim);
+        }
+  }
+}
+
+TEST_F(SHCalcUTest, wignerRotation)
+{
+  int p = 10, nch = 40;
+  shared_ptr<SHCalcConstants> _SHConst_ = make_shared<SHCalcConstants> (2*p);
+  shared_ptr<SHCalc> SHCalcu = make_shared<SHCalc>(2*p, _SHConst_);
+  vector<double> a = {3.0};
+  
+  vector<Quat> rots = {Quat(0.7, Pt(0.3, -1.2, 0.5)), Quat(2.9, Pt(1, 0, 0)),
+                       Quat(0.0, Pt(0, 0, 1)), Quat(M_PI, Pt(0, 1, 0)),
+                       Quat(1.3, Pt(0, 0, -1))};
+  for (int r = 0; r < rots.size(); r++)
+  {
+    MyMatrix<double> rot = rots[r].get_rotation_matrix();
+    P2MBatch orig, moved;
+    for (int c = 0; c < nch; c++)
+    {
+      Pt pt(2.0*sin(0.9*c), 1.5*cos(0.4*c+1.0), 2.2*sin(0.3*c+0.2));
+      Pt rpt = rots[r].rotate_point(pt);
+      orig.add(0, pt.x(), pt.y(), pt.z(), 0.5 - (c % 2));
+      moved.add(0, rpt.x(), rpt.y(), rpt.z(), 0.5 - (c % 2));
+    }
+    
+    vector<MyMatrix<cmplx> > E0(1, MyMatrix<cmplx>(p, 2*p+1)), E1 = E0;
+    MyMatrix<cmplx> Erot(p, 2*p+1);
+    P2MKernel::accumulate(orig, a, P2MKernel::REGULAR, 1.0, p, SHCalcu, E0);
+    P2MKernel::accumulate(moved, a, P2MKernel::REGULAR, 1.0, p, SHCalcu, E1);
+    WignerRotation(rot, p).rotate(E0[0], Erot);
+    
+    for (int n = 0; n < p; n++)
+      for (int m = -n; m <= n; m++)
+      {
+        EXPECT_NEAR(Erot(n, m+p).real(), E1[0](n, m+p).real(), preclim);
+        EXPECT_NEAR(Erot(n, m+p).imag(), E1[0](n, m+p).imag(), preclim);
+      }
+  }
+}
+
 #endif
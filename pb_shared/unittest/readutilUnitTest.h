@@ -10,6 +10,7 @@
 #define readutilUnitTest_h
 
 #include "readutil.h"
+#include "ExpansionFile.h"
 
 /* Class to test opening PQR and XYZ files */
 class ReadUtilUTest : public ::testing::Test
@@ -265,9 +266,10 @@ TEST_F(ReadUtilUTest, readPQRCen)
   ct = 0;
   for (int i=0; i < PQRtest.get_Nc(); i+=100)
   {
-    EXPECT_NEAR( at_x[ct], PQRtest.get_atom_pts()[i].x(), preclim);
-    EXPECT_NEAR( at_y[ct], PQRtest.get_atom_pts()[i].y(), preclim);
-    EXPECT_NEAR( at_z[ct], PQRtest.get_atom_pts()[i].z(), preclim);
+    Pt at = PQRtest.get_atom_pts()[i];
+    EXPECT_NEAR( at_x[ct], at.x(), preclim);
+    EXPECT_NEAR( at_y[ct], at.y(), preclim);
+    EXPECT_NEAR( at_z[ct], at.z(), preclim);
     EXPECT_NEAR( at_c[ct], PQRtest.get_charges()[i], preclim);
     EXPECT_NEAR( at_r[ct], PQRtest.get_radii()[i], preclim);
     ct++;
@@ -317,6 +319,95 @@ TEST_F(ReadUtilUTest, readXYZ)
   ASSERT_EQ( xyz, XYZtest.get_path());
 }
 
+// numbers are read as strtod reads them
+TEST_F(ReadUtilUTest, parseNumbers)
+{
+  vector<string> nums = {"0", "-0.0", "12.609", "-1.888", "+3.", ".5",
+    "0.4119", "1e-3", "-2.5E+4", "7.0271", "123456789.123456789",
+    "0.1000000000000000055511151231257827", "1e300", "4.9e-324", "33.067"};
+  for (int i = 0; i < nums.size(); i++)
+  {
+    double v;
+    const char * b = nums[i].c_str();
+    ASSERT_TRUE( LineScanner::parse_double(b, b + nums[i].size(), v));
+    EXPECT_EQ( strtod(b, NULL), v);
+  }
+  
+  vector<string> bad = {"", "-", ".", "CEN", "1.2x", "e5", "1e"};
+  for (int i = 0; i < bad.size(); i++)
+  {
+    double v;
+    const char * b = bad[i].c_str();
+    EXPECT_FALSE( LineScanner::parse_double(b, b + bad[i].size(), v));
+  }
+}
+
+// columns missing, run together or trailing, CRLF and no final newline
+TEST_F(ReadUtilUTest, readPQRColumns)
+{
+  string path = test_dir_loc + "columns_tmp.pqr";
+  {
+    ofstream fout(path.c_str(), ios::binary);
+    fout << "REMARK  made up\r\n";
+    fout << "ATOM      1  N   MET A   1      12.609   3.211   1.550  0.1592 1.8240\r\n";
+    fout << "ATOM    917  CA  GLY D  65      28.112 33.067-10.026  -0.0252 1.9080  C\r\n";
+    fout << "ATOM   1     X   CEN             0.0     0.0     0.0      0.0    1.0000\r\n";
+    fout << "ATOM      2  C   CHG A0         -9.500  22.900  -8.700 -1.0000  3.7300";
+  }
+  PQRFile pqr(path);
+  remove(path.c_str());
+  vector<Pt> at = pqr.get_atom_pts();
+  
+  ASSERT_EQ( 3, pqr.get_Nc());
+  ASSERT_EQ( 1, pqr.get_Ns());
+  EXPECT_EQ( 12.609, at[0].x());
+  EXPECT_EQ( 1.8240, pqr.get_radii()[0]);
+  EXPECT_EQ( 33.067, at[1].y());
+  EXPECT_EQ( -10.026, at[1].z());
+  EXPECT_EQ( -0.0252, pqr.get_charges()[1]);
+  EXPECT_EQ( 1.9080, pqr.get_radii()[1]);
+  EXPECT_EQ( 1.0, pqr.get_cg_radii()[0]);
+  EXPECT_EQ( -8.7, at[2].z());
+  EXPECT_EQ( 3.73, pqr.get_radii()[2]);
+}
+
+TEST_F(ReadUtilUTest, checkParseErrorLine)
+{
+  string path = test_dir_loc + "bad_tmp.pqr";
+  {
+    ofstream fout(path.c_str());
+    fout << "ATOM      1  N   MET     1      12.609   3.211   1.550  0.1592 1.8240\n";
+    fout << "\n";
+    fout << "ATOM      2  CA  MET     1      12.589   4.6?1   1.254  0.0221 1.9080\n";
+  }
+  try
+  {
+    PQRFile pqr(path);
+    FAIL();
+  }
+  catch( const ParseException& err )
+  {
+    EXPECT_EQ( 0, string(err.what()).find(path + ":3: "));
+  }
+  
+  {
+    ofstream fout(path.c_str());
+    fout << "1.0 2.0 3.0\n";
+    fout << "4.0 5.0\n";
+  }
+  try
+  {
+    XYZFile xyz(path, 2);
+    FAIL();
+  }
+  catch( const ParseException& err )
+  {
+    EXPECT_EQ( path + ":2: expected a number, found end of line",
+              string(err.what()));
+  }
+  remove(path.c_str());
+}
+
 TEST_F(ReadUtilUTest, readIFile)
 {
   int p(3), ct;
@@ -373,4 +464,52 @@ TEST_F(ReadUtilUTest, readHFFile)
 }
 
 
+TEST_F(ReadUtilUTest, binaryExpansionFile)
+{
+  int p(3), ns(17);
+  string start = test_dir_loc + "spol_test/test_0.00_p3.0.";
+  string fil = test_dir_loc + "spol_test/test_conv.bexp";
+  vector<string> files;
+  for (int i = 0; i < ns; i++) files.push_back(start+to_string(i)+".H.exp");
+  ExpansionFile::convert_text(files, fil);
+  
+  ExpansionFile bin(fil);
+  ASSERT_EQ( p, bin.get_p());
+  ASSERT_EQ( ns, bin.get_n());
+  EXPECT_NEAR( 1000, bin.get_rcut(), preclim);
+  for (int i = 0; i < ns; i++)
+  {
+    HFFile htest(files[i], p);
+    MyMatrix<cmplx> mat = bin.get_mat(i, p), lo = bin.get_mat(i, p-1),
+                    hi = bin.get_mat(i, p+1);
+    for (int n = 0; n < p; n++)
+      for (int m = -n; m <= n; m++)
+      {
+        EXPECT_EQ( htest.get_mat_nm(n, m), mat(n, m+p));
+        EXPECT_EQ( htest.get_mat_nm(n, m), hi(n, m+p+1));
+        if (n < p-1) EXPECT_EQ( htest.get_mat_nm(n, m), lo(n, m+p-1));
+      }
+    for (int m = -p; m <= p; m++) EXPECT_EQ( cmplx(0.0), hi(p, m+p+1));
+  }
+  
+  // damaged data
+  {
+    fstream f(fil.c_str(), ios::in | ios::out | ios::binary);
+    f.seekp(100);
+    f.put('x');
+  }
+  EXPECT_THROW( ExpansionFile bad(fil), BadExpansionFileException);
+  remove(fil.c_str());
+  
+  // written through a temporary file, which is not left behind
+  EXPECT_FALSE( ifstream((fil + ".tmp").c_str()).good());
+  EXPECT_THROW( ExpansionFile::convert_text(files, test_dir_loc +
+                                            "no_such_dir/test.bexp"),
+               CouldNotWriteException);
+  files.push_back(start + "missing.H.exp");
+  EXPECT_THROW( ExpansionFile::convert_text(files, fil),
+               CouldNotReadException);
+  EXPECT_FALSE( ifstream(fil.c_str()).good());
+}
+
 #endif /* readutilUnitTest_h */
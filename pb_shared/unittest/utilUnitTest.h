@@ -10,6 +10,11 @@
 #define utilUnitTest_h
 
 #include "util.h"
+#include "PointSoA.h"
+#include "PrecomputeCache.h"
+#include "AsyncOutput.h"
+#include "BDFarm.h"
+#include "FreeDiffusion.h"
 
 /*
  Class for testing euclidean points
@@ -228,4 +233,324 @@ TEST_F(QuatUTest, Rotate) // test for rotate_point
   EXPECT_NEAR( test3.z()/-1.26854099, 1, preclim);
 }
 
+class PointSoAUTest : public ::testing::Test
+{
+protected :
+  virtual void SetUp() {}
+  virtual void TearDown() {}
+};
+
+TEST_F(PointSoAUTest, rotateMatchesQuat)
+{
+  Quaternion qrot( 2.8, Point<double>(7.6, 1.8, 11.2));
+  MyMatrix<double> rot = qrot.get_rotation_matrix();
+  vector<Pt> pts = { Pt(0.5, 5.0, 100.4), Pt(20.3, 0.0, -50.4),
+                     Pt(0.0, 0.0, 0.0), Pt(0.0, 0.0, -3.0) };
+  PointSoA soa(pts);
+  soa.rotate(rot);
+  soa.translate(Pt(1.0, -2.0, 0.5));
+  
+  for (int i = 0; i < pts.size(); i++)
+  {
+    Pt ref = qrot.rotate_point(pts[i]) + Pt(1.0, -2.0, 0.5);
+    EXPECT_NEAR( ref.x(), soa.x(i), 1e-10);
+    EXPECT_NEAR( ref.y(), soa.y(i), 1e-10);
+    EXPECT_NEAR( ref.z(), soa.z(i), 1e-10);
+  }
+}
+
+TEST_F(PointSoAUTest, sphericalCache)
+{
+  vector<Pt> pts = { Pt(0.5, 5.0, 100.4), Pt(-20.3, 0.0, -50.4),
+                     Pt(0.0, 0.0, 0.0), Pt(0.0, 0.0, -3.0) };
+  PointSoA soa(pts);
+  for (int i = 0; i < pts.size(); i++)
+  {
+    Pt sph = soa.get_sph(i);
+    EXPECT_EQ( pts[i].r(), sph.r());
+    EXPECT_EQ( pts[i].theta(), sph.theta());
+    EXPECT_EQ( pts[i].phi(), sph.phi());
+  }
+  
+  // cache is refreshed after a move
+  soa.set(1, Pt(0.0, 2.0, 0.0));
+  EXPECT_NEAR( 2.0, soa.get_sph(1).r(), preclim);
+  EXPECT_NEAR( M_PI/2, soa.get_sph(1).theta(), preclim);
+  EXPECT_NEAR( M_PI/2, soa.get_sph(1).phi(), preclim);
+  
+  PointSoA cpy(soa);
+  cpy.translate(Pt(0.0, 0.0, 1.0));
+  EXPECT_NEAR( 101.4, cpy.get_sph(0).r() * cos(cpy.get_sph(0).theta()),
+              preclim);
+  EXPECT_NEAR( 100.4, soa.get_sph(0).r() * cos(soa.get_sph(0).theta()),
+              preclim);
+}
+
+class PrecomputeCacheUTest : public ::testing::Test
+{
+protected :
+  virtual void SetUp() { }
+  virtual void TearDown() { }
+  
+  void write_file(string path, int nbytes)
+  {
+    ofstream fout(path.c_str(), ios::binary);
+    fout << string(nbytes, 'x');
+  }
+};
+
+TEST_F(PrecomputeCacheUTest, keyRoundOff)
+{
+  CacheKey a, b, c;
+  a.add(3); a.add(string("imat")); a.add(1.25);
+  b.add(3); b.add(string("imat")); b.add(1.25 + 1e-12);
+  c.add(3); c.add(string("imat")); c.add(1.25 + 1e-4);
+  EXPECT_EQ( a.str(), b.str());
+  EXPECT_NE( a.str(), c.str());
+  EXPECT_EQ( 32, a.str().size());
+  
+  // computed data is hashed exactly
+  double v[2] = {1.25, 0.5}, w[2] = {1.25, 0.5 + 1e-12};
+  CacheKey d, e, f;
+  d.add(v, 2); e.add(v, 2); f.add(w, 2);
+  EXPECT_EQ( d.str(), e.str());
+  EXPECT_NE( d.str(), f.str());
+}
+
+TEST_F(PrecomputeCacheUTest, commitLookupEvict)
+{
+  string dir = test_dir_loc + "cache_test";
+  PrecomputeCache off("");
+  EXPECT_FALSE( off.enabled());
+  EXPECT_EQ( "", off.lookup("a"));
+  
+  // limit of 1.5 entries of 1 kB
+  PrecomputeCache cache(dir, 1.5/1024.0);
+  ASSERT_TRUE( cache.enabled());
+  EXPECT_EQ( "", cache.lookup("a"));
+  
+  string tmp = cache.begin_entry("a");
+  ASSERT_NE( "", tmp);
+  write_file(tmp + "/data", 1024);
+  EXPECT_EQ( "", cache.lookup("a")); // not visible until committed
+  cache.commit_entry("a", tmp);
+  EXPECT_EQ( dir + "/a", cache.lookup("a"));
+  
+  // a second job publishing the same entry loses, the first is kept
+  string dup = cache.begin_entry("a");
+  write_file(dup + "/data", 10);
+  cache.commit_entry("a", dup);
+  ifstream fin((dir + "/a/data").c_str(), ios::binary | ios::ate);
+  EXPECT_EQ( 1024, (int) fin.tellg());
+  
+  // the new entry pushes the older one out
+  tmp = cache.begin_entry("b");
+  write_file(tmp + "/data", 1024);
+  cache.commit_entry("b", tmp);
+  EXPECT_EQ( "", cache.lookup("a"));
+  EXPECT_EQ( dir + "/b", cache.lookup("b"));
+  
+  cache.discard(dir + "/b");
+  EXPECT_EQ( "", cache.lookup("b"));
+  rmdir(dir.c_str());
+}
+
+class AsyncOutputUTest : public ::testing::Test
+{
+protected :
+  virtual void SetUp() { }
+  virtual void TearDown() { }
+};
+
+// jobs run in the order posted, and a small ring only holds back the poster
+TEST_F(AsyncOutputUTest, orderAndFlush)
+{
+  vector<int> done;
+  {
+    AsyncOutput io(3);
+    EXPECT_EQ( 3, io.get_capacity());
+    for (int k = 0; k < 500; k++)
+    {
+      io.post([&done, k] () { done.push_back(k); });
+      EXPECT_LE( io.get_pending(), 3);
+    }
+    io.flush();
+    EXPECT_EQ( 0, io.get_pending());
+    ASSERT_EQ( 500, done.size());
+    
+    io.post([&done] () { throw runtime_error("bad job"); });
+    io.post([&done] () { done.push_back(-1); });
+  }
+  
+  // destructor runs what is left, failing jobs do not stop the rest
+  ASSERT_EQ( 501, done.size());
+  for (int k = 0; k < 500; k++) EXPECT_EQ( k, done[k]);
+  EXPECT_EQ( -1, done[500]);
+}
+
+// stats come out in trajectory order even when later trajectories finish first
+TEST_F(AsyncOutputUTest, farmStatsInOrder)
+{
+  string statfile = test_dir_loc + "farm_tmp.stat";
+  remove(statfile.c_str());
+  int ntraj = 9;
+  vector<int> ran(ntraj, 0);
+  
+  BDFarm farm(4, ntraj, statfile);
+  EXPECT_EQ( 4, farm.get_nthreads());
+  farm.run([&ran] (int w) -> BDFarm::TrajFn
+  {
+    return [&ran, w] (int traj) -> vector<string>
+    {
+      ran[traj]++;
+      this_thread::sleep_for(chrono::milliseconds(2*((traj+1)%3)));
+      return vector<string>(2, to_string(traj));
+    };
+  });
+  
+  ifstream in(statfile.c_str());
+  string line;
+  for (int k = 0; k < 2*ntraj; k++)
+  {
+    ASSERT_TRUE( getline(in, line));
+    EXPECT_EQ( to_string(k/2), line);
+    EXPECT_EQ( 1, ran[k/2]);
+  }
+  EXPECT_FALSE( getline(in, line));
+  remove(statfile.c_str());
+  
+  BDFarm bad(2, ntraj, "");
+  EXPECT_THROW( bad.run([] (int w) -> BDFarm::TrajFn
+  {
+    return [] (int traj) -> vector<string>
+    {
+      if (traj == 3) throw runtime_error("bad trajectory");
+      return vector<string>();
+    };
+  }), runtime_error);
+}
+
+// without mpirun a run is one rank, and files pass through unchanged
+TEST_F(AsyncOutputUTest, mpiShardOneRank)
+{
+  EXPECT_EQ( 0, MPIShard::rank());
+  EXPECT_EQ( 1, MPIShard::size());
+  
+  string path = test_dir_loc + "shard_tmp.bin";
+  string bytes("imat\0\x01\xff\n", 8);
+  MPIShard::write_file(path, bytes);
+  string back = MPIShard::read_file(path);
+  MPIShard::bcast(back);
+  EXPECT_EQ( bytes, back);
+  remove(path.c_str());
+  
+  map<int, vector<string> > stats;
+  stats[2] = vector<string>(1, "done");
+  MPIShard::gather(stats);
+  ASSERT_EQ( 1, stats.size());
+  EXPECT_EQ( "done", stats[2][0]);
+  
+  MPIShard::Counter counter;
+  EXPECT_EQ( 0, counter.next());
+  EXPECT_EQ( 1, counter.next());
+}
+
+
+/*
+ Class for testing counter-based random numbers
+ */
+class PhiloxUTest : public ::testing::Test
+{
+public :
+protected :
+  virtual void SetUp() {}
+  virtual void TearDown() {}
+};
+
+// known answers of Philox-4x32-10 from the Random123 distribution
+TEST_F(PhiloxUTest, knownAnswers)
+{
+  Philox::Ctr w = Philox::block({{0, 0, 0, 0}}, {{0, 0}});
+  EXPECT_EQ( 0x6627e8d5u, w[0]);
+  EXPECT_EQ( 0xe169c58du, w[1]);
+  EXPECT_EQ( 0xbc57ac4cu, w[2]);
+  EXPECT_EQ( 0x9b00dbd8u, w[3]);
+  
+  w = Philox::block({{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}},
+                    {{0xffffffff, 0xffffffff}});
+  EXPECT_EQ( 0x408f276du, w[0]);
+  EXPECT_EQ( 0x41c83b0eu, w[1]);
+  EXPECT_EQ( 0xa20bc7c6u, w[2]);
+  EXPECT_EQ( 0x6d5451fdu, w[3]);
+  
+  w = Philox::block({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}},
+                    {{0xa4093822, 0x299f31d0}});
+  EXPECT_EQ( 0xd16cfe09u, w[0]);
+  EXPECT_EQ( 0x94fdccebu, w[1]);
+  EXPECT_EQ( 0x5001e420u, w[2]);
+  EXPECT_EQ( 0x24126ea1u, w[3]);
+}
+
+// normal j does not depend on how many are drawn, and they are N(0,1)
+TEST_F(PhiloxUTest, gaussiansBySlot)
+{
+  int n = 20001;
+  vector<double> all(n), few(5);
+  Philox::gaussians({{7, 3}}, 12, 0, 0, &all[0], n);
+  Philox::gaussians({{7, 3}}, 12, 0, 0, &few[0], 5);
+  for (int j = 0; j < 5; j++) EXPECT_EQ( all[j], few[j]);
+  
+  double sum(0), sum2(0);
+  for (int j = 0; j < n; j++)
+  {
+    sum += all[j];
+    sum2 += all[j]*all[j];
+  }
+  EXPECT_NEAR( 0.0, sum/n, 0.03);
+  EXPECT_NEAR( 1.0, sum2/n, 0.03);
+  
+  PhiloxStream a(7, 3), b(7, 3), c(7, 4);
+  for (int j = 0; j < 5; j++)
+  {
+    double u = a.uniform();
+    EXPECT_EQ( u, b.uniform());
+    EXPECT_NE( u, c.uniform());
+    EXPECT_TRUE( u > 0.0 && u < 1.0);
+  }
+}
+
+class FreeDiffusionUTest : public ::testing::Test
+{
+public :
+protected :
+  virtual void SetUp() {}
+  virtual void TearDown() {}
+};
+
+// moments of the far field draws against their closed forms
+TEST_F(FreeDiffusionUTest, sampleMoments)
+{
+  int n = 20000;
+  double R(12.0), D(0.3), tsum(0), rshort(0), rlong(0);
+  PhiloxStream rng(11, 2);
+  for (int j = 0; j < n; j++)
+  {
+    tsum   += FreeDiffusion::exit_time(R, D, rng.uniform());
+    rshort += FreeDiffusion::radius(R, D, 0.002*R*R/D, rng.uniform());
+    rlong  += FreeDiffusion::radius(R, D, R*R/D, rng.uniform());
+  }
+  
+  // mean exit time from the center is R^2/6D
+  EXPECT_NEAR( tsum/n / (R*R/(6*D)), 1.0, 0.02);
+  // short times are free diffusion, mean 2 sqrt(2/pi) sqrt(2Dt)
+  EXPECT_NEAR( rshort/n / (2*sqrt(2/M_PI)*sqrt(0.004)*R), 1.0, 0.02);
+  // long ones the lowest mode, r sin(pi r/R) with mean (1-4/pi^2) R
+  EXPECT_NEAR( rlong/n / ((1-4/(M_PI*M_PI))*R), 1.0, 0.02);
+  
+  EXPECT_NEAR( FreeDiffusion::exit_cdf(0.1)/0.2928996518, 1.0, 1e-9);
+  EXPECT_NEAR( FreeDiffusion::return_cos(30.0, 20.0, 1e-12), -1.0, 1e-6);
+  EXPECT_NEAR( FreeDiffusion::return_cos(30.0, 20.0, 1-1e-12), 1.0, 1e-6);
+  EXPECT_LT( 0.0, FreeDiffusion::return_cos(30.0, 20.0, 0.5));
+}
+
 #endif /* utilUnitTest_h */
@@ -7,6 +7,7 @@
 //
 
 #include "ASolver.h"
+#include "PoleKernels.h"
 
 ASolver::ASolver(shared_ptr<BesselCalc> _bcalc,
                   shared_ptr<SHCalc> _shCalc,
@@ -86,6 +87,66 @@ void ASolver::solve_gradA(double prec, int MAX_POL_ROUNDS)
   calc_gradL();
 }
 
+void ASolver::write_A(string path)
+{
+  vector<MyMatrix<cmplx> > mats(N_);
+  for (int i = 0; i < N_; i++) mats[i] = _A_->operator[](i);
+  ExpansionFile::write(path, p_, _consts_->get_kappa(), polz_cutoff_, mats);
+}
+
+// A saved with another salt or cutoff does not solve this system
+static void check_medium(const ExpansionFile & fil, double kappa, double rcut)
+{
+  if (fabs(fil.get_kappa() - kappa) > 1e-12 || fabs(fil.get_rcut() - rcut) >
+      1e-12)
+    throw BadExpansionFileException(fil.get_path(), "was saved for kappa " +
+                                    to_string(fil.get_kappa()) + ", cutoff " +
+                                    to_string(fil.get_rcut()));
+}
+
+void ASolver::read_A(string path)
+{
+  ExpansionFile fil(path);
+  check_medium(fil, _consts_->get_kappa(), polz_cutoff_);
+  if (fil.get_n() != N_)
+    throw BadExpansionFileException(path, "has " + to_string(fil.get_n()) +
+                                    " molecules, need " + to_string(N_));
+  for (int i = 0; i < N_; i++) _A_->set_val(i, fil.get_mat(i, p_));
+  copy_to_prevA(); // grad(T) A is re-expanded from the previous A
+  solvedA_ = true;
+  calc_L();
+}
+
+void ASolver::write_gradA(string path)
+{
+  vector<MyMatrix<cmplx> > mats;
+  for (int i = 0; i < N_; i++)
+    for (int j = 0; j < N_; j++)
+      for (int d = 0; d < 3; d++)
+        mats.push_back(_gradA_->operator()(i, j)[d]);
+  ExpansionFile::write(path, p_, _consts_->get_kappa(), polz_cutoff_, mats,
+                       {N_, N_, 3});
+}
+
+void ASolver::read_gradA(string path)
+{
+  ExpansionFile fil(path);
+  check_medium(fil, _consts_->get_kappa(), polz_cutoff_);
+  if (fil.get_dim(0) != N_ || fil.get_dim(1) != N_ || fil.get_dim(2) != 3)
+    throw BadExpansionFileException(path, "is not grad(A) of " +
+                                    to_string(N_) + " molecules");
+  for (int i = 0; i < N_; i++)
+    for (int j = 0; j < N_; j++)
+    {
+      VecOfMats<cmplx>::type ga_ij(3);
+      for (int d = 0; d < 3; d++) ga_ij.set_val(d, fil.get_mat(i, j, d, p_));
+      _gradA_->set_val(i, j, ga_ij);
+    }
+  // grad(L) also needs the re-expanded gradients of T, from A
+  pre_compute_gradT_A();
+  calc_gradL();
+}
+
 
 void ASolver::copy_to_prevA()
 {
@@ -118,17 +179,25 @@ void ASolver::copy_to_prevGradA(int j)
 // one iteration of numerical solution for A (eq 51 in Lotan 2006)
 void ASolver::iter()
 {
-  int i, j;
-  MyMatrix<cmplx> Z, zj, ai;
+  int i, j, n, c;
   Pt v;
   copy_to_prevA();
   bool polz(false), interact(false), prev(true);
+
+  // scratch expansions come from the thread's arena and are released
+  // when the iteration returns
+  ScratchArena<cmplx>::Scope scratch;
+  MyMatrix<cmplx> & Z  = scratch.get(p_, 2*p_ + 1);
+  MyMatrix<cmplx> & Zj = scratch.get(p_, 2*p_ + 1);
+
   for (i = 0; i <  N_; i++)
   {
     interact = false;
     polz = false;
     // relevant re-expansions:
-    Z = MyMatrix<cmplx> (p_, 2*p_ + 1);
+    for (n = 0; n < p_; n++)
+      for (c = 0; c < 2*p_ + 1; c++) Z(n, c) = 0.0;
+
     for (j = 0; j < N_; j++)
     {
       if (i == j) continue;
@@ -140,21 +209,28 @@ void ASolver::iter()
       interact = true; //TODO: figure out the polarization
       if (v.norm() > polz_cutoff_+_sys_->get_ai(i)+_sys_->get_ai(j)) continue;
 
-      zj = re_expandA(i, j, prev);
-      Z += zj;
+      re_expandA_into(i, j, Zj, prev);
+      Z += Zj;
       _sys_->add_J_to_pol_I(i,j);
       polz = true;
     }
 
+    // gamma and delta are diagonal, so A_i = gamma (delta Z + E) is
+    // formed in place
+    MyMatrix<cmplx> & ai  = _A_->operator[](i);
+    MyMatrix<cmplx> & gam = _gamma_->operator[](i);
+    MyMatrix<cmplx> & del = _delta_->operator[](i);
+    MyMatrix<cmplx> & ei  = _E_->operator[](i);
     if (polz)
     {
-      ai = _delta_->operator[](i) * Z;
-      ai += _E_->operator[](i);
-      ai = _gamma_->operator[](i) * ai;
-      _A_->set_val(i, ai);
+      for (n = 0; n < p_; n++)
+        for (c = 0; c < 2*p_ + 1; c++)
+          ai(n, c) = gam(n, n) * (del(n, n) * Z(n, c) + ei(n, c));
     } else if (interact)
     {
-      _A_->set_val(i, _gamma_->operator[](i) * _E_->operator[](i));
+      for (n = 0; n < p_; n++)
+        for (c = 0; c < 2*p_ + 1; c++)
+          ai(n, c) = gam(n, n) * ei(n, c);
     }
   }
 }
@@ -163,20 +239,27 @@ void ASolver::iter()
 void ASolver::grad_iter(int j)
 {
   // Solving for grad_j(A^(i)) by iterating through T^(i,k)
-  int i, k;
+  int i, k, d, n, c;
 
   // relevant re-expansions (g prefix means gradient):
-  VecOfMats<cmplx>::type aij, add;
-  MyMatrix<cmplx> gamma_delta;
+  VecOfMats<cmplx>::type add;
   Pt v;
   bool prev(true), polz(false), interact(false); //want to re-expand previous
   copy_to_prevGradA(j);
+
+  ScratchArena<cmplx>::Scope scratch;
+  MyMatrix<cmplx> * aij[3];
+  for (d = 0; d < 3; d++) aij[d] = &scratch.get(p_, 2*p_ + 1);
+
   for (i = 0; i < N_; i++) // MoleculeAM of interest
   {
     interact = false;
     polz = false;
-    aij = VecOfMats<cmplx>::type (3, MyMatrix<cmplx>(p_,2*p_+1));
-    aij = get_gradT_Aij(j, i);
+    const VecOfMats<cmplx>::type & gradTA = _gradT_A_->operator()(j, i);
+    for (d = 0; d < 3; d++)
+      for (n = 0; n < p_; n++)
+        for (c = 0; c < 2*p_ + 1; c++)
+          (*aij[d])(n, c) = gradTA[d](n, c);
 
     for (k = 0; k < N_; k++) // other MoleculeAMs
     {
@@ -186,17 +269,20 @@ void ASolver::grad_iter(int j)
       interact = true;
       if (v.norm() > polz_cutoff_+_sys_->get_ai(i)+_sys_->get_ai(j)) continue;
       add = re_expand_gradA(i, k, j, prev); // T^(i,k) * grad_j A^(k)
-      aij += add;
+      for (d = 0; d < 3; d++) *aij[d] += add[d];
       polz = true;
     }
 
     if (interact)
     {
-      gamma_delta = _gamma_->operator[](i) * _delta_->operator[](i);
-      aij.set_val(0, gamma_delta * aij[0]);
-      aij.set_val(1, gamma_delta * aij[1]);
-      aij.set_val(2, gamma_delta * aij[2]);
-      _gradA_->set_val(i, j, aij);
+      // gamma and delta are diagonal
+      MyMatrix<cmplx> & gam = _gamma_->operator[](i);
+      MyMatrix<cmplx> & del = _delta_->operator[](i);
+      VecOfMats<cmplx>::type & gai = _gradA_->operator()(i, j);
+      for (d = 0; d < 3; d++)
+        for (n = 0; n < p_; n++)
+          for (c = 0; c < 2*p_ + 1; c++)
+            gai[d](n, c) = gam(n, n) * del(n, n) * (*aij[d])(n, c);
     }
   }
 }
@@ -329,6 +415,43 @@ MyMatrix<cmplx> ASolver::re_expandA(int i, int j, bool prev)
   return z;
 }
 
+/*
+ Same re-expansion as re_expandA, without temporaries: the kernels copy
+ their input before writing, so S and R^H are applied to out in place
+ */
+void ASolver::re_expandA_into(int i, int j, MyMatrix<cmplx> & out, bool prev)
+{
+  int n, m, lowI = i, hiJ = j;
+  if ( i > j ) { lowI = j; hiJ = i; }
+
+  const ReExpCoeffs & T = T_(lowI, hiJ);
+  const MyMatrix<cmplx> & aj = (prev ? _prevA_->operator[](j) :
+                                _A_->operator[](j));
+
+  if (!T.isSingular())
+  {
+    POLE_DISPATCH(p_, rotate_fixed, p_, T, &ReExpCoeffs::get_rval, aj, out,
+                  false);
+  } else
+  {
+    for (n = 0; n < p_; n++)
+      for (m = -n; m <= n; m++)
+        out(n, m+p_) = aj(n, m+p_);
+    rotate_sing_inplace(p_, T.get_TVec().theta(), out);
+  }
+
+  // S(n,l,m) for i < j and S(l,n,m) otherwise:
+  POLE_DISPATCH(p_, translate_fixed, p_, T, &ReExpCoeffs::get_sval, out, out,
+                (i > j), NULL);
+
+  if (!T.isSingular())
+  {
+    POLE_DISPATCH(p_, rotate_fixed, p_, T, &ReExpCoeffs::get_rval, out, out,
+                  true);
+  } else
+    rotate_sing_inplace(p_, T.get_TVec().theta(), out);
+}
+
 
 /*
  re-expand element j of grad(A) with element (i, j) of T
@@ -422,148 +545,100 @@ VecOfMats<cmplx>::type ASolver::re_expandA_gradT(int i, int j, bool prev)
 MyMatrix<cmplx> ASolver::expand_RX(int i, int j, WhichReEx whichR,
                                    WhichReEx whichA, bool prev, int wrt)
 {
-  int n, m, s, lowI, hiJ;
+  int n, m, lowI, hiJ;
   MyMatrix<cmplx> x1(p_, 2*p_ + 1);
-  cmplx inter, rval, aval;
+  cmplx aval;
 
   lowI = i; hiJ = j;
   if ( i > j ) { lowI = j; hiJ  = i; }
 
-  // fill X1:
+  if (!T_(lowI,hiJ).isSingular())
+  {
+    MyMatrix<cmplx> xin(p_, 2*p_ + 1);
+    cmplx (ReExpCoeffs::*rget)(int, int, int) const = &ReExpCoeffs::get_rval;
+    if (whichR == DDPHI)        rget = &ReExpCoeffs::get_dr_dphi_val;
+    else if (whichR == DDTHETA) rget = &ReExpCoeffs::get_dr_dtheta_val;
+
+    for (n = 0; n < p_; n++)
+      for (m = -n; m <= n; m++)
+        xin.set_val(n, m+p_, which_aval(whichA, prev, j, n, m, wrt));
+
+    POLE_DISPATCH(p_, rotate_fixed, p_, T_(lowI,hiJ), rget, xin, x1, false);
+    return x1;
+  }
+
+  // fill X1 for singular T:
+  Pt vec = T_(lowI, hiJ).get_TVec();
+  if (whichR == DDTHETA) return expand_dRdtheta_sing(i, j, vec.theta(), false);
+  else if (whichR == DDPHI) return expand_dRdphi_sing(i, j, vec.theta(), false);
+
   for (n = 0; n < p_; n++)
   {
     for (m = -n; m <= n; m++)
     {
-      inter  = 0;
-      if (T_(lowI,hiJ).isSingular())
-      {
-        Pt vec = T_(lowI, hiJ).get_TVec();
-        if (whichR == BASE)
-        {
-          aval = which_aval(whichA, prev, j, n, -m, wrt);
-          if (vec.theta() > M_PI/2.0)
-            x1.set_val(n, m+p_, (n%2 == 0 ? aval : -aval));
-          else x1.set_val(n, m+p_, which_aval(whichA, prev, j, n, m, wrt));
-        } else if (whichR == DDTHETA)
-        {
-          x1 = expand_dRdtheta_sing(i, j, vec.theta(), false);
-          return x1;
-        }
-        else
-        {
-          x1 = expand_dRdphi_sing(i, j, vec.theta(), false);
-          return x1;
-        }
-      } else
-      {
-        for (s = -n; s <= n; s++)
-        {
-          if (whichR == DDPHI)
-            rval = T_(lowI, hiJ).get_dr_dphi_val(n, m, s);
-          else if (whichR == DDTHETA)
-            rval = T_(lowI, hiJ).get_dr_dtheta_val(n, m, s);
-          else
-            rval = T_(lowI, hiJ).get_rval(n, m, s);
-
-          aval = which_aval(whichA, prev, j, n, s, wrt);
-
-          inter += rval * aval;
-        } // end s
-        x1.set_val(n, m+p_, inter);
-      }
+      aval = which_aval(whichA, prev, j, n, -m, wrt);
+      if (vec.theta() > M_PI/2.0)
+        x1.set_val(n, m+p_, (n%2 == 0 ? aval : -aval));
+      else x1.set_val(n, m+p_, which_aval(whichA, prev, j, n, m, wrt));
     } // end m
   } //end n
   return x1;
 }
 
 // perform second part of T*A and return results
-MyMatrix<cmplx> ASolver::expand_SX(int i, int j, MyMatrix<cmplx> x1,
+MyMatrix<cmplx> ASolver::expand_SX(int i, int j, const MyMatrix<cmplx> & x1,
                                    WhichReEx whichS)
 {
-  int n, m, l, lowI, hiJ;
-  cmplx inter, sval;
+  int lowI, hiJ;
   MyMatrix<cmplx> x2(p_, 2*p_ + 1);
 
   lowI = i; hiJ = j;
   if ( i > j )  { lowI = j; hiJ  = i; }
 
-  // fill x2:
-  for (n = 0; n < p_; n++)
-  {
-    for (m = -n; m <= n; m++)
-    {
-      inter  = 0;
-      for (l = abs(m); l < p_; l++)
-      {
-        if ( i < j )
-        {
-          if (whichS == DDR) sval = T_(lowI, hiJ).get_dsdr_val(n, l, m);
-          else sval = T_(lowI, hiJ).get_sval(n, l, m);
-        }
-        else
-        {
-          if (whichS == DDR) sval = T_(lowI, hiJ).get_dsdr_val(l, n, m);
-          else sval = T_(lowI, hiJ).get_sval(l, n, m);
-        }
-        inter += sval * x1(l, m+p_);
-      } // end l
-      x2.set_val(n, m+p_, inter);
-    } // end m
-  } //end n
+  double (ReExpCoeffs::*sget)(int, int, int) const = &ReExpCoeffs::get_sval;
+  if (whichS == DDR) sget = &ReExpCoeffs::get_dsdr_val;
+
+  // fill x2, S(n,l,m) for i < j and S(l,n,m) otherwise:
+  POLE_DISPATCH(p_, translate_fixed, p_, T_(lowI, hiJ), sget, x1, x2,
+                (i > j), NULL);
   return x2;
 }
 
 // perform third part of T*A and return results
-MyMatrix<cmplx> ASolver::expand_RHX(int i, int j, MyMatrix<cmplx> x2,
+MyMatrix<cmplx> ASolver::expand_RHX(int i, int j, const MyMatrix<cmplx> & x2,
                                     WhichReEx whichRH)
 {
-  int n, m, s, lowI, hiJ;
-  cmplx inter, rval;
+  int n, m, lowI, hiJ;
   MyMatrix<cmplx> z(p_, 2*p_ + 1);
 
   lowI = i; hiJ = j;
   if ( i > j )  { lowI = j; hiJ  = i; }
 
-  //fill zj:
+  if (!T_(lowI,hiJ).isSingular())
+  {
+    cmplx (ReExpCoeffs::*rget)(int, int, int) const = &ReExpCoeffs::get_rval;
+    if (whichRH == DDPHI)        rget = &ReExpCoeffs::get_dr_dphi_val;
+    else if (whichRH == DDTHETA) rget = &ReExpCoeffs::get_dr_dtheta_val;
+
+    POLE_DISPATCH(p_, rotate_fixed, p_, T_(lowI,hiJ), rget, x2, z, true);
+    return z;
+  }
+
+  //fill zj for singular T:
+  Pt vec = T_(lowI, hiJ).get_TVec();
+  if (whichRH == DDTHETA)
+    return expand_dRdtheta_sing(lowI, hiJ, vec.theta(), x2, true);
+  else if (whichRH == DDPHI)
+    return expand_dRdphi_sing(lowI, hiJ, vec.theta(), x2, true);
+
   for (n = 0; n < p_; n++)
   {
     for (m = -n; m <= n; m++)
     {
-      inter  = 0;
-      if (T_(lowI,hiJ).isSingular())
-      {
-        Pt vec = T_(lowI, hiJ).get_TVec();
-        if (whichRH == BASE)
-        {
-          if (vec.theta() > M_PI/2.0)
-            z.set_val(n, m+p_, (n%2 == 0 ? x2(n,-m+p_) : -x2(n,-m+p_)));
-          else
-            z.set_val(n, m+p_, x2(n,m+p_));
-        } else if (whichRH == DDTHETA)
-        {
-          z = expand_dRdtheta_sing(lowI, hiJ, vec.theta(), x2, true);
-          return z;
-        }
-        else
-        {
-          z = expand_dRdphi_sing(lowI, hiJ, vec.theta(), x2, true);
-          return z;
-        }
-      } else
-      {
-        for (s = -n; s <= n; s++)
-        {
-          if (whichRH == DDPHI)
-            rval = T_(lowI, hiJ).get_dr_dphi_val(n, s, m);
-          else if (whichRH == DDTHETA)
-            rval = T_(lowI, hiJ).get_dr_dtheta_val(n, s, m);
-          else
-            rval = T_(lowI, hiJ).get_rval(n, s, m);
-
-          inter += conj(rval) * x2(n, s+p_);
-        } // end s
-        z.set_val(n, m+p_, inter);
-      }
+      if (vec.theta() > M_PI/2.0)
+        z.set_val(n, m+p_, (n%2 == 0 ? x2(n,-m+p_) : -x2(n,-m+p_)));
+      else
+        z.set_val(n, m+p_, x2(n,m+p_));
     } // end m
   } //end n
   return z;
@@ -578,7 +653,8 @@ MyMatrix<cmplx> ASolver::expand_dRdtheta_sing(int i,int j,double theta,bool ham)
 }
 
 MyMatrix<cmplx> ASolver::expand_dRdtheta_sing(int i, int j, double theta,
-                                              MyMatrix<cmplx> mat, bool ham)
+                                              const MyMatrix<cmplx> & mat,
+                                              bool ham)
 {
   MyMatrix<cmplx> x(p_, 2*p_ + 1);
   x.set_val( 0, p_, cmplx(0.0, 0.0));
@@ -633,7 +709,8 @@ MyMatrix<cmplx> ASolver::expand_dRdphi_sing(int i,int j,double theta,bool ham)
 }
 
 MyMatrix<cmplx> ASolver::expand_dRdphi_sing(int i, int j, double theta,
-                                            MyMatrix<cmplx> mat, bool ham)
+                                            const MyMatrix<cmplx> & mat,
+                                            bool ham)
 {
   MyMatrix<cmplx> x(p_, 2*p_ + 1);
   x.set_val( 0, p_, cmplx(0.0, 0.0));
@@ -728,6 +805,7 @@ void ASolver::pre_compute_all_sh()
  */
 vector<MyMatrix<cmplx> > ASolver::calc_mol_sh(shared_ptr<BaseMolecule> mol)
 {
+  SHWorkspace shws = _shCalc_->make_workspace();
   vector<MyMatrix<cmplx> > vout;
   vout.reserve(mol->get_m());
   int j;
@@ -735,11 +813,11 @@ vector<MyMatrix<cmplx> > ASolver::calc_mol_sh(shared_ptr<BaseMolecule> mol)
   Pt pt;
   for (j = 0; j < mol->get_m(); j++)
   {
-    pt = mol->get_posj(j);
+    pt = mol->get_posj_sph(j);
     theta = pt.theta();
     phi = pt.phi();
-    _shCalc_->calc_sh(theta, phi);
-    vout.push_back(_shCalc_->get_full_result());
+    _shCalc_->calc_sh(theta, phi, shws);
+    vout.push_back(shws.get_full_result());
   }
   return vout;
 }
@@ -799,10 +877,11 @@ cmplx ASolver::calc_indi_e(int i, int n, int m)
   for (j = 0; j < _sys_->get_Mi(i); j++)
   {
     q = _sys_->get_qij(i, j);
-    rho = _sys_->get_posij(i, j).r();
+    rho = _sys_->get_posij_sph(i, j).r();
     lambda = pow(_sys_->get_lambda(), n);
     // q_ij * (rho_ij)^n * Y_(n,m)(theta_ij, phi_ij):
-    cmplx all_sh_acc = (*_allSh_)[i][j](n, abs(m));
+    // SH are only kept for molecules expanded from charges, see compute_E()
+    cmplx all_sh_acc = get_SH_ij(i, j, n, m);
     if ( m < 0 )
       all_sh_acc = conj( all_sh_acc );
 
@@ -848,23 +927,75 @@ void ASolver::compute_delta()
 
 /*
  Constructs the E vector, which contains a matrix for each MoleculeAM
- that defines the multipole expansion of that MoleculeAM. The values
- of the inner matrices are calculated in calc_indi_e()
+ that defines the multipole expansion of that MoleculeAM. The first
+ molecule of each rigid body type is expanded from its charges by
+ calc_mol_E(), every other copy gets that expansion rotated to its own
+ orientation (see BodyFrameCache)
  */
 void ASolver::compute_E()
 {
-  int i, n, m;
+  int i;
+  if (! bodyE_.is_assigned())
+  {
+    vector<shared_ptr<BaseMolecule> > mols(N_);
+    for (i = 0; i < N_; i++) mols[i] = _sys_->get_moli(i);
+    bodyE_ = BodyFrameCache(p_);
+    bodyE_.assign(mols);
+  }
+  
+  vector<bool> direct(N_, false);
   for (i = 0; i < N_; i++)
   {
-    // m goes from -n to n so you need 2*p columns:
+    if (bodyE_.has(i)) continue;
+    if ((*_allSh_)[i].empty())
+      (*_allSh_)[i] = calc_mol_sh(_sys_->get_moli(i));
+    calc_mol_E(i);
+    bodyE_.store(i, _sys_->get_moli(i), {_E_->operator[](i)});
+    direct[i] = true;
+  }
+  
+#pragma omp parallel for
+  for (i = 0; i < N_; i++)
+  {
+    if (direct[i]) continue;
+    vector<MyMatrix<cmplx> > rotE;
+    bodyE_.rotate_to(i, _sys_->get_moli(i), rotE);
+    _E_->operator[](i) = rotE[0];
+  }
+}
+
+/*
+ E for molecule i from its charges. Equivalent to calc_indi_e() for every
+ n, m, but each charge is visited once and (rho/lambda)^n is built by
+ recurrence. Only m >= 0 is summed, m < 0 is the conjugate
+ */
+void ASolver::calc_mol_E(int i)
+{
+  double lambda = _sys_->get_lambda();
+  MyMatrix<cmplx> & E = _E_->operator[](i);
+  vector<double> rn (p_);
+  int j, n, m;
+  Pt pos;
+  
+  for (n = 0; n < p_; n++)
+    for (m = -n; m <= n; m++)
+      E(n, m + p_) = 0.0;
+  
+  for (j = 0; j < _sys_->get_Mi(i); j++)
+  {
+    pos = _sys_->get_posij_sph(i, j);
+    rn[0] = _sys_->get_qij(i, j);
+    for (n = 1; n < p_; n++) rn[n] = rn[n-1] * (pos.r() / lambda);
+    
+    const MyMatrix<cmplx> & sh = (*_allSh_)[i][j];
     for (n = 0; n < p_; n++)
-    {
-      for (m = -n; m <= n; m++)
-      {
-        _E_->operator[](i).set_val(n, m + p_, calc_indi_e(i, n, m));
-      }
-    }
+      for (m = 0; m <= n; m++)
+        E(n, m + p_) += rn[n] * sh(n, m);
   }
+  
+  for (n = 0; n < p_; n++)
+    for (m = 1; m <= n; m++)
+      E(n, -m + p_) = conj(E(n, m + p_));
 }
 
 /*
@@ -873,8 +1004,11 @@ void ASolver::compute_E()
  */
 void ASolver::compute_T()
 {
+  SHWorkspace shws = _shCalc_->make_workspace();
   int i, j;
   Pt v, ci, cj;  // inter molecular vector
+  double mixedDist = _consts_->get_mixed_prec_dist();
+  vector<double> besselK;
 
   for (i = 0; i < N_; i++)
   {
@@ -886,11 +1020,14 @@ void ASolver::compute_T()
 
       // calculate spherical harmonics for inter molecular vector:
       double kappa = _consts_->get_kappa();
-      _shCalc_->calc_sh(v.theta(), v.phi());
-      vector<double> besselK = _besselCalc_->calc_mbfK(2*p_, kappa * v.r());
-      T_.set_val(i, j, ReExpCoeffs(p_, v, _shCalc_->get_full_result(),
+      _shCalc_->calc_sh(v.theta(), v.phi(), shws);
+      _besselCalc_->calc_mbfK(2*p_, kappa * v.r(), besselK);
+      // far field pairs hold their coefficients in single precision only
+      bool single = (mixedDist > 0) && (v.r() > mixedDist);
+      T_.set_val(i, j, ReExpCoeffs(p_, v, shws.get_full_result(),
                                    besselK, _reExpConsts_,
-                                   {kappa,kappa}, {_sys_->get_lambda()},true));
+                                   {kappa,kappa}, {_sys_->get_lambda()},true,
+                                   single));
     }
   }
 }
@@ -1163,8 +1300,8 @@ void ASolver::print_dAi( int i, int j, int p)
 void ASolver::reset_all()
 {
   T_  = MyMatrix<ReExpCoeffs>(_sys_->get_n(), _sys_->get_n());
-  _reExpConsts_ = make_shared<ReExpCoeffsConstants>(_consts_->get_kappa(),
-                                                    _sys_->get_lambda(), p_);
+  _reExpConsts_ = ReExpCoeffsConstants::get_shared(_consts_->get_kappa(),
+                                                   _sys_->get_lambda(), p_);
   int n, n1;
   for ( n = 0; n < N_; n++ )
   {
@@ -1174,8 +1311,9 @@ void ASolver::reset_all()
     _E_->operator[](n) = MyMatrix<cmplx> (p_, 2*p_+1);
     _prevA_->operator[](n) = MyMatrix<cmplx> (p_, 2*p_+1);
 
-    _allSh_->operator[](n) = vector<MyMatrix<cmplx>>
-                              (N_, MyMatrix<cmplx> (2*p_, 2*p_));
+    // harmonics are only needed for molecules whose E is not rotated,
+    // see compute_E() and get_SH_ij()
+    _allSh_->operator[](n).clear();
 
     for ( n1 = 0; n1 < N_; n1++ )
     {
@@ -1191,9 +1329,6 @@ void ASolver::reset_all()
 
   solvedA_ = false;
 
-  // precompute all SH:
-  pre_compute_all_sh();
-
   //precompute gamma, delta, E and T:
   compute_T();
   compute_gamma();
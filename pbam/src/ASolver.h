@@ -35,6 +35,9 @@
 #include "ReExpCalc.h"
 #include <memory>
 #include "SystemAM.h"
+#include "ScratchArena.h"
+#include "BodyFrameCache.h"
+#include "ExpansionFile.h"
 
 /*
  This class is designed to compute the vector A defined in Equation 22
@@ -82,6 +85,9 @@ protected:
   // Outer vector is every MoleculeAM
   shared_ptr<vector<vector<MyMatrix<cmplx> > > > _allSh_;
 
+  // E of each molecule type, rotated to every copy by compute_E()
+  BodyFrameCache  bodyE_;
+
   // calculate the SH for all charges in a MoleculeAM
   vector<MyMatrix<cmplx> > calc_mol_sh(shared_ptr<BaseMolecule> mol);
 
@@ -111,6 +117,9 @@ protected:
   // compute the E vector (equations on page 543 of Lotan 2006)
   void compute_E();
 
+  // compute E for molecule i directly from its charges
+  void calc_mol_E(int i);
+
   // initialize A vector
   void init_A();
 
@@ -121,6 +130,9 @@ protected:
   // if prev=True then re-expand prevA
   MyMatrix<cmplx> re_expandA(int i, int j, bool prev=false);
 
+  // as above, but write into out, which must already be (p, 2p+1)
+  void re_expandA_into(int i, int j, MyMatrix<cmplx> & out, bool prev=false);
+
   // re-expand element j of grad(A) with element (i, j) of T
   VecOfMats<cmplx>::type re_expand_gradA(int i,int j,int wrt,bool prev=false);
 
@@ -137,20 +149,20 @@ protected:
 
   // perform first part of T*A and return results for singular A wrt THETA
   MyMatrix<cmplx> expand_dRdtheta_sing(int i, int j, double theta,
-                                       MyMatrix<cmplx> mat, bool ham);
+                                       const MyMatrix<cmplx> & mat, bool ham);
   MyMatrix<cmplx> expand_dRdtheta_sing(int i, int j, double theta, bool ham);
 
   // perform first part of T*A and return results for singular A wrt PHI
   MyMatrix<cmplx> expand_dRdphi_sing(int i, int j, double theta,
-                                     MyMatrix<cmplx> mat, bool ham);
+                                     const MyMatrix<cmplx> & mat, bool ham);
   MyMatrix<cmplx> expand_dRdphi_sing(int i, int j, double theta, bool ham);
 
   // perform second part of T*A and return results (see eq 46 in Lotan 2006)
-  MyMatrix<cmplx> expand_SX(int i, int j, MyMatrix<cmplx> x1,
+  MyMatrix<cmplx> expand_SX(int i, int j, const MyMatrix<cmplx> & x1,
                             WhichReEx whichS);
 
   // perform third part of T*A and return results (see eq 46 in Lotan 2006)
-  MyMatrix<cmplx> expand_RHX(int i, int j, MyMatrix<cmplx> x2,
+  MyMatrix<cmplx> expand_RHX(int i, int j, const MyMatrix<cmplx> & x2,
                              WhichReEx whichRH);
 
   // precompute gradT times A(i,j) for all pairs of MoleculeAMs
@@ -206,7 +218,11 @@ public:
   cmplx get_gamma_ni( int i, int n)       {return _gamma_->operator[](i)(n,n);}
   cmplx get_delta_ni( int i, int n)       {return _delta_->operator[](i)(n,n);}
   cmplx get_SH_ij(int i, int j, int n, int m)
-  {return (*_allSh_)[i][j](n,abs(m));}
+  {
+    if ((*_allSh_)[i].empty())
+      (*_allSh_)[i] = calc_mol_sh(_sys_->get_moli(i));
+    return (*_allSh_)[i][j](n,abs(m));
+  }
   cmplx get_E_ni(int i, int n, int m)     {return _E_->operator[](i)(n,m+p_);}
   cmplx get_A_ni(int i, int n, int m)     {return _A_->operator[](i)(n,m+p_);}
   cmplx get_L_ni(int i, int n, int m)     {return _L_->operator[](i)(n,m+p_);}
@@ -276,6 +292,13 @@ public:
   // must solve for A before this
   void solve_gradA(double prec, int MAX_POL_ROUNDS=2);
 
+  // save A (or grad(A)) to a binary expansion file, or load it in place of
+  // solving. The system must have the same number of molecules
+  void write_A(string path);
+  void read_A(string path);
+  void write_gradA(string path);
+  void read_gradA(string path);
+
   /*
    Reset all relevant members given a new system
    */
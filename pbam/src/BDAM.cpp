@@ -188,45 +188,77 @@ void BDRunAM::run(string xyzfile, string statfile, int nSCF)
   int i(0), scf(2);
   int WRITEFREQ = 200;
   bool term(false), polz(true);
-  ofstream xyz_out, stats;
-  xyz_out.open(xyzfile);
-  stats.open(statfile, fstream::in | fstream::out | fstream::app);
+  open_output(xyzfile, statfile);
   
   while (i < maxIter_ and !term)
   {
     if ((i % WRITEFREQ) == 0 )
     {
-      _stepper_->get_system()->write_to_xyz(xyz_out);
-      if (i != 0)  _physCalc_->print_all();
+      write_output(i, i != 0);
     }
     
-    _stepper_->get_system()->clear_all_lists();
-    _asolver_->reset_all();
     if (nSCF != 0) scf = nSCF;
-
-    _asolver_->solve_A(prec_, scf);
-    _asolver_->solve_gradA(prec_, scf);
-    _physCalc_->calc_force();
-    _physCalc_->calc_torque();
-    _stepper_->bd_update(_physCalc_->get_F(), _physCalc_->get_Tau());
+    if (_stepper_->far_update())
+    {
+      // far from everything, moved without forces
+      if (_mts_) _mts_->invalidate();
+    } else if (_grid_)
+    {
+      bool pairs = _pairSolv_ && _grid_->pairs_close();
+      if (pairs)
+      {
+        _pairSolv_->get_sys()->clear_all_lists();
+        _pairSolv_->reset_all();
+        _pairSolv_->solve_A(prec_, scf);
+        _pairSolv_->solve_gradA(prec_, scf);
+      }
+      _grid_->set_use_pairs(pairs);
+      _grid_->calc_force();
+      _stepper_->bd_update(_physCalc_->get_F(), _physCalc_->get_Tau());
+    } else if (_table_ && !_table_->pairs_close())
+    {
+      if (_mts_) _mts_->invalidate();
+      _table_->calc_force();
+      _stepper_->bd_update(_table_->get_F(), _table_->get_Tau());
+    } else if (_mts_ && !_mts_->need_full())
+    {
+      _mts_->predict();
+      _stepper_->bd_update(_mts_->get_F(), _mts_->get_Tau());
+    } else
+    {
+      _stepper_->get_system()->clear_all_lists();
+      _asolver_->reset_all();
+      _asolver_->solve_A(prec_, scf);
+      _asolver_->solve_gradA(prec_, scf);
+      _physCalc_->calc_force();
+      _physCalc_->calc_torque();
+      if (_mts_) _mts_->refresh(_physCalc_->get_F(), _physCalc_->get_Tau());
+      _stepper_->bd_update(_physCalc_->get_F(), _physCalc_->get_Tau());
+    }
 
     if ( (i % 100) == 0 ) cout << "This is step " << i << " and polz " << polz<< endl;
 
-    if (_terminator_->is_terminated(_stepper_->get_system()))
+    bool escaped = _stepper_->get_escaped();
+    if (escaped || _terminator_->is_terminated(_stepper_->get_system()))
     {
       term = true;
       // Printing out details at end
-      _stepper_->get_system()->write_to_xyz(xyz_out);
-      _physCalc_->print_all();
-      stats << _terminator_->get_how_term(_stepper_->get_system());
-      stats << " at time (ps) " << _stepper_->get_system()->get_time() << endl;
+      write_output(i);
+      ostringstream how;
+      if (escaped) how << _stepper_->get_how_escaped();
+      else how << _terminator_->get_how_term(_stepper_->get_system());
+      how << " at time (ps) " << _stepper_->get_system()->get_time();
+      write_stats(how.str());
     }
     i++;
   }
   
   if ( i >= maxIter_ )
-    stats << "System has gone over max number of BD iterations" << endl;
+    write_stats("System has gone over max number of BD iterations");
   
-  xyz_out.close();
-  stats.close();
+  if (_mts_)
+    cout << "Full solves for " << _mts_->get_n_full() << " of "
+         << _mts_->get_n_steps() << " force steps, ending with k = "
+         << _mts_->get_k() << endl;
+  close_output();
 }
@@ -37,6 +37,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <memory>
 #include "ElectrostaticsAM.h"
 #include "BaseBD.h"
+#include "PotentialGrid.h"
 
 
 /*
@@ -119,6 +120,11 @@ protected:
 
   shared_ptr<ASolver> _asolver_;
   
+  // static molecules from a potential grid, with a solver of the mobile
+  // molecules alone for their close pairs (see set_static_grid)
+  shared_ptr<GridPhysCalc> _grid_;
+  shared_ptr<ASolver>      _pairSolv_;
+  
 public:
   // num is the number of bodies to perform calculations on (2, 3 or all).
   // If num=0, then the equations will be solved exactly
@@ -128,7 +134,16 @@ public:
   
   void run(string xyzfile = "test.xyz", string statfile = "stats.dat", 
            int nSCF = 0);
-
+  
+  // take forces from grid instead of solving the whole system every step.
+  // pairSolv, if given, solves the mobile molecules when any are close
+  void set_static_grid(shared_ptr<GridPhysCalc> grid,
+                       shared_ptr<ASolver> pairSolv = nullptr)
+  {
+    _grid_ = grid;
+    _pairSolv_ = pairSolv;
+    _physCalc_ = grid;
+  }
 };
 
 
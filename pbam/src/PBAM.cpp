@@ -7,6 +7,7 @@
 //
 
 #include "PBAM.h"
+#include "AllocCounter.h"
 
 PBAM::PBAM() : PBAMInput()
 {
@@ -47,6 +48,9 @@ poles_(5),
 solveTol_(1e-4)
 {
   setp_ = make_shared<Setup>(infile);
+  int seed = setp_->getRandSeed();
+  MPIShard::bcast(seed);
+  setp_->set_rand_seed(seed);
   check_setup();
 
   syst_ = make_shared<SystemAM> ();
@@ -178,20 +182,23 @@ void PBAM::init_write_system()
 {
   if (setp_->get_randOrient())
   {
+    // keyed by the run seed, on a counter the trajectory kicks never use
+    PhiloxStream rng(setp_->getRandSeed(), 0, 0, ~0u);
     for ( int i = 0; i < syst_->get_n(); i++)
-      syst_->rotate_mol(i, Quat().chooseRandom());
+      syst_->rotate_mol(i, Quat().chooseRandom(rng));
   }
 
   // writing initial configuration out
-  syst_->write_to_pqr( setp_->getRunName() + ".pqr");
+  if (MPIShard::rank() == 0)
+    syst_->write_to_pqr( setp_->getRunName() + ".pqr");
   cout << "Written config" << endl;
 }
 
 void PBAM::initialize_coeff_consts()
 {
-  _bessl_consts_ = make_shared<BesselConstants>(2*poles_);
+  _bessl_consts_ = BesselConstants::get_shared(2*poles_);
   _bessl_calc_ = make_shared<BesselCalc>(2*poles_, _bessl_consts_);
-  _sh_consts_ = make_shared<SHCalcConstants>(2*poles_);
+  _sh_consts_ = SHCalcConstants::get_shared(2*poles_);
   _sh_calc_ = make_shared<SHCalc>(2*poles_, _sh_consts_);
 
 }
@@ -207,6 +214,8 @@ int PBAM::run()
     run_energyforce( );
   else if ( setp_->getRunType() == "bodyapprox")
     run_bodyapprox( );
+  else if ( setp_->getRunType() == "pairtable")
+    run_pairtable( );
   else
     cout << "Runtype not recognized! See manual for options" << endl;
 
@@ -222,7 +231,7 @@ PBAMOutput PBAM::run_apbs()
 
 void PBAM::run_dynamics()
 {
-  int traj, i, j(0);
+  int i, j(0);
   shared_ptr<ASolver> ASolv = make_shared<ASolver> (_bessl_calc_, _sh_calc_, 
 												    syst_, consts_, poles_);
 
@@ -278,32 +287,166 @@ void PBAM::run_dynamics()
   HowTermCombine com = (setp_->get_andCombine() ? ALL : ONE);
   auto term_conds = make_shared<CombineTerminate> (terms, com);
 
-  char buff[100], outb[100];
+  char outb[100];
   sprintf( outb, "%s.stat", setp_->getRunName().c_str());
   string statfile = outb;
-
-  for (traj = 0; traj < setp_->getNTraj(); traj++)
+  
+  vector<string> typePQR(setp_->getNType());
+  for (i = 0; i < setp_->getNType(); i++) typePQR[i] = setp_->getTypeNPQR(i);
+
+  // With potgrid the static molecules are solved once, on their own, and
+  // their potential is tabulated for the mobile ones
+  vector<int> stat, mobile;
+  for (i = 0; i < syst_->get_n(); i++)
+    (syst_->get_typei(i) == "stat" ? stat : mobile).push_back(i);
+  shared_ptr<PotentialGrid> grid;
+  function<double(Pt)> statPot;
+  Pt gridCen;
+  if (setp_->get_pot_grid_h() > 0 && !stat.empty() && !mobile.empty())
+  {
+    vector<shared_ptr<BaseMolecule> > mols;
+    for (int k : stat)
+      mols.push_back(make_shared<MoleculeAM>(
+                     *dynamic_pointer_cast<MoleculeAM>(syst_->get_moli(k))));
+    auto statSys = make_shared<SystemAM>(mols, syst_->get_cutoff(),
+                                         syst_->get_boxlength());
+    auto statSolv = make_shared<ASolver>(_bessl_calc_, _sh_calc_, statSys,
+                                         consts_, poles_);
+    statSolv->solve_A(solveTol_);
+    auto electro = make_shared<ElectrostaticAM>(statSolv, 0);
+    statPot = [electro] (Pt p) { return electro->pot_at(p); };
+    grid = make_static_grid(statSys, setp_->get_pot_grid_h(),
+                            setp_->get_pot_grid_pad(), statPot, gridCen);
+    cout << "Potential of " << stat.size() << " static molecules on "
+         << grid->get_npts() << " grid points" << endl;
+  }
+  
+  // pair tables, read once and shared by every trajectory
+  vector<shared_ptr<PairTable> > tables;
+  try {
+    for (int t = 0; t < setp_->get_n_pair_tab(); t++)
+      tables.push_back(make_shared<PairTable>(setp_->get_pair_tab(t)));
+  } catch (const exception& ex)
+  {
+    cout << ex.what() << endl;
+    exit(0);
+  }
+  if (!tables.empty() &&
+      !PairTableCalc(syst_, tables, false, consts_, "").covers())
   {
-    sprintf( buff, "%s_%d.xyz", setp_->getRunName().c_str(), traj);
-    string xyztraj = buff;
-    sprintf( outb, "%s_%d.dat", setp_->getRunName().c_str(), traj);
-    string outfile = outb;
-
-    string stats = setp_->getRunName();
-    syst_->reset_positions( setp_->get_trajn_xyz(traj));
-    syst_->set_time(0.0);
-    BDRunAM dynamic_run( ASolv, term_conds, outfile);
-    dynamic_run.run(xyztraj, statfile);
-    cout << "Done with trajectory " << traj << endl;
-    if (traj==0)
-      for (i=0; i<syst_->get_n(); i++)
+    cout << "Pair tables do not cover every pair of molecule types, "
+         << "solving fully instead" << endl;
+    tables.clear();
+  }
+  
+  // Worker 0 runs on syst_ with the solver above, the others on clones with
+  // their own solvers. Every trajectory starts from the same initial system
+  auto initial = syst_->clone();
+  BDFarm farm(setp_->get_traj_threads(), setp_->getNTraj(), statfile);
+  if (farm.get_nthreads() > 1 || farm.get_nranks() > 1)
+    cout << "Running trajectories on " << farm.get_nthreads() << " threads"
+         << " of " << farm.get_nranks() << " ranks\n";
+  
+  farm.run([&] (int w) -> BDFarm::TrajFn
+  {
+    shared_ptr<SystemAM> sys = syst_;
+    shared_ptr<ASolver> wsolv = ASolv;
+    if (w > 0)
+    {
+      sys = initial->clone();
+      wsolv = make_shared<ASolver>(_bessl_calc_,
+                                   make_shared<SHCalc>(2*poles_, _sh_consts_),
+                                   sys, consts_, poles_);
+    }
+    
+    // the mobile molecules of sys on their own, for their close pairs
+    shared_ptr<ASolver> pairSolv;
+    if (grid && mobile.size() > 1)
+    {
+      vector<shared_ptr<BaseMolecule> > mols;
+      for (int k : mobile) mols.push_back(sys->get_moli(k));
+      auto pairSys = make_shared<SystemAM>(mols, sys->get_cutoff(),
+                                           sys->get_boxlength());
+      pairSolv = make_shared<ASolver>(_bessl_calc_,
+                                   make_shared<SHCalc>(2*poles_, _sh_consts_),
+                                   pairSys, consts_, poles_);
+    }
+    
+    return [=] (int traj) -> vector<string>
+    {
+      char buff[100];
+      sprintf( buff, "%s_%d.%s", setp_->getRunName().c_str(), traj,
+              (setp_->get_traj_format() == "pose") ? "ptraj" : "xyz");
+      string xyztraj = buff;
+      sprintf( buff, "%s_%d.dat", setp_->getRunName().c_str(), traj);
+      string outfile = buff;
+      
+      sys->reset_to(*initial);
+      sys->reset_positions( setp_->get_trajn_xyz(traj));
+      sys->set_time(0.0);
+      BDRunAM dynamic_run( wsolv, term_conds, outfile);
+      if (grid)
       {
-        Pt tmp = dynamic_run.get_force_i(i) * consts_->get_conv_factor();
-        force_[i][0] = tmp.x(); force_[i][1] = tmp.y(); force_[i][2] = tmp.z();
-        tmp = dynamic_run.get_torque_i(i) * consts_->get_conv_factor();
-        torque_[i][0] = tmp.x(); torque_[i][1] = tmp.y(); torque_[i][2] = tmp.z();
-        nrg_intera_[i]=dynamic_run.get_energy_i(i)*consts_->get_conv_factor();
+        auto gcalc = make_shared<GridPhysCalc>(sys, grid, statPot, gridCen,
+                                               mobile, false, consts_,
+                                               outfile);
+        if (pairSolv)
+          gcalc->set_pair_calc(make_shared<PhysCalcAM>(pairSolv, ""));
+        dynamic_run.set_static_grid(gcalc, pairSolv);
       }
+      dynamic_run.set_pose_traj(typePQR, setp_->get_traj_double());
+      dynamic_run.set_rand_seed(setp_->getRandSeed(), traj);
+      dynamic_run.set_far_field(setp_->get_far_gap(), setp_->get_far_b());
+      shared_ptr<PairTableCalc> tcalc;
+      if (!tables.empty())
+        tcalc = make_shared<PairTableCalc>(sys, tables, false, consts_,
+                                           outfile);
+      if (setp_->get_mts_k() > 1)
+      {
+        auto mts = make_shared<MultiStepForce>(sys,
+                                   setp_->get_mts_k(), setp_->get_mts_model(),
+                                   setp_->get_mts_tol(), setp_->get_mts_move(),
+                                   setp_->get_mts_rot(), consts_->get_kappa(),
+                                   consts_->get_dielectric_water(), false);
+        // the tables with the many-body remainder of full solves, else alone
+        if (setp_->get_mts_model() == "table") mts->set_table(tcalc);
+        else if (tcalc) dynamic_run.set_pair_table(tcalc);
+        dynamic_run.set_multi_step(mts);
+      } else if (tcalc) dynamic_run.set_pair_table(tcalc);
+      dynamic_run.run(xyztraj, "");
+      if (traj==0)
+        for (int i=0; i<sys->get_n(); i++)
+        {
+          Pt tmp = dynamic_run.get_force_i(i) * consts_->get_conv_factor();
+          force_[i][0] = tmp.x(); force_[i][1] = tmp.y(); force_[i][2] = tmp.z();
+          tmp = dynamic_run.get_torque_i(i) * consts_->get_conv_factor();
+          torque_[i][0] = tmp.x(); torque_[i][1] = tmp.y(); torque_[i][2] = tmp.z();
+          nrg_intera_[i]=dynamic_run.get_energy_i(i)*consts_->get_conv_factor();
+        }
+      return dynamic_run.get_stats();
+    };
+  });
+}
+
+void PBAM::solve_or_read_A(shared_ptr<ASolver> ASolv)
+{
+  string apre = setp_->get_afile();
+  string afil = apre + ".A.bexp", gfil = apre + ".dA.bexp";
+  if (apre != "" && ifstream(afil.c_str()).good() &&
+      ifstream(gfil.c_str()).good())
+  {
+    cout << "Reading A and grad(A) from " << apre << endl;
+    ASolv->read_A(afil);
+    ASolv->read_gradA(gfil);
+    return;
+  }
+  
+  ASolv->solve_A(solveTol_); ASolv->solve_gradA(solveTol_);
+  if (apre != "")
+  {
+    cout << "Writing A and grad(A) to " << apre << endl;
+    ASolv->write_A(afil);
+    ASolv->write_gradA(gfil);
   }
 }
 
@@ -312,7 +455,7 @@ void PBAM::run_electrostatics()
   int i;
   shared_ptr<ASolver> ASolv = make_shared<ASolver> (_bessl_calc_, _sh_calc_,
                                                     syst_, consts_, poles_);
-  ASolv->solve_A(solveTol_); ASolv->solve_gradA(solveTol_);
+  solve_or_read_A(ASolv);
   ElectrostaticAM Estat( ASolv, setp_->getGridPts());
 
   if ( setp_->getDXoutName() != "" )
@@ -333,9 +476,12 @@ void PBAM::run_energyforce()
 {
   int i;
   clock_t t3 = clock();
+#ifdef PB_BENCHMARK
+  AllocCounter::reset();
+#endif
   shared_ptr<ASolver> ASolv = make_shared<ASolver> (_bessl_calc_, _sh_calc_,
                                                     syst_, consts_, poles_);
-  ASolv->solve_A(solveTol_); ASolv->solve_gradA(solveTol_);
+  solve_or_read_A(ASolv);
   PhysCalcAM calcEnFoTo( ASolv, setp_->getRunName(), consts_->get_unitsEnum());
   calcEnFoTo.calc_all();
   calcEnFoTo.print_all();
@@ -352,12 +498,18 @@ void PBAM::run_energyforce()
   t3 = clock() - t3;
   printf ("energyforce calc took me %f seconds.\n",
           ((float)t3)/CLOCKS_PER_SEC);
+#ifdef PB_BENCHMARK
+  printf ("heap allocations: %ld\n", AllocCounter::get_count());
+#endif
 }
 
 void PBAM::run_bodyapprox()
 {
   int i;
   clock_t t3 = clock();  
+#ifdef PB_BENCHMARK
+  AllocCounter::reset();
+#endif
   shared_ptr<ASolver> ASolv = make_shared<ASolver> (_bessl_calc_, _sh_calc_,
                                                     syst_, consts_, poles_);
   ThreeBodyAM threeBodTest( ASolv, consts_->get_unitsEnum(), 
@@ -380,5 +532,82 @@ void PBAM::run_bodyapprox()
   t3 = clock() - t3;
   printf ("manybody approx calc took me %f seconds.\n",
           ((float)t3)/CLOCKS_PER_SEC);
+#ifdef PB_BENCHMARK
+  printf ("heap allocations: %ld\n", AllocCounter::get_count());
+#endif
 }
 
+void PBAM::run_pairtable()
+{
+  for (int t = 0; t < setp_->get_n_pair_tab(); t++)
+  {
+    string path = setp_->get_pair_tab(t);
+    int type[2] = {setp_->get_pair_tab_type(t, 0),
+                   setp_->get_pair_tab_type(t, 1)};
+    
+    // the first molecule of each type, turned back to its input orientation
+    // with its center at the origin
+    vector<shared_ptr<BaseMolecule> > mols(2);
+    double rad = 0.0;
+    for (int m = 0; m < 2; m++)
+    {
+      for (int i = 0; i < syst_->get_n() && !mols[m]; i++)
+        if (syst_->get_moli(i)->get_type() == type[m])
+          mols[m] = make_shared<MoleculeAM>(
+                        *dynamic_pointer_cast<MoleculeAM>(syst_->get_moli(i)));
+      if (!mols[m])
+      {
+        cout << "No molecule of type " << type[m]+1 << " for " << path << endl;
+        exit(0);
+      }
+      mols[m]->rotate(PairTable::transpose(mols[m]->get_orient()));
+      mols[m]->translate(mols[m]->get_centerk(0) * -1.0, Constants::MAX_DIST);
+      rad += mols[m]->get_ak(0);
+    }
+    
+    PairTable tab(setp_->get_pair_tab_L(), setp_->get_pair_tab_J(),
+                  setp_->get_pair_tab_nd(), rad + setp_->get_pair_tab_gap(0),
+                  rad + setp_->get_pair_tab_gap(1), type[0], type[1]);
+    mols[1]->translate(Pt(0.0, 0.0, tab.get_d0()), Constants::MAX_DIST);
+    auto pair = make_shared<SystemAM>(mols);
+    cout << "Tabulating " << path << " from " << tab.n_samples()
+         << " two-body solves" << endl;
+    
+    clock_t t3 = clock();
+    double err = tab.build(path + ".samples", setp_->get_traj_threads(),
+                           [&] (int w) -> PairTable::SolveFn
+    {
+      auto sys = pair->clone();
+      auto solv = make_shared<ASolver>(_bessl_calc_,
+                                       make_shared<SHCalc>(2*poles_, _sh_consts_),
+                                       sys, consts_, poles_);
+      auto calc = make_shared<PhysCalcAM>(solv, "");
+      return [=] (double d, Pt u, MyMatrix<double> R) -> PairTable::Sample
+      {
+        sys->reset_to(*pair);
+        sys->translate_mol(1, sys->get_centerik(1, 0) * -1.0);
+        sys->rotate_mol(1, R);
+        sys->translate_mol(1, u * d);
+        sys->clear_all_lists();
+        solv->reset_all();
+        solv->solve_A(solveTol_); solv->solve_gradA(solveTol_);
+        calc->calc_all();
+        PairTable::Sample s;
+        for (int m = 0; m < 2; m++)
+        {
+          s.e[m] = calc->get_omegai(m);
+          s.f[m] = calc->get_forcei(m);
+          s.tau[m] = calc->get_taui(m);
+        }
+        return s;
+      };
+    });
+    if (MPIShard::rank() != 0) continue;
+    
+    tab.write(path);
+    t3 = clock() - t3;
+    printf ("pair table of %ld bytes took me %f seconds, ", tab.get_bytes(),
+            ((float)t3)/CLOCKS_PER_SEC);
+    printf ("rms force error %.3g\n", err);
+  }
+}
@@ -35,6 +35,8 @@
 #include <time.h>
 #include "PBAMStruct.h"
 #include "BDAM.h"
+#include "BDFarm.h"
+#include "PairTable.h"
 
 
 using namespace std;
@@ -57,6 +59,10 @@ protected:
 
   int poles_;
   double solveTol_;
+  
+  // A and grad(A), read from the afile prefix when saved there, else
+  // solved for and saved there if a prefix is given
+  void solve_or_read_A(shared_ptr<ASolver> ASolv);
 
 public:
 
@@ -86,6 +92,7 @@ public:
   void run_dynamics();
   void run_electrostatics();
   void run_energyforce();
+  void run_pairtable();
 };
 
 
@@ -159,6 +159,7 @@ BaseTorqueCalc(_asolv->get_N())
 
 VecOfMats<cmplx>::type TorqueCalcAM::calc_H(int i)
 {
+  SHWorkspace shws = _shCalc_->make_workspace();
   VecOfMats<cmplx>::type H (3);
   int mi = _sys_->get_Mi(i);
   cmplx sh, h, gam;
@@ -172,8 +173,8 @@ VecOfMats<cmplx>::type TorqueCalcAM::calc_H(int i)
   for (j = 0; j < mi; j++)
   {
     qij = _sys_->get_qij(i, j);
-    Pt pt = _sys_->get_posij(i, j);
-    _shCalc_->calc_sh(pt.theta(),pt.phi());
+    Pt pt = _sys_->get_posij_sph(i, j);
+    _shCalc_->calc_sh(pt.theta(),pt.phi(), shws);
     scale = 1.0;
     
     if (_sys_->get_ai(i) == 0)
@@ -186,7 +187,7 @@ VecOfMats<cmplx>::type TorqueCalcAM::calc_H(int i)
       gam = gamma_i(n, n);
       for (m = 0; m <= n; m++)
       {
-        sh = _shCalc_->get_result(n, m);
+        sh = shws.get_result(n, m);
         h = bessI[n] * qij * scale * sh * gam;
         Hx(n, m+p_) += h * pt.x();
         Hy(n, m+p_) += h * pt.y();
@@ -381,9 +382,9 @@ void ThreeBodyAM::solveNmer( int num, double preclim )
       poles = p_;
     }
     shared_ptr<SystemAM> _sysTemp = make_subsystem(tempmol);
-    auto bConsta = make_shared<BesselConstants>(2*poles);
+    auto bConsta = BesselConstants::get_shared(2*poles);
     auto bCalcu = make_shared<BesselCalc>(2*poles, bConsta);
-    auto SHConsta = make_shared<SHCalcConstants>(2*poles);
+    auto SHConsta = SHCalcConstants::get_shared(2*poles);
     shared_ptr<SHCalc> SHCalcu = make_shared<SHCalc>(2*poles, SHConsta);
     shared_ptr<Constants> consts =  make_shared<Constants>(*_consts_);
     
@@ -629,39 +630,22 @@ void PhysCalcAM::compute_units( shared_ptr<Constants> cst, Units unit)
   }
 }
 
-void PhysCalcAM::print_all()
+PhysSnapshot PhysCalcAM::snapshot()
 {
-  int i;
-  streambuf * buf;
-  ofstream of;
-  vector<Pt> mol_pos = _sys_->get_allcenter();
-  
-  if(outfname_ != "")
+  PhysSnapshot snap;
+  snap.t = _sys_->get_time();
+  snap.unit = unit_;
+  snap.unitConv = unit_conv_;
+  snap.outfname = outfname_;
+  snap.pos = _sys_->get_allcenter();
+  for (int i = 0; i < N_; i++)
   {
-    of.open(outfname_, fstream::in | fstream::out | fstream::app);
-    buf = of.rdbuf();
-  } else {
-    buf = cout.rdbuf();
+    snap.rad.push_back(_sys_->get_radi(i));
+    snap.energy.push_back(get_omegai(i));
+    snap.force.push_back(get_forcei(i));
+    snap.torque.push_back(get_taui(i));
   }
-  
-  ostream out(buf);
-  out << "My units are " << unit_ << ". Time: " << _sys_->get_time() << endl;
-  for ( i = 0; i < N_; i++)
-  {
-    out << "Molecule #" << i + 1 << " radius: " << _sys_->get_radi(i) << endl;
-    out << "\tPOSITION: [" << mol_pos[i].x() << ", " << mol_pos[i].y();
-    out << ", " << mol_pos[i].z() << "]" << endl;
-    out << "\tENERGY: " << unit_conv_ * get_omegai(i) << endl;
-
-    out << "\tFORCE: " << get_forcei(i).norm() * unit_conv_ << ", [";
-    out << get_forcei(i).x() * unit_conv_ << " "
-        << get_forcei(i).y() * unit_conv_ << " "
-        << get_forcei(i).z() * unit_conv_ << "]"<<endl;
-    out << "\tTORQUE: " << get_taui(i).norm() << ", [";
-    out << get_taui(i).x() * unit_conv_ << " "
-        << get_taui(i).y() * unit_conv_ << " "
-        << get_taui(i).z() * unit_conv_ << "]"<<endl;
-  }  
+  return snap;
 }
 
 ThreeBodyPhysCalcAM::ThreeBodyPhysCalcAM(shared_ptr<ASolver> _asolv, int num,
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <memory>
 #include "ASolver.h"
+#include "PoleKernels.h"
 #include "SystemAM.h"
 #include "BasePhysCalc.h"
 
@@ -189,19 +190,11 @@ public:
    Calculate inner product of two matrices as defined in equation 29 of Lotan
    2006
    */
-  double lotan_inner_prod(MyMatrix<cmplx> U, MyMatrix<cmplx> V, int p)
+  double lotan_inner_prod(const MyMatrix<cmplx> & U,
+                          const MyMatrix<cmplx> & V, int p)
   {
-    double ip = 0;
-    int n, m, mT;
-    for (n = 0; n < p; n++)
-    {
-      for (m = -n; m <= n; m++)
-      {
-        mT = (m < 0) ? -1*m : m;
-        ip += U(n, mT+p_).real()*V(n, mT+p_).real()
-               + U(n, mT+p_).imag()*V(n, mT+p_).imag();
-      }
-    }
+    double ip;
+    POLE_DISPATCH(p, inner_prod_fixed, p, U, V, ip);
     return ip;
   }
   
@@ -321,7 +314,7 @@ public:
   void calc_torque()  { _torCalc_->calc_tau(); }
   void calc_all()     { calc_energy(); calc_force(); calc_torque(); }
   
-  void print_all();
+  PhysSnapshot snapshot();
   
   shared_ptr<vector<Pt> > get_Tau() { return _torCalc_->get_tau();}
   shared_ptr<vector<Pt> > get_F()    { return _fCalc_->get_F();}
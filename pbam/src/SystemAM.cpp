@@ -28,6 +28,7 @@ MoleculeAM::MoleculeAM(string movetype, double a, vector<double> qs,
   set_Dtr_Drot(movetype);
   
   centers_[0] = calc_center();
+  unwrappedCenter_ = centers_[0];
   as_[0] = a;
   
   reposition_charges();
@@ -41,6 +42,7 @@ MoleculeAM::MoleculeAM(string movetype, vector<double> qs, vector<Pt> pos,
 {
   set_Dtr_Drot(movetype);
   centers_[0] = cen;
+  unwrappedCenter_ = cen;
   as_[0] = 0;
 
   reposition_charges();
@@ -54,6 +56,7 @@ MoleculeAM::MoleculeAM(string movetype, vector<double> qs, vector<Pt> pos,
 {
   set_Dtr_Drot(movetype);
   centers_[0] = calc_center();
+  unwrappedCenter_ = centers_[0];
   as_[0] = 0;
   reposition_charges();
 }
@@ -66,9 +69,9 @@ Pt MoleculeAM::calc_center()
   {
   //printf("Inside calc_center: cen: %.3f, %.3f, %.3f\n",
   //       pos_[i].x(), pos_[i].y(), pos_[i].z());
-    xc += pos_[i].x();
-    yc += pos_[i].y();
-    zc += pos_[i].z();
+    xc += pos_.x(i);
+    yc += pos_.y(i);
+    zc += pos_.z(i);
   }
   xc /= (double) Nc_;
   yc /= (double) Nc_;
@@ -84,7 +87,7 @@ double MoleculeAM::calc_a()
   double dist;
   for (int i = 0; i < Nc_; i++)
   {
-    dist = pos_[i].norm() + vdwr_[i];
+    dist = pos_.get(i).norm() + vdwr_[i];
     if (dist > a) a = dist;
   }
   return a;
@@ -97,12 +100,10 @@ void MoleculeAM::reposition_charges()
   for (int i = 0; i < Nc_; i++)
   {
     // check that the charge is encompassed by the the center and radius:
-    if (pos_[i].dist(centers_[0])+vdwr_[i] > as_[0])
+    if (pos_.get(i).dist(centers_[0])+vdwr_[i] > as_[0])
       recalc_a = true;
-    pos_[i] = pos_[i] - centers_[0];
-  //printf("Inside repos_charg: cen: %.3f, %.3f, %.3f\n",
-  //       pos_[i].x(), pos_[i].y(), pos_[i].z());
   }
+  pos_.translate(centers_[0] * -1.0);
   
   if (recalc_a) as_[0] = calc_a();
 }
@@ -119,21 +120,14 @@ void MoleculeAM::translate(Pt dr, double boxlen)
 
 void MoleculeAM::rotate(Quat qrot)
 {
-  for (int i = 0; i < Nc_; i++)
-  {
-    pos_[i] = qrot.rotate_point(pos_[i]);
-  //cout << "Rotated pt " << pos_[i].x() << ", "
-  //<< pos_[i].y() << ", "<< pos_[i].z() << endl;
-  }
+  rotate(qrot.get_rotation_matrix());
 }
 
 
 void MoleculeAM::rotate(MyMatrix<double> rotmat)
 {
-  for (int i = 0; i < Nc_; i++)
-  {
-    pos_[i] = pos_[i].rotate(rotmat);
-  }
+  pos_.rotate(rotmat);
+  add_rotation(rotmat);
 }
 
 SystemAM::SystemAM(vector<shared_ptr<BaseMolecule> > mols, double cutoff,
@@ -204,7 +198,7 @@ SystemAM::SystemAM(Setup setup, double cutoff)
       }
       else
       {
-        trans = xyzI.get_pts()[j] + com * -1.0;
+        trans = xyzI.get_pt(j) + com * -1.0;
         rot = MyMatrix<double> (3, 3, 0.0);
         rot.set_val(0, 0, 1.0);
         rot.set_val(1, 1, 1.0);
@@ -212,12 +206,11 @@ SystemAM::SystemAM(Setup setup, double cutoff)
       }
       
       keys = { i, j };
-      vector<Pt> repos_charges(pqrI.get_Nc());
-      Pt new_pt;
+      vector<Pt> repos_charges(pqrI.get_atom_pts());
       
       for ( chg = 0; chg < pqrI.get_Nc(); chg ++)
       {
-        repos_charges[chg] = pqrI.get_atom_pts()[chg].rotate(rot) + trans;
+        repos_charges[chg] = repos_charges[chg].rotate(rot) + trans;
       }
       
       if (pqrI.get_Ns() != 0)  // coarse graining is in pqr
@@ -241,6 +234,9 @@ SystemAM::SystemAM(Setup setup, double cutoff)
                        setup.getDrot(i), setup.getDtr(i));
       }
       
+      // charges were placed with rot, keep it as the orientation so that
+      // copies of a type share the PQR body frame
+      mol->set_orient(rot);
       molecules_.push_back(mol);
       typeIdxToIdx_[keys] = k;
       k++;
@@ -289,6 +285,24 @@ void SystemAM::reset_positions( vector<string> xyzfiles )
   
 }
 
+shared_ptr<SystemAM> SystemAM::clone() const
+{
+  auto sys = make_shared<SystemAM>(*this);
+  for (int i = 0; i < N_; i++)
+    sys->molecules_[i] = make_shared<MoleculeAM>(
+                              *dynamic_pointer_cast<MoleculeAM>(molecules_[i]));
+  sys->reset_to(*this);
+  return sys;
+}
+
+void SystemAM::reset_to(const SystemAM & sys)
+{
+  for (int i = 0; i < N_; i++)
+    *dynamic_pointer_cast<MoleculeAM>(molecules_[i]) =
+                              *dynamic_pointer_cast<MoleculeAM>(sys.molecules_[i]);
+  t_ = sys.t_;
+}
+
 void SystemAM::write_to_pqr(string outfile, int mid)
 {
   int i, j, ct = 0;
@@ -316,29 +330,3 @@ void SystemAM::write_to_pqr(string outfile, int mid)
     ct++;
   }
 }
-
-void SystemAM::write_to_xyz(ofstream & xyz_out)
-{
-  int i, j, at_tot = 0;
-  char xyzlin[400];
-  
-  for ( i = 0; i < N_; i++ )
-    for ( j = 0; j < get_Mi(i); j++)
-      at_tot++;
-  at_tot += N_; // for adding CG centers
-  
-  xyz_out << at_tot << endl;
-  xyz_out << "Atoms. Timestep (ps): " << t_ << endl;
-  for ( i = 0; i < N_; i++ )
-  {
-    for ( j = 0; j < get_Mi(i); j++)
-    {
-      sprintf(xyzlin,"N %8.3f %8.3f %8.3f", get_posijreal(i, j).x(),
-              get_posijreal(i, j).y(), get_posijreal(i, j).z());
-      xyz_out << xyzlin << endl;
-    }
-    sprintf(xyzlin,"X %8.3f %8.3f %8.3f", get_centeri(i).x(),
-            get_centeri(i).y(), get_centeri(i).z());
-    xyz_out << xyzlin << endl;
-  }
-}
@@ -160,12 +160,16 @@ public:
   // reset positions with input xyz file
   void reset_positions( vector<string> xyzfiles );
   
+  // copy of the system whose molecules move independently of this one
+  shared_ptr<SystemAM> clone() const;
+  
+  // put every molecule back to its pose in sys, a clone of this system,
+  // keeping the molecule objects that solvers hold on to
+  void reset_to(const SystemAM & sys);
+  
   // write current system to PQR file
   void write_to_pqr( string outfile, int mid = -1);
   
-  // write current system configuration to XYZ file
-  void write_to_xyz(ofstream &xyz_out);
-  
 };
 
 #endif /* SystemAM_h */
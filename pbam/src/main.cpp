@@ -31,10 +31,17 @@
 
 #include "PBAM.h"
 
+// benchmark builds count heap allocations in the solvers
+#ifdef PB_BENCHMARK
+#define PB_COUNT_ALLOCS
+#include "AllocCounter.h"
+#endif
+
 using namespace std;
 
 int main(int argc, const char * argv[])
 {
+  MPIShard::Session mpi;
   string input_file = argv[1];
 //    string input_file = "/Users/davidbrookes/Projects/pb_solvers/pbam/pbam_test_files/manybodyapprox_test2/grid_test2/27_grid/run.energyforce_27_0.00.inp";
 //  string input_file = "/Users/davidbrookes/data/2fgr/electrostatics/run.electrostatic.inp";
@@ -513,6 +513,63 @@ TEST_F(ASolverUTest, checkE)
   EXPECT_NEAR(ASolvTest.get_E_ni( 1, 6, -5).imag()/-3.8653666e-06, 1., preclim);
 }
 
+TEST_F(ASolverUTest, checkERotatedCopies)
+{
+  const int vals = nvals;
+  auto bCalcu = make_shared<BesselCalc>(2*vals,
+                                        BesselConstants::get_shared(2*vals));
+  auto SHCalcu = make_shared<SHCalc>(2*vals,
+                                     SHCalcConstants::get_shared(2*vals));
+  vector<double> qs = {2.0, -1.0, 0.5}, vdw = {0.0, 0.0, 0.0};
+  vector<Pt> body = {Pt(1.0, 0.2, 0.0), Pt(-0.4, 0.9, 0.6), Pt(0.1,-0.3,-1.1)};
+  Quat qrot(1.1, Pt(0.2, -0.7, 0.4));
+  
+  // molecule 1 is a rotated copy of 0 and shares its E in the first system,
+  // in the second it is given its own type and is expanded from its charges
+  vector<shared_ptr<SystemAM> > systems;
+  for (int shared = 1; shared >= 0; shared--)
+  {
+    vector<shared_ptr<BaseMolecule> > mols;
+    for (int i = 0; i < 2; i++)
+    {
+      vector<Pt> pos(3);
+      for (int j = 0; j < 3; j++) pos[j] = body[j] + Pt(0.0, 0.0, 10.0*i);
+      mols.push_back(make_shared<MoleculeAM>("move", 2.0, qs, pos, vdw,
+                                             Pt(0.0, 0.0, 10.0*i),
+                                             (shared ? 0 : i), i));
+    }
+    systems.push_back(make_shared<SystemAM>(mols));
+    systems.back()->rotate_mol(1, qrot);
+  }
+  
+  ASolver shareSolv(bCalcu, SHCalcu, systems[0], const_, vals,
+                    systems[0]->get_cutoff());
+  ASolver directSolv(bCalcu, SHCalcu, systems[1], const_, vals,
+                     systems[1]->get_cutoff());
+  
+  // and again after both move, as in a BD step
+  for (int step = 0; step < 2; step++)
+  {
+    for (int n = 0; n < vals; n++)
+    {
+      for (int m = -n; m <= n; m++)
+      {
+        EXPECT_NEAR(shareSolv.get_E_ni(1, n, m).real(),
+                    directSolv.get_E_ni(1, n, m).real(), preclim);
+        EXPECT_NEAR(shareSolv.get_E_ni(1, n, m).imag(),
+                    directSolv.get_E_ni(1, n, m).imag(), preclim);
+      }
+    }
+    for (int s = 0; s < 2; s++)
+    {
+      systems[s]->rotate_mol(0, Quat(0.4, Pt(1.0, 1.0, 0.0)));
+      systems[s]->rotate_mol(1, Quat(-0.8, Pt(0.0, 0.3, 1.0)));
+    }
+    shareSolv.reset_all();
+    directSolv.reset_all();
+  }
+}
+
 TEST_F(ASolverUTest, checkSH)
 {
   const int vals = nvals;
@@ -595,6 +652,190 @@ TEST_F(ASolverUTest, checkAMulti)
 }
 
 
+
+// A and grad(A) saved to binary and loaded into a new solver
+TEST_F(ASolverUTest, checkASaveLoad)
+{
+  mol_.clear( );
+  Pt pos[3] = { Pt(0.0,0.0,-5.0), Pt(10.0,7.8,25.0), Pt(-10.0,7.8,25.0)};
+  for (int molInd = 0; molInd < 3; molInd ++ )
+  {
+    vector<double> charges = {2.0, 2.0, 2.0}, vdW = {0.0, 0.0, 0.0};
+    vector<Pt> posCharges = {pos[molInd], pos[molInd] + Pt(1.0, 0.0, 0.0),
+                             pos[molInd] + Pt(0.0, 1.0, 0.0)};
+    mol_.push_back(make_shared<MoleculeAM>("stat", 2.0, charges, posCharges,
+                                           vdW, pos[molInd], molInd, 0));
+  }
+  
+  const int vals = nvals;
+  auto bConsta = make_shared<BesselConstants>(2*vals);
+  auto bCalcu = make_shared<BesselCalc>(2*vals, bConsta);
+  auto SHConsta = make_shared<SHCalcConstants>(2*vals);
+  auto SHCalcu = make_shared<SHCalc>(2*vals, SHConsta);
+  auto sys = make_shared<SystemAM>(mol_);
+  
+  ASolver ASolvTest(bCalcu, SHCalcu, sys, const_, vals, sys->get_cutoff());
+  ASolvTest.solve_A(1E-20, 100);
+  ASolvTest.solve_gradA(1E-20, 100);
+  string afil = test_dir_loc + "A_test.bexp", gfil = test_dir_loc + "dA_test.bexp";
+  ASolvTest.write_A(afil);
+  ASolvTest.write_gradA(gfil);
+  
+  ASolver ASolvRead(bCalcu, SHCalcu, sys, const_, vals, sys->get_cutoff());
+  ASolvRead.read_A(afil);
+  ASolvRead.read_gradA(gfil);
+  for (int i = 0; i < 3; i++)
+    for (int n = 0; n < vals; n++)
+      for (int m = 0; m <= n; m++)
+      {
+        EXPECT_EQ( ASolvTest.get_A_ni(i, n, m), ASolvRead.get_A_ni(i, n, m));
+        // L is reexpanded from the conjugate-symmetric A, equal to roundoff
+        EXPECT_NEAR( ASolvTest.get_L_ni(i, n, m).real(),
+                    ASolvRead.get_L_ni(i, n, m).real(), preclim);
+        EXPECT_NEAR( ASolvTest.get_L_ni(i, n, m).imag(),
+                    ASolvRead.get_L_ni(i, n, m).imag(), preclim);
+        for (int j = 0; j < 3; j++)
+        {
+          EXPECT_EQ( ASolvTest.get_dAdx_ni(i, j, n, m),
+                    ASolvRead.get_dAdx_ni(i, j, n, m));
+          EXPECT_EQ( ASolvTest.get_dAdz_ni(i, j, n, m),
+                    ASolvRead.get_dAdz_ni(i, j, n, m));
+        }
+        // grad(L) as used for forces
+        for (int d = 0; d < 3; d++)
+          EXPECT_NEAR( abs((*ASolvTest.get_gradL())[i][d](n, m+vals) -
+                           (*ASolvRead.get_gradL())[i][d](n, m+vals)), 0,
+                      preclim);
+      }
+  
+  // grad(A) is not A, and A is only read with the cutoff it was saved with
+  EXPECT_THROW( ASolvRead.read_gradA(afil), BadExpansionFileException);
+  ASolver ASolvCut(bCalcu, SHCalcu, sys, const_, vals, sys->get_cutoff()/2);
+  EXPECT_THROW( ASolvCut.read_A(afil), BadExpansionFileException);
+  remove(afil.c_str());
+  remove(gfil.c_str());
+}
+// Far field single precision T should agree with the all double solution
+TEST_F(ASolverUTest, checkAMixedPrec)
+{
+  mol_.clear( );
+  shared_ptr<MoleculeAM> molNew;
+  Pt pos[3] = { Pt(0.0,0.0,-5.0), Pt(10.0,7.8,25.0), Pt(-10.0,7.8,25.0)};
+  for (int molInd = 0; molInd < 3; molInd ++ )
+  {
+    int M = 3; vector<double> charges(M); vector<double> vdW(M);
+    vector<Pt> posCharges(M);
+    charges[0]=2.0; vdW[0]=0; posCharges[0] = pos[molInd];
+    charges[1]=2.0; vdW[1]=0; posCharges[1] = pos[molInd] + Pt(1.0, 0.0, 0.0);
+    charges[2]=2.0; vdW[2]=0; posCharges[2] = pos[molInd] + Pt(0.0, 1.0, 0.0);
+    
+    molNew = make_shared<MoleculeAM> ( "stat", 2.0, charges, posCharges, vdW,
+                                      pos[molInd], molInd, 0);
+    mol_.push_back( molNew );
+  }
+  
+  const int vals = nvals;
+  shared_ptr<BesselConstants> bConsta = make_shared<BesselConstants>(2*vals);
+  shared_ptr<BesselCalc> bCalcu = make_shared<BesselCalc>(2*vals, bConsta);
+  shared_ptr<SHCalcConstants> SHConsta = make_shared<SHCalcConstants>(2*vals);
+  shared_ptr<SHCalc> SHCalcu = make_shared<SHCalc>(2*vals, SHConsta);
+  shared_ptr<SystemAM> sys = make_shared<SystemAM>(mol_);
+  
+  ASolver ASolvDbl(bCalcu, SHCalcu, sys, const_, vals, sys->get_cutoff());
+  ASolvDbl.solve_A(1E-40, 1000);
+  ASolvDbl.solve_gradA(1E-40, 1000);
+  
+  // Molecule 0 is ~35A from the others, 1 and 2 are 20A apart
+  shared_ptr<Constants> constMix = make_shared<Constants>(*const_);
+  constMix->set_mixed_prec_dist(25.0);
+  ASolver ASolvMix(bCalcu, SHCalcu, sys, constMix, vals, sys->get_cutoff());
+  ASolvMix.solve_A(1E-40, 1000);
+  ASolvMix.solve_gradA(1E-40, 1000);
+  
+  double mixlim = 1e-5;
+  for (int i = 0; i < 3; i++)
+  {
+    for ( int n = 0; n < vals; n++ )
+    {
+      for ( int m = 0; m <= n; m++ )
+      {
+        cmplx ad = ASolvDbl.get_A_ni(i, n, m);
+        cmplx am = ASolvMix.get_A_ni(i, n, m);
+        EXPECT_NEAR(abs(am - ad)/abs(ASolvDbl.get_A_ni(i, 0, 0)), 0, mixlim);
+        
+        for (int j = 0; j < 3; j++)
+        {
+          cmplx dd = ASolvDbl.get_dAdx_ni(i, j, n, m);
+          cmplx dm = ASolvMix.get_dAdx_ni(i, j, n, m);
+          EXPECT_NEAR(abs(dm - dd), 0, mixlim);
+        }
+      }
+    }
+  }
+}
+
+// exposes single polarization iterations for the allocation test
+class IterASolver : public ASolver
+{
+public:
+  IterASolver(shared_ptr<BesselCalc> bcalc, shared_ptr<SHCalc> shcalc,
+              shared_ptr<SystemAM> sys, shared_ptr<Constants> consts, int p)
+  :ASolver(bcalc, shcalc, sys, consts, p, sys->get_cutoff()) { }
+  
+  void run_iter() { iter(); }
+  MyMatrix<cmplx> get_reexp(int i, int j)   { return re_expandA(i, j); }
+  void get_reexp_into(int i, int j, MyMatrix<cmplx> & out)
+  { re_expandA_into(i, j, out); }
+};
+
+TEST_F(ASolverUTest, checkIterNoAlloc)
+{
+  mol_.clear( );
+  shared_ptr<MoleculeAM> molNew;
+  Pt pos[3] = { Pt(0.0,0.0,-5.0), Pt(10.0,7.8,25.0), Pt(-10.0,7.8,25.0)};
+  for (int molInd = 0; molInd < 3; molInd ++ )
+  {
+    int M = 3; vector<double> charges(M); vector<double> vdW(M);
+    vector<Pt> posCharges(M);
+    charges[0]=2.0; vdW[0]=0; posCharges[0] = pos[molInd];
+    charges[1]=2.0; vdW[1]=0; posCharges[1] = pos[molInd] + Pt(1.0, 0.0, 0.0);
+    charges[2]=2.0; vdW[2]=0; posCharges[2] = pos[molInd] + Pt(0.0, 1.0, 0.0);
+    
+    molNew = make_shared<MoleculeAM> ( "stat", 2.0, charges, posCharges, vdW,
+                                      pos[molInd], molInd, 0);
+    mol_.push_back( molNew );
+  }
+  
+  const int vals = nvals;
+  shared_ptr<BesselConstants> bConsta = make_shared<BesselConstants>(2*vals);
+  shared_ptr<BesselCalc> bCalcu = make_shared<BesselCalc>(2*vals, bConsta);
+  shared_ptr<SHCalcConstants> SHConsta = make_shared<SHCalcConstants>(2*vals);
+  shared_ptr<SHCalc> SHCalcu = make_shared<SHCalc>(2*vals, SHConsta);
+  shared_ptr<SystemAM> sys = make_shared<SystemAM>(mol_);
+  
+  IterASolver ASolvTest(bCalcu, SHCalcu, sys, const_, vals);
+  ASolvTest.run_iter();  // sizes the scratch arena
+  
+  AllocCounter::reset();
+  for (int t = 0; t < 3; t++) ASolvTest.run_iter();
+  EXPECT_EQ(AllocCounter::get_count(), 0);
+  
+  // buffered re-expansion matches the value returning one
+  MyMatrix<cmplx> out(vals, 2*vals+1);
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      if (i == j) continue;
+      MyMatrix<cmplx> ref = ASolvTest.get_reexp(i, j);
+      ASolvTest.get_reexp_into(i, j, out);
+      for (int n = 0; n < vals; n++)
+        for (int m = -n; m <= n; m++)
+          EXPECT_NEAR(abs(out(n, m+vals) - ref(n, m+vals)), 0, preclim);
+    }
+  }
+}
+
 TEST_F(ASolverUTest, checkAMultiPBC)
 {
   mol_.clear( );
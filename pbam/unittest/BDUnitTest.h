@@ -697,4 +697,277 @@ TEST_F(BDUTest, BDrunTimeTermRot)
   }
 }
 
+
+// ligand in the tabulated potential of a static receptor against the full
+// two body solve, with the ligand first on and then off the grid
+TEST_F(BDUTest, StaticGridForce)
+{
+  const int vals = 5;
+  auto bCalcu = make_shared<BesselCalc>(2*vals,
+                                        make_shared<BesselConstants>(2*vals));
+  auto SHCalcu = make_shared<SHCalc>(2*vals,
+                                     make_shared<SHCalcConstants>(2*vals));
+  auto cst = make_shared<Constants> (const_);
+  
+  for (double d : {18.0, 25.0})
+  {
+    vector<shared_ptr<BaseMolecule> > mol;
+    mol.push_back(make_shared<MoleculeAM>( "stat", 8.0,
+                            vector<double> {3.0, -1.0},
+                            vector<Pt> {Pt(2.0, 0.0, 0.0), Pt(-2.0, 1.0, 0.0)},
+                            vector<double> {0.0, 0.0}, Pt(0.0, 0.0, 0.0), 0, 0));
+    mol.push_back(make_shared<MoleculeAM>( "move", 2.0,
+                            vector<double> {-1.0, 0.5},
+                            vector<Pt> {Pt(d, 0.5, 0.3), Pt(d+1, 0.5, 0.3)},
+                            vector<double> {0.0, 0.0}, Pt(d, 0.5, 0.3), 1, 0));
+    auto sys = make_shared<SystemAM>(mol);
+    auto ASolvTest = make_shared<ASolver>( bCalcu, SHCalcu, sys, cst, vals,
+                                          sys->get_cutoff());
+    ASolvTest->solve_A(1E-12); ASolvTest->solve_gradA(1E-12);
+    PhysCalcAM full( ASolvTest, "");
+    full.calc_force(); full.calc_torque();
+    
+    vector<shared_ptr<BaseMolecule> > rec(1, make_shared<MoleculeAM>(
+                                *dynamic_pointer_cast<MoleculeAM>(mol[0])));
+    auto recSys = make_shared<SystemAM>(rec);
+    auto recSolv = make_shared<ASolver>( bCalcu, SHCalcu, recSys, cst, vals,
+                                        recSys->get_cutoff());
+    recSolv->solve_A(1E-12);
+    auto electro = make_shared<ElectrostaticAM>(recSolv, 0);
+    function<double(Pt)> pot = [electro] (Pt p) { return electro->pot_at(p);};
+    Pt cen;
+    auto grid = make_static_grid(recSys, 1.0, 12.0, pot, cen);
+    EXPECT_EQ( d < 20.0, grid->contains(sys->get_centerik(1, 0)));
+    
+    GridPhysCalc gcalc( sys, grid, pot, cen, vector<int> (1, 1), false, cst,
+                       "");
+    gcalc.calc_force();
+    EXPECT_NEAR( gcalc.get_forcei(1).x()/full.get_forcei(1).x(), 1, 0.05);
+    EXPECT_NEAR( gcalc.get_taui(1).z()/full.get_taui(1).z(), 1, 0.2);
+    EXPECT_EQ( 0.0, gcalc.get_forcei(0).norm());
+  }
+}
+
+TEST_F(BDUTest, FarFieldStep)
+{
+  auto make_sys = [] (Pt lig) {
+    vector<shared_ptr<BaseMolecule> > mol;
+    mol.push_back(make_shared<MoleculeAM>( "stat", 8.0,
+                            vector<double> {3.0}, vector<Pt> {Pt()},
+                            vector<double> {0.0}, Pt(), 0, 0));
+    mol.push_back(make_shared<MoleculeAM>( "move", 2.0,
+                            vector<double> {-1.0}, vector<Pt> {lig},
+                            vector<double> {0.0}, lig, 1, 0, 0.01, 0.5));
+    return make_shared<SystemAM>(mol);
+  };
+  auto cst = make_shared<Constants> (const_);
+  
+  // a lone ligand goes to the surface of its sphere, 40 - 8 - 2 - 5 out
+  auto sys = make_sys(Pt(0.0, 0.0, 40.0));
+  BDStepAM step( sys, cst);
+  step.set_rand_seed(3, 0);
+  step.set_far_field(5.0);
+  EXPECT_TRUE( step.far_update());
+  EXPECT_NEAR( (sys->get_centeri(1) - Pt(0.0, 0.0, 40.0)).norm(), 25.0, 1e-9);
+  EXPECT_EQ( 0.0, sys->get_centeri(0).norm());
+  EXPECT_LT( 0.0, sys->get_time());
+  EXPECT_FALSE( step.get_escaped());
+  
+  // but not when it is within the gap
+  sys = make_sys(Pt(0.0, 0.0, 14.0));
+  BDStepAM near( sys, cst);
+  near.set_far_field(5.0);
+  EXPECT_FALSE( near.far_update());
+  EXPECT_EQ( 14.0, sys->get_centeri(1).z());
+  
+  // from 60 past a b-surface of 40, escapes with chance 1 - 40/60
+  int n(2000), esc(0);
+  for (int s = 0; s < n; s++)
+  {
+    sys = make_sys(Pt(0.0, 60.0, 0.0));
+    BDStepAM bstep( sys, cst);
+    bstep.set_rand_seed(s, 0);
+    bstep.set_far_field(5.0, 40.0);
+    bstep.far_update();
+    if (bstep.get_escaped()) esc++;
+    else EXPECT_NEAR( sys->get_unwrapped_center(1).norm(), 40.0, 1e-9);
+  }
+  EXPECT_NEAR( esc/(double) n, 1.0/3.0, 0.03);
+}
+
+// forces between full solves from the frozen polarization and the linear
+// model, each against holding the last solved force, and the step schedule
+TEST_F(BDUTest, MultiStepForce)
+{
+  const int vals = 5;
+  auto bCalcu = make_shared<BesselCalc>(2*vals,
+                                        make_shared<BesselConstants>(2*vals));
+  auto SHCalcu = make_shared<SHCalc>(2*vals,
+                                     make_shared<SHCalcConstants>(2*vals));
+  auto cst = make_shared<Constants> (const_);
+  
+  for (string model : {"frozen", "linear"})
+  {
+    vector<shared_ptr<BaseMolecule> > mol;
+    mol.push_back(make_shared<MoleculeAM>( "stat", 8.0,
+                            vector<double> {3.0, -1.0},
+                            vector<Pt> {Pt(2.0, 0.0, 0.0), Pt(-2.0, 1.0, 0.0)},
+                            vector<double> {0.0, 0.0}, Pt(0.0, 0.0, 0.0), 0, 0));
+    mol.push_back(make_shared<MoleculeAM>( "move", 2.0,
+                            vector<double> {-1.0, 0.5},
+                            vector<Pt> {Pt(16, 0.5, 0.3), Pt(17, 0.5, 0.3)},
+                            vector<double> {0.0, 0.0}, Pt(16, 0.5, 0.3), 1, 0));
+    auto sys = make_shared<SystemAM>(mol);
+    auto ASolvTest = make_shared<ASolver>( bCalcu, SHCalcu, sys, cst, vals,
+                                          sys->get_cutoff());
+    PhysCalcAM full( ASolvTest, "");
+    auto solve = [&] () {
+      sys->clear_all_lists();
+      ASolvTest->reset_all();
+      ASolvTest->solve_A(1E-12); ASolvTest->solve_gradA(1E-12);
+      full.calc_force(); full.calc_torque();
+    };
+    
+    MultiStepForce mts( sys, 4, model, 0.5, 1.0, 0.2, cst->get_kappa(),
+                       cst->get_dielectric_water(), false);
+    EXPECT_TRUE( mts.need_full());
+    solve();
+    mts.refresh( full.get_F(), full.get_Tau());
+    // the linear model learns its slope from a second solve
+    if (model == "linear")
+    {
+      sys->translate_mol(1, Pt(0.3, 0.0, 0.0));
+      solve();
+      mts.refresh( full.get_F(), full.get_Tau());
+    }
+    Pt held = full.get_forcei(1);
+    
+    sys->translate_mol(1, Pt(0.3, 0.0, 0.0));
+    EXPECT_FALSE( mts.need_full());
+    mts.predict();
+    Pt cheap = mts.get_F()->operator[](1);
+    solve();
+    Pt exact = full.get_forcei(1);
+    EXPECT_LT( (cheap - exact).norm(), 0.5*(held - exact).norm());
+    EXPECT_NEAR( (cheap - exact).norm()/exact.norm(), 0, 0.02);
+    
+    for (int s = 1; s < 4; s++)
+    {
+      EXPECT_FALSE( mts.need_full());
+      mts.predict();
+    }
+    EXPECT_TRUE( mts.need_full());
+    mts.refresh( full.get_F(), full.get_Tau());
+    sys->translate_mol(1, Pt(0.0, 1.2, 0.0));
+    EXPECT_TRUE( mts.need_full());
+  }
+  
+  // a tolerance the model cannot meet halves the steps between solves
+  vector<shared_ptr<BaseMolecule> > mol;
+  mol.push_back(make_shared<MoleculeAM>( "stat", 8.0,
+                          vector<double> {3.0}, vector<Pt> {Pt()},
+                          vector<double> {0.0}, Pt(), 0, 0));
+  mol.push_back(make_shared<MoleculeAM>( "move", 2.0,
+                          vector<double> {-1.0}, vector<Pt> {Pt(12, 0, 0)},
+                          vector<double> {0.0}, Pt(12, 0, 0), 1, 0));
+  auto sys = make_shared<SystemAM>(mol);
+  auto F = make_shared<vector<Pt> >(2, Pt(1.0, 0.0, 0.0));
+  auto tau = make_shared<vector<Pt> >(2);
+  MultiStepForce mts( sys, 8, "frozen", 1e-6, 1.0, 0.2, cst->get_kappa(),
+                     cst->get_dielectric_water(), false);
+  mts.refresh( F, tau);
+  sys->translate_mol(1, Pt(0.5, 0.0, 0.0));
+  mts.predict();
+  mts.refresh( F, tau);
+  EXPECT_EQ( 4, mts.get_k());
+  EXPECT_LT( 1e-6, mts.get_drift());
+  EXPECT_EQ( 2, mts.get_n_full());
+}
+
+// a pair table of one dipolar type from two-body solves, read back from file,
+// against a full solve of a pair turned and moved off the table's frame. Near
+// contact mutual polarization needs higher degrees, so the table starts at a
+// 3A gap
+TEST_F(BDUTest, PairTable)
+{
+  const int vals = 5;
+  auto bCalcu = make_shared<BesselCalc>(2*vals,
+                                        make_shared<BesselConstants>(2*vals));
+  auto SHCalcu = make_shared<SHCalc>(2*vals,
+                                     make_shared<SHCalcConstants>(2*vals));
+  auto cst = make_shared<Constants> (const_);
+  auto make_mol = [] (Pt cen, int idx) {
+    return make_shared<MoleculeAM>( "move", 3.0, vector<double> {1.5, -0.5},
+                            vector<Pt> {cen + Pt(1.0, 0.5, 0.0),
+                                        cen + Pt(-1.0, 0.0, 0.5)},
+                            vector<double> {0.0, 0.0}, cen, 0, idx);
+  };
+  
+  vector<shared_ptr<BaseMolecule> > mol;
+  mol.push_back(make_mol(Pt(0.0, 0.0, 0.0), 0));
+  mol.push_back(make_mol(Pt(0.0, 0.0, 7.0), 1));
+  auto pair = make_shared<SystemAM>(mol);
+  
+  PairTable tab(3, 2, 6, 9.0, 19.0, 0, 0);
+  double err = tab.build("pair.tab.samples", 1, [&] (int w)
+  {
+    auto sys = pair->clone();
+    auto solv = make_shared<ASolver>(bCalcu, SHCalcu, sys, cst, vals,
+                                     sys->get_cutoff());
+    auto calc = make_shared<PhysCalcAM>(solv, "");
+    return [=] (double d, Pt u, MyMatrix<double> R) {
+      sys->reset_to(*pair);
+      sys->translate_mol(1, sys->get_centerik(1, 0) * -1.0);
+      sys->rotate_mol(1, R);
+      sys->translate_mol(1, u * d);
+      sys->clear_all_lists();
+      solv->reset_all();
+      solv->solve_A(1E-12); solv->solve_gradA(1E-12);
+      calc->calc_all();
+      PairTable::Sample s;
+      for (int m = 0; m < 2; m++)
+      {
+        s.e[m] = calc->get_omegai(m);
+        s.f[m] = calc->get_forcei(m);
+        s.tau[m] = calc->get_taui(m);
+      }
+      return s;
+    };
+  });
+  EXPECT_LT( err, 0.1);
+  
+  // both turned and moved off the origin
+  auto sys = pair->clone();
+  sys->rotate_mol(0, Quat(0.7, Pt(1.0, -2.0, 0.5)));
+  sys->rotate_mol(1, Quat(2.1, Pt(0.3, 1.0, -1.0)));
+  sys->translate_mol(0, Pt(5.0, -3.0, 2.0));
+  sys->translate_mol(1, Pt(8.0, 2.0, 4.0));
+  auto solv = make_shared<ASolver>(bCalcu, SHCalcu, sys, cst, vals,
+                                   sys->get_cutoff());
+  solv->solve_A(1E-12); solv->solve_gradA(1E-12);
+  PhysCalcAM full( solv, "");
+  full.calc_all();
+  
+  tab.write("pair.tab");
+  vector<shared_ptr<PairTable> > tabs {make_shared<PairTable>("pair.tab")};
+  EXPECT_EQ( tab.get_bytes(), tabs[0]->get_bytes());
+  PairTableCalc tcalc( sys, tabs, false, cst, "");
+  EXPECT_TRUE( tcalc.covers());
+  EXPECT_FALSE( tcalc.pairs_close());
+  tcalc.calc_force();
+  for (int m = 0; m < 2; m++)
+  {
+    Pt exact = full.get_forcei(m), dF = tcalc.get_forcei(m) - exact;
+    Pt exTau = full.get_taui(m), dTau = tcalc.get_taui(m) - exTau;
+    EXPECT_NEAR( dF.norm()/exact.norm(), 0, 0.1);
+    EXPECT_NEAR( dTau.norm()/exTau.norm(), 0, 0.15);
+  }
+  
+  sys->translate_mol(1, sys->get_pbc_dist_vec_base(sys->get_centerik(0, 0),
+                                                   sys->get_centerik(1, 0))
+                     * 0.5);
+  EXPECT_TRUE( tcalc.pairs_close());
+  EXPECT_THROW( PairTable("pair.tab.samples"), BadPairTableException);
+}
+
 #endif /* BDUnitTest_h */
@@ -33,6 +33,10 @@
 #include <limits.h>
 #include "gtest/gtest.h"
 
+// count heap allocations in this binary, see AllocCounter.h
+#define PB_COUNT_ALLOCS
+#include "AllocCounter.h"
+
 using namespace std;
 
 double preclim = 1e-7;    //! precision limit
@@ -83,16 +83,12 @@ BDStepSAM::BDStepSAM(shared_ptr<BaseSystem> _sys, shared_ptr<Constants> _consts,
        bool diff, bool force)
 :BaseBDStep(_sys, _consts, trans_diff_consts, rot_diff_consts, diff, force)
 {
-  random_device rd;
-  randGen_ = mt19937(rd());
 }
 
 BDStepSAM::BDStepSAM(shared_ptr<BaseSystem> _sys, shared_ptr<Constants> _consts,
                bool diff, bool force)
 :BaseBDStep(_sys, _consts, diff, force)
 {
-  random_device rd;
-  randGen_ = mt19937(rd());
 }
 
 void BDStepSAM::compute_min_dist( )
@@ -129,50 +125,88 @@ void BDRunSAM::run(string xyzfile, string statfile, int nSCF)
 {
   int i(0), scf(2), WRITEFREQ(200);
   bool term(false);
-  ofstream xyz_out, stats;
-  xyz_out.open(xyzfile);
-  stats.open(statfile, fstream::in | fstream::out | fstream::app);
+  open_output(xyzfile, statfile);
 
   while (i < maxIter_ and !term)
   {
-    _solver_->reset_all();
     if (nSCF != 0) scf = nSCF;
-
-    _solver_->solve(prec_, scf);
-    _gradSolv_->update_HF(_solver_->get_all_F(), _solver_->get_all_H());
-    _gradSolv_->solve(prec_, scf);
-    _physCalc_->calc_force();
-    _physCalc_->calc_torque();
+    bool far = _stepper_->far_update();
+    bool table = !far && !_grid_ && _table_ && !_table_->pairs_close();
+    bool cheap = !far && !_grid_ && !table && _mts_ && !_mts_->need_full();
+    if (far)
+    {
+      // far from everything, moved without forces
+      if (_mts_) _mts_->invalidate();
+    } else if (_grid_)
+    {
+      bool pairs = _pairSolv_ && _grid_->pairs_close();
+      if (pairs)
+      {
+        _pairSolv_->reset_all();
+        _pairSolv_->solve(prec_, scf);
+        _pairGrad_->update_HF(_pairSolv_->get_all_F(),
+                              _pairSolv_->get_all_H());
+        _pairGrad_->solve(prec_, scf);
+      }
+      _grid_->set_use_pairs(pairs);
+      _grid_->calc_force();
+    } else if (table)
+    {
+      if (_mts_) _mts_->invalidate();
+      _table_->calc_force();
+    } else if (cheap)
+    {
+      _mts_->predict();
+    } else
+    {
+      _solver_->reset_all();
+      _solver_->solve(prec_, scf);
+      _gradSolv_->update_HF(_solver_->get_all_F(), _solver_->get_all_H());
+      _gradSolv_->solve(prec_, scf);
+      _physCalc_->calc_force();
+      _physCalc_->calc_torque();
+      if (_mts_) _mts_->refresh(_physCalc_->get_F(), _physCalc_->get_Tau());
+    }
     
     
     if ((i % WRITEFREQ) == 0 )
     {
-      _stepper_->get_system()->write_to_xyz(xyz_out);
+      write_output(i);
 //      cout << "This is step " << i << endl;
 //      for (int i = 0; i<_stepper_->get_system()->get_n(); i++)
 //      {
 //      cout << "This is force " <<  _physCalc_->get_forcei(i).x() <<", "<< _physCalc_->get_forcei(i).y() << ", " << _physCalc_->get_forcei(i).z() <<  endl;
 //      }
-        _physCalc_->print_all();
     }
     
-    _stepper_->bd_update(_physCalc_->get_F(), _physCalc_->get_Tau());
+    if (table)
+      _stepper_->bd_update(_table_->get_F(), _table_->get_Tau());
+    else if (cheap)
+      _stepper_->bd_update(_mts_->get_F(), _mts_->get_Tau());
+    else if (!far)
+      _stepper_->bd_update(_physCalc_->get_F(), _physCalc_->get_Tau());
     
-    if (_terminator_->is_terminated(_stepper_->get_system()))
+    bool escaped = _stepper_->get_escaped();
+    if (escaped || _terminator_->is_terminated(_stepper_->get_system()))
     {
       term = true;
       // Printing out details at end
-      _stepper_->get_system()->write_to_xyz(xyz_out);
-      _physCalc_->print_all();
-      stats << _terminator_->get_how_term(_stepper_->get_system());
-      stats << " at time (ps) " << _stepper_->get_system()->get_time() << endl;
+      write_output(i);
+      ostringstream how;
+      if (escaped) how << _stepper_->get_how_escaped();
+      else how << _terminator_->get_how_term(_stepper_->get_system());
+      how << " at time (ps) " << _stepper_->get_system()->get_time();
+      write_stats(how.str());
     }
     i++;
   }
   
   if ( i >= maxIter_ )
-    stats << "System has gone over max number of BD iterations" << endl;
+    write_stats("System has gone over max number of BD iterations");
   
-  xyz_out.close();
-  stats.close();
+  if (_mts_)
+    cout << "Full solves for " << _mts_->get_n_full() << " of "
+         << _mts_->get_n_steps() << " force steps, ending with k = "
+         << _mts_->get_k() << endl;
+  close_output();
 }
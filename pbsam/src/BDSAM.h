@@ -36,6 +36,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <random>
 #include <memory>
 #include "BaseBD.h"
+#include "PotentialGrid.h"
 #include "ElectrostaticsSAM.h"
 
 
@@ -95,6 +96,12 @@ protected:
   shared_ptr<Solver> _solver_;
   shared_ptr<GradSolver> _gradSolv_;
   
+  // static molecules from a potential grid, with solvers of the mobile
+  // molecules alone for their close pairs (see set_static_grid)
+  shared_ptr<GridPhysCalc> _grid_;
+  shared_ptr<Solver>       _pairSolv_;
+  shared_ptr<GradSolver>   _pairGrad_;
+  
 public:
   // num is the number of bodies to perform calculations on (2, 3 or all).
   // If num=0, then the equations will be solved exactly
@@ -105,6 +112,19 @@ public:
   
   void run(string xyzfile = "test.xyz", string statfile = "stats.dat", 
            int nSCF = 0);
+  
+  // take forces from grid instead of solving the whole system every step.
+  // pairSolv and pairGrad, if given, solve the mobile molecules when any
+  // are close
+  void set_static_grid(shared_ptr<GridPhysCalc> grid,
+                       shared_ptr<Solver> pairSolv = nullptr,
+                       shared_ptr<GradSolver> pairGrad = nullptr)
+  {
+    _grid_ = grid;
+    _pairSolv_ = pairSolv;
+    _pairGrad_ = pairGrad;
+    _physCalc_ = grid;
+  }
 
   Pt get_force_i(int i)      {return _physCalc_->get_forcei(i);}
   Pt get_torque_i(int i)     {return _physCalc_->get_taui(i);}
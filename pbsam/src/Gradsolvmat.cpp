@@ -7,6 +7,7 @@
 //
 
 #include "Gradsolvmat.h"
+#include "PoleKernels.h"
 
 
 void GradCmplxMolMat::reset_mat()
@@ -36,6 +37,18 @@ void GradNumericalMat::reset_mat(int k)
   
 }
 
+// dimension d of the surface values of sphere k, points where the whole
+// gradient vanishes are zeroed so they can be skipped
+void GradNumericalMat::surf_dim(int k, int d, vector<double> & vals) const
+{
+  vals.resize(mat_[k].size());
+  for (int h = 0; h < (int) mat_[k].size(); h++)
+  {
+    Pt xh = mat_[k][h];
+    vals[h] = (xh.norm2() < 1e-15) ? 0.0 : xh.get_cart(d);
+  }
+}
+
 GradWFMatrix::GradWFMatrix(int I, int wrt, int ns, int p,
                            double eps_in, double eps_out,
                            double kappa)
@@ -188,44 +201,26 @@ void GradFMatrix::calc_val_k(int k, shared_ptr<IEMatrix> IE,
   }
   
 #ifdef __LAU
-  applyMMat(&IE->get_IE_k_org(k)[0],&df_in[0],&df_out[0],1.0,0.0,p2,dim,p2);
+  applyMMat(IE->get_IE_k_ptr(k),&df_in[0],&df_out[0],1.0,0.0,p2,dim,p2);
 #else
-  vector<MyMatrix<double> > df_out1(3, MyMatrix<double> (p2, 1));
-  for (int d = 0; d < dim; d++)  // 3 dimensions
-  {
-    MyMatrix<double> df_in1(p2, 1, &df_in[d*p2]);
-    df_out1[d] = IE->get_IE_k(k) * df_in1;  // Matrix vector multiplication
-  }
-  
-  for (int o = 0; o<p2; o++)
-    
+  POLE_DISPATCH(p_, ie_matmul_fixed, p_, IE->get_IE_k_ptr(k), &df_in[0],
+                &df_out[0], dim);
 #endif
 
   ct = 0;
   for (int d = 0; d < 3; d++)  // 3 dimensions
   {
-#ifndef __LAU
-    ct = 0;
-#endif
     for (int n = 0; n < p_; n++)  // rows in new matrix
     {
       double scl = 1.0 / (double)(2.0*n+1.0);
       for (int m = 0; m < n+1; m++)  // columns in new matrix
       {
-#ifdef __LAU
         dfRe = df_out[ct];
-#else
-        dfRe = df_out1[d](ct,0);
-#endif
         ct++;
         
         if ( m > 0 )
         {
-#ifdef __LAU
           dfIm = df_out[ct];
-#else
-          dfIm = df_out1[d](ct,0);
-#endif
           ct++;
         } else
           dfIm = 0.0;
@@ -298,41 +293,26 @@ void GradHMatrix::calc_val_k(int k, vector<double> besseli,
   }
 
 #ifdef __LAU
-  applyMMat(&IE->get_IE_k_org(k)[0],&dh_in[0],&dh_out[0],1.0,0.0,p2,dim,p2);
+  applyMMat(IE->get_IE_k_ptr(k),&dh_in[0],&dh_out[0],1.0,0.0,p2,dim,p2);
 #else
-  vector<MyMatrix<double> > dh_out1(3, MyMatrix<double> (p2, 1));
-  for (int d = 0; d < dim; d++)  // 3 dimensions
-  {
-    MyMatrix<double> dh_in1(p2, 1, &dh_in[d*p2]);
-    dh_out1[d] = IE->get_IE_k(k) * dh_in1;  // Matrix vector multiplication
-  }
+  POLE_DISPATCH(p_, ie_matmul_fixed, p_, IE->get_IE_k_ptr(k), &dh_in[0],
+                &dh_out[0], dim);
 #endif
   
   ct = 0;
   for (d = 0; d < 3; d++)  // 3 dimensions
   {
-#ifndef __LAU
-    ct = 0;
-#endif
     for (n = 0; n < p_; n++)  // rows in new matrix
     {
       double scl = besseli[n] / (double)(2.0*n+1.0);
       for (m = 0; m < n+1; m++)  // columns in new matrix
       {
-#ifdef __LAU
         dhR = dh_out[ct];
-#else
-        dhR = dh_out1[d](ct,0);
-#endif
         ct++;
         
         if ( m > 0 )
         {
-#ifdef __LAU
           dhI = dh_out[ct];
-#else
-          dhI = dh_out1[d](ct,0);
-#endif
           ct++;
         } else
           dhI = 0.0;
@@ -430,6 +410,57 @@ void GradLFMatrix::calc_val_k(int k, shared_ptr<BaseMolecule> mol,
 }
 
 
+/*
+ Only sphere k is refreshed, the others are refreshed after their own
+ dF has been updated
+ */
+void GradLFMatrix::init_k(int k, shared_ptr<GradFMatrix> dF,
+                          const SurfaceQuad & quad)
+{
+  vector<double> x, vals[3];
+  for (int d = 0; d < 3; d++)
+  {
+    quad.pack(dF->get_mat_k(k), d, x);
+    quad.eval_surf(k, x, vals[d], false);
+  }
+  
+  mat_[k].resize(quad.get_npts(k));
+  for (int h = 0; h < quad.get_npts(k); h++)
+    set_mat_kh(k, h, Pt(vals[0][h], vals[1][h], vals[2][h]));
+}
+
+void GradLFMatrix::calc_val_k(int k, const vector<int> & interpol,
+                              shared_ptr<TMatrix> T,
+                              shared_ptr<GradFMatrix> dF,
+                              const SurfaceQuad & quad)
+{
+  MyMatrix<Ptx> inner(p_, 2*p_+1);
+  VecOfMats<cmplx>::type Z(3, MyMatrix<cmplx> (p_, 2*p_+1));
+  vector<double> x, vals;
+  
+  for (int j = 0; j < get_ns(); j++)
+  {
+    if (j == k) continue;
+    if ((interpol[k] != 0) || (interpol[j] != 0)) continue;
+    
+    if (T->is_analytic(I_, k, I_, j))
+    {
+      inner += T->re_expand_gradX(dF->get_mat_k(j), I_, k, I_, j, true);
+    } else
+    {
+      for (int d = 0; d < 3; d++)
+      {
+        surf_dim(j, d, vals);
+        quad.project(k, j, vals, x, false);
+        quad.unpack(x, Z[d]);
+      }
+      inner += T->convert_to_ptx(Z);
+    }
+  }
+  mat_cmplx_[k] = inner;
+}
+
+
 GradLHMatrix::GradLHMatrix(int I, int wrt, int ns, int p, double kappa)
 :GradNumericalMat(I, wrt, ns, p), kappa_(kappa)
 {
@@ -512,6 +543,53 @@ void GradLHMatrix::calc_val_k(int k, shared_ptr<BaseMolecule> mol,
 }
 
 
+void GradLHMatrix::init_k(int k, shared_ptr<GradHMatrix> dH,
+                          const SurfaceQuad & quad)
+{
+  vector<double> x, vals[3];
+  for (int d = 0; d < 3; d++)
+  {
+    quad.pack(dH->get_mat_k(k), d, x);
+    quad.eval_surf(k, x, vals[d], true);
+  }
+  
+  mat_[k].resize(quad.get_npts(k));
+  for (int h = 0; h < quad.get_npts(k); h++)
+    set_mat_kh(k, h, Pt(vals[0][h], vals[1][h], vals[2][h]));
+}
+
+void GradLHMatrix::calc_val_k(int k, const vector<int> & interpol,
+                              shared_ptr<TMatrix> T,
+                              shared_ptr<GradHMatrix> dH,
+                              const SurfaceQuad & quad)
+{
+  MyMatrix<Ptx> inner(p_, 2*p_+1);
+  VecOfMats<cmplx>::type Z(3, MyMatrix<cmplx> (p_, 2*p_+1));
+  vector<double> x, vals;
+  
+  for (int j = 0; j < get_ns(); j++)
+  {
+    if (j == k) continue;
+    if ((interpol[k] != 0) || (interpol[j] != 0)) continue;
+    
+    if (T->is_analytic(I_, k, I_, j))
+    {
+      inner += T->re_expand_gradX(dH->get_mat_k(j), I_, k, I_, j);
+    } else
+    {
+      for (int d = 0; d < 3; d++)
+      {
+        surf_dim(j, d, vals);
+        quad.project(k, j, vals, x, true);
+        quad.unpack(x, Z[d]);
+      }
+      inner += T->convert_to_ptx(Z);
+    }
+  }
+  mat_cmplx_[k] = inner;
+}
+
+
 Ptx GradHMatrix::calc_dh_P(Pt P, int k,
                             vector<double> besseli,
                             shared_ptr<SHCalc> shcalc)
@@ -60,7 +60,7 @@ public:
     else               mat_[k](n, m+p_).set_z(val);
   }
   
-  MyMatrix<Ptx> get_mat_k(int k) const { return mat_[k]; }
+  const MyMatrix<Ptx> & get_mat_k(int k) const { return mat_[k]; }
   void set_mat_k(int k, MyMatrix<Ptx> mat )
   {
     for (int n = 0; n < p_; n++)
@@ -166,10 +166,11 @@ public:
   Ptx get_mat_knm(int k, int n, int m)  { return mat_cmplx_[k](n,m+p_); }
   void set_mat_kh(int k, int h, Pt val) { mat_[k][h] = val; }
   vector<Pt> get_mat_k(int k)           { return mat_[k]; }
-  vector<vector<Pt> > get_mat()         { return mat_; }
+  const vector<vector<Pt> > & get_mat() const { return mat_; }
   int get_mat_k_len(int k)                 { return (int)mat_[k].size(); }
   
   void reset_mat(int k);
+  void surf_dim(int k, int d, vector<double> & vals) const;
   
   friend ostream & operator<<(ostream & fout, GradNumericalMat & M)
   {
@@ -397,6 +398,11 @@ public:
                   shared_ptr<GradFMatrix> dF,
                   shared_ptr<PreCalcSH> pre_sh,
                   bool no_pre_sh=false);
+  
+  // As above, using the precomputed surface quadrature of the molecule
+  void init_k(int k, shared_ptr<GradFMatrix> dF, const SurfaceQuad & quad);
+  void calc_val_k(int k, const vector<int> & interpol, shared_ptr<TMatrix> T,
+                  shared_ptr<GradFMatrix> dF, const SurfaceQuad & quad);
 };
 
 /*
@@ -425,6 +431,11 @@ public:
                   shared_ptr<TMatrix> T, shared_ptr<GradHMatrix> dH,
                   shared_ptr<PreCalcSH> pre_sh,
                   bool no_pre_sh=false);
+  
+  // As above, using the precomputed surface quadrature of the molecule
+  void init_k(int k, shared_ptr<GradHMatrix> dH, const SurfaceQuad & quad);
+  void calc_val_k(int k, const vector<int> & interpol, shared_ptr<TMatrix> T,
+                  shared_ptr<GradHMatrix> dH, const SurfaceQuad & quad);
 };
 
 /*
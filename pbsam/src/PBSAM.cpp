@@ -7,6 +7,11 @@
 //
 
 #include "PBSAM.h"
+#include "AllocCounter.h"
+
+#ifdef __MPI
+#include <unistd.h>
+#endif
 
 PBSAM::PBSAM() : PBSAMInput(), poles_(6), solveTol_(1e-4)
 {
@@ -37,9 +42,13 @@ PBSAM::PBSAM() : PBSAMInput(), poles_(6), solveTol_(1e-4)
 }
 
 
-PBSAM::PBSAM(string infile) : poles_(6)
+PBSAM::PBSAM(string infile, string cacheDir) : poles_(6)
 {
   _setp_ = make_shared<Setup>(infile);
+  if (cacheDir != "") _setp_->set_cache_dir(cacheDir);
+  int seed = _setp_->getRandSeed();
+  MPIShard::bcast(seed);
+  _setp_->set_rand_seed(seed);
   check_setup();
 
   _syst_ = make_shared<SystemSAM> ();
@@ -55,7 +64,7 @@ PBSAM::PBSAM(string infile) : poles_(6)
     solveTol_ = 1e-4;
 
   init_consts_calcs();
-  initialize_pbsam();
+  share_precomputed();
 }
 
 
@@ -194,23 +203,26 @@ void PBSAM::init_write_system()
 {
   if (_setp_->get_randOrient())
   {
+    // keyed by the run seed, on a counter the trajectory kicks never use
+    PhiloxStream rng(_setp_->getRandSeed(), 0, 0, ~0u);
     for ( int i = 0; i < _syst_->get_n(); i++)
-      _syst_->rotate_mol(i, Quat().chooseRandom());
+      _syst_->rotate_mol(i, Quat().chooseRandom(rng));
   }
 
   // writing initial configuration out
-  _syst_->write_to_pqr( _setp_->getRunName() + ".pqr");
+  if (MPIShard::rank() == 0)
+    _syst_->write_to_pqr( _setp_->getRunName() + ".pqr");
   cout << "Written config" << endl;
 }
 
 
 void PBSAM::init_consts_calcs()
 {
-  _bessl_consts_ = make_shared<BesselConstants>(2*poles_);
+  _bessl_consts_ = BesselConstants::get_shared(2*poles_);
   _bessl_calc_ = make_shared<BesselCalc>(2*poles_, _bessl_consts_);
-  _sh_consts_ = make_shared<SHCalcConstants>(2*poles_);
+  _sh_consts_ = SHCalcConstants::get_shared(2*poles_);
   _sh_calc_ = make_shared<SHCalc>(2*poles_, _sh_consts_);
-  _exp_consts_ = make_shared<ExpansionConstants> (poles_);
+  _exp_consts_ = ExpansionConstants::get_shared(poles_);
 
   h_spol_.resize(_syst_->get_n());
   f_spol_.resize(_syst_->get_n());
@@ -233,12 +245,64 @@ shared_ptr<SystemSAM> PBSAM::make_subsystem(vector<int> mol_idx)
   return _subsys;
 }
 
+// IE matrices depend only on the sphere geometry, relative to the first
+// sphere so that copies anywhere in the box share an entry
+string PBSAM::imat_cache_key(int i, IEMatrix::Quadrature quad)
+{
+  auto mol = _syst_->get_moli(_syst_->get_mol_global_idx(i,0));
+  Pt c0 = mol->get_centerk(0), d;
+  CacheKey key;
+  key.add(string("imat 1"));
+  key.add(poles_);
+  key.add((int) quad);
+  if (quad == IEMatrix::UNIFORM) key.add(Constants::IMAT_GRID);
+  key.add(mol->get_ns());
+  for (int k = 0; k < mol->get_ns(); k++)
+  {
+    d = mol->get_centerk(k) - c0;
+    key.add(d.x()); key.add(d.y()); key.add(d.z());
+    key.add(mol->get_ak(k));
+  }
+  return key.str();
+}
+
+// Self-polarization depends on the IE matrices that are used, whether they
+// were computed, cached or given with the imat keyword, and adds the
+// charges, their spheres and the medium
+string PBSAM::spol_cache_key(int i, shared_ptr<IEMatrix> imat)
+{
+  auto mol = _syst_->get_moli(_syst_->get_mol_global_idx(i,0));
+  Pt c0 = mol->get_centerk(0), d, o;
+  CacheKey key;
+  key.add(string("spol 3"));
+  key.add(poles_);
+  for (int k = 0; k < mol->get_ns(); k++)
+    key.add(imat->get_IE_k_ptr(k), (size_t) poles_*poles_*poles_*poles_);
+  key.add(mol->get_nc());
+  for (int j = 0; j < mol->get_nc(); j++)
+  {
+    d = mol->get_posj_realspace(j) - c0;
+    o = mol->get_posj(j);
+    key.add(d.x()); key.add(d.y()); key.add(d.z());
+    key.add(o.x()); key.add(o.y()); key.add(o.z());
+    key.add(mol->get_qj(j));
+  }
+  key.add(_consts_->get_dielectric_prot());
+  key.add(_consts_->get_dielectric_water());
+  key.add(_consts_->get_kappa(), 1e-12);
+  key.add(_syst_->get_cutoff());
+  return key.str();
+}
+
 // Check to see if there are interaction
 // matrices provided and
-// if there are expansions from self-polarization
+// if there are expansions from self-polarization. Those that are not are
+// taken from the cache directory when there is one, else computed and
+// written out
 void PBSAM::initialize_pbsam()
 {
   int i, k, j, idx, idx0;
+  PrecomputeCache cache(_setp_->get_cache_dir(), _setp_->get_cache_mb());
   for (i = 0; i < _setp_->getNType(); i++)
   {
     string fil=_setp_->getTypeNPQR(i);
@@ -249,23 +313,61 @@ void PBSAM::initialize_pbsam()
                                      _sh_calc_, poles_, _exp_consts_,
                                      true, 0, true); // Calc points for mol
 
-    imats_[idx0] = make_shared<IEMatrix>(idx0, _syst_->get_moli(idx0),
-                                        _sh_calc_, poles_, _exp_consts_,
-                                        false);
+    IEMatrix::Quadrature quad = (_setp_->get_imat_quad() == "adaptive") ?
+                                IEMatrix::ADAPTIVE : IEMatrix::UNIFORM;
+    string ikey = cache.enabled() ? imat_cache_key(i, quad) : "";
+    string istart = _setp_->getTypeNImat(i), ient;
+    if (istart == "" && (ient = cache.lookup(ikey)) != "")
+      istart = ient + "/imat.imat";
 
-    if (_setp_->getTypeNImat(i) != "" )
+    bool readImat = (istart != "");
+    if (readImat)
     {
-      string istart = _setp_->getTypeNImat(i);
-      for (j = 0; j < _syst_->get_Ns_i(i); j++)
-        imats_[idx0]->init_from_file(istart+to_string(j)+".bin", j);
-
-    } else
+      imats_[idx0] = make_shared<IEMatrix>(idx0, _syst_->get_moli(idx0),
+                                          _sh_calc_, poles_, _exp_consts_,
+                                          false, 0, false, quad);
+      try
+      {
+        if (ient != "") cout << "Reading cached IMatrices " << istart << endl;
+        if (IMatStore::is_store_path(istart))
+          imats_[idx0]->init_from_store(IMatStore::open(istart),
+                                        _syst_->get_moli(idx0));
+        else
+          for (j = 0; j < _syst_->get_Ns_i(i); j++)
+            imats_[idx0]->init_from_file(istart+to_string(j)+".bin", j);
+      } catch (const exception & ex)
+      {
+        if (ient == "") throw;
+        // evicted or damaged since the lookup
+        cout << "Could not use cached IMatrices (" << ex.what()
+             << "), recomputing" << endl;
+        cache.discard(ient);
+        readImat = false;
+      }
+    }
+    
+    if (!readImat)
     {
+      imats_[idx0] = make_shared<IEMatrix>(idx0, _syst_->get_moli(idx0),
+                                          _sh_calc_, poles_, _exp_consts_,
+                                          false, Constants::IMAT_GRID, false,
+                                          quad);
       cout << "Generating IMatrices " << fil << endl;
       clock_t t3 = clock();
 
       imats_[idx0]->calc_vals(_syst_->get_moli(idx0), _sh_calc_);
-      imats_[idx0]->write_all_mat(fil.substr(0, fil.size()-4));
+      if (cache.enabled())
+      {
+        string tmp = cache.begin_entry(ikey);
+        if (tmp != "")
+        {
+          imats_[idx0]->write_store(tmp + "/imat.imat",
+                                    _syst_->get_moli(idx0));
+          cache.commit_entry(ikey, tmp);
+        }
+      } else
+        imats_[idx0]->write_store(fil.substr(0, fil.size()-4)+".imat",
+                                  _syst_->get_moli(idx0));
 
       t3 = clock() - t3;
       printf ("Imat took me %f seconds.\n",
@@ -275,7 +377,7 @@ void PBSAM::initialize_pbsam()
     for (k=1; k<_setp_->getTypeNCount(i); k++)
     {
       idx = _syst_->get_mol_global_idx(i,k);
-      imats_[idx] = make_shared<IEMatrix>(imats_[idx0]);
+      imats_[idx] = imats_[idx0]; // IE is read only, one copy per type
 
       _syst_->copy_grid(_syst_->get_mol_global_idx(i,0), idx);
     }
@@ -290,19 +392,51 @@ void PBSAM::initialize_pbsam()
                                             poles_, 0.0);
     }
     // Performing similar operations for expansions
-    if (_setp_->getTypeNExp(i) != "" )
+    string estart = _setp_->getTypeNExp(i), skey, sent;
+    if (estart == "" && cache.enabled())
     {
-      string estart = _setp_->getTypeNExp(i);
-      for (j = 0; j < _syst_->get_typect(i); j++)
+      skey = spol_cache_key(i, imats_[idx0]);
+      if ((sent = cache.lookup(skey)) != "")
       {
-        for (k = 0; k < _syst_->get_Ns_i(i); k++)
+        estart = sent + "/spol";
+        cout << "Reading cached self-pol " << estart << endl;
+      }
+    }
+    bool readExp = (estart != "");
+    if (readExp)
+    {
+      try
+      {
+        bool binary = ifstream((estart+".H.bexp").c_str()).good();
+        for (j = 0; j < _syst_->get_typect(i); j++)
         {
           idx = _syst_->get_mol_global_idx(i,j);
-          h_spol_[idx]->init_from_exp(estart+".H."+to_string(k)+".exp",k);
-          f_spol_[idx]->init_from_exp(estart+".F."+to_string(k)+".exp",k);
+          if (binary && j > 0)
+          {
+            h_spol_[idx]->set_all_mats(h_spol_[idx0]);
+            f_spol_[idx]->set_all_mats(f_spol_[idx0]);
+          } else if (binary)
+          {
+            h_spol_[idx]->init_from_binary(estart+".H.bexp");
+            f_spol_[idx]->init_from_binary(estart+".F.bexp");
+          } else
+            for (k = 0; k < _syst_->get_Ns_i(i); k++)
+            {
+              h_spol_[idx]->init_from_exp(estart+".H."+to_string(k)+".exp",k);
+              f_spol_[idx]->init_from_exp(estart+".F."+to_string(k)+".exp",k);
+            }
         }
+      } catch (const exception & ex)
+      {
+        if (sent == "") throw;
+        cout << "Could not use cached self-pol (" << ex.what()
+             << "), recomputing" << endl;
+        cache.discard(sent);
+        readExp = false;
       }
-    } else
+    }
+    
+    if (!readExp)
     {
       cout << "Solving for self-pol + writing out for mol type " << i << endl;
       // Make one mol system for each type to solve for self-polarization
@@ -324,18 +458,88 @@ void PBSAM::initialize_pbsam()
         f_spol_[idx] = self_pol.get_all_F()[0];
       }
       //Printing out H and F of selfpol
-      self_pol.get_all_H()[0]->print_all_to_file(fil.substr(0, fil.size()-4)
-                                                 +".H", _consts_->get_kappa(),
-                                                 _syst_->get_cutoff());
-
-      self_pol.get_all_F()[0]->print_all_to_file(fil.substr(0, fil.size()-4)
-                                                 +".F", _consts_->get_kappa(),
-                                                 _syst_->get_cutoff());
+      string tmp = cache.begin_entry(skey);
+      string eout = (tmp != "") ? tmp + "/spol" : fil.substr(0, fil.size()-4);
+      self_pol.get_all_H()[0]->write_binary(eout +".H.bexp",
+                                            _consts_->get_kappa(),
+                                            _syst_->get_cutoff());
+
+      self_pol.get_all_F()[0]->write_binary(eout +".F.bexp",
+                                            _consts_->get_kappa(),
+                                            _syst_->get_cutoff());
+      cache.commit_entry(skey, tmp);
     }
   }
 }
 
 
+// The other ranks get the matrices as the files rank 0 would cache them in,
+// and read them back through initialize_pbsam
+void PBSAM::share_precomputed()
+{
+#ifdef __MPI
+  int i, idx0, rank = MPIShard::rank();
+  if (MPIShard::size() == 1)
+  {
+    initialize_pbsam();
+    return;
+  }
+  
+  char tmpl[] = "/tmp/pbsam_mpi_XXXXXX";
+  const char * tmpdir = mkdtemp(tmpl);
+  if (tmpdir == NULL)
+  {
+    cout << "Could not make a directory in /tmp" << endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  
+  if (rank == 0) initialize_pbsam();
+  vector<string> paths;
+  for (i = 0; i < _setp_->getNType(); i++)
+  {
+    idx0 = _syst_->get_mol_global_idx(i,0);
+    string base = string(tmpdir) + "/type" + to_string(i);
+    string imat, hexp, fexp;
+    if (rank == 0)
+    {
+      imats_[idx0]->write_store(base + ".imat", _syst_->get_moli(idx0));
+      h_spol_[idx0]->write_binary(base + ".H.bexp", _consts_->get_kappa(),
+                                  _syst_->get_cutoff());
+      f_spol_[idx0]->write_binary(base + ".F.bexp", _consts_->get_kappa(),
+                                  _syst_->get_cutoff());
+      imat = MPIShard::read_file(base + ".imat");
+      hexp = MPIShard::read_file(base + ".H.bexp");
+      fexp = MPIShard::read_file(base + ".F.bexp");
+    }
+    MPIShard::bcast(imat);
+    MPIShard::bcast(hexp);
+    MPIShard::bcast(fexp);
+    if (rank != 0)
+    {
+      MPIShard::write_file(base + ".imat", imat);
+      MPIShard::write_file(base + ".H.bexp", hexp);
+      MPIShard::write_file(base + ".F.bexp", fexp);
+      _setp_->set_precomputed(i, base + ".imat", base);
+    }
+    paths.push_back(base + ".imat");
+    paths.push_back(base + ".H.bexp");
+    paths.push_back(base + ".F.bexp");
+  }
+  
+  if (rank != 0)
+  {
+    _setp_->set_cache_dir("");
+    initialize_pbsam();
+  }
+  for (i = 0; i < paths.size(); i++) remove(paths[i].c_str());
+  rmdir(tmpdir);
+  cout << "IMats and self-polarization shared with " << MPIShard::size()-1;
+  cout << " ranks" << endl;
+#else
+  initialize_pbsam();
+#endif
+}
+
 int PBSAM::run()
 {
   cout << "Now running program" << endl;
@@ -347,6 +551,8 @@ int PBSAM::run()
     run_energyforce( );
   else if ( _setp_->getRunType() == "bodyapprox")
     run_bodyapprox( );
+  else if ( _setp_->getRunType() == "pairtable")
+    run_pairtable( );
   else
     cout << "Runtype not recognized! See manual for options" << endl;
 
@@ -362,7 +568,7 @@ PBAMOutput PBSAM::run_apbs()
 
 void PBSAM::run_dynamics()
 {
-  int traj, i, j = 0;
+  int i, j = 0;
   auto solv = make_shared<Solver>(_syst_, _consts_, _sh_calc_, _bessl_calc_,
                                   poles_, imats_, h_spol_, f_spol_);
 
@@ -372,7 +578,8 @@ void PBSAM::run_dynamics()
                                        solv->get_IE(),
                                        solv->get_interpol_list(),
                                        solv->get_precalc_sh(),
-                                       _exp_consts_, poles_);
+                                       _exp_consts_, poles_, false,
+                                       solv->get_quad());
   vector<shared_ptr<BaseTerminate > >  terms(_setp_->get_numterms());
   for (i = 0; i < _setp_->get_numterms(); i++)
   {
@@ -425,40 +632,192 @@ void PBSAM::run_dynamics()
   HowTermCombine com = (_setp_->get_andCombine() ? ALL : ONE);
   auto term_conds = make_shared<CombineTerminate> (terms, com);
 
-  char buff[100], outb[100];
+  char outb[100];
   sprintf( outb, "%s.stat", _setp_->getRunName().c_str());
   string statfile = outb;
+  
+  vector<string> typePQR(_setp_->getNType());
+  for (i = 0; i < _setp_->getNType(); i++) typePQR[i] = _setp_->getTypeNPQR(i);
 
-  for (traj = 0; traj < _setp_->getNTraj(); traj++)
+  // With potgrid the static molecules are solved once, on their own, and
+  // their potential is tabulated for the mobile ones
+  vector<int> stat, mobile;
+  for (i = 0; i < _syst_->get_n(); i++)
+    (_syst_->get_typei(i) == "stat" ? stat : mobile).push_back(i);
+  shared_ptr<PotentialGrid> grid;
+  function<double(Pt)> statPot;
+  Pt gridCen;
+  if (_setp_->get_pot_grid_h() > 0 && !stat.empty() && !mobile.empty())
+  {
+    vector<shared_ptr<BaseMolecule> > mols;
+    vector<shared_ptr<IEMatrix> > statImats;
+    for (int k : stat)
+    {
+      mols.push_back(make_shared<MoleculeSAM>(
+                   *dynamic_pointer_cast<MoleculeSAM>(_syst_->get_moli(k))));
+      statImats.push_back(imats_[k]);
+    }
+    auto statSys = make_shared<SystemSAM>(mols, _syst_->get_cutoff(),
+                                          _syst_->get_boxlength());
+    auto statSolv = make_shared<Solver>(statSys, _consts_, _sh_calc_,
+                                        _bessl_calc_, poles_, statImats,
+                                        h_spol_, f_spol_);
+    if (statSys->get_n() > 1) statSolv->solve(solveTol_, 100);
+    auto electro = make_shared<ElectrostaticSAM>(statSolv, 0);
+    statPot = [electro] (Pt p) { return electro->pot_at(p); };
+    grid = make_static_grid(statSys, _setp_->get_pot_grid_h(),
+                            _setp_->get_pot_grid_pad(), statPot, gridCen);
+    cout << "Potential of " << stat.size() << " static molecules on "
+         << grid->get_npts() << " grid points" << endl;
+  }
+  
+  // pair tables, read once and shared by every trajectory
+  vector<shared_ptr<PairTable> > tables;
+  try {
+    for (int t = 0; t < _setp_->get_n_pair_tab(); t++)
+      tables.push_back(make_shared<PairTable>(_setp_->get_pair_tab(t)));
+  } catch (const exception& ex)
+  {
+    cout << ex.what() << endl;
+    exit(0);
+  }
+  if (!tables.empty() &&
+      !PairTableCalc(_syst_, tables, true, _consts_, "").covers())
+  {
+    cout << "Pair tables do not cover every pair of molecule types, "
+         << "solving fully instead" << endl;
+    tables.clear();
+  }
+  
+  // Worker 0 runs on _syst_ with the solvers above, the others on clones
+  // with their own solvers sharing the IMats, self-polarization and tables.
+  // Every trajectory starts from the same initial system
+  auto initial = _syst_->clone();
+  int nthreads = _setp_->get_traj_threads();
+  BDFarm farm(nthreads, _setp_->getNTraj(), statfile);
+  if (farm.get_nthreads() > 1 || farm.get_nranks() > 1)
+    cout << "Running trajectories on " << farm.get_nthreads() << " threads"
+         << " of " << farm.get_nranks() << " ranks\n";
+  
+  farm.run([&] (int w) -> BDFarm::TrajFn
   {
-    sprintf( buff, "%s_%d.xyz", _setp_->getRunName().c_str(), traj);
-    string xyztraj = buff;
-    sprintf( outb, "%s_%d.dat", _setp_->getRunName().c_str(), traj);
-    string outfile = outb;
-
-    string stats = _setp_->getRunName();
-    _syst_->reset_positions( _setp_->get_trajn_xyz(traj));
-    _syst_->set_time(0.0);
-    solv->set_H_F(h_spol_, f_spol_);
-    BDRunSAM dynamic_run( solv, gsolv, term_conds, outfile);
-    dynamic_run.run(xyztraj, statfile);
-    cout << "Done with trajectory " << traj << endl;
-    if (traj==0)
-      for (i=0; i<_syst_->get_n(); i++)
+    shared_ptr<SystemSAM> sys = _syst_;
+    shared_ptr<Solver> wsolv = solv;
+    shared_ptr<GradSolver> wgsolv = gsolv;
+    if (w > 0)
+    {
+      sys = initial->clone();
+      auto sh_calc = make_shared<SHCalc>(2*poles_, _sh_consts_);
+      wsolv = make_shared<Solver>(sys, _consts_, sh_calc, _bessl_calc_,
+                                  poles_, imats_, h_spol_, f_spol_);
+      wgsolv = make_shared<GradSolver>(sys, _consts_, sh_calc, _bessl_calc_,
+                                       wsolv->get_T(), wsolv->get_all_F(),
+                                       wsolv->get_all_H(), wsolv->get_IE(),
+                                       wsolv->get_interpol_list(),
+                                       wsolv->get_precalc_sh(),
+                                       _exp_consts_, poles_, false,
+                                       wsolv->get_quad());
+    }
+    
+    // the mobile molecules of sys on their own, for their close pairs
+    shared_ptr<Solver> pairSolv;
+    shared_ptr<GradSolver> pairGrad;
+    if (grid && mobile.size() > 1)
+    {
+      vector<shared_ptr<BaseMolecule> > mols;
+      vector<shared_ptr<IEMatrix> > pairImats;
+      for (int k : mobile)
       {
-        Pt tmp = dynamic_run.get_force_i(i)*_consts_->get_conv_factor();
-        force_[i][0]=tmp.x(); force_[i][1]=tmp.y(); force_[i][2]=tmp.z();
-        tmp = dynamic_run.get_torque_i(i)*_consts_->get_conv_factor();
-        torque_[i][0]=tmp.x(); torque_[i][1]=tmp.y(); torque_[i][2]=tmp.z();
-        nrg_intera_[i]=dynamic_run.get_energy_i(i)*_consts_->get_conv_factor();
+        mols.push_back(sys->get_moli(k));
+        pairImats.push_back(imats_[k]);
       }
-  }
+      auto pairSys = make_shared<SystemSAM>(mols, sys->get_cutoff(),
+                                            sys->get_boxlength());
+      auto sh_calc = make_shared<SHCalc>(2*poles_, _sh_consts_);
+      pairSolv = make_shared<Solver>(pairSys, _consts_, sh_calc, _bessl_calc_,
+                                     poles_, pairImats, h_spol_, f_spol_);
+      pairGrad = make_shared<GradSolver>(pairSys, _consts_, sh_calc,
+                                         _bessl_calc_, pairSolv->get_T(),
+                                         pairSolv->get_all_F(),
+                                         pairSolv->get_all_H(),
+                                         pairSolv->get_IE(),
+                                         pairSolv->get_interpol_list(),
+                                         pairSolv->get_precalc_sh(),
+                                         _exp_consts_, poles_, false,
+                                         pairSolv->get_quad());
+    }
+    
+    return [=] (int traj) -> vector<string>
+    {
+      char buff[100];
+      sprintf( buff, "%s_%d.%s", _setp_->getRunName().c_str(), traj,
+              (_setp_->get_traj_format() == "pose") ? "ptraj" : "xyz");
+      string xyztraj = buff;
+      sprintf( buff, "%s_%d.dat", _setp_->getRunName().c_str(), traj);
+      string outfile = buff;
+      
+      sys->reset_to(*initial);
+      sys->reset_positions( _setp_->get_trajn_xyz(traj));
+      sys->set_time(0.0);
+      wsolv->set_H_F(h_spol_, f_spol_);
+      wgsolv->reset_grads();
+      BDRunSAM dynamic_run( wsolv, wgsolv, term_conds, outfile);
+      if (grid)
+      {
+        auto gcalc = make_shared<GridPhysCalc>(sys, grid, statPot, gridCen,
+                                               mobile, true, _consts_,
+                                               outfile);
+        if (pairSolv)
+        {
+          pairSolv->set_H_F(h_spol_, f_spol_);
+          pairGrad->reset_grads();
+          gcalc->set_pair_calc(make_shared<PhysCalcSAM>(pairSolv, pairGrad,
+                                                        ""));
+        }
+        dynamic_run.set_static_grid(gcalc, pairSolv, pairGrad);
+      }
+      dynamic_run.set_pose_traj(typePQR, _setp_->get_traj_double());
+      dynamic_run.set_rand_seed(_setp_->getRandSeed(), traj);
+      dynamic_run.set_far_field(_setp_->get_far_gap(), _setp_->get_far_b());
+      shared_ptr<PairTableCalc> tcalc;
+      if (!tables.empty())
+        tcalc = make_shared<PairTableCalc>(sys, tables, true, _consts_,
+                                           outfile);
+      if (_setp_->get_mts_k() > 1)
+      {
+        auto mts = make_shared<MultiStepForce>(sys,
+                                   _setp_->get_mts_k(), _setp_->get_mts_model(),
+                                   _setp_->get_mts_tol(), _setp_->get_mts_move(),
+                                   _setp_->get_mts_rot(), _consts_->get_kappa(),
+                                   _consts_->get_dielectric_water(), true);
+        // the tables with the many-body remainder of full solves, else alone
+        if (_setp_->get_mts_model() == "table") mts->set_table(tcalc);
+        else if (tcalc) dynamic_run.set_pair_table(tcalc);
+        dynamic_run.set_multi_step(mts);
+      } else if (tcalc) dynamic_run.set_pair_table(tcalc);
+      dynamic_run.run(xyztraj, "");
+      if (traj==0)
+        for (int i=0; i<sys->get_n(); i++)
+        {
+          Pt tmp = dynamic_run.get_force_i(i)*_consts_->get_conv_factor();
+          force_[i][0]=tmp.x(); force_[i][1]=tmp.y(); force_[i][2]=tmp.z();
+          tmp = dynamic_run.get_torque_i(i)*_consts_->get_conv_factor();
+          torque_[i][0]=tmp.x(); torque_[i][1]=tmp.y(); torque_[i][2]=tmp.z();
+          nrg_intera_[i]=dynamic_run.get_energy_i(i)*
+                         _consts_->get_conv_factor();
+        }
+      return dynamic_run.get_stats();
+    };
+  });
 } // end run_dynamics()
 
 void PBSAM::run_electrostatics()
 {
   int i;
   clock_t t3 = clock();
+#ifdef PB_BENCHMARK
+  AllocCounter::reset();
+#endif
   Solver solv(_syst_, _consts_, _sh_calc_, _bessl_calc_, poles_,
               imats_, h_spol_, f_spol_);
   if (_syst_->get_n() > 1) solv.solve(solveTol_, 100);
@@ -466,6 +825,9 @@ void PBSAM::run_electrostatics()
   t3 = clock() - t3;
   printf ("Solve took me %f seconds.\n",
           ((float)t3)/CLOCKS_PER_SEC);
+#ifdef PB_BENCHMARK
+  printf ("heap allocations: %ld\n", AllocCounter::get_count());
+#endif
 
   ElectrostaticSAM estat(solv.get_all_H(), _syst_, _sh_calc_, _bessl_calc_,
                       _consts_, poles_, _setp_->getGridPts());
@@ -488,6 +850,9 @@ void PBSAM::run_energyforce()
 {
   int i;
   clock_t t3 = clock();
+#ifdef PB_BENCHMARK
+  AllocCounter::reset();
+#endif
   auto solv = make_shared<Solver>(_syst_, _consts_, _sh_calc_, _bessl_calc_,
                                   poles_, imats_, h_spol_, f_spol_);
   if (_syst_->get_n() > 1) solv->solve(1e-15, 200);
@@ -497,7 +862,8 @@ void PBSAM::run_energyforce()
                                        solv->get_all_F(), solv->get_all_H(),
                                        solv->get_IE(),solv->get_interpol_list(),
                                         solv->get_precalc_sh(),
-                                       _exp_consts_, poles_);
+                                       _exp_consts_, poles_, false,
+                                       solv->get_quad());
   if (_syst_->get_n() > 1) gsolv->solve(solveTol_, 200);
 
   PhysCalcSAM calcEnFoTo(solv, gsolv, _setp_->getRunName(),
@@ -517,6 +883,102 @@ void PBSAM::run_energyforce()
   t3 = clock() - t3;
   printf ("energyforce calc took me %f seconds.\n",
           ((float)t3)/CLOCKS_PER_SEC);
+#ifdef PB_BENCHMARK
+  printf ("heap allocations: %ld\n", AllocCounter::get_count());
+#endif
+}
+
+void PBSAM::run_pairtable()
+{
+  for (int t = 0; t < _setp_->get_n_pair_tab(); t++)
+  {
+    string path = _setp_->get_pair_tab(t);
+    int type[2] = {_setp_->get_pair_tab_type(t, 0),
+                   _setp_->get_pair_tab_type(t, 1)};
+    
+    // the first molecule of each type with its cog at the origin, turned
+    // back to its input orientation
+    vector<shared_ptr<BaseMolecule> > mols(2);
+    vector<shared_ptr<IEMatrix> > pairImats(2);
+    double rad = 0.0;
+    for (int m = 0; m < 2; m++)
+    {
+      for (int i = 0; i < _syst_->get_n() && !mols[m]; i++)
+        if (_syst_->get_moli(i)->get_type() == type[m])
+        {
+          mols[m] = make_shared<MoleculeSAM>(
+                    *dynamic_pointer_cast<MoleculeSAM>(_syst_->get_moli(i)));
+          pairImats[m] = imats_[i];
+        }
+      if (!mols[m])
+      {
+        cout << "No molecule of type " << type[m]+1 << " for " << path << endl;
+        exit(0);
+      }
+      Pt cog = dynamic_pointer_cast<MoleculeSAM>(mols[m])->get_cog();
+      mols[m]->translate(cog * -1.0, Constants::MAX_DIST);
+      mols[m]->rotate(PairTable::transpose(mols[m]->get_orient()));
+      double r = 0.0;
+      for (int k = 0; k < mols[m]->get_ns(); k++)
+        r = max(r, mols[m]->get_centerk(k).norm() + mols[m]->get_ak(k));
+      rad += r;
+    }
+    
+    PairTable tab(_setp_->get_pair_tab_L(), _setp_->get_pair_tab_J(),
+                  _setp_->get_pair_tab_nd(), rad + _setp_->get_pair_tab_gap(0),
+                  rad + _setp_->get_pair_tab_gap(1), type[0], type[1]);
+    mols[1]->translate(Pt(0.0, 0.0, tab.get_d0()), Constants::MAX_DIST);
+    auto pair = make_shared<SystemSAM>(mols);
+    cout << "Tabulating " << path << " from " << tab.n_samples()
+         << " two-body solves" << endl;
+    
+    clock_t t3 = clock();
+    double err = tab.build(path + ".samples", _setp_->get_traj_threads(),
+                           [&] (int w) -> PairTable::SolveFn
+    {
+      auto sys = pair->clone();
+      auto sh_calc = make_shared<SHCalc>(2*poles_, _sh_consts_);
+      return [=] (double d, Pt u, MyMatrix<double> R) -> PairTable::Sample
+      {
+        sys->reset_to(*pair);
+        sys->translate_mol(1, sys->get_cogi(1) * -1.0);
+        sys->rotate_mol(1, R);
+        sys->translate_mol(1, u * d);
+        // solvers of their own for every pose, as their re-expansions are
+        // of the system they were made for
+        auto solv = make_shared<Solver>(sys, _consts_, sh_calc, _bessl_calc_,
+                                        poles_, pairImats, h_spol_, f_spol_);
+        solv->solve(solveTol_, 100);
+        auto gsolv = make_shared<GradSolver>(sys, _consts_, sh_calc,
+                                             _bessl_calc_, solv->get_T(),
+                                             solv->get_all_F(),
+                                             solv->get_all_H(),
+                                             solv->get_IE(),
+                                             solv->get_interpol_list(),
+                                             solv->get_precalc_sh(),
+                                             _exp_consts_, poles_, false,
+                                             solv->get_quad());
+        gsolv->solve(solveTol_, 100);
+        auto calc = make_shared<PhysCalcSAM>(solv, gsolv, "");
+        calc->calc_all();
+        PairTable::Sample s;
+        for (int m = 0; m < 2; m++)
+        {
+          s.e[m] = calc->get_omegai(m);
+          s.f[m] = calc->get_forcei(m);
+          s.tau[m] = calc->get_taui(m);
+        }
+        return s;
+      };
+    });
+    if (MPIShard::rank() != 0) continue;
+    
+    tab.write(path);
+    t3 = clock() - t3;
+    printf ("pair table of %ld bytes took me %f seconds, ", tab.get_bytes(),
+            ((float)t3)/CLOCKS_PER_SEC);
+    printf ("rms force error %.3g\n", err);
+  }
 }
 
 void PBSAM::run_bodyapprox()
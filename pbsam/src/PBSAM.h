@@ -37,6 +37,9 @@
 #include "PBSAMStruct.h"
 #include "ElectrostaticsSAM.h"
 #include "BDSAM.h"
+#include "BDFarm.h"
+#include "PairTable.h"
+#include "PrecomputeCache.h"
 
 using namespace std;
 
@@ -65,12 +68,16 @@ protected:
 
   int poles_;
   double solveTol_;
+  
+  // Cache keys for the IE matrices and the self-polarized H and F of type i
+  string imat_cache_key(int i, IEMatrix::Quadrature quad);
+  string spol_cache_key(int i, shared_ptr<IEMatrix> imat);
 
 public:
 
   // Constructors
   PBSAM();
-  PBSAM(string infile);
+  PBSAM(string infile, string cacheDir = "");
   // For APBS
   PBSAM(const PBAMInput& pbami, const PBSAMInput& pbsami,
         vector<shared_ptr<BaseMolecule> > mls );
@@ -88,6 +95,9 @@ public:
   void init_write_system();
   void init_consts_calcs();
   void initialize_pbsam();
+  // initialize_pbsam on MPI rank 0, which then sends its IMats and
+  // self-polarization to the other ranks
+  void share_precomputed();
 
   int run();
   // for running the APBS version
@@ -97,6 +107,7 @@ public:
   void run_dynamics();
   void run_electrostatics();
   void run_energyforce();
+  void run_pairtable();
   
   shared_ptr<SystemSAM> make_subsystem(vector<int> mol_idx);
 };
@@ -155,37 +155,19 @@ void PhysCalcSAM::calc_torque()
   _torCalc_->calc_all_tau(_sys_, _fCalc_);
 }
 
-void PhysCalcSAM::print_all()
+PhysSnapshot PhysCalcSAM::snapshot()
 {
-  int i;
-  streambuf * buf;
-  ofstream of;
-
-  if(outfname_ != "")
-  {
-    of.open(outfname_, fstream::in | fstream::out | fstream::app);
-    buf = of.rdbuf();
-  } else {
-    buf = cout.rdbuf();
-  }
-
-  ostream out(buf);
-  out << "My units are " << unit_ << ". Time: " << _sys_->get_time() << endl;
-  for ( i = 0; i < N_; i++)
+  PhysSnapshot snap;
+  snap.t = _sys_->get_time();
+  snap.unit = unit_;
+  snap.unitConv = unit_conv_;
+  snap.outfname = outfname_;
+  for (int i = 0; i < N_; i++)
   {
-    Pt mol_pos = _sys_->get_cogi(i);
-    out << "Molecule #" << i + 1 << endl;
-    out << "\tPOSITION: [" << mol_pos.x() << ", " << mol_pos.y();
-    out << ", " << mol_pos.z() << "]" << endl;
-    out << "\tENERGY: " << unit_conv_ * get_omegai(i) << endl;
-
-    out << "\tFORCE: " << get_forcei(i).norm() * unit_conv_ << ", [";
-    out << get_forcei(i).x() * unit_conv_ << " "
-        << get_forcei(i).y() * unit_conv_ << " "
-        << get_forcei(i).z() * unit_conv_ << "]"<<endl;
-    out << "\tTORQUE: " << get_taui(i).norm() << ", [";
-    out << get_taui(i).x() * unit_conv_ << " "
-        << get_taui(i).y() * unit_conv_ << " "
-        << get_taui(i).z() * unit_conv_ << "]"<<endl;
+    snap.pos.push_back(_sys_->get_cogi(i));
+    snap.energy.push_back(get_omegai(i));
+    snap.force.push_back(get_forcei(i));
+    snap.torque.push_back(get_taui(i));
   }
+  return snap;
 }
@@ -112,7 +112,7 @@ public:
   void calc_energy();
   void calc_torque();
 
-  void print_all();
+  PhysSnapshot snapshot();
 
   shared_ptr<vector<Pt> > get_Tau() { return _torCalc_->get_tau(); }
   shared_ptr<vector<Pt> > get_F()   { return _fCalc_->get_F(); }
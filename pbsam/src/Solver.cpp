@@ -35,19 +35,18 @@ dev_sph_Ik_(_sys->get_n()),
 p_(p),
 kappa_(_consts->get_kappa())
 {
-  _reExConsts_ = make_shared<ReExpCoeffsConstants> (kappa_,
-                                                    _sys_->get_lambda(), p_,
-                                                    true);
+  _reExConsts_ = ReExpCoeffsConstants::get_shared(kappa_,
+                                                _sys_->get_lambda(), p_,
+                                                true);
 
   _precalcSH_ = make_shared<PreCalcSH>();
 
   _T_ = make_shared<TMatrix> (p_, _sys_, _shCalc_, _consts_,
                               _bCalc_, _reExConsts_);
-  precalc_sh_lf_lh();
-  precalc_sh_numeric();
-
-  _expConsts_ = make_shared<ExpansionConstants>(p_);
+  _expConsts_ = ExpansionConstants::get_shared(p_);
+  build_quad();
   shared_ptr<BaseMolecule> _mol;
+  map<vector<string>, shared_ptr<IEMatrix> > imatRead; // one IE per file set
   // intialize all matrices
   for (int I = 0; I < _sys_->get_n(); I++)
   {
@@ -61,21 +60,26 @@ kappa_(_consts->get_kappa())
     double kappa = _consts->get_kappa();
 
     _E_[I] = make_shared<EMatrix> (I, _sys_->get_Ns_i(I), p_);
-    _E_[I]->calc_vals(_mol, _shCalc_, _consts_->get_dielectric_prot());
-
     _LE_[I] = make_shared<LEMatrix> (I, _sys_->get_Ns_i(I), p_);
-    _LE_[I]->calc_vals(_mol, _shCalc_, _consts_->get_dielectric_prot());
+    calc_E_LE(I);
 
     _H_[I] = make_shared<HMatrix>(I, _sys_->get_Ns_i(I), p_, kappa);
     _F_[I] = make_shared<FMatrix>(I, _sys_->get_Ns_i(I), p_, 0.0);
 
     if (readHF)
     {
-      for (int k = 0; k < _sys_->get_Ns_i(I); k++)
+      string hf0 = expHF[I][0][0];
+      if (hf0.size() > 5 && hf0.compare(hf0.size()-5, 5, ".bexp") == 0)
       {
-        _H_[I]->init_from_exp(expHF[I][k][0], k);
-        _F_[I]->init_from_exp(expHF[I][k][1], k);
-      }
+        // one binary file per molecule for each of H and F
+        _H_[I]->init_from_binary(expHF[I][0][0]);
+        _F_[I]->init_from_binary(expHF[I][0][1]);
+      } else
+        for (int k = 0; k < _sys_->get_Ns_i(I); k++)
+        {
+          _H_[I]->init_from_exp(expHF[I][k][0], k);
+          _F_[I]->init_from_exp(expHF[I][k][1], k);
+        }
     } else
     {
       _H_[I]->init(_mol, _shCalc_, _consts_->get_dielectric_prot());
@@ -84,14 +88,25 @@ kappa_(_consts->get_kappa())
     _prevH_[I] = make_shared<HMatrix>(I, _sys_->get_Ns_i(I), p_, kappa);
     _rotH_[I] = make_shared<HMatrix>(I, _sys_->get_Ns_i(I), p_, kappa);
 
-    _IE_[I] = make_shared<IEMatrix>(I, _mol, _shCalc, p_, _expConsts_, false);
-    if (readImat)
+    if (readImat && imatRead.count(imats[I]))
     {
-      for (int k = 0; k < _sys_->get_Ns_i(I); k++)
-        _IE_[I]->init_from_file(imats[I][k], k);
-
+      _IE_[I] = imatRead[imats[I]];
+    } else if (readImat)
+    {
+      _IE_[I] = make_shared<IEMatrix>(I, _mol, _shCalc, p_, _expConsts_,
+                                      false, 0);
+      if (imats[I].size() == 1 && IMatStore::is_store_path(imats[I][0]))
+        _IE_[I]->init_from_store(IMatStore::open(imats[I][0]), _mol);
+      else
+        for (int k = 0; k < _sys_->get_Ns_i(I); k++)
+          _IE_[I]->init_from_file(imats[I][k], k);
+      imatRead[imats[I]] = _IE_[I];
     } else
+    {
+      _IE_[I] = make_shared<IEMatrix>(I, _mol, _shCalc, p_, _expConsts_,
+                                      false);
       _IE_[I]->calc_vals(_mol, _shCalc_);
+    }
 
     _LF_[I] = make_shared<LFMatrix> (I, _sys_->get_Ns_i(I), p_);
     _LH_[I] = make_shared<LHMatrix> (I, _sys_->get_Ns_i(I), p_, kappa);
@@ -136,17 +151,15 @@ p_(p),
 kappa_(_consts->get_kappa())
 {
   int molt;
-  _reExConsts_ = make_shared<ReExpCoeffsConstants> (kappa_,
-                                                    _sys_->get_lambda(),
-                                                    p_, true);
+  _reExConsts_ = ReExpCoeffsConstants::get_shared(kappa_,
+                                                _sys_->get_lambda(),
+                                                p_, true);
   _precalcSH_ = make_shared<PreCalcSH>();
 
   _T_ = make_shared<TMatrix> (p_, _sys_, _shCalc_, _consts_,
                               _bCalc_, _reExConsts_);
-  precalc_sh_lf_lh();
-  precalc_sh_numeric();
-
-  _expConsts_ = make_shared<ExpansionConstants>(p_);
+  _expConsts_ = ExpansionConstants::get_shared(p_);
+  build_quad();
   shared_ptr<BaseMolecule> _mol;
   // intialize all matrices
   for (int I = 0; I < _sys_->get_n(); I++)
@@ -162,13 +175,10 @@ kappa_(_consts->get_kappa())
     double kappa = _consts->get_kappa();
 
     _E_[I] = make_shared<EMatrix> (I, _sys_->get_Ns_i(I), p_);
-    _E_[I]->calc_vals(_mol, _shCalc_, _consts_->get_dielectric_prot());
-
     _LE_[I] = make_shared<LEMatrix> (I, _sys_->get_Ns_i(I), p_);
-    _LE_[I]->calc_vals(_mol, _shCalc_, _consts_->get_dielectric_prot());
+    calc_E_LE(I);
 
-    _IE_[I] = make_shared<IEMatrix>(I, _mol, _shCalc, p_, _expConsts_, false);
-    _IE_[I]->init_from_other(imats[I]);
+    _IE_[I] = imats[I];  // shared, never modified by the solver
 
     _H_[I] = make_shared<HMatrix>(I, _sys_->get_Ns_i(I), p_, kappa);
     _F_[I] = make_shared<FMatrix>(I, _sys_->get_Ns_i(I), p_, 0.0);
@@ -226,6 +236,8 @@ _reExConsts_(solvin->_reExConsts_),
 _expConsts_(solvin->_expConsts_),
 dev_sph_Ik_(solvin->dev_sph_Ik_),
 _precalcSH_(solvin->_precalcSH_),
+_quad_(solvin->_quad_),
+bodyELE_(solvin->bodyELE_),
 mu_(solvin->mu_)
 {
 }
@@ -278,6 +290,28 @@ void Solver::precalc_sh_numeric()
   }
 }
 
+// Surface tables are built once per molecule type and shared. Pair tables
+// are updated in place, and only when the molecule has rotated, so that a
+// GradSolver sharing them stays current
+void Solver::build_quad()
+{
+  map<int, shared_ptr<SurfaceQuad> > first_of_type;
+  _quad_.resize(_sys_->get_n());
+  for (int I = 0; I < _sys_->get_n(); I++)
+  {
+    if (_quad_[I])
+    {
+      _quad_[I]->update_pairs(_sys_->get_moli(I), _shCalc_, _bCalc_);
+      continue;
+    }
+    int type = _sys_->get_moli(I)->get_type();
+    _quad_[I] = make_shared<SurfaceQuad>(I, _sys_->get_moli(I), _T_,
+                                         _shCalc_, _bCalc_, _expConsts_,
+                                         p_, kappa_, first_of_type[type]);
+    if (!first_of_type[type]) first_of_type[type] = _quad_[I];
+  }
+}
+
 void Solver::set_H_F(vector<shared_ptr<HMatrix > > h_spol,
                      vector<shared_ptr<FMatrix > > f_spol)
 {
@@ -287,8 +321,10 @@ void Solver::set_H_F(vector<shared_ptr<HMatrix > > h_spol,
     molt = _sys_->get_moli(I)->get_type();
     _H_[I]->set_all_mats(h_spol[molt]);
     _F_[I]->set_all_mats(f_spol[molt]);
+    // forget the last solve, so that it does not steer the next
+    for (int k = 0; k < _sys_->get_Ns_i(I); k++) dev_sph_Ik_[I][k] = 1.0;
   }
-
+  update_prev_all();
 }
 
 double Solver::calc_converge_H(int I, int k, bool inner)
@@ -364,13 +400,11 @@ void Solver::step(int t, int I, int k)
   // Do full step for spol and for mpol at t > 0
   if ((_sys_->get_n() == 1) || (t > 0))
   {
-    _LH_[I]->init(_sys_->get_moli(I),_H_[I], _shCalc_, _bCalc_,
-                  _precalcSH_, _expConsts_);
-    _LH_[I]->calc_vals(_T_, _H_[I], _precalcSH_, k);
+    _LH_[I]->init(_H_[I], *_quad_[I]);
+    _LH_[I]->calc_vals(_T_, _H_[I], *_quad_[I], k);
 
-    _LF_[I]->init(_sys_->get_moli(I), _F_[I],_shCalc_, _bCalc_,
-                  _precalcSH_, _expConsts_);
-    _LF_[I]->calc_vals(_T_, _F_[I], _sys_, _precalcSH_, k);
+    _LF_[I]->init(_F_[I], *_quad_[I]);
+    _LF_[I]->calc_vals(_T_, _F_[I], *_quad_[I], k);
 
     if (_sys_->get_n()>1)
       _LHN_[I]->calc_vals(_sys_, _T_, _rotH_, k); // use rotated H for mpol
@@ -387,20 +421,20 @@ void Solver::step(int t, int I, int k)
 double Solver::iter(int t)
 {
   double mu_int(0), mu_mpol(0);
+  ScratchArena<cmplx>::Scope scratch;  // released at the end of the iteration
   if ( t == 0 ) mu_ = 0.0;
   Ns_tot_ = 0;
 
   if ((_sys_->get_n()>1) && (t==0)) // For 1st step of mpol
     for (int I = 0; I < _sys_->get_n(); I++)
     {
-      auto molI = _sys_->get_moli(I);
       for (int k = 0; k < _sys_->get_Ns_i(I); k++)
       {
-        _LH_[I]->init(molI,_H_[I], _shCalc_, _bCalc_, _precalcSH_, _expConsts_);
-        _LH_[I]->calc_vals(_T_, _H_[I], _precalcSH_, k);
+        _LH_[I]->init(_H_[I], *_quad_[I]);
+        _LH_[I]->calc_vals(_T_, _H_[I], *_quad_[I], k);
 
-        _LF_[I]->init(molI,_F_[I], _shCalc_, _bCalc_, _precalcSH_, _expConsts_);
-        _LF_[I]->calc_vals(_T_, _F_[I], _sys_, _precalcSH_, k);
+        _LF_[I]->init(_F_[I], *_quad_[I]);
+        _LF_[I]->calc_vals(_T_, _F_[I], *_quad_[I], k);
 
         _LHN_[I]->calc_vals(_sys_, _T_, _H_, k);
       //cout << "this is dev " << dev_sph_Ik_[I][k] << endl;
@@ -531,14 +565,55 @@ void Solver::solve(double tol, int maxiter)
 }
 
 
+// E and LE from charges for the first molecule of each rigid body type,
+// rotated to the current orientation for every other copy
+void Solver::calc_E_LE(int I)
+{
+  if (! bodyELE_.is_assigned())
+  {
+    vector<shared_ptr<BaseMolecule> > mols(_sys_->get_n());
+    for (int J = 0; J < _sys_->get_n(); J++) mols[J] = _sys_->get_moli(J);
+    bodyELE_ = BodyFrameCache(p_);
+    bodyELE_.assign(mols);
+  }
+  
+  shared_ptr<BaseMolecule> _mol = _sys_->get_moli(I);
+  int ns = _mol->get_ns();
+  vector<MyMatrix<cmplx> > ele(2*ns);
+  if (bodyELE_.has(I))
+  {
+    bodyELE_.rotate_to(I, _mol, ele);
+    for (int k = 0; k < ns; k++)
+    {
+      _E_[I]->set_mat_k(k, ele[k]);
+      _LE_[I]->set_mat_k(k, ele[ns+k]);
+    }
+  } else
+  {
+    for (int k = 0; k < ns; k++)
+    {
+      _E_[I]->reset_mat(k);
+      _LE_[I]->reset_mat(k);
+    }
+    _E_[I]->calc_vals(_mol, _shCalc_, _consts_->get_dielectric_prot());
+    _LE_[I]->calc_vals(_mol, _shCalc_, _consts_->get_dielectric_prot());
+    for (int k = 0; k < ns; k++)
+    {
+      ele[k] = _E_[I]->get_mat_k(k);
+      ele[ns+k] = _LE_[I]->get_mat_k(k);
+    }
+    bodyELE_.store(I, _mol, ele);
+  }
+}
+
 void Solver::reset_all()
 {
   for (int I = 0; I < _sys_->get_n(); I++)
   {
-    _E_[I]->calc_vals(_sys_->get_moli(I), _shCalc_,
-                      _consts_->get_dielectric_prot());
-    _LE_[I]->calc_vals(_sys_->get_moli(I), _shCalc_,
-                       _consts_->get_dielectric_prot());
+    calc_E_LE(I);
+    // XF and XH keep their own copy of E and LE, refreshed in place
+    _XF_[I]->set_E_LE(_sys_->get_moli(I), _E_[I], _LE_[I]);
+    _XH_[I]->set_E_LE(_sys_->get_moli(I), _E_[I], _LE_[I]);
     for (int k = 0; k < _sys_->get_Ns_i(I); k++)
     {
       _LF_[I]->reset_mat(k);
@@ -552,9 +627,7 @@ void Solver::reset_all()
     }
   }
 
-  _precalcSH_->clear_sh();
-  precalc_sh_lf_lh();
-  precalc_sh_numeric();
+  build_quad();
 }
 
 
@@ -569,7 +642,8 @@ GradSolver::GradSolver(shared_ptr<SystemSAM> _sys,
                        vector<vector<int > > interpol,
                        shared_ptr<PreCalcSH> precalc_sh,
                        shared_ptr<ExpansionConstants> _expConst,
-                       int p, bool no_pre_sh)
+                       int p, bool no_pre_sh,
+                       vector<shared_ptr<SurfaceQuad> > quad)
 :p_(p), Ns_tot_(0), _F_(_F), _H_(_H), _T_(_T),
 _bCalc_(_bCalc), _shCalc_(_shCalc),
 _sys_(_sys), _consts_(_consts), kappa_(_consts->get_kappa()),
@@ -585,37 +659,19 @@ dLF_(_sys->get_n(), vector<shared_ptr<GradLFMatrix> > (_sys->get_n())),
 dLH_(_sys->get_n(), vector<shared_ptr<GradLHMatrix> > (_sys->get_n())),
 dLHN_(_sys->get_n(), vector<shared_ptr<GradLHNMatrix> > (_sys->get_n())),
 gradT_A_(_sys->get_n(), vector<shared_ptr<GradCmplxMolMat> > (_sys->get_n())),
-precalcSH_(precalc_sh), noPreSH_(no_pre_sh)
+precalcSH_(precalc_sh), noPreSH_(no_pre_sh), quad_(quad)
 {
-  dF_.reserve(_sys_->get_n());
-  for (int I = 0; I < _sys_->get_n(); I++) // With respect to
+  if (quad_.size() == 0)
   {
-    for (int J = 0; J < _sys_->get_n(); J++) // molecule
-    {
-      dF_[I][J] = make_shared<GradFMatrix> (J, I, _sys_->get_Ns_i(I), p_);
-      dWF_[I][J] = make_shared<GradWFMatrix> (J, I, _sys_->get_Ns_i(I), p_,
-                                              _consts->get_dielectric_prot(),
-                                              _consts->get_dielectric_water(),
-                                              _consts->get_kappa());
-
-      dLF_[I][J] = make_shared<GradLFMatrix> (J, I, _sys_->get_Ns_i(I), p_);
-      dLHN_[I][J] = make_shared<GradLHNMatrix> (J, I, _sys_->get_Ns_i(I), p_);
-
-      prev_dH_[I][J] = make_shared<GradHMatrix> (J, I, _sys_->get_Ns_i(I),
-                                                 p_, kappa_);
-      outer_dH_[I][J] = make_shared<GradHMatrix> (J, I, _sys_->get_Ns_i(I),
-                                                  p_, kappa_);
-      dH_[I][J] = make_shared<GradHMatrix> (J,I,_sys_->get_Ns_i(I),p_,kappa_);
-
-      dWH_[I][J] = make_shared<GradWHMatrix> (J,I,_sys_->get_Ns_i(I),p_,kappa_);
-      dLH_[I][J] = make_shared<GradLHMatrix> (J,I,_sys_->get_Ns_i(I),p_,kappa_);
-
-      gradT_A_[I][J] = make_shared<GradCmplxMolMat> (J,I,_sys_->get_Ns_i(I),
-                                                  p_);
-    }
-    dev_sph_Ik_[I].resize(_sys_->get_Ns_i(I));
+    quad_.resize(_sys_->get_n());
+    for (int I = 0; I < _sys_->get_n(); I++)
+      quad_[I] = make_shared<SurfaceQuad>(I, _sys_->get_moli(I), _T_, _shCalc_,
+                                          _bCalc_, _expConsts_, p_, kappa_);
   }
 
+  dF_.reserve(_sys_->get_n());
+  reset_grads();
+
   for (int i = 0; i < _T_->get_T_ct(); i++)  _T_->compute_derivatives_i(i);
 }
 
@@ -623,6 +679,7 @@ GradSolver::GradSolver(shared_ptr<GradSolver> gradin)
 : p_(gradin->p_), kappa_(gradin->kappa_), Ns_tot_(gradin->Ns_tot_),
 precalcSH_(gradin->precalcSH_),
 noPreSH_(gradin->noPreSH_),
+quad_(gradin->quad_),
 _F_(gradin->_F_),
 _H_(gradin->_H_),
 _IE_(gradin->_IE_),
@@ -646,6 +703,40 @@ interpol_(gradin->interpol_),
 dev_sph_Ik_(gradin->dev_sph_Ik_)
 { }
 
+// Fresh gradient expansions, so that a new trajectory does not start from
+// the last gradients of the previous one
+void GradSolver::reset_grads()
+{
+  for (int I = 0; I < _sys_->get_n(); I++) // With respect to
+  {
+    for (int J = 0; J < _sys_->get_n(); J++) // molecule
+    {
+      // expansions of J, so one per sphere of J
+      dF_[I][J] = make_shared<GradFMatrix> (J, I, _sys_->get_Ns_i(J), p_);
+      dWF_[I][J] = make_shared<GradWFMatrix> (J, I, _sys_->get_Ns_i(J), p_,
+                                              _consts_->get_dielectric_prot(),
+                                              _consts_->get_dielectric_water(),
+                                              _consts_->get_kappa());
+
+      dLF_[I][J] = make_shared<GradLFMatrix> (J, I, _sys_->get_Ns_i(J), p_);
+      dLHN_[I][J] = make_shared<GradLHNMatrix> (J, I, _sys_->get_Ns_i(J), p_);
+
+      prev_dH_[I][J] = make_shared<GradHMatrix> (J, I, _sys_->get_Ns_i(J),
+                                                 p_, kappa_);
+      outer_dH_[I][J] = make_shared<GradHMatrix> (J, I, _sys_->get_Ns_i(J),
+                                                  p_, kappa_);
+      dH_[I][J] = make_shared<GradHMatrix> (J,I,_sys_->get_Ns_i(J),p_,kappa_);
+
+      dWH_[I][J] = make_shared<GradWHMatrix> (J,I,_sys_->get_Ns_i(J),p_,kappa_);
+      dLH_[I][J] = make_shared<GradLHMatrix> (J,I,_sys_->get_Ns_i(J),p_,kappa_);
+
+      gradT_A_[I][J] = make_shared<GradCmplxMolMat> (J,I,_sys_->get_Ns_i(J),
+                                                  p_);
+    }
+    dev_sph_Ik_[I].resize(_sys_->get_Ns_i(I));
+  }
+}
+
 void GradSolver::solve(double tol, int maxiter)
 {
   double mu;
@@ -676,6 +767,7 @@ double GradSolver::iter(int t, int wrt)
   shared_ptr<BaseMolecule> molI;
   vector<double> besseli, besselk;
   vector<int> mol_loop;
+  ScratchArena<cmplx>::Scope scratch;  // released at the end of the iteration
 
   for (int I = 0; I < _sys_->get_n(); I++)
     if (( I != wrt ) && ( _sys_->get_min_dist(wrt, I) < inter_pol_d))
@@ -697,17 +789,15 @@ double GradSolver::iter(int t, int wrt)
       if (!_sys_->get_moli(I)->is_J_in_interk(k, wrt) && (I != wrt))
         continue;
 
-      besseli = _bCalc_->calc_mbfI(p_+1, kappa_*molI->get_ak(k));
-      besselk = _bCalc_->calc_mbfK(p_+1, kappa_*molI->get_ak(k));
+      _bCalc_->calc_mbfI(p_+1, kappa_*molI->get_ak(k), besseli);
+      _bCalc_->calc_mbfK(p_+1, kappa_*molI->get_ak(k), besselk);
 
       update_outer_gradH(I, wrt, k);
       step( t, I, wrt, k, besseli, besselk);
       iter_inner_gradH(I, wrt, k, besseli, besselk);
 
-      dLF_[wrt][I]->init_k(k,molI,dF_[wrt][I],_shCalc_, precalcSH_ ,
-                           _expConsts_, noPreSH_);
-      dLH_[wrt][I]->init_k(k,molI,dH_[wrt][I],_shCalc_,_bCalc_, precalcSH_,
-                           _expConsts_, noPreSH_);
+      dLF_[wrt][I]->init_k(k, dF_[wrt][I], *quad_[I]);
+      dLH_[wrt][I]->init_k(k, dH_[wrt][I], *quad_[I]);
 
       dev_sph_Ik_[I][k] = calc_converge_gradH(I, wrt, k, false);
       mu_mpol += dev_sph_Ik_[I][k];
@@ -721,11 +811,8 @@ double GradSolver::iter(int t, int wrt)
 void GradSolver::step(int t, int I, int wrt, int k, vector<double> &besseli,
                       vector<double> &besselk)
 {
-  shared_ptr<BaseMolecule> molI = _sys_->get_moli(I);
-  dLF_[wrt][I]->calc_val_k(k, molI, interpol_[I], _T_, dF_[wrt][I],
-                           precalcSH_, noPreSH_);
-  dLH_[wrt][I]->calc_val_k(k, molI, interpol_[I], _T_, dH_[wrt][I],
-                           precalcSH_, noPreSH_);
+  dLF_[wrt][I]->calc_val_k(k, interpol_[I], _T_, dF_[wrt][I], *quad_[I]);
+  dLH_[wrt][I]->calc_val_k(k, interpol_[I], _T_, dH_[wrt][I], *quad_[I]);
 }
 
 
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <memory>
 #include "Gradsolvmat.h"
+#include "BodyFrameCache.h"
 #include <unordered_map>
 #include <map>
 #include <vector>
@@ -57,6 +58,8 @@ protected:
   vector<vector<double> >           dev_sph_Ik_;
   
   shared_ptr<PreCalcSH>             _precalcSH_;
+  vector<shared_ptr<SurfaceQuad> >  _quad_; // surface quadrature per molecule
+  BodyFrameCache                    bodyELE_; // E and LE per molecule type
 
   double                            mu_; // SCF deviation max
   
@@ -68,6 +71,9 @@ protected:
   
   void iter_innerH(int I, int k);
   
+  // set E and LE of molecule I, rotated from its type where possible
+  void calc_E_LE(int I);
+  
 public:
   //Used primarily for testing
   Solver(shared_ptr<SystemSAM> _sys, shared_ptr<Constants> _consts,
@@ -103,6 +109,8 @@ public:
   void precalc_sh_lf_lh();
   // pre-calculate spherical harmonics for numeric re-expansion
   void precalc_sh_numeric();
+  // build the surface quadrature tables used by LF, LH and their gradients
+  void build_quad();
   
   void set_H_F(vector<shared_ptr<HMatrix > > h_spol,
                vector<shared_ptr<FMatrix > > f_spol);
@@ -111,6 +119,7 @@ public:
   
   vector<shared_ptr<HMatrix> > get_all_H() {return _H_;}
   vector<shared_ptr<EMatrix> > get_all_E() {return _E_;}
+  vector<shared_ptr<LEMatrix> > get_all_LE() {return _LE_;}
   vector<shared_ptr<FMatrix> > get_all_F() {return _F_;}
   MyMatrix<cmplx> getH_ik(int I, int k) {return _H_[I]->get_mat_k(k);}
   MyMatrix<cmplx> getF_ik(int I, int k) {return _F_[I]->get_mat_k(k);}
@@ -139,6 +148,7 @@ public:
   shared_ptr<SHCalc> get_sh()              { return _shCalc_;}
   shared_ptr<BesselCalc> get_bessel()      { return _bCalc_;}
   shared_ptr<PreCalcSH> get_precalc_sh()   { return _precalcSH_; }
+  vector<shared_ptr<SurfaceQuad> > get_quad() { return _quad_; }
 };
 
 
@@ -151,6 +161,7 @@ protected:
   
   shared_ptr<PreCalcSH> precalcSH_;
   bool noPreSH_; // if sh values have not been pre-calculated
+  vector<shared_ptr<SurfaceQuad> > quad_; // surface quadrature per molecule
   
   vector<shared_ptr<FMatrix> >      _F_;  // converged solutions for these
   vector<shared_ptr<HMatrix> >      _H_;
@@ -200,7 +211,8 @@ public:
              vector<shared_ptr<HMatrix> > _H, vector<shared_ptr<IEMatrix> > _IE,
              vector<vector<int> > interpol,shared_ptr<PreCalcSH> precalc_sh,
              shared_ptr<ExpansionConstants> _expConst, int p,
-             bool no_pre_sh=false);
+             bool no_pre_sh=false,
+             vector<shared_ptr<SurfaceQuad> > quad = {});
   
   GradSolver(shared_ptr<GradSolver>);
   
@@ -218,6 +230,9 @@ public:
     }
   }
   
+  // zero all gradient expansions, for a new trajectory
+  void reset_grads();
+  
   shared_ptr<GradHMatrix> get_gradH(int I, int wrt) { return dH_[wrt][I];}
   shared_ptr<GradFMatrix> get_gradF(int I, int wrt) { return dF_[wrt][I];}
   
@@ -7,6 +7,7 @@
 //
 
 #include "Solvmat.h"
+#include "PoleKernels.h"
 
 
 // computes Y = alpha*A*X + beta*Y
@@ -130,6 +131,254 @@ ExpansionConstants::ExpansionConstants(int p)
   compute_coeffs();
 }
 
+shared_ptr<ExpansionConstants> ExpansionConstants::get_shared(int p)
+{
+  return TableRegistry<ExpansionConstants>::get({(double) p},
+                          [p] () { return make_shared<ExpansionConstants>(p); });
+}
+
+
+SurfaceQuad::SurfaceQuad(int I, shared_ptr<BaseMolecule> mol,
+                         shared_ptr<TMatrix> T, shared_ptr<SHCalc> shcalc,
+                         shared_ptr<BesselCalc> bcalc,
+                         shared_ptr<ExpansionConstants> _expconst,
+                         int p, double kappa,
+                         shared_ptr<const SurfaceQuad> same_type)
+:p_(p), kappa_(kappa)
+{
+  int k, l, h, n, c;
+  const int p2 = p_*p_;
+  SHWorkspace ws = shcalc->make_workspace();
+  vector<double> bes;
+  vector<int> exp_pts;
+  Pt q;
+  
+  // exposed points of each sphere, weights of Eq. 8c and 10b [1]. The m and
+  // -m terms of a real expansion are equal so m > 0 is counted twice
+  if (same_type)
+  {
+    _surf_ = same_type->_surf_;
+  } else
+  {
+    auto surf = make_shared<SurfTables>();
+    surf->nPts_.resize(mol->get_ns());
+    surf->ySurf_.resize(mol->get_ns());
+    surf->iSurf_.resize(mol->get_ns());
+    for (k = 0; k < mol->get_ns(); k++)
+    {
+      exp_pts = mol->get_gdpt_expj(k);
+      double dA = 4 * M_PI / (double) mol->get_gridj(k).size();
+      int npts = (int) exp_pts.size();
+      surf->nPts_[k] = npts;
+      surf->ySurf_[k].resize(npts*p2);
+      surf->iSurf_[k].resize(npts*p_);
+      for (h = 0; h < npts; h++)
+      {
+        q = mol->get_gridjh(k, exp_pts[h]);
+        double * row = &surf->ySurf_[k][h*p2];
+        pack_sh(q, shcalc, ws, 2.0, row);
+        for (n = 0; n < p_; n++)
+          for (c = n*n; c < (n+1)*(n+1); c++)
+            row[c] *= dA * _expconst->get_const1_l(n);
+        
+        bcalc->calc_mbfI(p_+1, kappa_*q.r(), bes);
+        for (n = 0; n < p_; n++) surf->iSurf_[k][h*p_+n] = 1.0 / bes[n];
+      }
+    }
+    _surf_ = surf;
+  }
+  
+  // pairs that are too close to re-expand analytically (Eq. 27b [1])
+  for (k = 0; k < mol->get_ns(); k++)
+  {
+    for (l = 0; l < mol->get_ns(); l++)
+    {
+      if ((k == l) || T->is_analytic(I, k, I, l)) continue;
+      pairIdx_[{k, l}] = (int) yPair_.size();
+      yPair_.push_back(vector<double> ());
+      rPair_.push_back(vector<double> ());
+      rkPair_.push_back(vector<double> ());
+      pairDist_.push_back(Pt());
+      build_pair((int) yPair_.size()-1, k, l, mol, shcalc, bcalc, ws);
+    }
+  }
+}
+
+void SurfaceQuad::build_pair(int idx, int k, int l,
+                             shared_ptr<BaseMolecule> mol,
+                             shared_ptr<SHCalc> shcalc,
+                             shared_ptr<BesselCalc> bcalc, SHWorkspace & ws)
+{
+  int h, n;
+  const int p2 = p_*p_;
+  double rscl, scl, ekr;
+  vector<double> bes;
+  vector<int> exp_pts = mol->get_gdpt_expj(l);
+  int npts = (int) exp_pts.size();
+  Pt sph_dist = mol->get_centerk(k) - mol->get_centerk(l);
+  
+  pairDist_[idx] = sph_dist;
+  yPair_[idx].resize(npts*p2);
+  rPair_[idx].resize(npts*p_);
+  rkPair_[idx].resize(npts*p_);
+  for (h = 0; h < npts; h++)
+  {
+    Pt loc = mol->get_gridjh(l, exp_pts[h]) - sph_dist;
+    pack_sh(loc, shcalc, ws, 1.0, &yPair_[idx][h*p2]);
+    
+    bcalc->calc_mbfK(p_+1, kappa_*loc.r(), bes);
+    rscl = mol->get_ak(k) / loc.r();
+    scl  = 1.0 / loc.r();
+    ekr  = exp(-kappa_*loc.r());
+    for (n = 0; n < p_; n++)
+    {
+      rPair_[idx][h*p_+n]  = scl;
+      rkPair_[idx][h*p_+n] = scl * bes[n] * ekr;
+      scl *= rscl;
+    }
+  }
+}
+
+int SurfaceQuad::update_pairs(shared_ptr<BaseMolecule> mol,
+                              shared_ptr<SHCalc> shcalc,
+                              shared_ptr<BesselCalc> bcalc)
+{
+  int nbuilt(0);
+  SHWorkspace ws = shcalc->make_workspace();
+  map<vector<int>, int>::iterator it;
+  for (it = pairIdx_.begin(); it != pairIdx_.end(); it++)
+  {
+    int k = it->first[0], l = it->first[1];
+    Pt sph_dist = mol->get_centerk(k) - mol->get_centerk(l);
+    // a translation moves both centers, up to rounding
+    if ((sph_dist - pairDist_[it->second]).norm() <= 1e-12*sph_dist.norm())
+      continue;
+    build_pair(it->second, k, l, mol, shcalc, bcalc, ws);
+    nbuilt++;
+  }
+  return nbuilt;
+}
+
+void SurfaceQuad::pack_sh(Pt pt, shared_ptr<SHCalc> shcalc, SHWorkspace & ws,
+                          double m_scl, double * row)
+{
+  int n, m, c(0);
+  shcalc->calc_sh(pt.theta(), pt.phi(), ws);
+  for (n = 0; n < p_; n++)
+  {
+    for (m = 0; m <= n; m++)
+    {
+      cmplx sh = ws.get_result(n, m);
+      if (m == 0)
+      {
+        row[c++] = sh.real();
+      } else
+      {
+        row[c++] = m_scl * sh.real();
+        row[c++] = m_scl * sh.imag();
+      }
+    }
+  }
+}
+
+void SurfaceQuad::pack(const MyMatrix<cmplx> & X, vector<double> & x) const
+{
+  int n, m, c(0);
+  x.resize(p_*p_);
+  for (n = 0; n < p_; n++)
+  {
+    for (m = 0; m <= n; m++)
+    {
+      x[c++] = X(n, m+p_).real();
+      if (m > 0) x[c++] = X(n, m+p_).imag();
+    }
+  }
+}
+
+void SurfaceQuad::pack(const MyMatrix<Ptx> & X, int d,
+                       vector<double> & x) const
+{
+  int n, m, c(0);
+  x.resize(p_*p_);
+  for (n = 0; n < p_; n++)
+  {
+    for (m = 0; m <= n; m++)
+    {
+      Ptx xnm = X(n, m+p_);
+      x[c++] = xnm.get_cart(d).real();
+      if (m > 0) x[c++] = xnm.get_cart(d).imag();
+    }
+  }
+}
+
+void SurfaceQuad::unpack(const vector<double> & x, MyMatrix<cmplx> & X) const
+{
+  int n, m, c(0);
+  for (n = 0; n < p_; n++)
+  {
+    for (m = 0; m <= n; m++)
+    {
+      if (m == 0)
+      {
+        X(n, p_) = x[c++];
+      } else
+      {
+        X(n, m+p_) = cmplx(x[c], x[c+1]);
+        X(n, -m+p_) = cmplx(x[c], -x[c+1]);
+        c += 2;
+      }
+    }
+  }
+}
+
+void SurfaceQuad::eval_surf(int k, const vector<double> & x,
+                            vector<double> & vals, bool isH) const
+{
+  int h, n, c;
+  const int p2 = p_*p_;
+  vals.resize(_surf_->nPts_[k]);
+  for (h = 0; h < _surf_->nPts_[k]; h++)
+  {
+    const double * row = &_surf_->ySurf_[k][h*p2];
+    double val = 0.0;
+    if (isH)
+    {
+      const double * ib = &_surf_->iSurf_[k][h*p_];
+      for (n = 0; n < p_; n++)
+      {
+        double blk = 0.0;
+        for (c = n*n; c < (n+1)*(n+1); c++) blk += row[c] * x[c];
+        val += blk * ib[n];
+      }
+    } else
+    {
+      for (c = 0; c < p2; c++) val += row[c] * x[c];
+    }
+    vals[h] = val;
+  }
+}
+
+void SurfaceQuad::project(int k, int l, const vector<double> & vals,
+                          vector<double> & x, bool isH) const
+{
+  int h, n, c;
+  const int p2 = p_*p_;
+  const int idx = pairIdx_.at({k, l});
+  const vector<double> & rad = (isH ? rkPair_[idx] : rPair_[idx]);
+  
+  x.assign(p2, 0.0);
+  for (h = 0; h < (int) vals.size(); h++)
+  {
+    if (vals[h] == 0.0) continue;
+    const double * row = &yPair_[idx][h*p2];
+    for (n = 0; n < p_; n++)
+    {
+      double s = vals[h] * rad[h*p_+n];
+      for (c = n*n; c < (n+1)*(n+1); c++) x[c] += s * row[c];
+    }
+  }
+}
+
 
 ComplexMoleculeMatrix::ComplexMoleculeMatrix(int I, int ns, int p)
 :p_(p), mat_(ns, MyMatrix<cmplx> (p, 2*p+1)), I_(I)
@@ -174,33 +423,21 @@ void EMatrix::calc_vals(shared_ptr<BaseMolecule> mol,
                         shared_ptr<SHCalc> _shcalc,
                         double eps_in)
 {
-  cmplx val;
+  P2MBatch batch;
+  vector<double> a_k(mol->get_ns());
   Pt cen;
-  double r_alpha, a_k, q_alpha;
   for (int k=0; k< mol->get_ns(); k++)
   {
+    a_k[k] = mol->get_ak(k);
     vector<int> allin = mol->get_ch_allin_k(k);
     for (int alpha=0; alpha < allin.size(); alpha++)
     {
       cen = (mol->get_posj_realspace(allin[alpha]) - mol->get_centerk(k));
-      _shcalc->calc_sh(cen.theta(), cen.phi());
-      for (int n = 0; n < p_; n++)
-      {
-        for (int m = -n; m < n+1; m++)
-        {
-          q_alpha = mol->get_qj(allin[alpha]);
-          r_alpha = cen.r();
-          a_k = mol->get_ak(k);
-          
-          val = _shcalc->get_result(n, m);
-          val *= q_alpha / eps_in;
-          val *= pow(r_alpha / a_k, n);
-          val += get_mat_knm(k, n, m);
-          set_mat_knm(k, n, m, val);
-        }
-      }
+      batch.add(k, cen.x(), cen.y(), cen.z(), mol->get_qj(allin[alpha]));
     }
   }
+  P2MKernel::accumulate(batch, a_k, P2MKernel::REGULAR, 1.0/eps_in, p_,
+                        _shcalc, mat_);
 }
 
 LEMatrix::LEMatrix(int I, int ns, int p)
@@ -212,58 +449,50 @@ void LEMatrix::calc_vals(shared_ptr<BaseMolecule> mol,
                          shared_ptr<SHCalc> _shcalc,
                          double eps_in)
 {
-  cmplx val;
+  P2MBatch batch;
+  vector<double> a_k(mol->get_ns());
   Pt cen;
-  
-  double r_alpha, a_k, q_alpha;
   for (int k=0; k< mol->get_ns(); k++)
   {
+    a_k[k] = mol->get_ak(k);
     vector<int> allout = mol->get_ch_allout_k(k);
     for (int alpha=0; alpha < allout.size(); alpha++)
     {
       cen = mol->get_posj_realspace(allout[alpha]) - mol->get_centerk(k);
-      _shcalc->calc_sh(cen.theta(), cen.phi());
-      for (int n = 0; n < p_; n++)
-      {
-        for (int m = -n; m < n+1; m++)
-        {
-          q_alpha = mol->get_qj(allout[alpha]);
-          r_alpha = cen.r();
-          a_k = mol->get_ak(k);
-          
-          val = _shcalc->get_result(n, m);
-          val *= q_alpha / eps_in;
-          val *= 1 / r_alpha;
-          val *= pow(a_k / r_alpha, n);
-          val += get_mat_knm(k, n, m);
-          set_mat_knm(k, n, m, val);
-        }
-      }
+      batch.add(k, cen.x(), cen.y(), cen.z(), mol->get_qj(allout[alpha]));
     }
   }
+  P2MKernel::accumulate(batch, a_k, P2MKernel::IRREGULAR, 1.0/eps_in, p_,
+                        _shcalc, mat_);
 }
 
 
 IEMatrix::IEMatrix(int I, shared_ptr<BaseMolecule> _mol,
                    shared_ptr<SHCalc> _shcalc, int p,
                    shared_ptr<ExpansionConstants> _expconst,
-                   bool calc_npts, int npts, bool set_mol)
+                   bool calc_npts, int npts, bool set_mol, Quadrature quad)
 : p_(p), I_(I),
 IE_orig_(_mol->get_ns(), vector<double> (p*p*p*p)),
+view_(_mol->get_ns(), NULL),
 _expConst_(_expconst), calc_pts_(calc_npts), set_mol_(set_mol),
 gridPts_(npts), gridPtLocs_(_mol->get_ns()),
-grid_exp_(_mol->get_ns()),grid_bur_(_mol->get_ns())
+grid_exp_(_mol->get_ns()),grid_bur_(_mol->get_ns()), quad_(quad)
 {
-  compute_grid_pts(_mol);
+  // the uniform grid is only needed by UNIFORM or to be stored in the mol,
+  // and matrices that will be read from file ask for no points at all
+  if (set_mol_ || (quad_ == UNIFORM && (calc_pts_ || gridPts_ > 0)))
+    compute_grid_pts(_mol);
 }
 
 IEMatrix::IEMatrix(shared_ptr<IEMatrix> imat_in)
 : p_(imat_in->p_), I_(imat_in->I_),
 IE_orig_(imat_in->IE_orig_),
+store_(imat_in->store_), view_(imat_in->view_),
 _expConst_(imat_in->_expConst_),
 calc_pts_(imat_in->calc_pts_), set_mol_(imat_in->set_mol_),
 gridPts_(imat_in->gridPts_), gridPtLocs_(imat_in->gridPtLocs_),
-grid_exp_(imat_in->grid_exp_),grid_bur_(imat_in->grid_bur_)
+grid_exp_(imat_in->grid_exp_),grid_bur_(imat_in->grid_bur_),
+quad_(imat_in->quad_)
 { }
 
 void IEMatrix::init_from_file(string imatfile, int k )
@@ -272,6 +501,33 @@ void IEMatrix::init_from_file(string imatfile, int k )
   set_IE_k(k, imat.get_mat());
 }
 
+void IEMatrix::init_from_store(shared_ptr<IMatStore> store,
+                               shared_ptr<BaseMolecule> mol)
+{
+  if (store->get_ns() != mol->get_ns())
+    throw BadIMatStoreException(store->get_path(), "has " +
+                                to_string(store->get_ns()) + " spheres, need "
+                                + to_string(mol->get_ns()));
+  
+  for (int k = 0; k < mol->get_ns(); k++)
+  {
+    if (fabs(store->get_radius(k) - mol->get_ak(k)) > 1e-6)
+      throw BadIMatStoreException(store->get_path(), "radius of sphere " +
+                                  to_string(k) + " does not match");
+    
+    if (store->get_p() == p_)
+    {
+      view_[k] = store->get_block(k);
+      vector<double>().swap(IE_orig_[k]);
+    } else
+    {
+      own_k(k);
+      store->copy_k(k, p_, &IE_orig_[k][0]);
+    }
+  }
+  store_ = store;
+}
+
 void IEMatrix::init_from_other(shared_ptr<IEMatrix> other)
 {
   for (int k=0; k < other->get_k(); k++)
@@ -308,13 +564,25 @@ void IEMatrix::write_mat_k_reg(string imatFname, int k)
   fout << p_ << endl; // pole order
   for (int i = 0; i< p_*p_*p_*p_; i++)
   {
-    fout << IE_orig_[k][i] << " "; //mat
+    fout << get_IE_k_ind(k, i) << " "; //mat
     if ( (i%(p_*p_-1)) == 0 && (i > 0)) fout << endl;
   }
   
   fout.close();
 }
 
+void IEMatrix::write_store(string path, shared_ptr<BaseMolecule> mol)
+{
+  vector<vector<double> > mats(get_k());
+  vector<double> radii(get_k());
+  for (int k = 0; k < get_k(); k++)
+  {
+    mats[k]  = get_IE_k_org(k);
+    radii[k] = mol->get_ak(k);
+  }
+  IMatStore::write(path, p_, mats, radii, (int) quad_, gridPts_);
+}
+
 void IEMatrix::write_mat_k(string imatFname, int k)
 {
   ofstream fout;
@@ -326,7 +594,7 @@ void IEMatrix::write_mat_k(string imatFname, int k)
   }
   int length = p_*p_*p_*p_;
   fout.write( reinterpret_cast<char const *> (&p_), sizeof(p_)); // pole order
-  fout.write( reinterpret_cast<char const *>(&IE_orig_[k][0]),
+  fout.write( reinterpret_cast<char const *>(get_IE_k_ptr(k)),
              length*sizeof(double) ); //mat
   
   fout.close();
@@ -384,6 +652,9 @@ IEMatrix::compute_integral(shared_ptr<BaseMolecule> _mol,
                            shared_ptr<SHCalc> sh_calc,
                            int k)
 {
+  if (quad_ == ADAPTIVE) return compute_integral_adaptive(_mol, sh_calc, k);
+  
+  SHWorkspace shws = sh_calc->make_workspace();
   int min, grid_tot;
   bool bur;
   vector<MatOfMats<cmplx>::type > Ys(2,
@@ -415,22 +686,22 @@ IEMatrix::compute_integral(shared_ptr<BaseMolecule> _mol,
     int ind = (bur) ? grid_bur_[k][h] : grid_exp_[k][h];
     Pt gdpt = gridPtLocs_[k][ind];
     // convert the position relative to the center to spherical coordinates.
-    sh_calc->calc_sh(gdpt.theta(), gdpt.phi());
+    sh_calc->calc_sh(gdpt.theta(), gdpt.phi(), shws);
     
     // collect sums for (n,m) rows x (l,s) column
     for(int l = 0; l < p_; l++)
       for(int s = 0; s <= l; s++)
       {
         cmplx Yls, Ynm;
-        if(s==0) Yls = complex<double> (sh_calc->get_result(l,0));
-        else     Yls = complex<double> (sh_calc->get_result(l,s));
+        if(s==0) Yls = complex<double> (shws.get_result(l,0));
+        else     Yls = complex<double> (shws.get_result(l,s));
         
         for(int n=0; n<=l; n++)
           for(int m=0; m<=n; m++)
           {
             if( n==l && m > s) break;
-            if(m==0) Ynm = complex<double> (sh_calc->get_result(n,0));
-            else     Ynm = complex<double> (sh_calc->get_result(n,m));
+            if(m==0) Ynm = complex<double> (shws.get_result(n,0));
+            else     Ynm = complex<double> (shws.get_result(n,m));
             
             // integrate using the appropriate integration rules
             if(m==0 && s==0 && (n+l)%2==0) //simpson's rule
@@ -485,6 +756,12 @@ IEMatrix::compute_integral(shared_ptr<BaseMolecule> _mol,
         } // end m
   } // end l
   
+  fill_by_symmetry(Ys);
+  return Ys;
+} // end compute_integral
+
+void IEMatrix::fill_by_symmetry(vector<MatOfMats<cmplx>::type > & Ys)
+{
   for(int l=0; l<p_; l++)
     for(int s=0; s<=l; s++)
       for(int n=0; n<=l; n++)
@@ -497,14 +774,154 @@ IEMatrix::compute_integral(shared_ptr<BaseMolecule> _mol,
             Ys[1](l,s).set_val(n, m, Ys[1](l,s+1)(myind[0], myind[1]));
           }
         }
+}
+
+void IEMatrix::adaptive_quad_pts(shared_ptr<BaseMolecule> mol, int k, int p,
+                                 vector<Pt> & dirs, vector<double> & wts)
+{
+  const int nq = 5;        // Gauss points per side of a cell
+  const int maxDepth = 5;  // times a cell crossed by a cap edge is split
+  const int nt = max(p, 2), nphi = 2 * nt;
+  dirs.clear(); wts.clear();
+  
+  // A surface point at unit direction u is buried by neighbour j when
+  // u.e_j > cos(alpha_j), e_j being the direction from k to j
+  vector<Pt> capAx;
+  vector<double> capCos, capAng;
+  double ak = mol->get_ak(k);
+  Pt ck = mol->get_centerk(k);
+  vector<int> neighs = mol->get_neighj(k);
+  for (int j = 0; j < neighs.size(); j++)
+  {
+    Pt v = mol->get_centerk(neighs[j]) - ck;
+    double d = v.norm(), aj = mol->get_ak(neighs[j]);
+    if (d == 0.0)
+    {
+      if (aj > ak) return;  // whole sphere buried
+      continue;
+    }
+    double cosa = (ak*ak + d*d - aj*aj) / (2.0*ak*d);
+    if (cosa >= 1.0) continue;
+    if (cosa <= -1.0) return;
+    capAx.push_back(v * (1.0/d));
+    capCos.push_back(cosa);
+    capAng.push_back(acos(cosa));
+  }
+  
+  vector<double> gx, gw;
+  gauss_legendre(nq, gx, gw);
+  
+  auto unit = [] (double th, double ph)
+  {
+    return Pt(sin(th)*cos(ph), sin(th)*sin(ph), cos(th));
+  };
+  auto angle = [] (Pt a, Pt b)
+  {
+    return acos(max(-1.0, min(1.0, a.dot(b))));
+  };
+  
+  // cells in (theta, phi), where the harmonics are trigonometric
+  // polynomials, so a Gauss rule per cell is accurate right up to the poles
+  struct Cell { double t0, t1, f0, f1; int depth; };
+  vector<Cell> todo;
+  for (int i = 0; i < nt; i++)
+    for (int j = 0; j < nphi; j++)
+      todo.push_back({M_PI*i/nt, M_PI*(i+1)/nt,
+                      2.0*M_PI*j/nphi, 2.0*M_PI*(j+1)/nphi, 0});
+  
+  while (!todo.empty())
+  {
+    Cell c = todo.back();
+    todo.pop_back();
+    double tm = 0.5*(c.t0 + c.t1), fm = 0.5*(c.f0 + c.f1);
+    double ht = 0.5*(c.t1 - c.t0), hf = 0.5*(c.f1 - c.f0);
+    
+    // angular radius of the cell about its center
+    Pt cen = unit(tm, fm);
+    double rad = 0.0;
+    for (int a = -1; a <= 1; a++)
+      for (int b = -1; b <= 1; b++)
+        rad = max(rad, angle(cen, unit(tm + a*ht, fm + b*hf)));
+    rad *= 1.1;
+    
+    bool buried = false, mixed = false;
+    for (int j = 0; j < capAx.size() && !buried; j++)
+    {
+      double beta = angle(cen, capAx[j]);
+      if (beta + rad < capAng[j])       buried = true;
+      else if (beta - rad <= capAng[j]) mixed = true;
+    }
+    if (buried) continue;
+    
+    if (mixed && c.depth < maxDepth)
+    {
+      todo.push_back({c.t0, tm, c.f0, fm, c.depth+1});
+      todo.push_back({c.t0, tm, fm, c.f1, c.depth+1});
+      todo.push_back({tm, c.t1, c.f0, fm, c.depth+1});
+      todo.push_back({tm, c.t1, fm, c.f1, c.depth+1});
+      continue;
+    }
+    
+    for (int a = 0; a < nq; a++)
+      for (int b = 0; b < nq; b++)
+      {
+        double th = tm + ht*gx[a];
+        Pt dir = unit(th, fm + hf*gx[b]);
+        bool exposed = true;
+        for (int j = 0; mixed && j < capAx.size() && exposed; j++)
+          if (dir.dot(capAx[j]) > capCos[j]) exposed = false;
+        if (!exposed) continue;
+        dirs.push_back(dir);
+        wts.push_back(gw[a] * gw[b] * ht * hf * sin(th));
+      }
+  }
+}
+
+vector<MatOfMats<cmplx>::type >
+IEMatrix::compute_integral_adaptive(shared_ptr<BaseMolecule> _mol,
+                                    shared_ptr<SHCalc> sh_calc,
+                                    int k)
+{
+  SHWorkspace shws = sh_calc->make_workspace();
+  vector<MatOfMats<cmplx>::type > Ys(2,
+                                     MatOfMats<cmplx>::type(p_, p_,
+                                                            MyMatrix<cmplx>
+                                                            (p_, p_)));
+  vector<Pt> dirs;
+  vector<double> wts;
+  adaptive_quad_pts(_mol, k, p_, dirs, wts);
+  
+  for (int h = 0; h < dirs.size(); h++)
+  {
+    double w = wts[h];
+    sh_calc->calc_sh(dirs[h].theta(), dirs[h].phi(), shws);
+    
+    for(int l = 0; l < p_; l++)
+      for(int s = 0; s <= l; s++)
+      {
+        cmplx Yls = shws.get_result(l,s);
+        for(int n=0; n<=l; n++)
+          for(int m=0; m<=n; m++)
+          {
+            if( n==l && m > s) break;
+            cmplx Ynm = shws.get_result(n,m);
+            Ys[0](l,s)(n,m) += w * cmplx(Yls.real()*Ynm.real(),
+                                         Yls.real()*Ynm.imag());
+            Ys[1](l,s)(n,m) += w * cmplx(Yls.imag()*Ynm.real(),
+                                         Yls.imag()*Ynm.imag());
+          }
+      }
+  }
   
+  fill_by_symmetry(Ys);
   return Ys;
-} // end compute_integral
+}
 
 // Currently using old format because I dont know whats going on!
 // TODO: change to understandable
 void IEMatrix::populate_mat(vector<MatOfMats<cmplx>::type >  Ys, int k)
 {
+  own_k(k);
   int i = 0;
   int sNeg = -1; int mNeg = -1;
   for(int l=0; l<p_; l++)
@@ -584,6 +1001,7 @@ void IEMatrix::reset_mat()
 {
   for (int k = 0; k < IE_orig_.size(); k++)
   {
+    own_k(k);
     for (int ind = 0; ind < p_*p_*p_*p_; ind++)
       IE_orig_[k][ind] = 0.0;
   }
@@ -635,7 +1053,8 @@ void LFMatrix::calc_vals(shared_ptr<TMatrix> T, shared_ptr<FMatrix> F,
                          int k, bool no_pre_sh)
 {
   reset_mat(k);
-  MyMatrix<cmplx> reex;
+  ScratchArena<cmplx>::Scope scratch;
+  MyMatrix<cmplx> & reex = scratch.get(p_, 2*p_+1);
   for (int j = 0; j < T->get_nsi(I_); j++)
   {
     if (j==k) continue;
@@ -643,7 +1062,7 @@ void LFMatrix::calc_vals(shared_ptr<TMatrix> T, shared_ptr<FMatrix> F,
     if (T->is_analytic(I_, k, I_, j))
     {
       bool isF = true;
-      reex = T->re_expandX(F->get_mat_k(j), I_, k, I_, j, isF );
+      T->re_expand_into(F->get_mat_k(j), reex, I_, k, I_, j, isF );
     }
     else
     {
@@ -656,6 +1075,40 @@ void LFMatrix::calc_vals(shared_ptr<TMatrix> T, shared_ptr<FMatrix> F,
 }
 
 
+void LFMatrix::init(shared_ptr<FMatrix> F, const SurfaceQuad & quad)
+{
+  vector<double> x;
+  for (int k = 0; k < get_ns(); k++)
+  {
+    quad.pack(F->get_mat_k(k), x);
+    quad.eval_surf(k, x, mat_[k], false);
+  }
+}
+
+void LFMatrix::calc_vals(shared_ptr<TMatrix> T, shared_ptr<FMatrix> F,
+                         const SurfaceQuad & quad, int k)
+{
+  reset_mat(k);
+  ScratchArena<cmplx>::Scope scratch;
+  MyMatrix<cmplx> & reex = scratch.get(p_, 2*p_+1);
+  vector<double> x;
+  for (int j = 0; j < get_ns(); j++)
+  {
+    if (j==k) continue;
+    
+    if (T->is_analytic(I_, k, I_, j))
+    {
+      T->re_expand_into(F->get_mat_k(j), reex, I_, k, I_, j, true);
+    } else
+    {
+      quad.project(k, j, mat_[j], x, false);
+      quad.unpack(x, reex);
+    }
+    mat_cmplx_[k] += reex;
+  }
+}
+
+
 LHMatrix::LHMatrix(int I, int ns, int p, double kappa)
 :NumericalMatrix(I, ns, p), kappa_(kappa)
 {
@@ -703,14 +1156,15 @@ void LHMatrix::calc_vals(shared_ptr<TMatrix> T, shared_ptr<HMatrix> H,
                          shared_ptr<PreCalcSH> pre_sh, int k, bool no_pre_sh)
 {
   reset_mat(k);
-  MyMatrix<cmplx> reex;
+  ScratchArena<cmplx>::Scope scratch;
+  MyMatrix<cmplx> & reex = scratch.get(p_, 2*p_+1);
   
   for (int j = 0; j < T->get_nsi(I_); j++)
   {
     if (j==k) continue;
     
     if (T->is_analytic(I_, k, I_, j))
-      reex = T->re_expandX(H->get_mat_k(j), I_, k, I_, j );
+      T->re_expand_into(H->get_mat_k(j), reex, I_, k, I_, j );
     else
       reex = T->re_expandX_numeric(get_mat(), I_, k, I_, j, kappa_, pre_sh,
                                    no_pre_sh);
@@ -720,6 +1174,40 @@ void LHMatrix::calc_vals(shared_ptr<TMatrix> T, shared_ptr<HMatrix> H,
 }
 
 
+void LHMatrix::init(shared_ptr<HMatrix> H, const SurfaceQuad & quad)
+{
+  vector<double> x;
+  for (int k = 0; k < get_ns(); k++)
+  {
+    quad.pack(H->get_mat_k(k), x);
+    quad.eval_surf(k, x, mat_[k], true);
+  }
+}
+
+void LHMatrix::calc_vals(shared_ptr<TMatrix> T, shared_ptr<HMatrix> H,
+                         const SurfaceQuad & quad, int k)
+{
+  reset_mat(k);
+  ScratchArena<cmplx>::Scope scratch;
+  MyMatrix<cmplx> & reex = scratch.get(p_, 2*p_+1);
+  vector<double> x;
+  for (int j = 0; j < get_ns(); j++)
+  {
+    if (j==k) continue;
+    
+    if (T->is_analytic(I_, k, I_, j))
+    {
+      T->re_expand_into(H->get_mat_k(j), reex, I_, k, I_, j);
+    } else
+    {
+      quad.project(k, j, mat_[j], x, true);
+      quad.unpack(x, reex);
+    }
+    mat_cmplx_[k] += reex;
+  }
+}
+
+
 LHNMatrix::LHNMatrix(int I, int ns, int p, shared_ptr<SystemSAM> sys)
 :interPol_(ns, 1), ComplexMoleculeMatrix(I, ns, p)
 {
@@ -750,7 +1238,8 @@ void LHNMatrix::calc_vals(shared_ptr<SystemSAM> sys, shared_ptr<TMatrix> T,
                           vector<shared_ptr<HMatrix> > H, int k)
 {
   reset_mat(k);
-  MyMatrix<cmplx> reex;
+  ScratchArena<cmplx>::Scope scratch;
+  MyMatrix<cmplx> & reex = scratch.get(p_, 2*p_+1);
   Pt Ik, Jl;
   double aIk, aJl, interPolcut = 10.0;
   for (int J = 0; J < T->get_nmol(); J++)
@@ -768,7 +1257,7 @@ void LHNMatrix::calc_vals(shared_ptr<SystemSAM> sys, shared_ptr<TMatrix> T,
 //        cout << "This is H before I " << I_ << " and k " << k
 //        << " and j " << J << " and l " << l<< endl;
 //        H[J]->print_kmat(l);
-        reex = T->re_expandX(H[J]->get_mat_k(l), I_, k, J, l);
+        T->re_expand_into(H[J]->get_mat_k(l), reex, I_, k, J, l);
         mat_[k] += reex;
         
 //        cout << "This is H After " << endl;
@@ -793,18 +1282,24 @@ XHMatrix::XHMatrix(int I, int ns, int p,
                    shared_ptr<EMatrix> E,
                    shared_ptr<LEMatrix> LE)
 : ComplexMoleculeMatrix(I, ns, p), E_LE_mat_(ns, MyMatrix<cmplx> (p, 2*p+1))
+{
+  set_E_LE(mol, E, LE);
+}
+
+void XHMatrix::set_E_LE(shared_ptr<BaseMolecule> mol, shared_ptr<EMatrix> E,
+                        shared_ptr<LEMatrix> LE)
 {
   double ak;
   
-  for (int k = 0; k < ns; k++)
+  for (int k = 0; k < get_ns(); k++)
   {
     ak = mol->get_ak(k);
     for (int n = 0; n < p_; n++)
     {
       for (int m = -n; m < n+1; m++)
       {
-        E_LE_mat_[k](n, m+p) = (E->get_mat_knm(k, n, m) +
-                                ak*LE->get_mat_knm(k, n, m));
+        E_LE_mat_[k](n, m+p_) = (E->get_mat_knm(k, n, m) +
+                                 ak*LE->get_mat_knm(k, n, m));
       }
     }
   }
@@ -836,10 +1331,16 @@ XFMatrix::XFMatrix(int I, int ns, int p, double eps_in, double eps_out,
                    shared_ptr<LEMatrix> LE)
 :ComplexMoleculeMatrix(I, ns, p), eps_(eps_in/eps_out),
 E_LE_mat_(ns, MyMatrix<cmplx> (p, 2*p+1))
+{
+  set_E_LE(mol, E, LE);
+}
+
+void XFMatrix::set_E_LE(shared_ptr<BaseMolecule> mol, shared_ptr<EMatrix> E,
+                        shared_ptr<LEMatrix> LE)
 {
   double ak;
   
-  for (int k = 0; k < ns; k++)
+  for (int k = 0; k < get_ns(); k++)
   {
     ak = mol->get_ak(k);
     for (int n = 0; n < p_; n++)
@@ -893,32 +1394,21 @@ void HMatrix::init_from_exp(string hfilename, int k)
 void HMatrix::init(shared_ptr<BaseMolecule> mol,
                    shared_ptr<SHCalc> _sh_calc, double eps_in)
 {
-  cmplx val;
+  P2MBatch batch;
+  vector<double> a_k(mol->get_ns());
   Pt cen;
-  double r_alpha, a_k, q_alpha;
   for (int k=0; k< mol->get_ns(); k++)
   {
+    a_k[k] = mol->get_ak(k);
     for (int alpha=0; alpha < mol->get_nc_k(k); alpha++)
     {
       cen = mol->get_posj(mol->get_ch_k_alpha(k, alpha));
-      _sh_calc->calc_sh(cen.theta(), cen.phi());
-      for (int n = 0; n < p_; n++)
-      {
-        for (int m = -n; m < n+1; m++)
-        {
-          q_alpha = mol->get_qj(mol->get_ch_k_alpha(k, alpha));
-          r_alpha = cen.r();
-          a_k = mol->get_ak(k);
-          
-          val = _sh_calc->get_result(n, m);
-          val *= q_alpha / eps_in;
-          val *= pow(r_alpha / a_k, n);
-          val += get_mat_knm(k, n, m);
-          set_mat_knm(k, n, m, val);
-        }
-      }
+      batch.add(k, cen.x(), cen.y(), cen.z(),
+                mol->get_qj(mol->get_ch_k_alpha(k, alpha)));
     }
   }
+  P2MKernel::accumulate(batch, a_k, P2MKernel::REGULAR, 1.0/eps_in, p_,
+                        _sh_calc, mat_);
 }
 
 void HMatrix::calc_vals(shared_ptr<BaseMolecule> mol,
@@ -957,11 +1447,10 @@ void HMatrix::calc_vals(shared_ptr<BaseMolecule> mol,
   
   const int p2 = p_*p_;
 #ifdef __LAU  
-  applyMMat(&IE->get_IE_k_org(k)[0], &h_in[0], &h_out[0], 1.0, 0.0, p2, 1, p2);
+  applyMMat(IE->get_IE_k_ptr(k), &h_in[0], &h_out[0], 1.0, 0.0, p2, 1, p2);
 #else  
-  MyMatrix<double> h_out1(p2, 1);
-  MyMatrix<double> h_in1 (p2, 1, h_in); 
-  h_out1 = IE->get_IE_k(k) * h_in1;  // Matrix vector multiplication
+  POLE_DISPATCH(p_, ie_matmul_fixed, p_, IE->get_IE_k_ptr(k), &h_in[0],
+                &h_out[0], 1);
 #endif  
 
   int ctr(0);
@@ -971,20 +1460,12 @@ void HMatrix::calc_vals(shared_ptr<BaseMolecule> mol,
     for (int m = 0; m < n+1; m++)  // columns in new matrix
     {
       double hRe, hIm;
-#ifdef __LAU  
       hRe = h_out[ctr];
-#else  
-      hRe = h_out1(ctr,0);
-#endif
       ctr++;
       
       if ( m > 0 )
       {
-#ifdef __LAU  
         hIm = h_out[ctr];
-#else
-        hIm = h_out1(ctr,0);
-#endif
         ctr++;
       } else
         hIm = 0.0;
@@ -1066,11 +1547,10 @@ void FMatrix::calc_vals(shared_ptr<BaseMolecule> mol,
   }
 
 #ifdef __LAU  
-  applyMMat(&IE->get_IE_k_org(k)[0], &f_in[0], &f_out[0], 1.0, 0.0, p2, 1, p2);
+  applyMMat(IE->get_IE_k_ptr(k), &f_in[0], &f_out[0], 1.0, 0.0, p2, 1, p2);
 #else  
-  MyMatrix<double> f_out1(p2, 1);
-  MyMatrix<double> f_in1 (p2, 1, f_in); 
-  f_out1 = IE->get_IE_k(k) * f_in1;  // Matrix vector multiplication
+  POLE_DISPATCH(p_, ie_matmul_fixed, p_, IE->get_IE_k_ptr(k), &f_in[0],
+                &f_out[0], 1);
 #endif  
 
   ct = 0;
@@ -1079,20 +1559,12 @@ void FMatrix::calc_vals(shared_ptr<BaseMolecule> mol,
     scl = 1.0 / (double)(2.0*n+1.0);
     for (int m = 0; m < n+1; m++)  // columns in new matrix
     {
-#ifdef __LAU  
       fRe = f_out[ct];
-#else  
-      fRe = f_out1(ct,0);
-#endif
       ct++;
      
       if ( m > 0 )
       {    
-#ifdef __LAU  
         fIm = f_out[ct];
-#else
-        fIm = f_out1(ct,0);
-#endif
         ct++;
       } else
         fIm = 0.0;
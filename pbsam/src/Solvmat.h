@@ -13,6 +13,10 @@
 #include "BesselCalc.h"
 #include "TMatrix.h"
 #include "SystemSAM.h"
+#include "ScratchArena.h"
+#include "P2MKernel.h"
+#include "IMatStore.h"
+#include "ExpansionFile.h"
 
 /*
  References:
@@ -64,15 +68,106 @@ protected:
 public:
   ExpansionConstants(int p);
   
+  // shared instance for p poles, built on first use (see TableRegistry)
+  static shared_ptr<ExpansionConstants> get_shared(int p);
+  
   void set_const1_l(int l, double val) { expansionConst1_.set_val(l, val); }
   void set_const2_l(int l, double val) { expansionConst2_.set_val(l, val); }
   double get_const1_l(int l)        { return expansionConst1_[l]; }
   double get_const2_l(int l)        { return expansionConst2_[l]; }
-  vector<int> get_imat_loc(int m)   { return imatLoc_[m]; }
+  vector<int> get_imat_loc(int m) const  { return imatLoc_[m]; }
   const int get_p() const           { return p_; }
 };
 
 
+/*
+ Surface quadrature tables for the exposed grid points of one molecule.
+
+ Expansions of real surface functions obey X(n,-m) = X(n,m)*, so they are
+ packed into p^2 reals, in the same (n, m>=0, re/im) order as the IE matrix.
+ For every exposed point the spherical harmonics are stored packed in the
+ same way, in one contiguous row, with the surface weights and radial
+ factors alongside. Evaluating an expansion on the surface (M2P, Eq. 8c and
+ 10b [1]) is then a dense matrix-vector product over all points, and the
+ numerical re-expansion of surface values (P2M, Eq. 27b [1]) its transpose,
+ without any SH or Bessel evaluations inside the solver iterations.
+ */
+class SurfaceQuad
+{
+protected:
+  int p_;
+  double kappa_;
+
+  // M2P: for each sphere k rows of (nPts, p^2) weighted harmonics and
+  // (nPts, p) 1 / i_n(kappa r). These only depend on the molecule type, so
+  // all copies of a type share them
+  struct SurfTables
+  {
+    vector<int>             nPts_;
+    vector<vector<double> > ySurf_;
+    vector<vector<double> > iSurf_;
+  };
+  shared_ptr<const SurfTables> _surf_;
+
+  // P2M: for each numerically re-expanded pair {k, l} the harmonics of the
+  // exposed points of l about the center of k (nPts, p^2) and the radial
+  // factors (a_k/r)^n / r, without and with k_n(kappa r) exp(-kappa r).
+  // These follow the sphere centers, so they are kept with the separation
+  // of the centers they were built for
+  map<vector<int>, int>   pairIdx_;
+  vector<vector<double> > yPair_;
+  vector<vector<double> > rPair_;
+  vector<vector<double> > rkPair_;
+  vector<Pt>              pairDist_;
+
+  // harmonics at pt packed into row, m > 0 entries are scaled by m_scl
+  void pack_sh(Pt pt, shared_ptr<SHCalc> shcalc, SHWorkspace & ws,
+               double m_scl, double * row);
+  
+  // fill the tables of pair idx = {k, l} for the current sphere centers
+  void build_pair(int idx, int k, int l, shared_ptr<BaseMolecule> mol,
+                  shared_ptr<SHCalc> shcalc, shared_ptr<BesselCalc> bcalc,
+                  SHWorkspace & ws);
+
+public:
+  /*
+   Tables for molecule I. same_type may be the quadrature of another copy
+   of the same type, whose surface tables are then shared
+   */
+  SurfaceQuad(int I, shared_ptr<BaseMolecule> mol, shared_ptr<TMatrix> T,
+              shared_ptr<SHCalc> shcalc, shared_ptr<BesselCalc> bcalc,
+              shared_ptr<ExpansionConstants> _expconst, int p, double kappa,
+              shared_ptr<const SurfaceQuad> same_type = nullptr);
+  
+  /*
+   Rebuild the pair tables whose sphere centers have moved relative to each
+   other since they were built, which happens when the molecule rotates.
+   Returns the number of pairs rebuilt
+   */
+  int update_pairs(shared_ptr<BaseMolecule> mol, shared_ptr<SHCalc> shcalc,
+                   shared_ptr<BesselCalc> bcalc);
+
+  void pack(const MyMatrix<cmplx> & X, vector<double> & x) const;
+  // dimension d of a gradient expansion
+  void pack(const MyMatrix<Ptx> & X, int d, vector<double> & x) const;
+  void unpack(const vector<double> & x, MyMatrix<cmplx> & X) const;
+
+  // values at the exposed points of sphere k of the packed expansion x,
+  // divided by i_n(kappa r) for an H expansion
+  void eval_surf(int k, const vector<double> & x, vector<double> & vals,
+                 bool isH) const;
+
+  // project values at the exposed points of sphere l onto a packed
+  // expansion about sphere k, with the screened radial factor for H
+  void project(int k, int l, const vector<double> & vals,
+               vector<double> & x, bool isH) const;
+
+  bool has_pair(int k, int l) const
+  { return pairIdx_.find({k, l}) != pairIdx_.end(); }
+
+  int get_npts(int k) const { return _surf_->nPts_[k]; }
+  const int get_p() const   { return p_; }
+};
 
 
 /*
@@ -91,7 +186,7 @@ public:
   cmplx get_mat_knm(int k, int n, int m) { return mat_[k](n, m+p_); }
   void set_mat_knm(int k, int n, int m, cmplx val)
   { mat_[k].set_val(n, m+p_, val); }
-  MyMatrix<cmplx> get_mat_k(int k)       { return mat_[k]; }
+  const MyMatrix<cmplx> & get_mat_k(int k) const { return mat_[k]; }
   void set_mat_k(int k, MyMatrix<cmplx> mtin) { mat_[k] = mtin; }
   const int get_I() const   { return I_; }
   const int get_p() const   { return p_; }
@@ -143,6 +238,22 @@ public:
     cout << endl;
   }
   
+  // All spheres to or from one binary expansion file
+  void write_binary(string path, double kappa, double rcut) const
+  {
+    ExpansionFile::write(path, p_, kappa, rcut, mat_);
+  }
+  
+  void init_from_binary(string path)
+  {
+    ExpansionFile fil(path);
+    if (fil.get_n() != get_ns())
+      throw BadExpansionFileException(path, "has " + to_string(fil.get_n())
+                                      + " spheres, need " +
+                                      to_string(get_ns()));
+    for (int k = 0; k < get_ns(); k++) mat_[k] = fil.get_mat(k, p_);
+  }
+  
   void print_all_to_file(string exp_prefix, double kappa, double rcut)
   {
     for (int k = 0; k < mat_.size(); k++)
@@ -234,13 +345,32 @@ public:
  Class for pre-computing values of surface integral matrices I_E. Each object
  of this class refers to one molecule. See equation 21 in Yap 2010 for more
  info.
+ 
+ The integrals over the exposed surface of each sphere are computed with
+ one of two quadratures:
+   UNIFORM: the spiral grid of make_uniform_sph_grid with npts points, as
+            stored with the molecule
+   ADAPTIVE: Gauss-Legendre product rules on (theta, phi) cells. The
+            buried part of a sphere is the union of the caps cut out by its
+            neighbours, and cells that a cap edge crosses are split until
+            they are small. For the test molecules at p = 5 this takes
+            20-48k points per sphere instead of the 250k of the default
+            uniform grid, and agrees with a 1M point uniform grid to 1e-4
+ 
+ Matrices loaded from an IMatStore at the order they were stored in are
+ used in place from the mapped file instead of being copied.
  */
 class IEMatrix
 {
+public:
+  enum Quadrature { UNIFORM, ADAPTIVE };
+  
 protected:
   
   // indices in order are k, (n, m), (l, s)
   vector<vector<double> > IE_orig_;
+  shared_ptr<IMatStore>   store_;  // keeps mapped matrices alive
+  vector<const double *>  view_;   // sphere k in store_, NULL if in IE_orig_
   shared_ptr<ExpansionConstants> _expConst_;
   bool calc_pts_; // Boolean of whether or not to estimate number of points
   bool set_mol_; // Whether or not to save calculated points in mol
@@ -249,22 +379,55 @@ protected:
   int gridPts_; // grid point count for surface integrals
   vector<vector<Pt> > gridPtLocs_; // vector of locations in space of grid
   vector<vector<int> > grid_exp_, grid_bur_;
+  Quadrature quad_;
+  
+  // Fill in the (n,m) > (l,s) entries of the integrals by symmetry
+  void fill_by_symmetry(vector<MatOfMats<cmplx>::type > & Ys);
+  
+  // Integrals over the exposed surface of sphere k, ADAPTIVE quadrature
+  vector<MatOfMats<cmplx>::type > compute_integral_adaptive(
+                                              shared_ptr<BaseMolecule> _mol,
+                                              shared_ptr<SHCalc> sh_calc,
+                                              int k);
   
 public:
   IEMatrix(int I, shared_ptr<BaseMolecule> _mol, shared_ptr<SHCalc> sh_calc, int p,
            shared_ptr<ExpansionConstants> _expconst, bool calc_npts = false,
-           int npts = Constants::IMAT_GRID, bool set_mol = false );
+           int npts = Constants::IMAT_GRID, bool set_mol = false,
+           Quadrature quad = UNIFORM);
+  
+  // Exposed quadrature points on sphere k of mol for ADAPTIVE: unit
+  // directions from the sphere center and their weights on the unit sphere
+  static void adaptive_quad_pts(shared_ptr<BaseMolecule> mol, int k, int p,
+                                vector<Pt> & dirs, vector<double> & wts);
   
   IEMatrix(shared_ptr<IEMatrix> imat_in);
   
   void init_from_file(string imatfile, int k );
   void init_from_other(shared_ptr<IEMatrix> other);
   
-  void set_IE_k(int k, vector<double> ie) { IE_orig_[k] = ie;}
+  // Matrices of every sphere from store, checked against the spheres of mol
+  void init_from_store(shared_ptr<IMatStore> store,
+                       shared_ptr<BaseMolecule> mol);
+  
+  void set_IE_k(int k, vector<double> ie) { IE_orig_[k] = ie; own_k(k); }
   
   int get_k()                         { return (int)IE_orig_.size(); }
-  double get_IE_k_ind(int k, int ind) { return IE_orig_[k][ind]; }
-  vector<double> get_IE_k_org(int k)  { return IE_orig_[k]; }
+  double get_IE_k_ind(int k, int ind) { return get_IE_k_ptr(k)[ind]; }
+  vector<double> get_IE_k_org(int k)
+  {
+    const double * ie = get_IE_k_ptr(k);
+    return vector<double>(ie, ie + p_*p_*p_*p_);
+  }
+  const double * get_IE_k_ptr(int k)
+  { return view_[k] ? view_[k] : &IE_orig_[k][0]; }
+  
+  // Make sphere k use IE_orig_ again, e.g. before it is recomputed
+  void own_k(int k)
+  {
+    view_[k] = NULL;
+    IE_orig_[k].resize(p_*p_*p_*p_);
+  }
   
   MyMatrix<double> get_IE_k( int k );
   
@@ -287,6 +450,9 @@ public:
 
   void write_mat_k(string imat_prefix, int k);
   void write_mat_k_reg(string imat_prefix, int k);
+  
+  // All spheres to a single IMatStore file
+  void write_store(string path, shared_ptr<BaseMolecule> mol);
 };
 
 
@@ -311,7 +477,7 @@ public:
   cmplx get_mat_knm(int k, int n, int m)   { return mat_cmplx_[k](n,m+p_); }
   void set_mat_kh(int k, int h, double val) { mat_[k][h] = val; }
   vector<double> get_mat_k(int k)           { return mat_[k]; }
-  vector<vector<double> > get_mat()         { return mat_; }
+  const vector<vector<double> > & get_mat() const { return mat_; }
   int get_mat_k_len(int k)                 { return (int)mat_[k].size(); }
   const int get_I() const   { return I_; }
   const int get_p() const   { return p_; }
@@ -385,6 +551,11 @@ public:
   void calc_vals(shared_ptr<TMatrix> T, shared_ptr<FMatrix> F,
                  shared_ptr<SystemSAM> sys, shared_ptr<PreCalcSH> pre_sh, int k,
                  bool no_pre_sh=false);
+  
+  // As above, using the precomputed surface quadrature of the molecule
+  void init(shared_ptr<FMatrix> F, const SurfaceQuad & quad);
+  void calc_vals(shared_ptr<TMatrix> T, shared_ptr<FMatrix> F,
+                 const SurfaceQuad & quad, int k);
 };
 
 /*
@@ -408,6 +579,10 @@ public:
                  shared_ptr<PreCalcSH> pre_sh, int k,
                  bool no_pre_sh=false);
   
+  // As above, using the precomputed surface quadrature of the molecule
+  void init(shared_ptr<HMatrix> H, const SurfaceQuad & quad);
+  void calc_vals(shared_ptr<TMatrix> T, shared_ptr<HMatrix> H,
+                 const SurfaceQuad & quad, int k);
 };
 
 /*
@@ -440,6 +615,10 @@ public:
   XHMatrix(int I, int ns, int p, shared_ptr<BaseMolecule> mol,
            shared_ptr<EMatrix> E, shared_ptr<LEMatrix> LE);
   
+  // refresh the stored E and LE terms, e.g. after the molecule rotated
+  void set_E_LE(shared_ptr<BaseMolecule> mol, shared_ptr<EMatrix> E,
+                shared_ptr<LEMatrix> LE);
+  
   void calc_vals(shared_ptr<BaseMolecule> mol, shared_ptr<BesselCalc> bcalc,
                  shared_ptr<LHMatrix> LH, shared_ptr<LFMatrix> LF,
                  shared_ptr<LHNMatrix> LHN, double kappa, int k);
@@ -459,6 +638,10 @@ public:
            shared_ptr<BaseMolecule> mol, shared_ptr<EMatrix> E,
            shared_ptr<LEMatrix> LE);
   
+  // refresh the stored E and LE terms, e.g. after the molecule rotated
+  void set_E_LE(shared_ptr<BaseMolecule> mol, shared_ptr<EMatrix> E,
+                shared_ptr<LEMatrix> LE);
+  
   void calc_vals(shared_ptr<BaseMolecule> mol, shared_ptr<BesselCalc> bcalc,
                  shared_ptr<LHMatrix> LH, shared_ptr<LFMatrix> LF,
                  shared_ptr<LHNMatrix> LHN, double kappa, int k);
@@ -13,15 +13,12 @@ MoleculeSAM::MoleculeSAM(int type, int type_idx, string movetype, vector<double>
           vector<Pt> pos, vector<double> vdwr, vector<Pt> cens,
           vector<double> as, double drot, double dtrans)
 :BaseMolecule(type, type_idx, movetype, qs, pos, vdwr, cens, as, drot, dtrans),
-cgCharges_((int) cens.size()),
-cgGridPts_((int) cens.size()),
-cgGdPtExp_((int) cens.size()),
-cgGdPtBur_((int) cens.size())
+_cg_(make_shared<CGTypeData>((int) cens.size()))
 {
   map_repos_charges();
   check_connect();
   calc_cog();
-  for ( int i = 0; i < Ns_; i++ ) cgNeighs_.push_back(find_neighbors( i ));
+  for ( int i = 0; i < Ns_; i++ ) _cg_->cgNeighs_.push_back(find_neighbors( i ));
   interPol_.resize(Ns_); interAct_.resize(Ns_);
 }
 
@@ -30,11 +27,12 @@ MoleculeSAM::MoleculeSAM(int type, int type_idx, string movetype, vector<double>
                        vector<Pt> msms_np, double tol_sp, int n_trials,
                        int max_trials, double beta, double drot,
                        double dtrans)
-:BaseMolecule(type, type_idx, movetype, qs, pos, vdwr, drot, dtrans)
+:BaseMolecule(type, type_idx, movetype, qs, pos, vdwr, drot, dtrans),
+_cg_(make_shared<CGTypeData>())
 {
   find_centers(msms_sp, msms_np, tol_sp, n_trials, max_trials, beta);
   check_connect();
-  for ( int i = 0; i < Ns_; i++ ) cgNeighs_.push_back(find_neighbors( i ));
+  for ( int i = 0; i < Ns_; i++ ) _cg_->cgNeighs_.push_back(find_neighbors( i ));
   interPol_.resize(Ns_);  interAct_.resize(Ns_);
   
   map_repos_charges();
@@ -46,14 +44,15 @@ MoleculeSAM::MoleculeSAM(int type, int type_idx, string movetype, vector<double>
                        double tol_sp, double drot, double dtrans, int n_trials,
                        int max_trials, double beta)
                        
-:BaseMolecule(type, type_idx, movetype, qs, pos, vdwr, drot, dtrans)
+:BaseMolecule(type, type_idx, movetype, qs, pos, vdwr, drot, dtrans),
+_cg_(make_shared<CGTypeData>())
 {
 
   MSMSFile surf_file (msms_f);
   find_centers(surf_file.get_sp(), surf_file.get_np(), tol_sp, n_trials, 
                max_trials, beta);
   check_connect();
-  for ( int i = 0; i < Ns_; i++ ) cgNeighs_.push_back(find_neighbors( i ));
+  for ( int i = 0; i < Ns_; i++ ) _cg_->cgNeighs_.push_back(find_neighbors( i ));
   interPol_.resize(Ns_);  interAct_.resize(Ns_);
   
   map_repos_charges();
@@ -61,15 +60,15 @@ MoleculeSAM::MoleculeSAM(int type, int type_idx, string movetype, vector<double>
 }
 
 MoleculeSAM::MoleculeSAM(const MoleculeSAM& mol)
-:BaseMolecule(mol.type_, mol.typeIdx_, mol.moveType_, mol.qs_, mol.pos_,
-              mol.vdwr_, mol.centers_, mol.as_, mol.drot_, mol.dtrans_),
-cgNeighs_(mol.cgNeighs_),cgGridPts_(mol.cgGridPts_),
-cgGdPtExp_(mol.cgGdPtExp_), cgGdPtBur_(mol.cgGdPtBur_),
-cog_(mol.cog_), cgCharges_(mol.cgCharges_), chToCG_(mol.chToCG_),
-cgChargesIn_(mol.cgChargesIn_), cgChargesOut_(mol.cgChargesOut_),
+:BaseMolecule(mol.type_, mol.typeIdx_, mol.moveType_, mol.qs_,
+              mol.pos_.to_vector(), mol.vdwr_, mol.centers_, mol.as_,
+              mol.drot_, mol.dtrans_),
+cog_(mol.cog_), _cg_(mol._cg_),
 interPol_(mol.interPol_), interAct_(mol.interAct_)
 {
+  orient_ = mol.orient_;
   calc_cog();
+  cog_unwrapped_ = mol.cog_unwrapped_;
 }
 
 
@@ -78,22 +77,22 @@ void MoleculeSAM::map_repos_charges()
   int closest;
   for (int cg = 0; cg < Nc_; cg++)
   {
-    closest = find_closest_center(pos_[cg]);
-    cgCharges_[closest].push_back(cg);
-    pos_[cg] = pos_[cg] - centers_[closest];  // reposition charge
+    closest = find_closest_center(pos_.get(cg));
+    _cg_->cgCharges_[closest].push_back(cg);
+    pos_.set(cg, pos_.get(cg) - centers_[closest]);  // reposition charge
 
-    chToCG_[cg] = closest;
+    _cg_->chToCG_[cg] = closest;
   }
   
   // Assigning all charges to either in or out of MoleculeSAM
-  cgChargesIn_.resize(Ns_); cgChargesOut_.resize(Ns_);
+  _cg_->cgChargesIn_.resize(Ns_); _cg_->cgChargesOut_.resize(Ns_);
   for (int i = 0; i < Ns_; i++)
   {
     for (int cg = 0; cg < Nc_; cg++)
     {
       if ( get_posj_realspace(cg).dist(get_centerk(i)) < get_ak(i))
-        cgChargesIn_[i].push_back(cg);
-      else cgChargesOut_[i].push_back(cg);
+        _cg_->cgChargesIn_[i].push_back(cg);
+      else _cg_->cgChargesOut_[i].push_back(cg);
     }
   }
 }
@@ -120,23 +119,24 @@ void MoleculeSAM::calc_cog()
   cog_ = Pt(0.0, 0.0, 0.0);
   for (int i = 0; i < Nc_; i++)  cog_ = cog_ + get_posj_realspace(i);
   cog_ = cog_ * (1.0/(double) Nc_);
+  cog_unwrapped_ = cog_;
 }
 
-Pt MoleculeSAM::random_pt()
+Pt MoleculeSAM::random_pt(PhiloxStream & rng)
 {
-  double phi = drand48(  )*2*M_PI;
-  double u = drand48(  )*2 - 1;
+  double phi = rng.uniform()*2*M_PI;
+  double u = rng.uniform()*2 - 1;
   
   return Pt( sqrt(1 - u*u ) * cos(phi), sqrt(1 - u*u) * sin(phi), u);
 }
 
-double MoleculeSAM::random_norm()
+double MoleculeSAM::random_norm(PhiloxStream & rng)
 {
   double v1, v2, rsq = 0.0;
   do
   {
-    v1 = 2.0 * drand48(  ) - 1.0;
-    v2 = 2.0 * drand48(  ) - 1.0;
+    v1 = 2.0 * rng.uniform() - 1.0;
+    v2 = 2.0 * rng.uniform() - 1.0;
     rsq = v1*v1 + v2*v2;
   } while ( rsq >= 1.0 || rsq == 0.0 );
   
@@ -148,6 +148,7 @@ void MoleculeSAM::translate(Pt dr, double boxlen)
 {
   Pt dv_cen  = cog_ + dr;
   
+  cog_unwrapped_ = cog_unwrapped_ + dr; // unwrapped position
   cog_ = Pt(dv_cen.x() - round(dv_cen.x()/boxlen)*boxlen,
                dv_cen.y() - round(dv_cen.y()/boxlen)*boxlen,
                dv_cen.z() - round(dv_cen.z()/boxlen)*boxlen);
@@ -165,29 +166,21 @@ void MoleculeSAM::translate(Pt dr, double boxlen)
 
 void MoleculeSAM::rotate(Quat qrot)
 {
-  for (int k = 0; k < Ns_; k++)
-  {
-    centers_[k] = qrot.rotate_point(centers_[k]);
-    for (int i = 0; i < cgCharges_[k].size(); i++)
-    {
-      pos_[cgCharges_[k][i]] = qrot.rotate_point(pos_[cgCharges_[k][i]]);
-    }
-  }
-  
-  calc_cog();
+  rotate(qrot.get_rotation_matrix());
 }
 
+// Charges are stored relative to their sphere, so rotating the centers and
+// every charge offset once rotates the molecule about the origin. The
+// per-sphere charge lists are not used here: with MSMS coarse-graining they
+// can name a charge twice. The center of geometry moves with the molecule.
 void MoleculeSAM::rotate(MyMatrix<double> rotmat)
 {
   for (int k = 0; k < Ns_; k++)
-  {
     centers_[k] = centers_[k].rotate(rotmat);
-    for (int i = 0; i < cgCharges_[k].size(); i++)
-    {
-      pos_[cgCharges_[k][i]] = pos_[cgCharges_[k][i]].rotate(rotmat);
-    }
-  }
-  calc_cog();
+  pos_.rotate(rotmat);
+  cog_ = cog_.rotate(rotmat);
+  cog_unwrapped_ = cog_unwrapped_.rotate(rotmat);
+  add_rotation(rotmat);
 }
 
 void MoleculeSAM::find_centers(vector<Pt> sp, vector<Pt> np,
@@ -196,6 +189,8 @@ void MoleculeSAM::find_centers(vector<Pt> sp, vector<Pt> np,
 {
   vector<int> unbound (Nc_);
   int j = -1; int ct = 0;
+  // the same coarse graining for a type, whatever else was drawn before
+  PhiloxStream rng(0, type_);
   for (int i = 0; i < Nc_; i++) unbound[i] = i;
 
   while(unbound.size() != 0 && ct < Nc_)
@@ -204,38 +199,38 @@ void MoleculeSAM::find_centers(vector<Pt> sp, vector<Pt> np,
     cout << "# spheres to be CGed: " << unbound.size() << endl;
     centers_.resize(j+1);
     as_.resize(j+1);
-    cgCharges_.resize(j+1);
+    _cg_->cgCharges_.resize(j+1);
     
     while (m < n_trials || (m >= n_trials && n_max==0 && m < max_trials))
     {
       m++;
-      CGSphere best = find_best_center(sp, np, unbound, tol_sp, beta);
+      CGSphere best = find_best_center(sp, np, unbound, rng, tol_sp, beta);
       if (best.get_n() > n_max)
       {
         centers_[j] = best.get_center();
         as_[j] = best.get_a();
-        cgCharges_[j] = best.get_ch();
+        _cg_->cgCharges_[j] = best.get_ch();
         n_max = best.get_n();
       }
     }
     
     if (n_max == 0)
     {
-      int rand_ind = unbound[(int) floor(drand48() * unbound.size())];
-      cgCharges_[j] = { rand_ind };
+      int rand_ind = unbound[(int) floor(rng.uniform() * unbound.size())];
+      _cg_->cgCharges_[j] = { rand_ind };
       n_max = 1;
     }
     
     if (n_max == 1)
     {
-      centers_[j] = pos_[cgCharges_[j][0]];
-      as_[j] = vdwr_[cgCharges_[j][0]];
+      centers_[j] = pos_.get(_cg_->cgCharges_[j][0]);
+      as_[j] = vdwr_[_cg_->cgCharges_[j][0]];
     }
     
     // remove bound charges from list of unbound charges:
-    for (int l = 0; l < cgCharges_[j].size(); l++)
+    for (int l = 0; l < _cg_->cgCharges_[j].size(); l++)
       for (int f = 0; f < unbound.size(); f++)
-        if (unbound[f] == cgCharges_[j][l])
+        if (unbound[f] == _cg_->cgCharges_[j][l])
         {
           unbound.erase(unbound.begin() + f);
         }
@@ -244,12 +239,14 @@ void MoleculeSAM::find_centers(vector<Pt> sp, vector<Pt> np,
 
   // Setting important vals and vectors
   Ns_ = (int) centers_.size();
-  cgGridPts_.resize(Ns_); cgGdPtExp_.resize(Ns_); cgGdPtBur_.resize(Ns_);
+  _cg_->cgGridPts_.resize(Ns_); _cg_->cgGdPtExp_.resize(Ns_);
+  _cg_->cgGdPtBur_.resize(Ns_);
   cout << "End of find_centers" << endl;
 }
 
 CGSphere MoleculeSAM::find_best_center(vector<Pt> sp,vector<Pt> np,
                                       vector<int> unbound,
+                                      PhiloxStream & rng,
                                       double tol_sp, double beta)
 {
   int sz = (int) unbound.size();
@@ -258,7 +255,7 @@ CGSphere MoleculeSAM::find_best_center(vector<Pt> sp,vector<Pt> np,
   int iter(1200), best_N(0);
   vector<int> ch;  // encompassed charges of best sphere
   
-  best_cen = pos_[unbound[(int) floor(drand48()*sz)]];  
+  best_cen = pos_.get(unbound[(int) floor(rng.uniform()*sz)]);  
   for (int m = 0; m < iter; m++)
   {
     Pt tri_cen;
@@ -273,7 +270,7 @@ CGSphere MoleculeSAM::find_best_center(vector<Pt> sp,vector<Pt> np,
       if (distsq < cmin) cmin = distsq;
     }
     double scale = sqrt(cmin);
-    tri_cen = best_cen + (random_pt() * scale * random_norm());
+    tri_cen = best_cen + (random_pt(rng) * scale * random_norm(rng));
     
     int min_id = 0;
     tri_a = __DBL_MAX__;
@@ -293,12 +290,13 @@ CGSphere MoleculeSAM::find_best_center(vector<Pt> sp,vector<Pt> np,
     // count number of unbound charges within this sphere
     for (int i = 0; i < sz; i++)
     {
-      double dist = (pos_[unbound[i]] - tri_cen).norm() + vdwr_[unbound[i]];
+      double dist = (pos_.get(unbound[i]) - tri_cen).norm()
+                    + vdwr_[unbound[i]];
       if (dist < sqrt(tri_a)) tri_N++;
     }
     
     //apply MC criteria
-    if (exp(beta*(tri_N - best_N)) > drand48())
+    if (exp(beta*(tri_N - best_N)) > rng.uniform())
     {
       best_cen = tri_cen;
       best_N = tri_N;
@@ -311,7 +309,8 @@ CGSphere MoleculeSAM::find_best_center(vector<Pt> sp,vector<Pt> np,
   ch.reserve(best_N);
   for (int i = 0; i < sz; i++)
   {
-    double dist = (pos_[unbound[i]] - best_cen).norm() + vdwr_[unbound[i]];
+    double dist = (pos_.get(unbound[i]) - best_cen).norm()
+                  + vdwr_[unbound[i]];
     if (dist < sqrt(best_a))
     {
       ch.push_back(unbound[i]);
@@ -478,7 +477,7 @@ SystemSAM::SystemSAM(Setup setup, double cutoff)
       }
       else
       {
-        trans = xyzI.get_pts()[j] + com * -1.0;
+        trans = xyzI.get_pt(j) + com * -1.0;
         rot = MyMatrix<double> (3, 3, 0.0);
         rot.set_val(0, 0, 1.0);
         rot.set_val(1, 1, 1.0);
@@ -578,6 +577,24 @@ void SystemSAM::reset_positions( vector<string> xyzfiles )
   
 }
 
+shared_ptr<SystemSAM> SystemSAM::clone() const
+{
+  auto sys = make_shared<SystemSAM>(*this);
+  for (int i = 0; i < N_; i++)
+    sys->molecules_[i] = make_shared<MoleculeSAM>(
+                              *dynamic_pointer_cast<MoleculeSAM>(molecules_[i]));
+  sys->reset_to(*this);
+  return sys;
+}
+
+void SystemSAM::reset_to(const SystemSAM & sys)
+{
+  for (int i = 0; i < N_; i++)
+    *dynamic_pointer_cast<MoleculeSAM>(molecules_[i]) =
+                              *dynamic_pointer_cast<MoleculeSAM>(sys.molecules_[i]);
+  t_ = sys.t_;
+}
+
 void SystemSAM::write_to_pqr(string outfile, int mid)
 {
   int i, j, k, upper, lower, ct(0);
@@ -618,33 +635,3 @@ void SystemSAM::write_to_pqr(string outfile, int mid)
     }
   }
 }
-
-void SystemSAM::write_to_xyz(ofstream & xyz_out)
-{
-  int i, j, k, at_tot = 0;
-  char xyzlin[400];
-  
-  for ( i = 0; i < N_; i++ )
-  {
-    at_tot += get_Nc_i(i);
-    at_tot += get_Ns_i(i);
-  }
-  
-  xyz_out << at_tot << endl;
-  xyz_out << "Atoms. Timestep (ps): " << t_ << endl;
-  for ( i = 0; i < N_; i++ )
-  {
-    for ( j = 0; j < get_Nc_i(i); j++)
-    {
-      sprintf(xyzlin,"N %8.3f %8.3f %8.3f", get_posijreal(i, j).x(),
-              get_posijreal(i, j).y(), get_posijreal(i, j).z());
-      xyz_out << xyzlin << endl;
-    }
-    for (k = 0; k < get_Ns_i(i); k++)
-    {
-      sprintf(xyzlin,"X %8.3f %8.3f %8.3f", get_centerik(i, k).x(),
-            get_centerik(i, k).y(), get_centerik(i, k).z());
-      xyz_out << xyzlin << endl;
-    }
-  }
-}
@@ -59,12 +59,16 @@ public:
 };
 
 
-class MoleculeSAM : public BaseMolecule
+/*
+ Coarse-graining data of a molecule type: the sphere neighbours, which
+ charges each sphere holds and the surface grids with their exposed and
+ buried points. None of it changes as a molecule moves, so every copy made
+ from the representative of a type refers to one instance rather than
+ carrying its own
+ */
+class CGTypeData
 {
-protected:
-  Pt                  cog_; // MoleculeSAM center of geometry
-  Pt                  cog_unwrapped_; // MoleculeSAM center of geometry unwrapp
-  
+public:
   vector<vector<int> > cgNeighs_; // list of indices of CG centers that neighbor
                                    // each coarse grained sphere
   vector<vector<Pt> >  cgGridPts_; // grid points on the surface of
@@ -79,15 +83,27 @@ protected:
                                    // coarse grained sphere
   vector<vector<int> > cgChargesOut_; // indices of charges not within each
                                    // coarse grained sphere
+  map<int, int>        chToCG_; // maps index of charge to
+                                //index of its coarse-grained sphere
+  
+  CGTypeData(int ns=0)
+  :cgGridPts_(ns), cgGdPtExp_(ns), cgGdPtBur_(ns), cgCharges_(ns) { }
+};
+
 
+class MoleculeSAM : public BaseMolecule
+{
+protected:
+  Pt                  cog_; // MoleculeSAM center of geometry
+  Pt                  cog_unwrapped_; // MoleculeSAM center of geometry unwrapp
+  
+  shared_ptr<CGTypeData> _cg_; // shared by every copy of this type
+  
   vector<vector<vector<int> > > interPol_; // For each sph in mol, list of
                                        // mol/sph pairs that are within 10A
   vector<vector<vector<int> > > interAct_; // For each sph in mol, list of
                                       // mol/sph pairs that are btw 100 & 10A
   
-  map<int, int>        chToCG_; // maps index of charge to
-                                //index of its coarse-grained sphere
-  
   int find_closest_center(Pt pos);
   
   /*
@@ -102,7 +118,7 @@ protected:
    remaining chargesg
    */
   CGSphere find_best_center(vector<Pt> sp,vector<Pt> np,
-                            vector<int> unbounded,
+                            vector<int> unbounded, PhiloxStream & rng,
                             double tol_sp, double beta=2.0);
 
   /* Ensure that all the CG spheres are touching */
@@ -112,10 +128,10 @@ protected:
   vector <int> find_neighbors( int i);
   
   // random number from normal distribution
-  double random_norm();
+  double random_norm(PhiloxStream & rng);
   
   /* Choose a random orientation for a Pt vector  */
-  Pt random_pt();
+  Pt random_pt(PhiloxStream & rng);
 
   void map_repos_charges();
   
@@ -157,9 +173,16 @@ public:
     return false;
   }
   
-  void set_gridj(int j, vector<Pt> grid) {cgGridPts_[j] = grid;}
-  void set_gridexpj(int j, vector<int> grid_exp) {cgGdPtExp_[j] = grid_exp;}
-  void set_gridburj(int j, vector<int> grid_bur) {cgGdPtBur_[j] = grid_bur;}
+  // The grids belong to the type, setting them on one copy sets them on all
+  void set_gridj(int j, vector<Pt> grid) {_cg_->cgGridPts_[j] = grid;}
+  void set_gridexpj(int j, vector<int> grid_exp)
+  {_cg_->cgGdPtExp_[j] = grid_exp;}
+  void set_gridburj(int j, vector<int> grid_bur)
+  {_cg_->cgGdPtBur_[j] = grid_bur;}
+  
+  // true if this molecule refers to the same type data as mol
+  bool shares_type_data(const MoleculeSAM & mol) const
+  { return _cg_ == mol._cg_; }
   
   void translate(Pt dr, double boxlen);
   void rotate(Quat qrot); // This will rotate with respect to origin!
@@ -168,19 +191,19 @@ public:
   void calc_cog();
   void write_pqr(string outfile);
 
-  int get_nc_k(int k) const           { return (int) cgCharges_[k].size(); }
-  vector<int> get_neighj(int j) const { return cgNeighs_[j]; }
-  vector<Pt> get_gridj(int j) const   { return cgGridPts_[j]; }
-  Pt get_gridjh(int j, int h) const   { return cgGridPts_[j][h]; }
-  vector<int> get_gdpt_expj(int j) const { return cgGdPtExp_[j]; }
-  vector<int> get_gdpt_burj(int j) const { return cgGdPtBur_[j]; }
-  vector<int> get_ch_allin_k(int k)   { return cgChargesIn_[k]; }
-  vector<int> get_ch_allout_k(int k)  { return cgChargesOut_[k]; }
-  int get_ch_k_alpha(int k, int alpha){ return cgCharges_[k][alpha]; }
-  Pt get_cen_j(int j)                 { return centers_[chToCG_[j]]; }
+  int get_nc_k(int k) const     { return (int) _cg_->cgCharges_[k].size(); }
+  vector<int> get_neighj(int j) const { return _cg_->cgNeighs_[j]; }
+  vector<Pt> get_gridj(int j) const   { return _cg_->cgGridPts_[j]; }
+  Pt get_gridjh(int j, int h) const   { return _cg_->cgGridPts_[j][h]; }
+  vector<int> get_gdpt_expj(int j) const { return _cg_->cgGdPtExp_[j]; }
+  vector<int> get_gdpt_burj(int j) const { return _cg_->cgGdPtBur_[j]; }
+  vector<int> get_ch_allin_k(int k)   { return _cg_->cgChargesIn_[k]; }
+  vector<int> get_ch_allout_k(int k)  { return _cg_->cgChargesOut_[k]; }
+  int get_ch_k_alpha(int k, int alpha){ return _cg_->cgCharges_[k][alpha]; }
+  Pt get_cen_j(int j)                 { return centers_[_cg_->chToCG_[j]]; }
   Pt get_cog() const                  { return cog_;}
   Pt get_unwrapped_center() const     { return cog_unwrapped_; }
-  const int get_cg_of_ch(int j)       { return chToCG_[j]; }
+  const int get_cg_of_ch(int j)       { return _cg_->chToCG_[j]; }
   vector<vector<int> > get_inter_act_k(int k) {return interAct_[k]; }
 
 };
@@ -238,9 +261,13 @@ public:
   void save_min_dist();
   
   //Copy surface integral points from molecule i to molecule j. MUST
-  // be the same type!
+  // be the same type! Copies of one type already share their grids
   void copy_grid( int i, int j)
   {
+    auto moli = dynamic_pointer_cast<MoleculeSAM>(molecules_[i]);
+    auto molj = dynamic_pointer_cast<MoleculeSAM>(molecules_[j]);
+    if (moli && molj && moli->shares_type_data(*molj)) return;
+    
     for (int k = 0; k < molecules_[i]->get_ns(); k++)
     {
       molecules_[j]->set_gridj(k, molecules_[i]->get_gridj(k));
@@ -252,13 +279,18 @@ public:
   // Reset positions for new BD trajectory
   void reset_positions(vector<string> xyzfiles);
   
+  // Copy of the system whose molecules move independently of this one.
+  // Type data and surface grids stay shared between the two
+  shared_ptr<SystemSAM> clone() const;
+  
+  // Put every molecule back to its pose in sys, a clone of this system,
+  // keeping the molecule objects that solvers hold on to
+  void reset_to(const SystemSAM & sys);
+  
   // write current system to PQR file, mid=-1 is print all MoleculeSAMs,
   // else only print one
   void write_to_pqr(string outfile, int mid = -1 );
   
-  // write current system configuration to XYZ file
-  void write_to_xyz(ofstream &xyz_out);
-  
 };
 
 /*
@@ -269,18 +301,18 @@ class OverlappingMoleculeSAMException: public exception
 protected:
   int idx1_;
   int idx2_;
+  string msg_;
   
 public:
   OverlappingMoleculeSAMException(int idx1, int idx2)
   :idx1_(idx1), idx2_(idx2)
   {
+    msg_ = "MoleculeSAM " + to_string(idx1_)+" & " + to_string(idx2_) + " overlap";
   }
   
   virtual const char* what() const throw()
   {
-    string ss;
-    ss = "MoleculeSAM " + to_string(idx1_)+" & " + to_string(idx2_) + " overlap";
-    return ss.c_str();
+    return msg_.c_str();
   }
 };
 
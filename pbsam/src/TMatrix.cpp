@@ -7,13 +7,16 @@
 //
 
 #include "TMatrix.h"
+#include "PoleKernels.h"
 
 TMatrix::TMatrix(int p, shared_ptr<SystemSAM> _sys,
                  shared_ptr<SHCalc> _shcalc,
                  shared_ptr<Constants> _consts,
                  shared_ptr<BesselCalc> _besselcalc,
                  shared_ptr<ReExpCoeffsConstants> _reexpconsts)
-:p_(p), kappa_(_consts->get_kappa()), Nmol_(_sys->get_n()), _system_(_sys),
+:p_(p), kappa_(_consts->get_kappa()),
+mixedDist_(_consts->get_mixed_prec_dist()), Nmol_(_sys->get_n()),
+_system_(_sys),
 _besselCalc_(_besselcalc), _shCalc_(_shcalc)
 {
   int total_spheres=0;
@@ -42,6 +45,8 @@ void TMatrix::update_vals(shared_ptr<SystemSAM> _sys, shared_ptr<SHCalc> _shcalc
   double ak, al;
   vector<int> idx_vec;
   vector<double> kapVal(2);
+  vector<double> besselK;
+  SHWorkspace shws = _shcalc->make_workspace();
   for (int I = 0; I < _sys->get_n(); I++)
   {
     for (int J = 0; J < _sys->get_n(); J++)
@@ -75,15 +80,17 @@ void TMatrix::update_vals(shared_ptr<SystemSAM> _sys, shared_ptr<SHCalc> _shcalc
           if ( I == J ) kapVal = {0.0, kappa_};
           kapVal = {kappa_, kappa_};
           v = _sys->get_pbc_dist_vec_base(c_Ik, c_Jl);
-          vector<double> besselK = _besselcalc->calc_mbfK(2*p_,kapVal[1]*v.r());
-          _shcalc->calc_sh(v.theta(), v.phi());
+          _besselcalc->calc_mbfK(2*p_, kapVal[1]*v.r(), besselK);
+          _shcalc->calc_sh(v.theta(), v.phi(), shws);
           
           vector<double> lambdas = {_sys->get_aik(J, l), _sys->get_aik(I, k)};
+          // far pairs keep their coefficients in single precision only
+          bool single = (mixedDist_ > 0) && (v.r() > mixedDist_);
           auto re_exp = make_shared<ReExpCoeffs>(p_, v,
-                                                 _shcalc->get_full_result(),
+                                                 shws.get_full_result(),
                                                  besselK, _reexpconsts,
                                                  kapVal,
-                                                 lambdas, false);
+                                                 lambdas, false, single);
           T_.push_back(re_exp);
           idxMap_[idx_vec] = idx;
           idx++;
@@ -132,7 +139,7 @@ void TMatrix::update_vals(shared_ptr<SystemSAM> _sys, shared_ptr<SHCalc> _shcalc
 //}
 
 
-MyMatrix<cmplx> TMatrix::re_expandX_numeric(vector<vector<double> > X,
+MyMatrix<cmplx> TMatrix::re_expandX_numeric(const vector<vector<double> > & X,
                                             int I, int k,
                                             int J, int l, double kappa,
                                             shared_ptr<PreCalcSH> pre_sh,
@@ -171,7 +178,7 @@ MyMatrix<cmplx> TMatrix::re_expandX_numeric(vector<vector<double> > X,
 
 
 
-MyMatrix<cmplx> TMatrix::re_expandX(MyMatrix<cmplx> X,
+MyMatrix<cmplx> TMatrix::re_expandX(const MyMatrix<cmplx> & X,
                                     int I, int k,
                                    int J, int l, bool isF)
 {
@@ -185,6 +192,40 @@ MyMatrix<cmplx> TMatrix::re_expandX(MyMatrix<cmplx> X,
   return Z;
 }
 
+/*
+ The kernels copy their input before writing, so after the first rotation
+ the translation and back rotation can run in place on out
+ */
+void TMatrix::re_expand_into(const MyMatrix<cmplx> & X, MyMatrix<cmplx> & out,
+                             int I, int k, int J, int l, bool isF)
+{
+  const ReExpCoeffs & T = *T_[idxMap_[{I, k, J, l}]];
+  double (ReExpCoeffs::*sget)(int, int, int) const = &ReExpCoeffs::get_sval;
+  if (isF) sget = &ReExpCoeffs::get_s_fval;
+  
+  if (!T.isSingular())
+  {
+    POLE_DISPATCH(p_, rotate_fixed, p_, T, &ReExpCoeffs::get_rval, X, out,
+                  false);
+  } else
+  {
+    for (int n = 0; n < p_; n++)
+      for (int m = -n; m <= n; m++)
+        out(n, m+p_) = X(n, m+p_);
+    rotate_sing_inplace(p_, T.get_TVec().theta(), out);
+  }
+  
+  POLE_DISPATCH(p_, translate_fixed, p_, T, sget, out, out, false,
+                &T.get_lam_scale()[0]);
+  
+  if (!T.isSingular())
+  {
+    POLE_DISPATCH(p_, rotate_fixed, p_, T, &ReExpCoeffs::get_rval, out, out,
+                  true);
+  } else
+    rotate_sing_inplace(p_, T.get_TVec().theta(), out);
+}
+
 
 /*
  re-expand element j of grad(X) with element (i, j) of T. Requires 
@@ -234,7 +275,7 @@ MyMatrix<Ptx> TMatrix::re_expand_gradX(MyMatrix<Ptx> dX,
 }
 
 
-MyMatrix<Ptx> TMatrix::re_expandX_gradT(MyMatrix<cmplx> X,
+MyMatrix<Ptx> TMatrix::re_expandX_gradT(const MyMatrix<cmplx> & X,
                                          int I, int k,
                                          int J, int l)
 {
@@ -284,7 +325,7 @@ MyMatrix<Ptx> TMatrix::re_expandX_gradT(MyMatrix<cmplx> X,
 }
 
 // Perform local expansion from J, l onto I, k
-MyMatrix<Ptx> TMatrix::re_expandgradX_numeric(vector<vector<Pt> > X,
+MyMatrix<Ptx> TMatrix::re_expandgradX_numeric(const vector<vector<Pt> > & X,
                                               int I, int k,
                                               int J, int l, double kappa,
                                               shared_ptr<PreCalcSH> pre_sh,
@@ -298,10 +339,11 @@ MyMatrix<Ptx> TMatrix::re_expandgradX_numeric(vector<vector<Pt> > X,
   
   for (h = 0; h < X[l].size(); h++)
   {
-    if (X[l][h].norm2() < 1e-15) continue;
+    Pt xh = X[l][h];
+    if (xh.norm2() < 1e-15) continue;
     for (int d = 0; d < 3; d++)
     {
-      xval = X[l][h].get_cart(d);
+      xval = xh.get_cart(d);
       
       Pt sph_dist = _system_->get_centerik(I, k) - _system_->get_centerik(J, l);
       Pt loc = _system_->get_gridijh(J, l, exp_pts[h]) - sph_dist;
@@ -334,156 +376,110 @@ bool TMatrix::is_Jl_greater(int I, int k, int J, int l)
 }
 
 // perform first part of T*A and return results
-MyMatrix<cmplx> TMatrix::expand_RX(MyMatrix<cmplx> X,
+MyMatrix<cmplx> TMatrix::expand_RX(const MyMatrix<cmplx> & X,
                                    int I, int k, int J, int l,
                                    WhichReEx whichR)
 {
 
-  int n, m, s, map_idx;
+  int n, m, map_idx;
   map_idx = idxMap_[{I, k, J, l}];
   
   MyMatrix<cmplx> x1(p_, 2*p_ + 1);
-  cmplx inter, rval, aval;
+  cmplx aval;
+  
+  if (!T_[map_idx]->isSingular())
+  {
+    cmplx (ReExpCoeffs::*rget)(int, int, int) const = &ReExpCoeffs::get_rval;
+    if (whichR == DDPHI)        rget = &ReExpCoeffs::get_dr_dphi_val;
+    else if (whichR == DDTHETA) rget = &ReExpCoeffs::get_dr_dtheta_val;
+    
+    POLE_DISPATCH(p_, rotate_fixed, p_, *T_[map_idx], rget, X, x1, false);
+    return x1;
+  }
+  
+  // fill X1 for singular T:
+  Pt vec = T_[map_idx]->get_TVec();
+  if (whichR == DDTHETA)
+    return expand_dRdtheta_sing(X, I, k, J, l, vec.theta(), false);
+  else if (whichR == DDPHI)
+    return expand_dRdphi_sing(X, I, k, J, l, vec.theta(), false);
   
-  // fill X1:
   for (n = 0; n < p_; n++)
   {
     for (m = -n; m <= n; m++)
     {
-      inter  = 0;
-      if (T_[map_idx]->isSingular())
-      {
-        Pt vec = T_[map_idx]->get_TVec();
-        if (whichR == BASE)
-        {
-          aval = X(n, -m+p_);
-          if (vec.theta() > M_PI/2.0)
-            x1.set_val(n, m+p_, (n%2 == 0 ? aval : -aval));
-          else x1.set_val(n, m+p_, X(n, m+p_));
-        } else if (whichR == DDTHETA)
-        {
-          x1 = expand_dRdtheta_sing(X, I, k, J, l, vec.theta(), false);
-          return x1;
-        }
-        else
-        {
-          x1 = expand_dRdphi_sing(X, I, k, J, l, vec.theta(), false);
-          return x1;
-        }
-      } else
-      {
-        for (s = -n; s <= n; s++)
-        {
-          if (whichR == DDPHI)
-            rval = T_[map_idx]->get_dr_dphi_val(n, m, s);
-          else if (whichR == DDTHETA)
-            rval = T_[map_idx]->get_dr_dtheta_val(n, m, s);
-          else
-            rval = T_[map_idx]->get_rval(n, m, s);
-          
-          aval = X(n, s+p_);
-          
-          inter += rval * aval;
-        } // end s
-        x1.set_val(n, m+p_, inter);
-      }
+      aval = X(n, -m+p_);
+      if (vec.theta() > M_PI/2.0)
+        x1.set_val(n, m+p_, (n%2 == 0 ? aval : -aval));
+      else x1.set_val(n, m+p_, X(n, m+p_));
     } // end m
   } //end n
   return x1;
 }
 
 // perform second part of T*A and return results
-MyMatrix<cmplx> TMatrix::expand_SX(MyMatrix<cmplx> x1,
+MyMatrix<cmplx> TMatrix::expand_SX(const MyMatrix<cmplx> & x1,
                                    int I, int k, int J, int l,
                                    WhichReEx whichS)
 {
-  double fac;
-  cmplx inter, sval;
   MyMatrix<cmplx> x2(p_, 2*p_ + 1);
   
-  int n, m, s, map_idx = idxMap_[{I, k, J, l}];
-  vector<double> lam = T_[map_idx]->get_lambdas();
-  vector<double> lamScl = T_[map_idx]->get_lam_scale();
+  int map_idx = idxMap_[{I, k, J, l}];
+  const vector<double> & lamScl = T_[map_idx]->get_lam_scale();
+  
+  double (ReExpCoeffs::*sget)(int, int, int) const = &ReExpCoeffs::get_sval;
+  if (whichS == DDR)        sget = &ReExpCoeffs::get_dsdr_val;
+  else if (whichS == FBASE) sget = &ReExpCoeffs::get_s_fval;
   
   // fill x2:
-  for (n = 0; n < p_; n++)
-  {
-    for (m = -n; m <= n; m++)
-    {
-      inter  = 0;
-      for (s = abs(m); s < p_; s++)
-      {
-        fac = ( s <= n ) ? lamScl[n-s] : 1.0;
-        if (whichS == DDR) sval = T_[map_idx]->get_dsdr_val(n, s, m);
-        else if (whichS == FBASE) sval = T_[map_idx]->get_s_fval(n, s, m);
-        else sval = T_[map_idx]->get_sval(n, s, m);
-        inter += fac * sval * x1(s, m+p_);
-      } // end l
-      x2.set_val(n, m+p_, inter);
-    } // end m
-  } //end n
+  POLE_DISPATCH(p_, translate_fixed, p_, *T_[map_idx], sget, x1, x2, false,
+                &lamScl[0]);
   return x2;
 }
 //
 // perform third part of T*A and return results
-MyMatrix<cmplx> TMatrix::expand_RHX( MyMatrix<cmplx> x2,
+MyMatrix<cmplx> TMatrix::expand_RHX( const MyMatrix<cmplx> & x2,
                                     int I, int k, int J, int l,
                                     WhichReEx whichRH)
 {
-  int n, m, s, map_idx = idxMap_[{I, k, J, l}];
-  cmplx inter, rval;
+  int n, m, map_idx = idxMap_[{I, k, J, l}];
   MyMatrix<cmplx> z(p_, 2*p_ + 1);
   
 //  bool jl_greater = is_Jl_greater(I, k, J, l);
 //  if (jl_greater) map_idx = idxMap_[{I, k, J, l}];
 //  else            map_idx = idxMap_[{J, l, I, k}];
   
-  //fill zj:
+  if (!T_[map_idx]->isSingular())
+  {
+    cmplx (ReExpCoeffs::*rget)(int, int, int) const = &ReExpCoeffs::get_rval;
+    if (whichRH == DDPHI)        rget = &ReExpCoeffs::get_dr_dphi_val;
+    else if (whichRH == DDTHETA) rget = &ReExpCoeffs::get_dr_dtheta_val;
+    
+    POLE_DISPATCH(p_, rotate_fixed, p_, *T_[map_idx], rget, x2, z, true);
+    return z;
+  }
+  
+  //fill zj for singular T:
+  Pt vec = T_[map_idx]->get_TVec();
+  if (whichRH == DDTHETA)
+    return expand_dRdtheta_sing(x2, I, k, J, l, vec.theta(), true);
+  else if (whichRH == DDPHI)
+    return expand_dRdphi_sing(x2, I, k, J, l, vec.theta(), true);
+  
   for (n = 0; n < p_; n++)
   {
     for (m = -n; m <= n; m++)
     {
-      inter  = 0;
-      if (T_[map_idx]->isSingular())
-      {
-        Pt vec = T_[map_idx]->get_TVec();
-        if (whichRH == BASE)
-        {
-          if (vec.theta() > M_PI/2.0)
-            z.set_val(n, m+p_, (n%2 == 0 ? x2(n,-m+p_) : -x2(n,-m+p_)));
-          else
-            z.set_val(n, m+p_, x2(n,m+p_));
-        } else if (whichRH == DDTHETA)
-        {
-          z = expand_dRdtheta_sing(x2, I, k, J, l, vec.theta(), true);
-          return z;
-        }
-        else
-        {
-          z = expand_dRdphi_sing(x2, I, k, J, l, vec.theta(), true);
-          return z;
-        }
-      } else
-      {
-        for (s = -n; s <= n; s++)
-        {
-          if (whichRH == DDPHI)
-            rval = T_[map_idx]->get_dr_dphi_val(n, s, m);
-          else if (whichRH == DDTHETA)
-            rval = T_[map_idx]->get_dr_dtheta_val(n, s, m);
-          else
-            rval = T_[map_idx]->get_rval(n, s, m);
-          
-          inter += conj(rval) * x2(n, s+p_);
-        } // end s
-        z.set_val(n, m+p_, inter);
-      }
+      if (vec.theta() > M_PI/2.0)
+        z.set_val(n, m+p_, (n%2 == 0 ? x2(n,-m+p_) : -x2(n,-m+p_)));
+      else
+        z.set_val(n, m+p_, x2(n,m+p_));
     } // end m
   } //end n
   return z;
 }
 
-MyMatrix<cmplx> TMatrix::expand_dRdtheta_sing(MyMatrix<cmplx> mat,
+MyMatrix<cmplx> TMatrix::expand_dRdtheta_sing(const MyMatrix<cmplx> & mat,
                                               int I, int k, int J, int l,
                                               double theta, bool ham)
 {
@@ -536,7 +532,7 @@ MyMatrix<cmplx> TMatrix::expand_dRdtheta_sing(MyMatrix<cmplx> mat,
   return x;
 }
 
-MyMatrix<cmplx> TMatrix::expand_dRdphi_sing(MyMatrix<cmplx> mat,
+MyMatrix<cmplx> TMatrix::expand_dRdphi_sing(const MyMatrix<cmplx> & mat,
                                             int I, int k, int J, int l,
                                             double theta, bool ham)
 {
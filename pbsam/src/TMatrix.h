@@ -34,6 +34,7 @@ protected:
   
   int     p_;
   double  kappa_;
+  double  mixedDist_; // sphere separation beyond which T is single precision
   vector<double> lam_scl_; // S factors, 0=kpio and 1=kpoo, for PB-SAM
   
   vector<shared_ptr<ReExpCoeffs> > T_;
@@ -51,23 +52,23 @@ protected:
   
   
   // inner functions for re-expansion
-  MyMatrix<cmplx> expand_RX(MyMatrix<cmplx> X,
+  MyMatrix<cmplx> expand_RX(const MyMatrix<cmplx> & X,
                             int I, int k, int J, int l,
                             WhichReEx whichR);
   
-  MyMatrix<cmplx> expand_SX(MyMatrix<cmplx> x1,
+  MyMatrix<cmplx> expand_SX(const MyMatrix<cmplx> & x1,
                             int I, int k, int J, int l,
                             WhichReEx whichS);
   
-  MyMatrix<cmplx> expand_RHX(MyMatrix<cmplx> x2,
+  MyMatrix<cmplx> expand_RHX(const MyMatrix<cmplx> & x2,
                              int I, int k, int J, int l,
                              WhichReEx whichRH);
   
-  MyMatrix<cmplx> expand_dRdtheta_sing(MyMatrix<cmplx> mat,
+  MyMatrix<cmplx> expand_dRdtheta_sing(const MyMatrix<cmplx> & mat,
                                       int I, int k, int J, int l,
                                       double theta, bool ham);
   
-  MyMatrix<cmplx> expand_dRdphi_sing(MyMatrix<cmplx> mat,
+  MyMatrix<cmplx> expand_dRdphi_sing(const MyMatrix<cmplx> & mat,
                                        int I, int k, int J, int l,
                                        double theta, bool ham);
   
@@ -109,8 +110,16 @@ public:
   /*
    Re-expand a matrix X with respect to T(I,k)(J,l)
    */
-  MyMatrix<cmplx> re_expandX(MyMatrix<cmplx> X, int I, int k, int J, int l,
-                             bool isF = false);
+  MyMatrix<cmplx> re_expandX(const MyMatrix<cmplx> & X,
+                             int I, int k, int J, int l, bool isF = false);
+  
+  /*
+   As re_expandX, but write the result into out, which must already be
+   (p, 2p+1). No temporaries are created, so this can be used in the
+   polarization loops with a buffer the caller keeps between calls
+   */
+  void re_expand_into(const MyMatrix<cmplx> & X, MyMatrix<cmplx> & out,
+                      int I, int k, int J, int l, bool isF = false);
   
   /*
    Re-expand a numerical surface with respect to T(I,k)(J,l) (Equation 27b [1])
@@ -118,8 +127,8 @@ public:
 //  MyMatrix<cmplx> re_expandX_numeric(vector<vector<double> > X, int I, int k,
 //                                   int J, int l, double kappa);
   
-  MyMatrix<cmplx> re_expandX_numeric(vector<vector<double> > X, int I, int k,
-                                     int J, int l, double kappa,
+  MyMatrix<cmplx> re_expandX_numeric(const vector<vector<double> > & X,
+                                     int I, int k, int J, int l, double kappa,
                                      shared_ptr<PreCalcSH> pre_sh,
                                      bool no_pre_sh=false);
   
@@ -136,7 +145,7 @@ public:
    Re-expand X with element (I, k, J, l) of grad(T) and return
    a matrix of Point objects containing each element of the gradient
    */
-  MyMatrix<Ptx> re_expandX_gradT(MyMatrix<cmplx> X,
+  MyMatrix<Ptx> re_expandX_gradT(const MyMatrix<cmplx> & X,
                                  int I, int k,
                                  int J, int l);
   
@@ -144,7 +153,7 @@ public:
    Locally re-expand X with element (I, k, J, l) of grad(T) and return
    a matrix of Point objects containing each element of the gradient
    */
-  MyMatrix<Ptx> re_expandgradX_numeric(vector<vector<Pt> > X,
+  MyMatrix<Ptx> re_expandgradX_numeric(const vector<vector<Pt> > & X,
                                        int I, int k,
                                        int J, int l, double kappa,
                                        shared_ptr<PreCalcSH> pre_sh,
@@ -0,0 +1,99 @@
+/*
+ expconvert.cpp
+ 
+ Converts text expansion files, one per sphere, to one binary expansion
+ file. Either give prefixes, to convert <prefix>.0.exp, <prefix>.1.exp, ...
+ to <prefix>.bexp, or the output .bexp followed by the sphere files in order
+ 
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ExpansionFile.h"
+
+using namespace std;
+
+int convert(const vector<string> & files, string out)
+{
+  try
+  {
+    ExpansionFile::convert_text(files, out);
+  } catch (const BadExpansionFileException & ex)
+  {
+    cout << ex.what() << endl;
+    return 1;
+  } catch (const CouldNotReadException & ex)
+  {
+    cout << ex.what() << endl;
+    return 1;
+  } catch (const CouldNotWriteException & ex)
+  {
+    cout << ex.what() << endl;
+    return 1;
+  }
+  cout << "Wrote " << out << " from " << files.size() << " files" << endl;
+  return 0;
+}
+
+int main(int argc, const char * argv[])
+{
+  if ( argc < 2 )
+  {
+    cout << "Correct input format: ./pbexpconv <exp_prefix> ..." << endl;
+    cout << "                  or: ./pbexpconv out.bexp sph0.exp sph1.exp ...";
+    cout << endl;
+    exit(0);
+  }
+  
+  string first = argv[1];
+  if (first.size() > 5 && first.compare(first.size()-5, 5, ".bexp") == 0)
+  {
+    vector<string> files;
+    for (int a = 2; a < argc; a++) files.push_back(argv[a]);
+    for (int k = 0; k < files.size(); k++)
+      if (!ifstream(files[k].c_str()))
+      {
+        cout << "Could not read " << files[k] << endl;
+        return 1;
+      }
+    return files.empty() ? 1 : convert(files, first);
+  }
+  
+  for (int a = 1; a < argc; a++)
+  {
+    string prefix = argv[a];
+    vector<string> files;
+    while (ifstream((prefix + "." + to_string(files.size()) + ".exp").c_str()))
+      files.push_back(prefix + "." + to_string(files.size()) + ".exp");
+    
+    if (files.empty())
+    {
+      cout << "No files " << prefix << ".[#].exp found" << endl;
+      return 1;
+    }
+    if (convert(files, prefix + ".bexp") != 0) return 1;
+  }
+  return 0;
+}
@@ -31,20 +31,30 @@
 
 #include "PBSAM.h"
 
+// benchmark builds count heap allocations in the solvers
+#ifdef PB_BENCHMARK
+#define PB_COUNT_ALLOCS
+#include "AllocCounter.h"
+#endif
+
 using namespace std;
 
 int main(int argc, const char * argv[])
 {
-  if ( argc != 2 )
+  string cache_dir = "";
+  if ( argc == 4 && string(argv[2]) == "--cache-dir" )
+    cache_dir = argv[3];
+  else if ( argc != 2 )
   {
-    cout << "Correct input format: ./exec run.inp " << endl;
+    cout << "Correct input format: ./exec run.inp [--cache-dir <dir>]" << endl;
     exit(0);
   }
   string input_file = argv[1];
 //string test_dir_loc = "/Users/davidbrookes/Projects/pb_solvers/pbsam/pbsam_test_files/gtest/";
 //  string input_file = "/Users/lfelberg/PBSAM/pb_solvers/pbsam/pbsam_test_files/dynamics_test/opp/run.gly.hr.inp";
   
-  PBSAM pbsam_run(input_file);
+  MPIShard::Session mpi;
+  PBSAM pbsam_run(input_file, cache_dir);
   pbsam_run.run();
   return 0;
 }
@@ -0,0 +1,97 @@
+/*
+ trajconvert.cpp
+ 
+ Expands a binary pose trajectory (.ptraj) written by a dynamics run back to
+ atoms: frames first to last to an XYZ file, or a single frame to a PQR.
+ With only the trajectory given, prints a summary of its frames
+ 
+ Copyright (c) 2015, Teresa Head-Gordon, Lisa Felberg, Enghui Yap, David Brookes
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of UC Berkeley nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PoseTrajectory.h"
+
+using namespace std;
+
+static bool ends_with(string s, string ext)
+{
+  return s.size() > ext.size() &&
+         s.compare(s.size()-ext.size(), ext.size(), ext) == 0;
+}
+
+int main(int argc, const char * argv[])
+{
+  if ( argc < 2 )
+  {
+    cout << "Correct input format: ./pbtraj in.ptraj" << endl;
+    cout << "                  or: ./pbtraj in.ptraj out.xyz [first [last]]";
+    cout << endl;
+    cout << "                  or: ./pbtraj in.ptraj out.pqr [frame]" << endl;
+    exit(0);
+  }
+  
+  try
+  {
+    PoseTrajReader traj(argv[1]);
+    int nfr = traj.get_nframes();
+    if (argc == 2)
+    {
+      cout << argv[1] << ": " << traj.get_nmol() << " molecules of "
+           << traj.get_ntype() << " types, " << nfr << " frames" << endl;
+      for (int ty = 0; ty < traj.get_ntype(); ty++)
+        cout << "  type " << ty << ": " << traj.get_type_ref(ty).pqr << endl;
+      if (nfr > 0)
+        cout << "  time (ps) " << traj.get_frame(0).t << " to "
+             << traj.get_frame(nfr-1).t << endl;
+      return 0;
+    }
+    
+    string out = argv[2];
+    ofstream fout(out.c_str());
+    if (!fout)
+    {
+      cout << "Could not open " << out << endl;
+      return 1;
+    }
+    if (ends_with(out, ".pqr"))
+    {
+      int f = (argc > 3) ? atoi(argv[3]) : nfr-1;
+      traj.write_pqr(fout, f);
+      cout << "Wrote frame " << f << " to " << out << endl;
+    } else
+    {
+      int first = (argc > 3) ? atoi(argv[3]) : 0;
+      int last  = (argc > 4) ? atoi(argv[4]) : nfr-1;
+      for (int f = first; f <= last; f++) traj.write_xyz(fout, f);
+      cout << "Wrote frames " << first << " to " << last << " to " << out;
+      cout << endl;
+    }
+  } catch (const exception & ex)
+  {
+    cout << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -11,6 +11,8 @@
 
 #include "PhysCalcSAM.h"
 #include "Solver.h"
+#include "ElectrostaticsSAM.h"
+#include "PotentialGrid.h"
 
 /*
  Class for unit testing energy calculations
@@ -375,4 +377,127 @@ TEST_F(ForceUTest, three_mol_test)
 }
 
 
+// ligand in the tabulated potential of a lone static receptor, which is
+// not solved, against the full two body solve. Torques are about the cog,
+// as in PhysCalcSAM
+TEST_F(ForceUTest, static_grid_test)
+{
+  int pol(3);
+  PQRFile pqr(test_dir_loc + "test_cged.pqr");
+  auto cst = make_shared<Constants> ();
+  cst->set_dielectric_water(80);
+  cst->set_dielectric_prot(4);
+  cst->set_salt_concentration(0.01);
+  cst->set_temp(298.15);
+  cst->set_kappa(0.0325628352);
+  
+  auto SHCalcTest = make_shared<SHCalc> (2*pol,
+                                   make_shared<SHCalcConstants> (2*pol));
+  auto BesselCal = make_shared<BesselCalc>(2*pol,
+                                   make_shared<BesselConstants> (2*pol));
+  auto _expcons = make_shared<ExpansionConstants> (pol);
+  
+  auto rec = make_shared<MoleculeSAM>(0, 0, "stat", pqr.get_charges(),
+                                      pqr.get_atom_pts(), pqr.get_radii(),
+                                      pqr.get_cg_centers(),
+                                      pqr.get_cg_radii());
+  rec->translate(Pt(0.0, 0.0, 0.0) - rec->get_cog(), 1e14);
+  auto lig = make_shared<MoleculeSAM>(1, 0, "move",
+                                      vector<double> {-1.0, 0.5},
+                                      vector<Pt> {Pt(-1.5, 0.0, 0.0),
+                                                  Pt(1.5, 0.0, 0.0)},
+                                      vector<double> {1.0, 1.0},
+                                      vector<Pt> {Pt(-1.5, 0.0, 0.0),
+                                                  Pt(1.5, 0.0, 0.0)},
+                                      vector<double> {1.8, 1.8});
+  double recR(0.0);
+  for (int k = 0; k < rec->get_ns(); k++)
+    recR = max(recR, rec->get_centerk(k).norm() + rec->get_ak(k));
+  
+  // self polarization and surface integrals of each type, on its own
+  vector<shared_ptr<IEMatrix> > imats;
+  vector<shared_ptr<HMatrix> > h_spol;
+  vector<shared_ptr<FMatrix> > f_spol;
+  for (auto mol : {rec, lig})
+  {
+    auto one = make_shared<SystemSAM>(vector<shared_ptr<BaseMolecule> >
+                                      (1, make_shared<MoleculeSAM>(*mol)));
+cout << "DBG at Solver self_pol(one" << endl;
+    Solver self_pol(one, cst, SHCalcTest, BesselCal, pol);
+    self_pol.solve(1e-15, 500);
+    imats.push_back(self_pol.get_IE()[0]);
+    h_spol.push_back(self_pol.get_all_H()[0]);
+    f_spol.push_back(self_pol.get_all_F()[0]);
+  }
+  
+cout << "DBG at auto statSys = make_shared<Sys" << endl;
+  auto statSys = make_shared<SystemSAM>(vector<shared_ptr<BaseMolecule> >
+                                        (1, make_shared<MoleculeSAM>(*rec)));
+  auto statSolv = make_shared<Solver>(statSys, cst, SHCalcTest, BesselCal,
+                                      pol, vector<shared_ptr<IEMatrix> >
+                                      (1, imats[0]), h_spol, f_spol);
+cout << "DBG at auto electro = make_shared<Ele" << endl;
+  auto electro = make_shared<ElectrostaticSAM>(statSolv, 0);
+  function<double(Pt)> pot = [electro] (Pt p) { return electro->pot_at(p);};
+  Pt cen;
+  auto grid = make_static_grid(statSys, 1.0, 12.0, pot, cen);
+  
+  // first on the grid, then off it
+  for (double gap : {6.0, 16.0})
+  {
+    vector<shared_ptr<BaseMolecule> > mols;
+    mols.push_back(make_shared<MoleculeSAM>(*rec));
+    mols.push_back(make_shared<MoleculeSAM>(*lig));
+    mols[1]->rotate(Quat(0.7, Pt(0.3, -0.5, 1.0)));
+    mols[1]->translate(Pt(recR + 2.0 + gap, 0.5, 0.3) - mols[1]->get_cog(),
+                       1e14);
+cout << "DBG at auto sys = make_shared<SystemS" << endl;
+    auto sys = make_shared<SystemSAM>(mols);
+    
+cout << "DBG at auto solv = make_shared<Solver" << endl;
+    auto solv = make_shared<Solver>(sys, cst, SHCalcTest, BesselCal, pol,
+                                    imats, h_spol, f_spol);
+    solv->solve(1e-15, 200);
+cout << "DBG at auto gsolv" << endl;
+    auto gsolv = make_shared<GradSolver>(sys, cst, SHCalcTest, BesselCal,
+                                         solv->get_T(), solv->get_all_F(),
+                                         solv->get_all_H(), solv->get_IE(),
+                                         solv->get_interpol_list(),
+                                         solv->get_precalc_sh(), _expcons,
+                                         pol, false, solv->get_quad());
+cout << "DBG gsolve" << endl;
+    gsolv->solve(1e-16, 200);
+cout << "DBG at PhysCalcSAM full" << endl;
+    PhysCalcSAM full(solv, gsolv, "");
+    full.calc_force();
+    full.calc_torque();
+    full.calc_energy();
+    for (int sgn : {-1, 1})
+    {
+      vector<shared_ptr<BaseMolecule> > m2;
+      m2.push_back(make_shared<MoleculeSAM>(*rec));
+      m2.push_back(make_shared<MoleculeSAM>(*dynamic_pointer_cast<MoleculeSAM>(mols[1])));
+      m2[1]->translate(Pt(sgn*0.01, 0, 0), 1e14);
+      auto s2 = make_shared<SystemSAM>(m2);
+      auto sv = make_shared<Solver>(s2, cst, SHCalcTest, BesselCal, pol, imats, h_spol, f_spol);
+      sv->solve(1e-15, 200);
+      auto gs = make_shared<GradSolver>(s2, cst, SHCalcTest, BesselCal, sv->get_T(), sv->get_all_F(), sv->get_all_H(), sv->get_IE(), sv->get_interpol_list(), sv->get_precalc_sh(), _expcons, pol, false, sv->get_quad());
+      PhysCalcSAM pc(sv, gs, "");
+      pc.calc_energy();
+      cout << "DBG E " << sgn << " " << pc.get_omegai(0) << " " << pc.get_omegai(1) << endl;
+    }
+    cout << "DBG E0 " << full.get_omegai(0) << " " << full.get_omegai(1) << endl;
+    
+    EXPECT_EQ( gap < 12.0, grid->contains(sys->get_cogi(1)));
+cout << "DBG at GridPhysCalc gcalc(" << endl;
+    GridPhysCalc gcalc( sys, grid, pot, cen, vector<int> (1, 1), true, cst,
+                       "");
+    gcalc.calc_force();
+    for (int i=0;i<2;i++) cout << "DBG " << gap << " F " << full.get_forcei(i).x() << " " << full.get_forcei(i).y() << " " << full.get_forcei(i).z() << " T " << full.get_taui(i).x() << " " << full.get_taui(i).y() << " " << full.get_taui(i).z() << " gF " << gcalc.get_forcei(i).x() << " " << gcalc.get_forcei(i).y() << " " << gcalc.get_forcei(i).z() << " gT " << gcalc.get_taui(i).x() << " " << gcalc.get_taui(i).y() << " " << gcalc.get_taui(i).z() << endl;
+    EXPECT_NEAR( gcalc.get_forcei(1).x()/full.get_forcei(1).x(), 1, 0.05);
+    EXPECT_NEAR( gcalc.get_taui(1).z()/full.get_taui(1).z(), 1, 0.2);
+    EXPECT_EQ( 0.0, gcalc.get_forcei(0).norm());
+  }
+}
+
 #endif /* EnergyForceUnitTest_h */
@@ -436,6 +436,144 @@ TEST_F(SolverUTest, IMATTestImatOrig)
 }
 
 
+TEST_F(SolverUTest, IMATAdaptiveQuad)
+{
+  int pol = 5;
+  PQRFile pqr(test_dir_loc + "test_zund.pqr");
+  auto mol = make_shared<MoleculeSAM>(0, 0, "stat", pqr.get_charges(),
+                                   pqr.get_atom_pts(), pqr.get_radii(),
+                                   pqr.get_cg_centers(), pqr.get_cg_radii());
+  auto _SHConstTest = make_shared<SHCalcConstants> (2*pol);
+  auto SHCalcTest = make_shared<SHCalc> (2*pol, _SHConstTest);
+  auto _expcons = make_shared<ExpansionConstants> (pol);
+  int nunif = 250000;
+  IEMatrix ieUnif(0, mol, SHCalcTest, pol, _expcons, false, nunif);
+  ieUnif.calc_vals(mol, SHCalcTest);
+  IEMatrix ieAdapt(0, mol, SHCalcTest, pol, _expcons, false,
+                   Constants::IMAT_GRID, false, IEMatrix::ADAPTIVE);
+  ieAdapt.calc_vals(mol, SHCalcTest);
+  
+  IEMatrix ieFine(0, mol, SHCalcTest, pol, _expcons, false, 4*nunif);
+  ieFine.calc_vals(mol, SHCalcTest);
+  
+  // same integrals as the dense uniform grids, from far fewer points
+  vector<Pt> dirs;
+  vector<double> wts;
+  for (int k = 0; k < mol->get_ns(); k++)
+  {
+    IEMatrix::adaptive_quad_pts(mol, k, pol, dirs, wts);
+    EXPECT_LT( dirs.size(), nunif/4);
+    ASSERT_EQ( ieUnif.get_IE_k(k).get_nrows(),
+               ieAdapt.get_IE_k(k).get_nrows());
+    ASSERT_EQ( ieUnif.get_IE_k(k).get_ncols(),
+               ieAdapt.get_IE_k(k).get_ncols());
+    for (int i = 0; i < pol*pol*pol*pol; i++)
+    {
+      EXPECT_NEAR( ieUnif.get_IE_k_ind(k, i), ieAdapt.get_IE_k_ind(k, i),
+                  5e-4);
+      EXPECT_NEAR( ieFine.get_IE_k_ind(k, i), ieAdapt.get_IE_k_ind(k, i),
+                  1e-4);
+    }
+  }
+  
+  // a lone sphere is all exposed and its IE is the identity
+  vector<Pt> one = {Pt(0.0, 0.0, 0.0)};
+  auto lone = make_shared<MoleculeSAM>(0, 0, "stat", vector<double> {1.0},
+                                       one, vector<double> {1.0}, one,
+                                       vector<double> {3.0});
+  IEMatrix ieLone(0, lone, SHCalcTest, pol, _expcons, false,
+                  Constants::IMAT_GRID, false, IEMatrix::ADAPTIVE);
+  ieLone.calc_vals(lone, SHCalcTest);
+  MyMatrix<double> ie = ieLone.get_IE_k(0);
+  for (int i = 0; i < pol*pol; i++)
+    for (int j = 0; j < pol*pol; j++)
+      EXPECT_NEAR( (i == j) ? 1.0 : 0.0, ie(i, j), 1e-5);
+}
+
+TEST_F(SolverUTest, IMATStore)
+{
+  int pol = 3;
+  PQRFile pqr(test_dir_loc + "test_zund.pqr");
+  auto mol = make_shared<MoleculeSAM>(0, 0, "stat", pqr.get_charges(),
+                                   pqr.get_atom_pts(), pqr.get_radii(),
+                                   pqr.get_cg_centers(), pqr.get_cg_radii());
+  auto _SHConstTest = make_shared<SHCalcConstants> (2*pol);
+  auto SHCalcTest = make_shared<SHCalc> (2*pol, _SHConstTest);
+  auto _expcons = make_shared<ExpansionConstants> (pol);
+  IEMatrix ieMatTest(0, mol, SHCalcTest, pol, _expcons, false, 200);
+  ieMatTest.calc_vals(mol, SHCalcTest);
+  
+  string fil = test_dir_loc + "imat_test/store_test.imat";
+  ieMatTest.write_store(fil, mol);
+  
+  // same order: matrices are used in place from the aligned mapping
+  {
+    auto store = IMatStore::open(fil);
+    ASSERT_EQ( store, IMatStore::open(fil));
+    ASSERT_EQ( pol, store->get_p());
+    ASSERT_EQ( mol->get_ns(), store->get_ns());
+    IEMatrix ieRead(0, mol, SHCalcTest, pol, _expcons, false, 0);
+    ieRead.init_from_store(store, mol);
+    for (int k = 0; k < mol->get_ns(); k++)
+    {
+      EXPECT_EQ( 0, (size_t) store->get_block(k) % IMatStore::ALIGN);
+      EXPECT_EQ( store->get_block(k), ieRead.get_IE_k_ptr(k));
+      EXPECT_NEAR( mol->get_ak(k), store->get_radius(k), preclim);
+      for (int i = 0; i < pol*pol*pol*pol; i++)
+        EXPECT_EQ( ieMatTest.get_IE_k_ind(k, i), ieRead.get_IE_k_ind(k, i));
+    }
+    
+    // lower order: leading corner of each block
+    int pl = pol-1;
+    auto _expconsl = make_shared<ExpansionConstants> (pl);
+    IEMatrix ieLow(0, mol, SHCalcTest, pl, _expconsl, false, 0);
+    ieLow.init_from_store(store, mol);
+    for (int k = 0; k < mol->get_ns(); k++)
+      for (int r = 0; r < pl*pl; r++)
+        for (int c = 0; c < pl*pl; c++)
+          EXPECT_EQ( ieMatTest.get_IE_k_ind(k, r*pol*pol+c),
+                    ieLow.get_IE_k_ind(k, r*pl*pl+c));
+    
+    // wrong molecule
+    vector<Pt> one = {Pt(0.0, 0.0, 0.0)};
+    auto lone = make_shared<MoleculeSAM>(0, 0, "stat", vector<double> {1.0},
+                                         one, vector<double> {1.0}, one,
+                                         vector<double> {3.0});
+    IEMatrix ieLone(0, lone, SHCalcTest, pol, _expcons, false, 0);
+    EXPECT_THROW( ieLone.init_from_store(store, lone), BadIMatStoreException);
+  }
+  
+  // a damaged header or index fails on open, a damaged block on verify
+  string bad = test_dir_loc + "imat_test/store_bad.imat";
+  ifstream fin(fil.c_str(), ios::binary);
+  string bytes((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+  size_t stride = (pol*pol*pol*pol*sizeof(double) + IMatStore::ALIGN-1)
+                  / IMatStore::ALIGN * IMatStore::ALIGN;
+  int last = (int) (bytes.size() - stride);  // first byte of the last block
+  for (int pos : {(int) sizeof(IMatStore::Header) + 1, last})
+  {
+    string dmg = bytes;
+    dmg[pos] ^= 1;
+    ofstream fout(bad.c_str(), ios::binary);
+    fout << dmg;
+    fout.close();
+    if (pos < last)
+    {
+      EXPECT_THROW( IMatStore st(bad), BadIMatStoreException);
+    } else
+    {
+      IMatStore st(bad);
+      EXPECT_NO_THROW( st.verify(0));
+      EXPECT_THROW( st.verify(), BadIMatStoreException);
+      EXPECT_THROW( st.verify(mol->get_ns()-1), BadIMatStoreException);
+    }
+  }
+  EXPECT_NO_THROW( IMatStore(fil).verify());
+  
+  remove(fil.c_str());
+  remove(bad.c_str());
+}
+
 TEST_F(SolverUTest, Efix_test)
 {
   int pol = 5;
@@ -814,6 +952,66 @@ TEST_F(SolverUTest, mutual_pol_test)
 }
 
 
+// E and LE of a rotated copy are rotated from the stored expansion of the
+// first molecule of its type and match an expansion from its charges
+TEST_F(SolverUTest, ELE_rotated_copy_test)
+{
+  int pol(3), nmol(2);
+  PQRFile pqr(test_dir_loc + "test_cged.pqr");
+  vector<shared_ptr<BaseMolecule> > mols;
+  for (int i=0; i<nmol; i++)
+    mols.push_back(make_shared<MoleculeSAM>(0, 0, "stat", pqr.get_charges(),
+                                         pqr.get_atom_pts(), pqr.get_radii(),
+                                         pqr.get_cg_centers(),
+                                         pqr.get_cg_radii()));
+  mols[1]->rotate(Quat(1.1, Pt(0.2, -0.7, 0.4)));
+  for (int i=0; i<nmol; i++)
+    mols[i]->translate(Pt(20.0*i, 0.0, 0.0) - mols[i]->get_cog(), 1e14);
+  auto sys = make_shared<SystemSAM>(mols);
+  auto cst = make_shared<Constants> ();
+  cst->set_dielectric_water(80);
+  cst->set_dielectric_prot(4);
+  cst->set_salt_concentration(0.01);
+  cst->set_temp(298.15);
+  cst->set_kappa(0.0325628352);
+  
+  auto _SHConstTest = make_shared<SHCalcConstants> (2*pol);
+  auto SHCalcTest = make_shared<SHCalc> (2*pol, _SHConstTest);
+  auto BesselCons = make_shared<BesselConstants> (2*pol);
+  auto BesselCal = make_shared<BesselCalc>(2*pol, BesselCons);
+  
+  Solver solvTest( sys, cst, SHCalcTest, BesselCal, pol);
+  
+  // and again after both rotate, as in a BD step
+  for (int step = 0; step < 2; step++)
+  {
+    for (int i = 0; i < sys->get_n(); i++)
+    {
+      int ns = sys->get_Ns_i(i);
+      EMatrix emat(i, ns, pol);
+      LEMatrix lemat(i, ns, pol);
+      emat.calc_vals(sys->get_moli(i), SHCalcTest, cst->get_dielectric_prot());
+      lemat.calc_vals(sys->get_moli(i), SHCalcTest, cst->get_dielectric_prot());
+      for (int k = 0; k < ns; k++)
+      {
+        for (int n = 0; n < pol; n++)
+        {
+          for (int m = -n; m <= n; m++)
+          {
+            cmplx e = solvTest.get_all_E()[i]->get_mat_knm(k, n, m);
+            cmplx le = solvTest.get_all_LE()[i]->get_mat_knm(k, n, m);
+            EXPECT_NEAR(abs(emat.get_mat_knm(k, n, m) - e), 0, preclim);
+            EXPECT_NEAR(abs(lemat.get_mat_knm(k, n, m) - le), 0, preclim);
+          }
+        }
+      }
+    }
+    sys->rotate_mol(0, Quat(0.4, Pt(1.0, 1.0, 0.0)));
+    sys->rotate_mol(1, Quat(-0.8, Pt(0.0, 0.3, 1.0)));
+    solvTest.reset_all();
+  }
+}
+
 TEST_F(SolverUTest, grad_pre_test)
 {
   int pol(3), nmol(2);
@@ -10,6 +10,7 @@
 #define SystemUnitTest_h
 
 #include "SystemSAM.h"
+#include "PoseTrajectory.h"
 
 class CGSphereUTest : public ::testing::Test
 {
@@ -289,6 +290,83 @@ TEST_F(MoleculeSAMUTest, rotate2)
   }
 }
 
+// With MSMS coarse-graining a charge can be listed under two spheres. It must
+// still be rotated once, and the center of geometry must move with it
+TEST_F(MoleculeSAMUTest, rotateSharedCharges)
+{
+  int i, k, nlisted(0);
+  PQRFile pqr(test_dir_loc + "test.pqr");
+  MSMSFile surf_file (test_dir_loc + "test.vert");
+  MoleculeSAM molNew( 0, 0, "stat", pqr.get_charges(),
+                     pqr.get_atom_pts(), pqr.get_radii(),
+                     surf_file.get_sp(), surf_file.get_np(), 2.5);
+  for (k = 0; k < molNew.get_ns(); k++) nlisted += molNew.get_nc_k(k);
+  ASSERT_GT(nlisted, molNew.get_nc());
+  
+  vector<Pt> before(molNew.get_nc());
+  for (i = 0; i < molNew.get_nc(); i++)
+    before[i] = molNew.get_posj_realspace(i);
+  Pt cog0 = molNew.get_cog();
+  
+  Quat qrot( 1.0, Pt(1.0, 1.0, 1.0));
+  molNew.rotate( qrot );
+  
+  Pt mean(0.0, 0.0, 0.0);
+  for (i = 0; i < molNew.get_nc(); i++)
+  {
+    Pt ref = qrot.rotate_point(before[i]);
+    Pt now = molNew.get_posj_realspace(i);
+    EXPECT_NEAR( ref.x(), now.x(), preclim);
+    EXPECT_NEAR( ref.y(), now.y(), preclim);
+    EXPECT_NEAR( ref.z(), now.z(), preclim);
+    mean = mean + now;
+  }
+  mean = mean * (1.0/(double) molNew.get_nc());
+  
+  Pt cog = molNew.get_cog();
+  Pt ref = qrot.rotate_point(cog0);
+  EXPECT_NEAR( ref.x(), cog.x(), preclim);
+  EXPECT_NEAR( ref.y(), cog.y(), preclim);
+  EXPECT_NEAR( ref.z(), cog.z(), preclim);
+  EXPECT_NEAR( mean.x(), cog.x(), preclim);
+  EXPECT_NEAR( mean.y(), cog.y(), preclim);
+  EXPECT_NEAR( mean.z(), cog.z(), preclim);
+}
+
+TEST_F(MoleculeSAMUTest, copySharesTypeData)
+{
+  PQRFile pqr(test_dir_loc + "test_1BRS_cg.pqr");
+  MoleculeSAM molNew( 0, 0, "stat", pqr.get_charges(),
+                  pqr.get_atom_pts(), pqr.get_radii(),
+                  pqr.get_cg_centers(), pqr.get_cg_radii());
+  MoleculeSAM molCpy(molNew);
+  MoleculeSAM molOth( 0, 1, "stat", pqr.get_charges(),
+                  pqr.get_atom_pts(), pqr.get_radii(),
+                  pqr.get_cg_centers(), pqr.get_cg_radii());
+  EXPECT_TRUE(molCpy.shares_type_data(molNew));
+  EXPECT_FALSE(molOth.shares_type_data(molNew));
+  
+  // grids set on one copy are seen by the other
+  molNew.set_gridj(0, {Pt(1.0, 2.0, 3.0)});
+  ASSERT_EQ(1, molCpy.get_gridj(0).size());
+  EXPECT_NEAR(2.0, molCpy.get_gridjh(0, 0).y(), preclim);
+  EXPECT_EQ(0, molOth.get_gridj(0).size());
+  
+  // while the pose stays per copy
+  molCpy.rotate( Quat( M_PI/2, Pt(0.0, 0.0, 1.0)));
+  molCpy.translate( Pt(5.0, 0.0, 0.0), 1e5);
+  for (int i=0; i<molNew.get_nc(); i+=40)
+  {
+    Pt orig = molNew.get_posj_realspace(i);
+    Pt moved = molCpy.get_posj_realspace(i);
+    EXPECT_NEAR(-orig.y() + 5.0, moved.x(), preclim);
+    EXPECT_NEAR( orig.x(), moved.y(), preclim);
+    EXPECT_NEAR( orig.z(), moved.z(), preclim);
+  }
+  for (int k=0; k<molNew.get_ns(); k++)
+    EXPECT_EQ(molNew.get_nc_k(k), molCpy.get_nc_k(k));
+}
+
 class SystemUTest : public ::testing::Test
 {
 public :
@@ -524,5 +602,104 @@ TEST_F(SystemUTest, PBCcheck)
   EXPECT_NEAR( -48.79/dis12.z(), 1.0, preclim);
 }
 
+// Poses written to a trajectory regenerate every atom and sphere center
+TEST_F(SystemUTest, poseTrajectory)
+{
+  double boxl = 180.0;
+  vector<shared_ptr<BaseMolecule> > mol_;
+  Pt pos[3] = { Pt(0.0,0.0,0.0), Pt(70.0,70.0,70.0), Pt(-65.3,-68.2,-61.21)};
+  int type[3] = {0, 0, 1}, tidx[3] = {0, 1, 0};
+  PQRFile pqr(test_dir_loc + "test_1BRS_cg.pqr");
+  for (int molInd = 0; molInd < 3; molInd ++ )
+  {
+    mol_.push_back(make_shared<MoleculeSAM>(type[molInd], tidx[molInd], "stat",
+                                            pqr.get_charges(),
+                                            pqr.get_atom_pts(), pqr.get_radii(),
+                                            pqr.get_cg_centers(),
+                                            pqr.get_cg_radii()));
+    mol_[molInd]->translate(mol_[molInd]->get_cog()*(-1), boxl);
+    mol_[molInd]->rotate(Quat(0.4*molInd, Pt(1.0, -2.0, 0.5)));
+    mol_[molInd]->translate(pos[molInd], boxl);
+  }
+  auto sys = make_shared<SystemSAM>(mol_, 75.0, boxl);
+  
+  string fil[2] = {test_dir_loc+"pose_dbl.ptraj", test_dir_loc+"pose_flt.ptraj"};
+  vector<vector<Pt> > lab(2);  // atoms then centers of every molecule
+  {
+    PoseTrajWriter wdbl(fil[0], sys, {"a.pqr", "b.pqr"}, false);
+    PoseTrajWriter wflt(fil[1], sys, {"a.pqr", "b.pqr"}, true, 64);
+    for (int f = 0; f < 2; f++)
+    {
+      if (f > 0)
+      {
+        sys->rotate_mol(1, Quat(1.3, Pt(0.0, 1.0, 1.0)));
+        sys->translate_mol(1, Pt(30.0, 25.0, -20.0)); // across the box edge
+        sys->rotate_mol(2, Quat(-0.7, Pt(1.0, 0.0, 0.0)));
+        sys->set_time(2.5);
+      }
+      wdbl.write_frame(200*f, {-1.0*f, 0.5, 2.0});
+      wflt.write_frame(200*f, {-1.0*f, 0.5, 2.0});
+      for (int i = 0; i < 3; i++)
+      {
+        for (int j = 0; j < sys->get_Nc_i(i); j++)
+          lab[f].push_back(sys->get_posijreal(i, j));
+        for (int k = 0; k < sys->get_Ns_i(i); k++)
+          lab[f].push_back(sys->get_centerik(i, k));
+      }
+    }
+  }
+  
+  for (int p = 0; p < 2; p++)
+  {
+    PoseTrajReader traj(fil[p]);
+    double tol = (p == 0) ? 1e-9 : 1e-4;
+    ASSERT_EQ( 2, traj.get_nframes());
+    EXPECT_EQ( 2, traj.get_ntype());
+    EXPECT_EQ( "b.pqr", traj.get_type_ref(1).pqr);
+    EXPECT_EQ( 1, traj.get_type(2));
+    for (int f = 0; f < 2; f++)
+    {
+      PoseTrajectory::Frame fr = traj.get_frame(f);
+      vector<Pt> atoms, cens;
+      EXPECT_EQ( 200*f, fr.step);
+      EXPECT_NEAR( 2.5*f, fr.t, preclim);
+      EXPECT_NEAR( -1.0*f, fr.energy[0], preclim);
+      int ct = 0;
+      for (int i = 0; i < 3; i++)
+      {
+        traj.expand(fr, i, atoms, cens);
+        atoms.insert(atoms.end(), cens.begin(), cens.end());
+        for (int j = 0; j < atoms.size(); j++, ct++)
+        {
+          EXPECT_NEAR( lab[f][ct].x(), atoms[j].x(), tol);
+          EXPECT_NEAR( lab[f][ct].y(), atoms[j].y(), tol);
+          EXPECT_NEAR( lab[f][ct].z(), atoms[j].z(), tol);
+        }
+      }
+      EXPECT_EQ( lab[f].size(), ct);
+    }
+  }
+  
+  // expanded frame is what the system writes, and a cut frame is ignored
+  string xfil = test_dir_loc + "pose_sys.xyz";
+  ofstream xout(xfil.c_str());
+  sys->write_to_xyz(xout);
+  xout.close();
+  ifstream xin(xfil.c_str());
+  stringstream sysxyz, trajxyz;
+  sysxyz << xin.rdbuf();
+  PoseTrajReader(fil[0]).write_xyz(trajxyz, 1);
+  EXPECT_EQ( sysxyz.str(), trajxyz.str());
+  
+  ofstream cut(fil[0].c_str(), ofstream::binary | ofstream::app);
+  cut << "partial";
+  cut.close();
+  EXPECT_EQ( 2, PoseTrajReader(fil[0]).get_nframes());
+  
+  remove(fil[0].c_str());
+  remove(fil[1].c_str());
+  remove(xfil.c_str());
+}
+
 
 #endif /* SystemUnitTest_h */
@@ -25,8 +25,8 @@ class TMatrixUTest : public ::testing::Test
   
   vector<vector<vector<vector<double> > > > Hin = {{{{-0.00585,-0.0111658741,0.0508634184,-0.052510966,-0.00503811243,-0.0326385457,0.00908195863,-0.0165499472,0.00417366401,-0.043845211,0.020661115,0.00372575487,0.0110565917,0.00663396028,-0.0150460049}, {0.0,0.0,0.0882629907,0.0,-0.00874260686,0.0563207937,0.0,-0.0287190261,-0.00720203871,-0.000106503325,0.0,0.00646528051,-0.0190791595,1.61143899e-05,-0.026256467}}, {{-0.2011,0,0,0,0,0,0,0,0,0,0,0,0,0,0}, {0.0,0.0,0,0.0,0,0,0.0,0,0,0,0.0,0,0,0,0}}}, {{{0.00438225415,0.000184416296,0.00285261912,-0.000896306288,0.00109196276,0.000558332113,5.89605634e-05,-7.61231311e-05,0.00119903431,6.96383244e-05,-0.0004028978,0.000115874699,-0.000167683669,0.00136333431,     0.000640611311},{0.0,0.0,-0.000680999907,0.0,0.00124067469,-0.00103087442,0.0,0.000441185826,0.000863508264,0.000234523443,0.0,-0.000365710005,0.000678223951,0.000253506416,9.38494831e-05}}}};
   
-  vector<vector<vector<double> > > Hout_re = {{{0.000782700702,-0.000791370539,-0.000240787154,0.000315397505,0.000271212625,0.00011115778,-3.46729293e-05,-0.000140086331,-8.64384885e-05,-3.8480857e-05,-3.27199469e-05,3.88124732e-05,4.20893571e-05,2.30189355e-05,9.23807324e-06,},{-0.0126186235,0.00429416833,0.00249780646,-0.000663089408,-0.00112838681,-0.000368626104,-6.40250261e-05,0.000324370933,0.000210481912,3.40662188e-05,8.71256387e-05,-5.19089875e-05,-8.00924331e-05,-2.29175302e-05,3.34503709e-06,}},{{0.000219711312,2.4359843e-05,1.56976434e-05,3.9595817e-07,2.39467155e-06,-9.55848593e-08,-2.49210848e-07,2.15893926e-07,4.31303632e-08,-1.31529139e-07,-4.87608466e-08,4.58566939e-09,2.37357946e-08,-2.21373536e-08,-1.22779539e-08,}}};
-  vector<vector<vector<double> > > Hout_im = {{{0,0,0.000128274702,0,5.0240829e-05,-2.13656528e-05,0,-5.82794396e-05,-4.13222261e-05,-1.07636756e-05,0,2.25209434e-05,3.99603276e-05,2.35503497e-05,9.11933724e-06,},{0,0,0.00113296594,0,-0.000511818607,-0.000421027815,0,0.000147129582,0.000240402779,0.00011279649,0,-2.35451048e-05,-9.14779007e-05,-7.58821218e-05,-2.50925929e-05,}},{{0,0,-1.4608819e-05,0,-1.8946681e-06,-1.86630436e-06,0,-7.42577582e-08,-3.4554469e-07,-9.07496691e-08,0,2.28743061e-08,-3.94441672e-08,-2.99867886e-08,3.41056879e-09,}}};
+  vector<vector<vector<double> > > Hout_re = {{{0.000782700702,-0.000792437963,-0.000237056708,0.000316210766,0.000270921048,0.00011119593,-3.48841386e-05,-0.000140138333,-8.64612376e-05,-3.85566785e-05,-3.26890895e-05,3.88467476e-05,4.21021748e-05,2.30463026e-05,9.25955926e-06,},{-0.0126186235,0.00429416833,0.00249780646,-0.000663089408,-0.00112838681,-0.000368626104,-6.40250261e-05,0.000324370933,0.000210481912,3.40662188e-05,8.71256387e-05,-5.19089875e-05,-8.00924331e-05,-2.29175302e-05,3.34503709e-06,}},{{0.000219711312,2.4359843e-05,1.56976434e-05,3.9595817e-07,2.39467155e-06,-9.55848593e-08,-2.49210848e-07,2.15893926e-07,4.31303632e-08,-1.31529139e-07,-4.87608466e-08,4.58566939e-09,2.37357946e-08,-2.21373536e-08,-1.22779539e-08,}}};
+  vector<vector<vector<double> > > Hout_im = {{{0,0,0.000134908867,0,4.95654201e-05,-2.22578895e-05,0,-5.82535738e-05,-4.11309119e-05,-1.06512628e-05,0,2.25385258e-05,3.99376867e-05,2.3515181e-05,9.10947567e-06,},{0,0,0.00113296594,0,-0.000511818607,-0.000421027815,0,0.000147129582,0.000240402779,0.00011279649,0,-2.35451048e-05,-9.14779007e-05,-7.58821218e-05,-2.50925929e-05,}},{{0,0,-1.4608819e-05,0,-1.8946681e-06,-1.86630436e-06,0,-7.42577582e-08,-3.4554469e-07,-9.07496691e-08,0,2.28743061e-08,-3.94441672e-08,-2.99867886e-08,3.41056879e-09,}}};
   
 };
 
@@ -160,4 +160,187 @@ TEST_F(TMatrixUTest, xforIntra_analytic_test)
   }
 }
 
+// surface quadrature tables reproduce the point by point LH and
+// numerical re-expansion
+TEST_F(TMatrixUTest, surface_quad_test)
+{
+  int pol = 5;
+  double kap = 0.21053961;
+  PQRFile pqr(test_dir_loc + "test_cged.pqr");
+  vector<shared_ptr<BaseMolecule> > mols;
+  mols.push_back(make_shared<MoleculeSAM>(0, 0, "stat", pqr.get_charges(),
+                                     pqr.get_atom_pts(), pqr.get_radii(),
+                                     pqr.get_cg_centers(), pqr.get_cg_radii()));
+  auto sys = make_shared<SystemSAM>(mols);
+  
+  auto cst = make_shared<Constants> ();
+  auto _SHConstTest = make_shared<SHCalcConstants> (2*pol);
+  auto SHCalcTest = make_shared<SHCalc> (2*pol, _SHConstTest);
+  auto BesselCons = make_shared<BesselConstants> (2*pol);
+  auto BesselCal = make_shared<BesselCalc>(2*pol, BesselCons);
+  auto _expcons = make_shared<ExpansionConstants> (pol);
+  
+  IEMatrix ieMatTest(0, sys->get_moli(0), SHCalcTest, pol,
+                     _expcons, true, 0, true);
+  auto ReExp = make_shared<ReExpCoeffsConstants>(kap,sys->get_lambda(),pol);
+  auto tmat = make_shared<TMatrix>(pol, sys, SHCalcTest, cst, BesselCal,
+                                   ReExp);
+  SurfaceQuad quad(0, sys->get_moli(0), tmat, SHCalcTest, BesselCal,
+                   _expcons, pol, kap);
+  
+  auto hmat = make_shared<HMatrix>(0, sys->get_Ns_i(0), pol, kap);
+  hmat->init(sys->get_moli(0), SHCalcTest, 4.0);
+  shared_ptr<PreCalcSH> precalc_sh = make_shared<PreCalcSH>();
+  LHMatrix lhmt(0, sys->get_Ns_i(0), pol, kap), lhquad(0, sys->get_Ns_i(0),
+                                                       pol, kap);
+  lhmt.init(sys->get_moli(0), hmat, SHCalcTest, BesselCal, precalc_sh,
+            _expcons, true);
+  lhquad.init(hmat, quad);
+  
+  for (int k = 0; k < sys->get_Ns_i(0); k++)
+  {
+    ASSERT_EQ(lhmt.get_mat_k_len(k), lhquad.get_mat_k_len(k));
+    for (int h = 0; h < lhmt.get_mat_k_len(k); h++)
+      EXPECT_NEAR(lhmt.get_mat_kh(k, h), lhquad.get_mat_kh(k, h), preclim);
+  }
+  
+  vector<double> x;
+  MyMatrix<cmplx> out(pol, 2*pol+1);
+  int npair = 0;
+  for (int k = 0; k < sys->get_Ns_i(0); k++)
+  {
+    for (int j = 0; j < sys->get_Ns_i(0); j++)
+    {
+      if ((j == k) || tmat->is_analytic(0, k, 0, j)) continue;
+      ASSERT_TRUE(quad.has_pair(k, j));
+      npair++;
+      for (int scr = 0; scr < 2; scr++)
+      {
+        MyMatrix<cmplx> ref = tmat->re_expandX_numeric(lhmt.get_mat(), 0, k,
+                                                       0, j, scr*kap,
+                                                       precalc_sh, true);
+        quad.project(k, j, lhmt.get_mat()[j], x, scr == 1);
+        quad.unpack(x, out);
+        for (int n = 0; n < pol; n++)
+          for (int m = -n; m <= n; m++)
+            EXPECT_NEAR(abs(ref(n, m+pol) - out(n, m+pol)), 0, preclim);
+      }
+    }
+  }
+  EXPECT_GT(npair, 0);
+
+  // a copy of the same type shares the surface tables, and its pair tables
+  // follow rotations but not translations
+  auto shared = make_shared<SurfaceQuad>(0, sys->get_moli(0), tmat,
+                                         SHCalcTest, BesselCal, _expcons,
+                                         pol, kap,
+                                         make_shared<SurfaceQuad>(quad));
+  for (int k = 0; k < sys->get_Ns_i(0); k++)
+    EXPECT_EQ(quad.get_npts(k), shared->get_npts(k));
+  sys->get_moli(0)->translate(Pt(3.0, -2.0, 5.0), 1e14);
+  EXPECT_EQ(0, shared->update_pairs(sys->get_moli(0), SHCalcTest, BesselCal));
+  sys->get_moli(0)->rotate(Quat(1.0, Pt(1.0, 1.0, 1.0)));
+  EXPECT_EQ(npair, shared->update_pairs(sys->get_moli(0), SHCalcTest,
+                                        BesselCal));
+  SurfaceQuad fresh(0, sys->get_moli(0), tmat, SHCalcTest, BesselCal,
+                    _expcons, pol, kap);
+  vector<double> xf;
+  for (int k = 0; k < sys->get_Ns_i(0); k++)
+  {
+    for (int j = 0; j < sys->get_Ns_i(0); j++)
+    {
+      if (!fresh.has_pair(k, j)) continue;
+      fresh.project(k, j, lhmt.get_mat()[j], xf, true);
+      shared->project(k, j, lhmt.get_mat()[j], x, true);
+      ASSERT_EQ(xf.size(), x.size());
+      for (int c = 0; c < (int) x.size(); c++)
+        EXPECT_NEAR(xf[c], x[c], preclim);
+    }
+  }
+}
+
+// far pairs kept in single precision re-expand like double ones, and
+// their derivatives can still be computed afterwards
+TEST_F(TMatrixUTest, mixed_prec_test)
+{
+  int pol = 5;
+  PQRFile pqr(test_dir_loc + "test_cged.pqr");
+  vector<shared_ptr<BaseMolecule> > mols;
+  for (int i = 0; i < 2; i++)
+    mols.push_back(make_shared<MoleculeSAM>(0, i, "stat", pqr.get_charges(),
+                                     pqr.get_atom_pts(), pqr.get_radii(),
+                                     pqr.get_cg_centers(), pqr.get_cg_radii()));
+  mols[1]->translate(Pt(60.0, 0.0, 0.0), 1e48);
+  auto sys = make_shared<SystemSAM>(mols);
+  
+  auto cst = make_shared<Constants> ();
+  auto cstMix = make_shared<Constants> (*cst);
+  cstMix->set_mixed_prec_dist(30.0);
+  auto _SHConstTest = make_shared<SHCalcConstants> (2*pol);
+  auto SHCalcTest = make_shared<SHCalc> (2*pol, _SHConstTest);
+  auto BesselCons = make_shared<BesselConstants> (2*pol);
+  auto BesselCal = make_shared<BesselCalc>(2*pol, BesselCons);
+  auto ReExp = make_shared<ReExpCoeffsConstants> (cst->get_kappa(),
+                                                  sys->get_lambda(), pol);
+  
+  TMatrix tdbl( pol, sys, SHCalcTest, cst, BesselCal, ReExp);
+  TMatrix tmix( pol, sys, SHCalcTest, cstMix, BesselCal, ReExp);
+  ASSERT_EQ(tdbl.get_T_ct(), tmix.get_T_ct());
+  for (int i = 0; i < tdbl.get_T_ct(); i++)
+  {
+    tdbl.compute_derivatives_i(i);
+    tmix.compute_derivatives_i(i);
+  }
+  
+  int ct = 0;
+  MyMatrix<cmplx> hin(pol, 2*pol+1);
+  for (int n = 0; n < pol; n++)
+  {
+    for (int m = 0; m <= n; m++)
+    {
+      hin(n, m+pol) = complex<double> (Hin[0][0][0][ct], Hin[0][0][1][ct]);
+      if (m > 0) hin(n, -m+pol) = conj(hin(n, m+pol));
+      ct++;
+    }
+  }
+  
+  double mixlim = 1e-5;
+  int nsingle = 0;
+  for (int k = 0; k < sys->get_Ns_i(0); k++)
+  {
+    for (int l = 0; l < sys->get_Ns_i(1); l++)
+    {
+      if (! tdbl.is_analytic(0, k, 1, l)) continue;
+      if (tmix.get_T_Ik_Jl(0, k, 1, l)->is_single_prec()) nsingle++;
+      
+      MyMatrix<cmplx> xd = tdbl.re_expandX(hin, 0, k, 1, l);
+      MyMatrix<cmplx> xm = tmix.re_expandX(hin, 0, k, 1, l);
+      MyMatrix<Ptx> gd = tdbl.re_expandX_gradT(hin, 0, k, 1, l);
+      MyMatrix<Ptx> gm = tmix.re_expandX_gradT(hin, 0, k, 1, l);
+      double xscl(0), gscl(0);
+      for (int n = 0; n < pol; n++)
+        for (int m = -n; m <= n; m++)
+        {
+          xscl = max(xscl, abs(xd(n, m+pol)));
+          gscl = max(gscl, max(abs(gd(n, m+pol).x()),
+                               max(abs(gd(n, m+pol).y()),
+                                   abs(gd(n, m+pol).z()))));
+        }
+      
+      for (int n = 0; n < pol; n++)
+        for (int m = -n; m <= n; m++)
+        {
+          EXPECT_NEAR(abs(xm(n, m+pol) - xd(n, m+pol))/xscl, 0, mixlim);
+          EXPECT_NEAR(abs(gm(n, m+pol).x() - gd(n, m+pol).x())/gscl, 0,
+                      mixlim);
+          EXPECT_NEAR(abs(gm(n, m+pol).y() - gd(n, m+pol).y())/gscl, 0,
+                      mixlim);
+          EXPECT_NEAR(abs(gm(n, m+pol).z() - gd(n, m+pol).z())/gscl, 0,
+                      mixlim);
+        }
+    }
+  }
+  EXPECT_GT(nsingle, 0);
+}
+
 #endif /* TMatrixUnitTest_h */